@@ -0,0 +1,60 @@
+#if !defined(BINDLESS_GLSL)
+#define BINDLESS_GLSL
+
+//Global descriptor heap of the bindless mode, shared with BindlessDescriptorHeap on the cpp side
+#define BINDLESS_SET             4
+#define BINDLESS_TEXTURE_BINDING 0
+#define BINDLESS_SCENE_BINDING   1
+#define MAX_BINDLESS_TEXTURES    4096
+
+#if defined(__cplusplus)
+#include <cstdint>
+#define BUFFER_REFERENCE(type) uint64_t
+#else
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+#include "gltfMaterial.glsl"
+#include "perFrame.glsl"
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer GltfMaterialBuffer {
+    GltfMaterial materials[];
+};
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer PrimitiveInfoBuffer {
+    PerPrimitive infos[];
+};
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer UintBuffer {
+    uint values[];
+};
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer FloatBuffer {
+    float values[];
+};
+#define BUFFER_REFERENCE(type) type
+#endif
+
+//Device addresses of the scene buffers, written once when the scene is set on the view
+struct BindlessSceneAddresses
+{
+    BUFFER_REFERENCE(GltfMaterialBuffer) materials;
+    BUFFER_REFERENCE(PrimitiveInfoBuffer) primitive_infos;
+    BUFFER_REFERENCE(UintBuffer) indices;
+    BUFFER_REFERENCE(FloatBuffer) positions;
+    BUFFER_REFERENCE(FloatBuffer) normals;
+    BUFFER_REFERENCE(FloatBuffer) texcoords;
+    uint index_type_uint32;
+    uint material_count;
+    uint texture_count;
+    uint padding;
+};
+
+#if !defined(__cplusplus)
+layout(set = BINDLESS_SET, binding = BINDLESS_TEXTURE_BINDING) uniform sampler2D bindless_textures[];
+
+layout(set = BINDLESS_SET, binding = BINDLESS_SCENE_BINDING) uniform _BindlessScene {
+    BindlessSceneAddresses bindless_scene;
+};
+#endif
+
+#undef BUFFER_REFERENCE
+
+#endif
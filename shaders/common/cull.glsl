@@ -0,0 +1,62 @@
+#ifndef CULL_GLSL
+#define CULL_GLSL
+//Frustum and Hi-Z tests of world space boxes. The includer declares the cull uniform with frustum_planes, hiz_view_proj,
+//hiz_size, hiz_mip_count, inverse_depth and flip_y, and the hiz sampler holding the farthest depth pyramid
+
+bool insideFrustum(vec3 bboxMin, vec3 bboxMax) {
+    for (int i = 0; i < 6; i++) {
+        vec4 plane = cull.frustum_planes[i];
+        //Corner farthest along the plane normal
+        vec3 corner = mix(bboxMin, bboxMax, greaterThan(plane.xyz, vec3(0)));
+        if (dot(plane.xyz, corner) + plane.w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+float nearer(float a, float b) {
+    return cull.inverse_depth != 0 ? max(a, b) : min(a, b);
+}
+
+float farther(float a, float b) {
+    return cull.inverse_depth != 0 ? min(a, b) : max(a, b);
+}
+
+bool occluded(vec3 bboxMin, vec3 bboxMax) {
+    vec2  uvMin   = vec2(1.0);
+    vec2  uvMax   = vec2(0.0);
+    float nearest = cull.inverse_depth != 0 ? 0.0 : 1.0;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = vec3((i & 1) != 0 ? bboxMax.x : bboxMin.x, (i & 2) != 0 ? bboxMax.y : bboxMin.y, (i & 4) != 0 ? bboxMax.z : bboxMin.z);
+        vec4 clip   = cull.hiz_view_proj * vec4(corner, 1.0);
+        //Boxes crossing the near plane of the Hi-Z camera are kept
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv  = ndc.xy * 0.5 + 0.5;
+        if (cull.flip_y != 0)
+            uv.y = 1.0 - uv.y;
+        uvMin   = min(uvMin, uv);
+        uvMax   = max(uvMax, uv);
+        nearest = nearer(nearest, ndc.z);
+    }
+    uvMin = clamp(uvMin, vec2(0.0), vec2(1.0));
+    uvMax = clamp(uvMax, vec2(0.0), vec2(1.0));
+
+    //Level where the footprint covers at most 2x2 texels
+    vec2  footprint = (uvMax - uvMin) * vec2(cull.hiz_size);
+    int   level     = int(clamp(ceil(log2(max(max(footprint.x, footprint.y), 1.0))), 0.0, float(cull.hiz_mip_count - 1)));
+    ivec2 levelSize = max(cull.hiz_size >> level, ivec2(1));
+    ivec2 texelMin  = clamp(ivec2(uvMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+    ivec2 texelMax  = clamp(ivec2(uvMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+
+    float farthest = cull.inverse_depth != 0 ? 1.0 : 0.0;
+    for (int y = texelMin.y; y <= texelMax.y; y++)
+        for (int x = texelMin.x; x <= texelMax.x; x++)
+            farthest = farther(farthest, texelFetch(hiz, ivec2(x, y), level).r);
+
+    //Occluded when even the nearest point of the box lies behind the farthest occluder
+    return cull.inverse_depth != 0 ? nearest < farthest : nearest > farthest;
+}
+
+#endif
@@ -12,6 +12,7 @@
 #endif
 
 #include "perFrame.glsl"
+#include "virtualTexture.glsl"
 
 precision highp float;
 
@@ -53,9 +54,13 @@ layout(location = 0) out vec4 o_color;
 #endif
 
 
+#ifdef BINDLESS
+#define primitive_infos bindless_scene.primitive_infos.infos
+#else
 layout(std430, set = 0, binding = 2) buffer _GlobalPrimitiveUniform {
     PerPrimitive primitive_infos[];
 };
+#endif
 
 
 
@@ -70,7 +75,7 @@ vec3 getNormal(const int texture_idx)
     if (texture_idx <0){
         return normalize(in_normal);
     }
-    vec3 tangentNormal = texture(scene_textures[texture_idx], in_uv).xyz * 2.0 - 1.0;
+    vec3 tangentNormal = sampleSceneTexture(texture_idx, in_uv).xyz * 2.0 - 1.0;
 
     vec3 q1 = dFdx(in_world_pos);
     vec3 q2 = dFdy(in_world_pos);
@@ -106,7 +111,7 @@ void main(void)
     // This layout intentionally reserves the 'r' channel for (optional) occlusion map data
     if (material.pbrMetallicRoughnessTexture > -1)
     {
-        vec4 mrSample = texture(scene_textures[material.pbrMetallicRoughnessTexture], in_uv);
+        vec4 mrSample = sampleSceneTexture(material.pbrMetallicRoughnessTexture, in_uv);
         perceptual_roughness *= mrSample.g;
         metallic *= mrSample.b;
     }
@@ -126,7 +131,7 @@ void main(void)
     baseColor = material.pbrBaseColorFactor;
     if (material.pbrBaseColorTexture > -1)
     {
-        baseColor *= texture(scene_textures[material.pbrBaseColorTexture], in_uv);
+        baseColor *= sampleSceneTexture(material.pbrBaseColorTexture, in_uv);
     }
     diffuse_color = baseColor.rgb;
 
@@ -136,7 +141,7 @@ void main(void)
     vec3 emissionColor            = material.emissiveFactor;
     if (material.emissiveTexture > -1)
     {
-        emissionColor *= SRGBtoLinear(texture(scene_textures[material.emissiveTexture], in_uv), 2.2).rgb;
+        emissionColor *= SRGBtoLinear(sampleSceneTexture(material.emissiveTexture, in_uv), 2.2).rgb;
     }
 
 
@@ -19,9 +19,13 @@ layout (location = 3) in vec3 in_world_pos;
 
 layout (location = 0) out vec4 o_color;
 
+#ifdef BINDLESS
+#define primitive_infos bindless_scene.primitive_infos.infos
+#else
 layout(std430, set = 0, binding = 2) buffer _GlobalPrimitiveUniform {
     PerPrimitive primitive_infos[];
 };
+#endif
 
 layout(binding = 2, set=1) uniform sampler2D brdf_lut;
 layout(binding = 0, set=1) uniform samplerCube irradiance_map;
@@ -1,3 +1,6 @@
+#if !defined(PER_FRAME_GLSL)
+#define PER_FRAME_GLSL
+
 layout(set = 0, binding = 0) uniform _GlobalFrameUniform {
     mat4 view_proj;
     mat4 inv_view_proj;
@@ -46,6 +49,4 @@ vec3  worldPosFromDepth    (vec2 uv, float depth){
     return pos;
 }
 
-
-
-
+#endif
@@ -3,9 +3,17 @@
 #define MAX_SCENE_TEXTURES  1024
 #define MAX_SCENE_MATERIALS 25
 
-layout (std430, set=0, binding = 3)  buffer  MaterialBuffer 
+#ifdef BINDLESS
+//Textures live in the global heap and materials are fetched through their device address
+#include "bindless.glsl"
+
+#define scene_textures  bindless_textures
+#define scene_materials bindless_scene.materials.materials
+#else
+layout (std430, set=0, binding = 3)  buffer  MaterialBuffer
 {
     GltfMaterial scene_materials[MAX_SCENE_MATERIALS];
 };
 
-layout(set =0, binding =6) uniform sampler2D scene_textures[MAX_SCENE_TEXTURES];                         
\ No newline at end of file
+layout(set =0, binding =6) uniform sampler2D scene_textures[MAX_SCENE_TEXTURES];
+#endif
@@ -1,3 +0,0 @@
-float4 main() : SV_Target {
-    return float4(0.0f, 0.0f, 0.0f, 0.0f);
-}
\ No newline at end of file
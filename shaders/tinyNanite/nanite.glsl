@@ -0,0 +1,59 @@
+#ifndef NANITE_GLSL
+#define NANITE_GLSL
+//Cooked cluster DAG as uploaded from NaniteMesh.h, every struct follows the std430 layout of its c++ counterpart
+
+#include "tinyNanite.h"
+
+struct NaniteVertex {
+    vec3  position;
+    float u;
+    vec3  normal;
+    float v;
+};
+
+struct NaniteCluster {
+    vec3  bounds_min;
+    uint  vertex_offset;
+    vec3  bounds_max;
+    //In triangles, indices are local to the vertices of the cluster
+    uint  triangle_offset;
+    vec4  lod_bounds;
+    uint  vertex_count;
+    uint  triangle_count;
+    uint  group_index;
+    uint  generating_group_index;
+    float lod_error;
+    float parent_lod_error;
+    uint  mip_level;
+    uint  padding;
+};
+
+struct NaniteClusterGroup {
+    vec3  bounds_min;
+    float lod_error;
+    vec3  bounds_max;
+    float padding;
+    vec4  lod_bounds;
+    uint  cluster_offset;
+    uint  cluster_count;
+    uint  mip_level;
+    uint  padding1;
+};
+
+struct NaniteHierarchyNode {
+    vec4 lod_bounds[NANITE_MAX_BVH_NODE_FANOUT];
+    //w holds the min lod error of the subtree
+    vec4 bounds_min[NANITE_MAX_BVH_NODE_FANOUT];
+    //w holds the max lod error of the subtree
+    vec4 bounds_max[NANITE_MAX_BVH_NODE_FANOUT];
+    uint children[NANITE_MAX_BVH_NODE_FANOUT];
+};
+
+struct NaniteInstance {
+    mat4 model;
+    //World space box of the whole mesh, w of bounds_min holds the largest scale of the model matrix
+    vec4 bounds_min;
+    vec4 bounds_max;
+};
+
+#endif
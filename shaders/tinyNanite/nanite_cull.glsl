@@ -0,0 +1,88 @@
+#ifndef NANITE_CULL_GLSL
+#define NANITE_CULL_GLSL
+//Resources shared by the instance and the cluster culling. Hierarchy nodes to visit are queued as (instance, node) pairs,
+//node_count is the number of queued nodes not processed yet so the traversal is over once it drops to zero
+
+#include "nanite.glsl"
+
+layout(set = 0, binding = 0) uniform _NaniteCullUniform {
+    mat4  hiz_view_proj;
+    mat4  view_proj;
+    vec4  frustum_planes[6];
+    vec3  camera_pos;
+    //Pixels covered by one unit at a distance of one unit
+    float lod_scale;
+    ivec2 hiz_size;
+    uint  hiz_mip_count;
+    uint  inverse_depth;
+    vec2  viewport_size;
+    uint  flip_y;
+    uint  use_occlusion;
+    //Largest error in pixels a drawn cluster may have
+    float lod_threshold;
+    float near_plane;
+    //Clusters whose screen rect is smaller in pixels go to the software rasterizer, 0 draws every cluster in hardware
+    float sw_raster_threshold;
+    uint  instance_count;
+    uint  max_node_tasks;
+    uint  max_visible_clusters;
+    uint  root_node;
+} cull;
+
+layout(std430, set = 0, binding = 1) readonly buffer _Instances {
+    NaniteInstance instances[];
+};
+
+layout(std430, set = 0, binding = 2) coherent buffer _QueueState {
+    uint node_read_offset;
+    uint node_write_offset;
+    int  node_count;
+    //Slots used in visible_clusters by both raster paths
+    uint visible_cluster_count;
+    //Draw count of the hardware raster pass
+    uint hw_cluster_count;
+    //VkDispatchIndirectCommand of the software raster pass, one group per cluster
+    uint sw_cluster_count;
+    uint sw_dispatch_y;
+    uint sw_dispatch_z;
+} queue;
+
+//Two uints per task, the instance is written last and stays NANITE_INVALID_INDEX until the task is ready
+layout(std430, set = 0, binding = 3) coherent buffer _NodeTasks {
+    uint node_tasks[];
+};
+
+layout(set = 1, binding = 0) uniform sampler2D hiz;
+
+#include "../common/cull.glsl"
+
+void pushNode(uint instanceIndex, uint nodeIndex) {
+    uint slot = atomicAdd(queue.node_write_offset, 1);
+    if (slot >= cull.max_node_tasks)
+        return;
+    //Counted before it is visible so the traversal can not end while the task is written
+    atomicAdd(queue.node_count, 1);
+    node_tasks[slot * 2 + 1] = nodeIndex;
+    memoryBarrierBuffer();
+    atomicExchange(node_tasks[slot * 2], instanceIndex);
+}
+
+//Screen space size in pixels of an error measured on the lod sphere, taken at the point of the sphere nearest to the camera
+float projectedError(NaniteInstance instance, vec4 lodBounds, float error) {
+    float scale    = instance.bounds_min.w;
+    vec3  center   = (instance.model * vec4(lodBounds.xyz, 1.0)).xyz;
+    float distance = max(length(center - cull.camera_pos) - lodBounds.w * scale, cull.near_plane);
+    return error * scale * cull.lod_scale / distance;
+}
+
+bool boxVisible(NaniteInstance instance, vec3 localMin, vec3 localMax) {
+    vec3 center   = (instance.model * vec4((localMin + localMax) * 0.5, 1.0)).xyz;
+    vec3 extent   = mat3(abs(instance.model[0].xyz), abs(instance.model[1].xyz), abs(instance.model[2].xyz)) * ((localMax - localMin) * 0.5);
+    vec3 worldMin = center - extent;
+    vec3 worldMax = center + extent;
+    if (!insideFrustum(worldMin, worldMax))
+        return false;
+    return cull.use_occlusion == 0 || !occluded(worldMin, worldMax);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+#ifdef VISIBILITY_BUFFER
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_EXT_shader_atomic_int64 : require
+#endif
+
+#ifdef VISIBILITY_BUFFER
+#include "../perFrame.glsl"
+#include "nanite_visibility.glsl"
+
+//Fragments hidden by the depth of the pass skip the atomic
+layout(early_fragment_tests) in;
+
+layout(std430, set = 0, binding = 6) buffer _Visibility {
+    uint64_t visibility[];
+};
+
+layout(location = 0) flat in uint visibility_id;
+
+void main() {
+    uint pixel = uint(gl_FragCoord.y) * uint(per_frame.resolution.x) + uint(gl_FragCoord.x);
+    atomicMax(visibility[pixel], packVisibility(gl_FragCoord.z, visibility_id));
+}
+#else
+#include "nanite_visualize.glsl"
+
+layout(location = 0) in vec3 normal;
+layout(location = 1) flat in vec3 color;
+layout(location = 0) out vec4 o_color;
+
+void main() {
+    o_color = vec4(color * visualizeLighting(normal), 1.0);
+}
+#endif
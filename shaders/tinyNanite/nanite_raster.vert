@@ -0,0 +1,61 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+#ifdef VISIBILITY_BUFFER
+#extension GL_ARB_gpu_shader_int64 : require
+#endif
+//Draws the clusters selected by the culling, one indirect draw per visible cluster and one vertex per triangle corner.
+//With VISIBILITY_BUFFER the triangle id is passed on for the visibility buffer instead of the shading inputs
+
+#include "../perFrame.glsl"
+#include "nanite_visualize.glsl"
+#ifdef VISIBILITY_BUFFER
+#include "nanite_visibility.glsl"
+#endif
+
+layout(std430, set = 0, binding = 1) readonly buffer _Instances {
+    NaniteInstance instances[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer _Clusters {
+    NaniteCluster clusters[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer _Vertices {
+    NaniteVertex vertices[];
+};
+
+layout(std430, set = 0, binding = 4) readonly buffer _Indices {
+    uint indices[];
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer _VisibleClusters {
+    uvec2 visible_clusters[];
+};
+
+#ifdef VISIBILITY_BUFFER
+layout(location = 0) flat out uint o_visibility_id;
+#else
+layout(push_constant) uniform _Visualize {
+    uint mode;
+} visualize;
+
+layout(location = 0) out vec3 o_normal;
+layout(location = 1) flat out vec3 o_color;
+#endif
+
+void main() {
+    //First instance of the draw is the visible cluster slot
+    uvec2          visible  = visible_clusters[gl_InstanceIndex];
+    NaniteInstance instance = instances[visible.x];
+    NaniteCluster  cluster  = clusters[visible.y];
+    NaniteVertex   vertex   = vertices[cluster.vertex_offset + indices[cluster.triangle_offset * 3 + uint(gl_VertexIndex)]];
+    uint           triangle = uint(gl_VertexIndex) / 3u;
+
+    gl_Position = per_frame.view_proj * instance.model * vec4(vertex.position, 1.0);
+#ifdef VISIBILITY_BUFFER
+    o_visibility_id = packVisibilityId(uint(gl_InstanceIndex), triangle, false);
+#else
+    o_normal = mat3(instance.model) * vertex.normal;
+    o_color  = visualizeColor(visualize.mode, visible.y, cluster, triangle, false);
+#endif
+}
@@ -0,0 +1,95 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_ARB_gpu_shader_int64 : require
+//Material pass of the visibility buffer. Every pixel fetches the triangle left by the hardware and software rasterizers,
+//interpolates its attributes at the position rebuilt from the depth and is shaded once whatever path drew it.
+//Writes the depth of both paths for the Hi-Z of the next frame
+
+#include "../perFrame.glsl"
+#include "nanite_visualize.glsl"
+#include "nanite_visibility.glsl"
+
+layout(std430, set = 0, binding = 1) readonly buffer _Instances {
+    NaniteInstance instances[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer _Clusters {
+    NaniteCluster clusters[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer _Vertices {
+    NaniteVertex vertices[];
+};
+
+layout(std430, set = 0, binding = 4) readonly buffer _Indices {
+    uint indices[];
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer _VisibleClusters {
+    uvec2 visible_clusters[];
+};
+
+layout(std430, set = 0, binding = 6) readonly buffer _Visibility {
+    uint64_t visibility[];
+};
+
+layout(push_constant) uniform _Resolve {
+    uint mode;
+    uint flip_y;
+} resolve;
+
+layout(location = 0) in vec2 inUV;
+layout(location = 0) out vec4 o_color;
+
+//Barycentrics of p projected on the plane of the triangle
+vec3 barycentrics(vec3 p, vec3 a, vec3 b, vec3 c) {
+    vec3  ab    = b - a;
+    vec3  ac    = c - a;
+    vec3  ap    = p - a;
+    float d00   = dot(ab, ab);
+    float d01   = dot(ab, ac);
+    float d11   = dot(ac, ac);
+    float d20   = dot(ap, ab);
+    float d21   = dot(ap, ac);
+    float denom = d00 * d11 - d01 * d01;
+    if (denom == 0.0)
+        return vec3(1.0, 0.0, 0.0);
+    float v = (d11 * d20 - d01 * d21) / denom;
+    float w = (d00 * d21 - d01 * d20) / denom;
+    return vec3(1.0 - v - w, v, w);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth;
+    uint  slot;
+    uint  triangle;
+    bool  software;
+    if (!unpackVisibility(visibility[pixel.y * per_frame.resolution.x + pixel.x], depth, slot, triangle, software))
+        discard;
+
+    uvec2          visible  = visible_clusters[slot];
+    NaniteInstance instance = instances[visible.x];
+    NaniteCluster  cluster  = clusters[visible.y];
+
+    //World position of the pixel, unlike screen space barycentrics it holds for triangles crossing the near plane
+    vec2 uv = gl_FragCoord.xy / vec2(per_frame.resolution);
+    if (resolve.flip_y != 0)
+        uv.y = 1.0 - uv.y;
+    vec4 world = per_frame.inv_view_proj * vec4(uv * 2.0 - 1.0, depth, 1.0);
+    world /= world.w;
+
+    vec3 positions[3];
+    vec3 normals[3];
+    for (uint i = 0; i < 3; i++) {
+        NaniteVertex vertex = vertices[cluster.vertex_offset + indices[(cluster.triangle_offset + triangle) * 3 + i]];
+        positions[i]        = (instance.model * vec4(vertex.position, 1.0)).xyz;
+        normals[i]          = vertex.normal;
+    }
+    vec3 weights = barycentrics(world.xyz, positions[0], positions[1], positions[2]);
+    vec3 normal  = mat3(instance.model) * (normals[0] * weights.x + normals[1] * weights.y + normals[2] * weights.z);
+
+    vec3 color   = visualizeColor(resolve.mode, visible.y, cluster, triangle, software);
+    o_color      = vec4(color * visualizeLighting(normal), 1.0);
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,37 @@
+#ifndef NANITE_VISIBILITY_GLSL
+#define NANITE_VISIBILITY_GLSL
+//64 bit visibility buffer written by both rasterizers. The depth is the high word so a single atomicMax keeps the
+//nearest triangle, the low word holds the software flag, the visible cluster slot and the triangle of the cluster.
+//The includer enables GL_ARB_gpu_shader_int64
+
+#include "tinyNanite.h"
+
+uint packVisibilityId(uint slot, uint triangle, bool software) {
+    return (software ? NANITE_VISIBILITY_SOFTWARE_FLAG : 0u) | (slot << NANITE_VISIBILITY_TRIANGLE_BITS) | triangle;
+}
+
+//Nearer is larger, the cleared value 0 is the far plane
+uint64_t packVisibility(float depth, uint id) {
+    return (uint64_t(floatBitsToUint(1.0 - clamp(depth, 0.0, 1.0))) << 32) | uint64_t(id);
+}
+
+bool unpackVisibility(uint64_t visibility, out float depth, out uint slot, out uint triangle, out bool software) {
+    uint depthBits = uint(visibility >> 32);
+    uint id        = uint(visibility);
+    depth          = 1.0 - uintBitsToFloat(depthBits);
+    slot           = (id & ~NANITE_VISIBILITY_SOFTWARE_FLAG) >> NANITE_VISIBILITY_TRIANGLE_BITS;
+    triangle       = id & ((1u << NANITE_VISIBILITY_TRIANGLE_BITS) - 1u);
+    software       = (id & NANITE_VISIBILITY_SOFTWARE_FLAG) != 0;
+    return depthBits != 0;
+}
+
+//Framebuffer position in pixels, the same convention as gl_FragCoord of the hardware path
+vec3 screenPosition(vec4 clip, vec2 viewportSize, bool flipY) {
+    vec3 ndc = clip.xyz / clip.w;
+    vec2 uv  = ndc.xy * 0.5 + 0.5;
+    if (flipY)
+        uv.y = 1.0 - uv.y;
+    return vec3(uv * viewportSize, ndc.z);
+}
+
+#endif
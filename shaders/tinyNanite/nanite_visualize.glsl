@@ -0,0 +1,40 @@
+#ifndef NANITE_VISUALIZE_GLSL
+#define NANITE_VISUALIZE_GLSL
+//Debug colors shared by the direct raster and the visibility buffer resolve
+
+#include "nanite.glsl"
+
+#define VISUALIZE_SHADED 0
+#define VISUALIZE_CLUSTERS 1
+#define VISUALIZE_TRIANGLES 2
+#define VISUALIZE_GROUPS 3
+#define VISUALIZE_MIP_LEVEL 4
+#define VISUALIZE_RASTER_PATH 5
+
+vec3 hashColor(uint id) {
+    id = (id ^ 61u) ^ (id >> 16u);
+    id *= 9u;
+    id = id ^ (id >> 4u);
+    id *= 0x27d4eb2du;
+    id = id ^ (id >> 15u);
+    return vec3((id >> 16u) & 0xffu, (id >> 8u) & 0xffu, id & 0xffu) / 255.0 * 0.8 + 0.2;
+}
+
+vec3 visualizeColor(uint mode, uint clusterIndex, NaniteCluster cluster, uint triangle, bool software) {
+    switch (mode) {
+        case VISUALIZE_CLUSTERS: return hashColor(clusterIndex);
+        case VISUALIZE_TRIANGLES: return hashColor(clusterIndex * NANITE_MAX_CLUSTER_TRIANGLES + triangle);
+        case VISUALIZE_GROUPS: return hashColor(cluster.group_index);
+        case VISUALIZE_MIP_LEVEL: return hashColor(cluster.mip_level);
+        //Software rasterized clusters in red, hardware ones in green
+        case VISUALIZE_RASTER_PATH: return software ? vec3(0.9, 0.2, 0.2) : vec3(0.2, 0.9, 0.2);
+        default: return vec3(0.8);
+    }
+}
+
+//Fixed light, only meant to show the shape and the selected clusters
+float visualizeLighting(vec3 normal) {
+    return max(dot(normalize(normal), normalize(vec3(0.3, 1.0, 0.5))), 0.0) * 0.8 + 0.2;
+}
+
+#endif
@@ -1,4 +1,9 @@
 #define NANITE_PERSISTENT_CLUSTER_CULLING_GROUP_SIZE		64
 #define NANITE_MAX_BVH_NODE_FANOUT 4
 #define NANITE_MAX_BVH_NODES_PER_GROUP						(NANITE_PERSISTENT_CLUSTER_CULLING_GROUP_SIZE / NANITE_MAX_BVH_NODE_FANOUT)
-#define NANITE_MAX_BVH_NODE_FANOUT_BITS 2
\ No newline at end of file
+#define NANITE_MAX_BVH_NODE_FANOUT_BITS 2
+#define NANITE_HIERARCHY_GROUP_FLAG 0x80000000u
+#define NANITE_INVALID_INDEX 0xffffffffu
+#define NANITE_MAX_CLUSTER_TRIANGLES 128
+#define NANITE_VISIBILITY_TRIANGLE_BITS 7
+#define NANITE_VISIBILITY_SOFTWARE_FLAG 0x80000000u
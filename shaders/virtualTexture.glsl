@@ -0,0 +1,105 @@
+#ifndef VIRTUAL_TEXTURE_GLSL
+#define VIRTUAL_TEXTURE_GLSL
+
+//Scene texture fetches of the passes streaming their pages, see VirtualTexturePass for the layout of the resources.
+//Expects scene_textures declared before, which still hold the mip tail of every virtual texture
+
+#ifdef VIRTUAL_TEXTURE
+
+#define VT_PAGE_SIZE          128
+#define VT_PAGE_BORDER        4
+#define VT_PHYSICAL_PAGE_SIZE 136
+#define VT_FEEDBACK_TILE      8
+
+struct VirtualTextureInfo
+{
+    uint first_page;
+    uint level_count;
+    uint width;
+    uint height;
+};
+
+//0 if the page is not resident, its atlas slot + 1 otherwise
+layout(std430, set = 0, binding = 16) readonly buffer _VirtualPageTable {
+    uint vt_page_table[];
+};
+
+layout(std430, set = 0, binding = 17) readonly buffer _VirtualTextures {
+    uint               vt_atlas_pages_per_row;
+    uint               vt_texture_count;
+    uvec2              vt_feedback_size;
+    uvec2              vt_feedback_jitter;
+    uint               vt_feedback_sample;
+    uint               vt_padding;
+    VirtualTextureInfo vt_textures[];
+};
+
+//Page wanted by one pixel of every VT_FEEDBACK_TILE square, the pixel and the fetch change every frame
+layout(std430, set = 0, binding = 18) writeonly buffer _VirtualFeedback {
+    uint vt_feedback[];
+};
+
+layout(set = 1, binding = 16) uniform sampler2D vt_atlas;
+
+uint vt_sample_index = 0;
+
+uint vtPageCount(uint texels)
+{
+    return (texels + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE;
+}
+
+vec4 sampleSceneTexture(int texture_index, vec2 uv)
+{
+    vec2 uv_dx = dFdx(uv);
+    vec2 uv_dy = dFdy(uv);
+    if (uint(texture_index) >= vt_texture_count || vt_textures[texture_index].level_count == 0)
+        return textureGrad(scene_textures[texture_index], uv, uv_dx, uv_dy);
+
+    VirtualTextureInfo info = vt_textures[texture_index];
+    vec2  texel_dx = uv_dx * vec2(info.width, info.height);
+    vec2  texel_dy = uv_dy * vec2(info.width, info.height);
+    float lod      = 0.5 * log2(max(dot(texel_dx, texel_dx), dot(texel_dy, texel_dy)));
+    uint  level    = uint(clamp(floor(lod), 0.0, 31.0));
+
+    uint level_first_page = info.first_page;
+    for (uint l = 0; l < min(level, info.level_count); l++)
+        level_first_page += vtPageCount(max(info.width >> l, 1u)) * vtPageCount(max(info.height >> l, 1u));
+
+    bool write_feedback = vt_sample_index++ == vt_feedback_sample && all(equal(uvec2(gl_FragCoord.xy) % VT_FEEDBACK_TILE, vt_feedback_jitter));
+    vec2 wrapped_uv     = fract(uv);
+
+    //Finest resident level at or above the wanted one
+    for (uint l = level; l < info.level_count; l++) {
+        uvec2 level_size  = max(uvec2(info.width, info.height) >> l, uvec2(1));
+        uvec2 level_pages = uvec2(vtPageCount(level_size.x), vtPageCount(level_size.y));
+        vec2  texel       = wrapped_uv * vec2(level_size);
+        uvec2 page        = min(uvec2(texel) / VT_PAGE_SIZE, level_pages - 1);
+        uint  page_index  = level_first_page + page.y * level_pages.x + page.x;
+
+        if (write_feedback) {
+            uvec2 cell = uvec2(gl_FragCoord.xy) / VT_FEEDBACK_TILE;
+            if (all(lessThan(cell, vt_feedback_size)))
+                vt_feedback[cell.y * vt_feedback_size.x + cell.x] = page_index;
+            write_feedback = false;
+        }
+
+        uint entry = vt_page_table[page_index];
+        if (entry != 0) {
+            uint slot     = entry - 1;
+            vec2 physical = vec2(slot % vt_atlas_pages_per_row, slot / vt_atlas_pages_per_row) * VT_PHYSICAL_PAGE_SIZE + VT_PAGE_BORDER + texel - vec2(page * VT_PAGE_SIZE);
+            return textureLod(vt_atlas, physical / vec2(textureSize(vt_atlas, 0)), 0.0);
+        }
+        level_first_page += level_pages.x * level_pages.y;
+    }
+
+    //Nothing streamed for this uv yet, the mip tail is always resident
+    return textureGrad(scene_textures[texture_index], uv, uv_dx, uv_dy);
+}
+
+#else
+
+#define sampleSceneTexture(texture_index, uv) texture(scene_textures[texture_index], uv)
+
+#endif
+
+#endif
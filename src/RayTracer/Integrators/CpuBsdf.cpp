@@ -0,0 +1,575 @@
+#include "CpuBsdf.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+static constexpr float PI     = 3.14159265359f;
+static constexpr float INV_PI = 0.3183098861837697f;
+
+static uvec4 Pcg4d(uvec4 v) {
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+    v = v ^ (v >> 16u);
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+    return v;
+}
+
+static float UintToFloat(uint32_t x) {
+    return std::bit_cast<float>(0x3f800000u | (x >> 9)) - 1.0f;
+}
+
+float CpuRng::next1() {
+    state.w++;
+    return UintToFloat(Pcg4d(state).x);
+}
+
+vec2 CpuRng::next2() {
+    state.w++;
+    uvec4 pcg = Pcg4d(state);
+    return vec2(UintToFloat(pcg.x), UintToFloat(pcg.y));
+}
+
+vec3 CpuRng::next3() {
+    state.w++;
+    uvec4 pcg = Pcg4d(state);
+    return vec3(UintToFloat(pcg.x), UintToFloat(pcg.y), UintToFloat(pcg.z));
+}
+
+CpuFrame CpuFrame::make(const vec3& n) {
+    CpuFrame frame;
+    frame.n          = n;
+    frame.tangent    = glm::normalize(glm::cross(n, std::abs(n.z) < 0.999f ? vec3(0, 0, 1) : vec3(0, 1, 0)));
+    frame.bitTangent = glm::normalize(glm::cross(n, frame.tangent));
+    return frame;
+}
+
+static vec3 Reflect(const vec3& v) {
+    return vec3(-v.x, -v.y, v.z);
+}
+
+static vec3 Reflect(const vec3& v, const vec3& n) {
+    return -v + 2 * glm::dot(v, n) * n;
+}
+
+static vec3 SquareToCosineHemisphere(const vec2& rand) {
+    float r   = std::sqrt(rand.x);
+    float phi = rand.y * 2 * PI;
+    return vec3(r * std::cos(phi), r * std::sin(phi), std::sqrt(1 - rand.x));
+}
+
+static float SquareToCosineHemispherePdf(const vec3& v) {
+    return v.z >= 0 ? v.z * INV_PI : 0;
+}
+
+static float Luminance(const vec3& v) {
+    return 0.2126f * v.x + 0.7152f * v.y + 0.0722f * v.z;
+}
+
+static float GgxD(float alpha, const vec3& wh) {
+    float cosTheta = wh.z;
+    if (cosTheta <= 0)
+        return 0;
+    float alphaSq    = alpha * alpha;
+    float cosThetaSq = cosTheta * cosTheta;
+    float tanThetaSq = std::max(1.0f - cosThetaSq, 0.0f) / cosThetaSq;
+    float denom      = alphaSq + tanThetaSq;
+    return alphaSq * INV_PI / (cosThetaSq * cosThetaSq * denom * denom);
+}
+
+//Zero when v sees the back of the microfacet
+static float GgxG1(const vec3& v, const vec3& wh, float alpha) {
+    float cosTheta = glm::dot(v, wh);
+    if (cosTheta * v.z <= 0)
+        return 0;
+    float cosThetaSq = cosTheta * cosTheta;
+    float tanThetaSq = std::max(1.0f - cosThetaSq, 0.0f) / cosThetaSq;
+    return 2.0f / (1.0f + std::sqrt(1.0f + alpha * alpha * tanThetaSq));
+}
+
+static float GgxG(float alpha, const vec3& wi, const vec3& wo, const vec3& wh) {
+    return GgxG1(wo, wh, alpha) * GgxG1(wi, wh, alpha);
+}
+
+static vec3 GgxSample(float alpha, const vec2& rand) {
+    float phi        = 2.0f * PI * rand.x;
+    float cosThetaSq = 1.0f / (1.0f + alpha * alpha * rand.y / (1.0f - rand.y));
+    float cosTheta   = std::sqrt(cosThetaSq);
+    float sinTheta   = std::sqrt(std::max(1.0f - cosThetaSq, 0.0f));
+    return vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+}
+
+static float SmithMaskingG2(const vec3& v, float roughness) {
+    float alpha  = roughness * roughness;
+    float a2     = alpha * alpha;
+    vec3  v2     = v * v;
+    float lambda = (-1.0f + std::sqrt(1.0f + (v2.x * a2 + v2.y * a2) / v2.z)) / 2.0f;
+    return 1.0f / (1.0f + lambda);
+}
+
+static float DielectricReflectance(float eta, float cosThetaI, float& cosThetaT) {
+    if (cosThetaI < 0) {
+        eta       = 1.0f / eta;
+        cosThetaI = -cosThetaI;
+    }
+    float sinThetaTSq = eta * eta * (1.0f - cosThetaI * cosThetaI);
+    if (sinThetaTSq > 1.0f) {
+        cosThetaT = 0;
+        return 1;
+    }
+    cosThetaT = std::sqrt(std::max(1.0f - sinThetaTSq, 0.0f));
+    float rs  = (eta * cosThetaI - cosThetaT) / (eta * cosThetaI + cosThetaT);
+    float rp  = (eta * cosThetaT - cosThetaI) / (eta * cosThetaT + cosThetaI);
+    return (rs * rs + rp * rp) * 0.5f;
+}
+
+static float DielectricReflectance(float eta, float cosThetaI) {
+    float cosThetaT;
+    return DielectricReflectance(eta, cosThetaI, cosThetaT);
+}
+
+static float ConductorReflectance(float eta, float k, float cosThetaI) {
+    float cosThetaISq = cosThetaI * cosThetaI;
+    float sinThetaISq = std::max(1.0f - cosThetaISq, 0.0f);
+    float sinThetaIQu = sinThetaISq * sinThetaISq;
+    float innerTerm   = eta * eta - k * k - sinThetaISq;
+    float aSqPlusBSq  = std::sqrt(std::max(innerTerm * innerTerm + 4.0f * eta * eta * k * k, 0.0f));
+    float a           = std::sqrt(std::max((aSqPlusBSq + innerTerm) * 0.5f, 0.0f));
+    float rs          = ((aSqPlusBSq + cosThetaISq) - (2.0f * a * cosThetaI)) / ((aSqPlusBSq + cosThetaISq) + (2.0f * a * cosThetaI));
+    float rp          = ((cosThetaISq * aSqPlusBSq + sinThetaIQu) - (2.0f * a * cosThetaI * sinThetaISq)) / ((cosThetaISq * aSqPlusBSq + sinThetaIQu) + (2.0f * a * cosThetaI * sinThetaISq));
+    return 0.5f * (rs + rs * rp);
+}
+
+static vec3 ConductorReflectance(const vec3& eta, const vec3& k, float cosThetaI) {
+    return vec3(ConductorReflectance(eta.x, k.x, cosThetaI), ConductorReflectance(eta.y, k.y, cosThetaI), ConductorReflectance(eta.z, k.z, cosThetaI));
+}
+
+static vec3 FresnelSchlick(const vec3& f0, float cosTheta) {
+    return f0 + (vec3(1) - f0) * std::pow(1.0f - cosTheta, 5.0f);
+}
+
+//Radiance scale of a refraction from the side of wi to the side of wo
+static float GetEtaScale(const RTMaterial& mat, const vec3& wo, const vec3& wi) {
+    if (glm::dot(wo, wi) > 0)
+        return 1;
+    float eta = wo.z > 0 ? 1.0f / mat.ior : mat.ior;
+    return eta * eta;
+}
+
+bool CpuBsdf::isSpecular(const RTMaterial& mat) {
+    if (mat.bsdf_type == RT_BSDF_TYPE_MIRROR)
+        return true;
+    if (mat.bsdf_type == RT_BSDF_TYPE_DIELECTRIC || mat.bsdf_type == RT_BSDF_TYPE_CONDUCTOR)
+        return mat.roughness < 1e-3f;
+    return false;
+}
+
+bool CpuBsdf::isTwoSided(const RTMaterial& mat) {
+    return mat.bsdf_type == RT_BSDF_TYPE_DIELECTRIC || mat.bsdf_type == RT_BSDF_TYPE_DISNEY;
+}
+
+vec3 CpuBsdf::getAlbedo(const RTMaterial& mat, const vec2& uv) const {
+    return scene.hasTexture(mat.texture_id) ? vec3(scene.sampleTexture(mat.texture_id, uv)) : mat.albedo;
+}
+
+float CpuBsdf::getRoughness(const RTMaterial& mat, const vec2& uv) const {
+    return scene.hasTexture(mat.roughness_texture_id) ? scene.sampleTexture(mat.roughness_texture_id, uv).r : mat.roughness;
+}
+
+float CpuBsdf::getMetallic(const RTMaterial& mat, const vec2& uv) const {
+    return scene.hasTexture(mat.roughness_texture_id) ? scene.sampleTexture(mat.roughness_texture_id, uv).g : mat.metallic;
+}
+
+vec3 CpuBsdf::eval(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    switch (mat.bsdf_type) {
+        case RT_BSDF_TYPE_DIFFUSE: return diffuseF(mat, event);
+        case RT_BSDF_TYPE_CONDUCTOR: return conductorF(mat, event, false);
+        case RT_BSDF_TYPE_PLASTIC: return plasticF(mat, event);
+        case RT_BSDF_TYPE_DIELECTRIC: return dielectricF(mat, event);
+        case RT_BSDF_TYPE_DISNEY: return disneyF(mat, event);
+        default: return vec3(0);
+    }
+}
+
+float CpuBsdf::pdf(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    switch (mat.bsdf_type) {
+        case RT_BSDF_TYPE_DIFFUSE: return diffusePdf(mat, event);
+        case RT_BSDF_TYPE_CONDUCTOR: return conductorPdf(mat, event);
+        case RT_BSDF_TYPE_PLASTIC: return plasticPdf(mat, event);
+        case RT_BSDF_TYPE_DIELECTRIC: return dielectricPdf(mat, event);
+        case RT_BSDF_TYPE_DISNEY: return disneyPdf(mat, event);
+        default: return 0;
+    }
+}
+
+CpuBsdfSample CpuBsdf::sample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const {
+    switch (mat.bsdf_type) {
+        case RT_BSDF_TYPE_DIFFUSE: return diffuseSample(mat, event, rng);
+        case RT_BSDF_TYPE_MIRROR: return mirrorSample(mat, event);
+        case RT_BSDF_TYPE_CONDUCTOR: return conductorSample(mat, event, rng, false);
+        case RT_BSDF_TYPE_PLASTIC: return plasticSample(mat, event, rng);
+        case RT_BSDF_TYPE_DIELECTRIC: return dielectricSample(mat, event, rng);
+        case RT_BSDF_TYPE_DISNEY: return disneySample(mat, event, rng);
+        default: return {};
+    }
+}
+
+vec3 CpuBsdf::diffuseF(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    return getAlbedo(mat, event.uv) * INV_PI * std::max(0.0f, event.wi.z);
+}
+
+float CpuBsdf::diffusePdf(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    return SquareToCosineHemispherePdf(event.wi);
+}
+
+CpuBsdfSample CpuBsdf::diffuseSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const {
+    event.wi = SquareToCosineHemisphere(rng.next2());
+    return {diffuseF(mat, event), diffusePdf(mat, event), RT_BSDF_LOBE_DIFFUSE};
+}
+
+CpuBsdfSample CpuBsdf::mirrorSample(const RTMaterial& mat, CpuScatterEvent& event) const {
+    event.wi = Reflect(event.wo);
+    return {getAlbedo(mat, event.uv), 1, RT_BSDF_LOBE_SPECULAR | RT_BSDF_LOBE_REFLECTION};
+}
+
+//schlick selects the albedo tinted schlick fresnel of the disney metal lobe over the complex ior of conductors
+vec3 CpuBsdf::conductorF(const RTMaterial& mat, const CpuScatterEvent& event, bool schlick) const {
+    float roughness = getRoughness(mat, event.uv);
+    if (event.wi.z <= 0 || event.wo.z <= 0 || roughness < 1e-3f)
+        return vec3(0);
+    vec3  wh      = glm::normalize(event.wi + event.wo);
+    float cosO    = glm::dot(wh, event.wo);
+    vec3  albedo  = getAlbedo(mat, event.uv);
+    vec3  fresnel = schlick ? FresnelSchlick(albedo, cosO) : ConductorReflectance(mat.eta, mat.k, cosO) * albedo;
+    return fresnel * GgxD(roughness, wh) * GgxG(roughness, event.wi, event.wo, wh) / (4 * event.wo.z);
+}
+
+float CpuBsdf::conductorPdf(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    float roughness = getRoughness(mat, event.uv);
+    if (event.wi.z <= 0 || event.wo.z <= 0 || roughness < 1e-3f)
+        return 0;
+    vec3 wh = glm::normalize(event.wi + event.wo);
+    return GgxD(roughness, wh) * wh.z / (4 * glm::dot(wh, event.wo));
+}
+
+CpuBsdfSample CpuBsdf::conductorSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng, bool schlick) const {
+    vec2 rand = rng.next2();
+    if (event.wo.z <= 0)
+        return {};
+    float roughness = getRoughness(mat, event.uv);
+    if (roughness < 1e-3f) {
+        event.wi    = Reflect(event.wo);
+        vec3 albedo = getAlbedo(mat, event.uv);
+        vec3 f      = schlick ? FresnelSchlick(albedo, event.wo.z) : ConductorReflectance(mat.eta, mat.k, event.wo.z) * albedo;
+        return {f, 1, RT_BSDF_LOBE_SPECULAR | RT_BSDF_LOBE_REFLECTION};
+    }
+    vec3 wh  = GgxSample(roughness, rand);
+    event.wi = Reflect(event.wo, wh);
+    if (glm::dot(event.wi, wh) <= 0 || event.wi.z <= 0)
+        return {};
+    return {conductorF(mat, event, schlick), conductorPdf(mat, event), RT_BSDF_LOBE_GLOSSY | RT_BSDF_LOBE_REFLECTION};
+}
+
+//Probability of sampling the specular lobe of plastic, the same in sample and pdf
+static float PlasticGlossyProb(const RTMaterial& mat, float cosThetaO) {
+    float glossyProb = DielectricReflectance(1 / mat.ior, cosThetaO);
+    float diffProb   = (1 - glossyProb) * mat.avgTransmittance;
+    return glossyProb / (glossyProb + diffProb);
+}
+
+vec3 CpuBsdf::plasticF(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    const vec3& wo = event.wo;
+    const vec3& wi = event.wi;
+    if (wo.z <= 0 || wi.z <= 0)
+        return vec3(0);
+
+    float roughness = getRoughness(mat, event.uv);
+    vec3  albedo    = getAlbedo(mat, event.uv);
+    vec3  specularContrib(0);
+    float fOut, fIn;
+    if (roughness > 0) {
+        vec3 wh         = glm::normalize(wo + wi);
+        fOut            = DielectricReflectance(1 / mat.ior, glm::dot(wo, wh));
+        fIn             = DielectricReflectance(1 / mat.ior, glm::dot(wi, wh));
+        specularContrib = vec3(fOut * GgxD(roughness, wh) * GgxG(roughness, wi, wo, wh) / (4 * wo.z));
+    } else {
+        //Smooth plastic, the delta coating is only reached through sample
+        fOut = DielectricReflectance(1 / mat.ior, wo.z);
+        fIn  = DielectricReflectance(1 / mat.ior, wi.z);
+    }
+    vec3 diffuseContrib = albedo * (1 - fOut) * (1 - fIn) * (1 / (mat.ior * mat.ior)) * wi.z * INV_PI / (vec3(1) - mat.diffuseFresnel * albedo);
+    if (glm::all(glm::greaterThan(mat.scaledSigmaA, vec3(0))))
+        diffuseContrib *= glm::exp(mat.scaledSigmaA * (-1.0f / wo.z - 1.0f / wi.z));
+    return specularContrib + diffuseContrib;
+}
+
+float CpuBsdf::plasticPdf(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    const vec3& wo = event.wo;
+    const vec3& wi = event.wi;
+    if (wo.z <= 0 || wi.z <= 0)
+        return 0;
+    float roughness  = getRoughness(mat, event.uv);
+    float glossyProb = PlasticGlossyProb(mat, wo.z);
+    float pdf        = (1 - glossyProb) * wi.z * INV_PI;
+    if (roughness > 0) {
+        vec3 wh = glm::normalize(wo + wi);
+        pdf += glossyProb * GgxD(roughness, wh) * wh.z / (4 * std::abs(glm::dot(wo, wh)));
+    }
+    return pdf;
+}
+
+CpuBsdfSample CpuBsdf::plasticSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const {
+    vec2 rand = rng.next2();
+    if (event.wo.z <= 0)
+        return {};
+    float roughness  = getRoughness(mat, event.uv);
+    float glossyProb = PlasticGlossyProb(mat, event.wo.z);
+    if (rand.x < glossyProb) {
+        vec2 remapped = vec2((glossyProb - rand.x) / glossyProb, rand.y);
+        if (roughness <= 0) {
+            event.wi = Reflect(event.wo);
+            return {vec3(DielectricReflectance(1 / mat.ior, event.wo.z)), glossyProb, RT_BSDF_LOBE_SPECULAR | RT_BSDF_LOBE_REFLECTION};
+        }
+        event.wi = Reflect(event.wo, GgxSample(roughness, remapped));
+        if (event.wi.z <= 0)
+            return {};
+        return {plasticF(mat, event), plasticPdf(mat, event), RT_BSDF_LOBE_GLOSSY | RT_BSDF_LOBE_REFLECTION};
+    }
+    event.wi = SquareToCosineHemisphere(vec2((rand.x - glossyProb) / (1 - glossyProb), rand.y));
+    if (event.wi.z <= 0)
+        return {};
+    return {plasticF(mat, event), plasticPdf(mat, event), RT_BSDF_LOBE_DIFFUSE | RT_BSDF_LOBE_REFLECTION};
+}
+
+//Generalized half vector of rough_dielectric, on the side of the macro normal
+static vec3 DielectricHalfVector(const RTMaterial& mat, const vec3& wo, const vec3& wi, bool reflect) {
+    if (reflect)
+        return glm::normalize(wi + wo) * (wo.z > 0 ? 1.0f : -1.0f);
+    float eta = wo.z > 0 ? 1.0f / mat.ior : mat.ior;
+    return -glm::normalize(wi + wo * eta);
+}
+
+vec3 CpuBsdf::dielectricF(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    float roughness = getRoughness(mat, event.uv);
+    if (roughness < 1e-3f)
+        return vec3(0);
+    const vec3& wo      = event.wo;
+    const vec3& wi      = event.wi;
+    bool        reflect = wo.z * wi.z > 0;
+    float       eta     = wo.z > 0 ? 1.0f / mat.ior : mat.ior;
+    vec3        wh      = DielectricHalfVector(mat, wo, wi, reflect);
+    float       F       = DielectricReflectance(1.0f / mat.ior, glm::dot(wo, wh));
+    float       D       = GgxD(roughness, wh);
+    float       G       = GgxG(roughness, wi, wo, wh);
+    vec3        albedo  = getAlbedo(mat, event.uv);
+    if (reflect)
+        return albedo * F * D * G / (4.0f * std::abs(wo.z));
+    float whDotIn   = glm::dot(wh, wi);
+    float whDotOut  = glm::dot(wh, wo);
+    float sqrtDenom = eta * whDotOut + whDotIn;
+    return albedo * (1.0f - F) * D * G * std::abs(whDotIn * whDotOut / (wo.z * sqrtDenom * sqrtDenom)) * GetEtaScale(mat, wo, wi);
+}
+
+float CpuBsdf::dielectricPdf(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    float roughness = getRoughness(mat, event.uv);
+    if (roughness < 1e-3f)
+        return 0;
+    const vec3& wo      = event.wo;
+    const vec3& wi      = event.wi;
+    bool        reflect = wo.z * wi.z > 0;
+    float       eta     = wo.z > 0 ? 1.0f / mat.ior : mat.ior;
+    vec3        wh      = DielectricHalfVector(mat, wo, wi, reflect);
+    float       F       = DielectricReflectance(1.0f / mat.ior, glm::dot(wo, wh));
+    //ggx_sample draws half vectors proportional to D * cos
+    float whPdf = GgxD(roughness, wh) * wh.z;
+    if (whPdf <= 0 || glm::dot(wo, wh) * wo.z <= 0)
+        return 0;
+    if (reflect)
+        return F * whPdf / (4.0f * std::abs(glm::dot(wo, wh)));
+    float sqrtDenom = glm::dot(wo, wh) * eta + glm::dot(wi, wh);
+    return whPdf * (1.0f - F) * std::abs(glm::dot(wi, wh)) / (sqrtDenom * sqrtDenom);
+}
+
+CpuBsdfSample CpuBsdf::dielectricSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const {
+    float roughness = getRoughness(mat, event.uv);
+    vec2  rand      = rng.next2();
+    vec3  albedo    = getAlbedo(mat, event.uv);
+    if (roughness < 1e-3f) {
+        float eta = event.wo.z < 0 ? mat.ior : 1.0f / mat.ior;
+        float cosThetaT;
+        float fresnel = DielectricReflectance(eta, std::abs(event.wo.z), cosThetaT);
+        if (rand.x < fresnel) {
+            event.wi = Reflect(event.wo);
+            return {fresnel * albedo, fresnel, RT_BSDF_LOBE_SPECULAR | RT_BSDF_LOBE_REFLECTION};
+        }
+        event.wi = vec3(-eta * event.wo.x, -eta * event.wo.y, event.wo.z > 0 ? -cosThetaT : cosThetaT);
+        return {(1 - fresnel) * albedo * GetEtaScale(mat, event.wo, event.wi), 1 - fresnel, RT_BSDF_LOBE_SPECULAR | RT_BSDF_LOBE_REFRACTION};
+    }
+
+    vec3  wh       = GgxSample(roughness, rand);
+    float whDotOut = glm::dot(event.wo, wh);
+    //Microfacets facing away from wo are masked, their directions would be weighted with another half vector
+    if (whDotOut * event.wo.z <= 0)
+        return {};
+    float cosThetaT;
+    float F       = DielectricReflectance(1.0f / mat.ior, whDotOut, cosThetaT);
+    bool  reflect = rng.next1() < F;
+    if (reflect) {
+        event.wi = Reflect(event.wo, wh);
+        if (event.wi.z * event.wo.z <= 0)
+            return {};
+    } else {
+        float eta = whDotOut < 0 ? mat.ior : 1.0f / mat.ior;
+        event.wi  = (eta * whDotOut - (whDotOut > 0 ? 1.0f : -1.0f) * cosThetaT) * wh - eta * event.wo;
+        if (event.wi.z * event.wo.z >= 0)
+            return {};
+    }
+    return {dielectricF(mat, event), dielectricPdf(mat, event), RT_BSDF_LOBE_GLOSSY | (reflect ? RT_BSDF_LOBE_REFLECTION : RT_BSDF_LOBE_REFRACTION)};
+}
+
+static float ClearcoatAlpha(const RTMaterial& mat) {
+    return (1.0f - mat.clearCoatGloss) * 0.1f + mat.clearCoatGloss * 0.001f;
+}
+
+//GTR1 distribution of the disney clear coat
+static float ClearcoatD(float alpha, float cosTheta) {
+    float alphaSq = alpha * alpha;
+    return (alphaSq - 1.0f) / (PI * std::log(alphaSq) * (1.0f + (alphaSq - 1.0f) * cosTheta * cosTheta));
+}
+
+vec3 CpuBsdf::clearcoatF(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    if (event.wi.z <= 0 || event.wo.z <= 0)
+        return vec3(0);
+    vec3  wh = glm::normalize(event.wi + event.wo);
+    float r0 = 0.04f;
+    float F  = r0 + (1.0f - r0) * std::pow(1.0f - std::abs(glm::dot(wh, event.wi)), 5.0f);
+    float D  = ClearcoatD(ClearcoatAlpha(mat), wh.z);
+    float G  = SmithMaskingG2(event.wi, 0.25f) * SmithMaskingG2(event.wo, 0.25f);
+    return vec3(F * D * G / (4.0f * event.wo.z));
+}
+
+float CpuBsdf::clearcoatPdf(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    if (event.wi.z <= 0 || event.wo.z <= 0)
+        return 0;
+    vec3 wh = glm::normalize(event.wi + event.wo);
+    return ClearcoatD(ClearcoatAlpha(mat), wh.z) * std::abs(wh.z) / (4.0f * std::abs(glm::dot(wh, event.wi)));
+}
+
+CpuBsdfSample CpuBsdf::clearcoatSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const {
+    vec2 rand = rng.next2();
+    if (event.wo.z <= 0)
+        return {};
+    float alphaSq  = ClearcoatAlpha(mat) * ClearcoatAlpha(mat);
+    float cosTheta = std::sqrt((1.0f - std::pow(alphaSq, 1.0f - rand.x)) / (1.0f - alphaSq));
+    float sinTheta = std::sqrt(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+    float phi      = rand.y * PI * 2.0f;
+    event.wi       = glm::normalize(Reflect(event.wo, vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta)));
+    if (event.wi.z <= 0)
+        return {};
+    return {clearcoatF(mat, event), clearcoatPdf(mat, event), RT_BSDF_LOBE_GLOSSY | RT_BSDF_LOBE_REFLECTION};
+}
+
+static vec3 DisneyDiffuse(const RTMaterial& mat, const vec3& baseColor, float roughness, const vec3& wi, const vec3& wo) {
+    if (wi.z <= 0 || wo.z <= 0)
+        return vec3(0);
+    auto  fd          = [](const vec3& w, float f90) { return 1.0f + (f90 - 1.0f) * std::pow(1.0f - std::abs(w.z), 5.0f); };
+    vec3  wh          = glm::normalize(wi + wo);
+    float cosD        = std::abs(glm::dot(wh, wi));
+    vec3  baseColorPI = baseColor * INV_PI;
+    float fd90        = 0.5f + 2.0f * roughness * cosD * cosD;
+    vec3  baseDiffuse = baseColorPI * fd(wo, fd90) * fd(wi, fd90);
+    float fss90       = roughness * cosD;
+    float scale       = fd(wi, fss90) * fd(wo, fss90) * (1.0f / (std::abs(wi.z) + std::abs(wo.z)) - 0.5f) + 0.5f;
+    vec3  subsurface  = 1.25f * baseColorPI * scale;
+    vec3  diffuse     = glm::mix(baseDiffuse, subsurface, mat.subSurfaceFactor);
+
+    float lum   = Luminance(baseColor);
+    vec3  tint  = lum > 0 ? baseColor / lum : vec3(1);
+    vec3  sheen = (vec3(1 - mat.sheenTint) + mat.sheenTint * tint) * std::pow(1.0f - glm::dot(wi, wh), 5.0f) * mat.sheen;
+    return (diffuse + sheen) * wi.z;
+}
+
+struct DisneyWeights {
+    float diffuse;
+    float metal;
+    float glass;
+    float clearCoat;
+
+    float total() const { return diffuse + metal + glass + clearCoat; }
+};
+
+static DisneyWeights GetDisneyWeights(const RTMaterial& mat, float metallic) {
+    return {
+        .diffuse   = (1.0f - metallic) * (1.0f - mat.specularTransmission),
+        .metal     = 1.0f - mat.specularTransmission * (1.0f - metallic),
+        .glass     = (1.0f - metallic) * mat.specularTransmission,
+        .clearCoat = 0.25f * mat.clearCoat,
+    };
+}
+
+vec3 CpuBsdf::disneyF(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    if (event.wo.z <= 0)
+        return dielectricF(mat, event);
+    DisneyWeights weights = GetDisneyWeights(mat, getMetallic(mat, event.uv));
+    vec3          result(0);
+    if (weights.diffuse > 0)
+        result += weights.diffuse * DisneyDiffuse(mat, getAlbedo(mat, event.uv), getRoughness(mat, event.uv), event.wi, event.wo);
+    if (weights.metal > 0)
+        result += weights.metal * conductorF(mat, event, true);
+    if (weights.glass > 0)
+        result += weights.glass * dielectricF(mat, event);
+    if (weights.clearCoat > 0)
+        result += weights.clearCoat * clearcoatF(mat, event);
+    return result;
+}
+
+float CpuBsdf::disneyPdf(const RTMaterial& mat, const CpuScatterEvent& event) const {
+    if (event.wo.z <= 0)
+        return dielectricPdf(mat, event);
+    DisneyWeights weights = GetDisneyWeights(mat, getMetallic(mat, event.uv));
+    float         result  = 0;
+    if (weights.diffuse > 0)
+        result += weights.diffuse * diffusePdf(mat, event);
+    if (weights.metal > 0)
+        result += weights.metal * conductorPdf(mat, event);
+    if (weights.glass > 0)
+        result += weights.glass * dielectricPdf(mat, event);
+    if (weights.clearCoat > 0)
+        result += weights.clearCoat * clearcoatPdf(mat, event);
+    return result / weights.total();
+}
+
+//One lobe picks the direction, f and pdf are those of the whole mixture. Delta lobes are scaled by their weight alone
+CpuBsdfSample CpuBsdf::disneySample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const {
+    if (event.wo.z <= 0)
+        return dielectricSample(mat, event, rng);
+    DisneyWeights weights = GetDisneyWeights(mat, getMetallic(mat, event.uv));
+    float         r       = rng.next1() * weights.total();
+
+    CpuBsdfSample lobe;
+    float         lobeWeight;
+    if (r < weights.diffuse) {
+        lobe       = diffuseSample(mat, event, rng);
+        lobeWeight = weights.diffuse;
+    } else if (r < weights.diffuse + weights.metal) {
+        lobe       = conductorSample(mat, event, rng, true);
+        lobeWeight = weights.metal;
+    } else if (r < weights.diffuse + weights.metal + weights.glass) {
+        lobe       = dielectricSample(mat, event, rng);
+        lobeWeight = weights.glass;
+    } else {
+        lobe       = clearcoatSample(mat, event, rng);
+        lobeWeight = weights.clearCoat;
+    }
+    if (lobe.pdf <= 0)
+        return {};
+    if (lobe.flags & RT_BSDF_LOBE_SPECULAR)
+        return {lobe.f * lobeWeight, lobe.pdf * lobeWeight / weights.total(), lobe.flags};
+    return {disneyF(mat, event), disneyPdf(mat, event), lobe.flags};
+}
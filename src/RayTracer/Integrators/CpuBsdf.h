@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../Utils/CpuScene.h"
+
+//pcg4d generator of the shaders, every draw advances w and hashes the whole state
+struct CpuRng {
+    uvec4 state;
+
+    float next1();
+    vec2  next2();
+    vec3  next3();
+};
+
+struct CpuFrame {
+    vec3 tangent;
+    vec3 bitTangent;
+    vec3 n;
+
+    static CpuFrame make(const vec3& n);
+    vec3            toLocal(const vec3& v) const { return vec3(glm::dot(v, tangent), glm::dot(v, bitTangent), glm::dot(v, n)); }
+    vec3            toWorld(const vec3& v) const { return tangent * v.x + bitTangent * v.y + n * v.z; }
+};
+
+//Directions are in the local frame of the shading normal, wo points back along the incoming ray
+struct CpuScatterEvent {
+    vec3     wo;
+    vec3     wi;
+    vec3     p;
+    vec2     uv;
+    CpuFrame frame;
+    uint32_t materialIdx;
+};
+
+struct CpuBsdfSample {
+    //Includes the cosine of wi like the shaders
+    vec3     f{0};
+    float    pdf{0};
+    uint32_t flags{0};
+};
+
+/**
+ * Cpu port of bsdf.glsl and disney.glsl. Returns the same f and pdf as the shaders except where they are inconsistent
+ * with each other, the reference must converge to the right answer:
+ * conductor_albedo_f returns its value, disney_sample returns the pdf of the whole mixture, the microfacet half vector
+ * pdfs of rough plastic and dielectric include the cosine ggx_sample draws them with, smooth dielectrics use the
+ * unsigned cosine for their fresnel term, disney diffuse and clear coat carry the cosine of wi like the other lobes
+ * and smooth plastic keeps its diffuse substrate.
+ */
+class CpuBsdf {
+public:
+    explicit CpuBsdf(const CpuScene& scene) : scene(scene) {}
+
+    vec3          eval(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    float         pdf(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    CpuBsdfSample sample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const;
+
+    vec3 getAlbedo(const RTMaterial& mat, const vec2& uv) const;
+
+    //Materials whose every lobe is a delta, light sampling is skipped on them
+    static bool isSpecular(const RTMaterial& mat);
+    //Transmissive materials keep the shading normal on the side it faces instead of flipping it toward wo
+    static bool isTwoSided(const RTMaterial& mat);
+
+protected:
+    float getRoughness(const RTMaterial& mat, const vec2& uv) const;
+    float getMetallic(const RTMaterial& mat, const vec2& uv) const;
+
+    vec3          diffuseF(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    float         diffusePdf(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    CpuBsdfSample diffuseSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const;
+
+    CpuBsdfSample mirrorSample(const RTMaterial& mat, CpuScatterEvent& event) const;
+
+    vec3          conductorF(const RTMaterial& mat, const CpuScatterEvent& event, bool schlick) const;
+    float         conductorPdf(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    CpuBsdfSample conductorSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng, bool schlick) const;
+
+    vec3          plasticF(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    float         plasticPdf(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    CpuBsdfSample plasticSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const;
+
+    vec3          dielectricF(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    float         dielectricPdf(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    CpuBsdfSample dielectricSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const;
+
+    vec3          clearcoatF(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    float         clearcoatPdf(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    CpuBsdfSample clearcoatSample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const;
+
+    vec3          disneyF(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    float         disneyPdf(const RTMaterial& mat, const CpuScatterEvent& event) const;
+    CpuBsdfSample disneySample(const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const;
+
+    const CpuScene& scene;
+};
@@ -0,0 +1,287 @@
+#include "CpuPathIntegrator.h"
+
+#include "imgui.h"
+#include "Common/Timer.h"
+#include "Common/samplerCPP/ThreadPool.h"
+#include "Scene/Compoments/Camera.h"
+
+#include <chrono>
+
+//Offsets and ray extents of raygen.rgen and trace_common.glsl
+static constexpr float EPS  = 1e-5f;
+static constexpr float TMIN = 0.001f;
+static constexpr float TMAX = 10000.0f;
+
+//The pool also runs scene loading and mip generation, by default the passes leave it these threads
+static constexpr int RESERVED_POOL_THREADS = 2;
+
+static float PowerHeuristic(float pdfA, float pdfB) {
+    float a = pdfA * pdfA;
+    float b = pdfB * pdfB;
+    return a + b > 0 ? a / (a + b) : 0;
+}
+
+static bool IsDeltaLight(const RTLight& light) {
+    return light.light_type == RT_LIGHT_TYPE_POINT || light.light_type == RT_LIGHT_TYPE_DIRECTIONAL;
+}
+
+CpuPathIntegrator::CpuPathIntegrator(Device& device, CpuPathTracingConfig _config) : Integrator(device), config(_config) {
+    tileSize       = std::max(config.tile_size, 1);
+    config.threads = std::max(config.threads, 0);
+    if (config.threads == 0)
+        config.threads = std::max(static_cast<int>(ThreadPool::GetThreadPool().size()) - RESERVED_POOL_THREADS, 1);
+}
+
+CpuPathIntegrator::~CpuPathIntegrator() {
+    cancelPass();
+}
+
+void CpuPathIntegrator::initScene(RTSceneEntry& entry) {
+    cancelPass();
+    Integrator::initScene(entry);
+    cpuScene.build(device, entry);
+
+    accumulation.assign(width * height, vec3(0));
+    pendingImage.assign(width * height, vec4(0));
+    resolved.assign(width * height, vec4(0, 0, 0, 1));
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+
+    uploadBuffers.resize(renderContext->getFramesInFlight());
+    for (auto& uploadBuffer : uploadBuffers)
+        uploadBuffer = std::make_unique<Buffer>(device, sizeof(vec4) * width * height, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    uploadVersions.assign(uploadBuffers.size(), UINT64_MAX);
+    resolvedVersion = 0;
+    restart();
+}
+
+void CpuPathIntegrator::render(RenderGraph& renderGraph) {
+    if (getPC().first_frame) {
+        //The render threads read the lights, the environment map changes only between passes
+        cancelPass();
+        cpuScene.updateLights(*entry_);
+        restart();
+    }
+    else if (getPC().frame_num == 0)
+        restart();
+
+    if (pass.valid() && pass.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        if (pass.get()) {
+            std::swap(resolved, pendingImage);
+            resolvedVersion++;
+            lastPassMs = passMs;
+            if (!passStale)
+                sampleCount++;
+        }
+        passStale = false;
+    }
+    if (!pass.valid() && (config.max_samples <= 0 || sampleCount < static_cast<uint32_t>(config.max_samples)))
+        startPass();
+
+    uint32_t frameIndex = renderContext->getActiveFrameIndex();
+    if (uploadVersions[frameIndex] != resolvedVersion) {
+        uploadBuffers[frameIndex]->uploadData(resolved.data(), sizeof(vec4) * resolved.size());
+        uploadVersions[frameIndex] = resolvedVersion;
+    }
+
+    auto output = renderGraph.getBlackBoard().getHandle(RT_IMAGE_NAME);
+    renderGraph.addComputePass(
+        "CPU PT upload",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            builder.writeTexture(output, TextureUsage::TRANSFER_DST);
+        },
+        [this, frameIndex](RenderPassContext& context) {
+            VkBufferImageCopy region{};
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            region.imageExtent      = {width, height, 1};
+            context.commandBuffer.copyBufferToImage(*uploadBuffers[frameIndex], context.renderGraph.getBlackBoard().getImage(RT_IMAGE_NAME), {region});
+        });
+}
+
+void CpuPathIntegrator::startPass() {
+    PassSettings settings{
+        .viewInverse = camera->viewInverse(),
+        .projInverse = camera->projInverse(),
+        .minDepth    = static_cast<uint32_t>(std::max(config.min_depth, 0)),
+        .maxDepth    = static_cast<uint32_t>(std::max(config.max_depth, 0)),
+        .sampleBsdf  = config.sample_bsdf,
+        .sampleLight = config.sample_light,
+        .sampleIndex = sampleCount,
+    };
+    pass = ThreadPool::GetThreadPool().push([this, settings](int) { return renderPass(settings); });
+}
+
+void CpuPathIntegrator::cancelPass() {
+    if (!pass.valid())
+        return;
+    cancel = true;
+    pass.get();
+    cancel    = false;
+    passStale = false;
+}
+
+void CpuPathIntegrator::restart() {
+    sampleCount = 0;
+    passStale   = pass.valid();
+}
+
+bool CpuPathIntegrator::renderPass(const PassSettings& settings) {
+    Timer timer;
+    timer.start();
+    ThreadPool::ParallelFor(tilesX * tilesY, [this, &settings](uint32_t tileIdx) { renderTile(settings, tileIdx); }, config.threads);
+    if (cancel)
+        return false;
+
+    float sampleWeight = 1.0f / float(settings.sampleIndex + 1);
+    ThreadPool::ParallelFor(
+        height, [this, sampleWeight](uint32_t y) {
+            for (uint32_t x = 0; x < width; x++)
+                pendingImage[y * width + x] = vec4(accumulation[y * width + x] * sampleWeight, 1);
+        },
+        config.threads);
+    passMs = timer.stop<Timer::Milliseconds>();
+    return true;
+}
+
+void CpuPathIntegrator::renderTile(const PassSettings& settings, uint32_t tileIdx) {
+    if (cancel)
+        return;
+    uint32_t x0 = tileIdx % tilesX * tileSize;
+    uint32_t y0 = tileIdx / tilesX * tileSize;
+    uint32_t x1 = std::min(x0 + tileSize, width);
+    uint32_t y1 = std::min(y0 + tileSize, height);
+    for (uint32_t y = y0; y < y1; y++)
+        for (uint32_t x = x0; x < x1; x++) {
+            vec3 color = tracePath(settings, x, y);
+            //A single nan or inf sample would stay in the pixel for the whole accumulation
+            if (glm::any(glm::isnan(color)) || glm::any(glm::isinf(color)))
+                color = vec3(0);
+            vec3& sum = accumulation[y * width + x];
+            sum       = settings.sampleIndex == 0 ? color : sum + color;
+        }
+}
+
+vec3 CpuPathIntegrator::tracePath(const PassSettings& settings, uint32_t x, uint32_t y) const {
+    CpuRng rng{uvec4(x, y, settings.sampleIndex, 0)};
+
+    vec2 uv     = (vec2(x, y) + vec2(0.5f)) / vec2(width, height);
+    vec2 d      = uv * 2.0f - 1.0f;
+    vec4 target = settings.projInverse * vec4(d.x, d.y, 1, 1);
+
+    CpuRay ray;
+    ray.origin    = vec3(settings.viewInverse * vec4(0, 0, 0, 1));
+    ray.direction = glm::normalize(vec3(settings.viewInverse * vec4(glm::normalize(vec3(target) / target.w), 0)));
+    ray.tMin      = TMIN;
+    ray.tMax      = TMAX;
+
+    vec3 throughput(1.0f);
+    vec3 color(0.0f);
+    bool specularBounce = true;
+
+    for (uint32_t depth = 0; depth < settings.maxDepth; depth++) {
+        CpuHit hit;
+        if (!cpuScene.intersect(ray, hit)) {
+            if (specularBounce)
+                color += throughput * cpuScene.evalEnvironment(ray.direction);
+            break;
+        }
+
+        const RTMaterial& mat = cpuScene.getMaterial(hit.materialIdx);
+        vec3              wo  = -ray.direction;
+        vec3              n_s = hit.n_s;
+        if (glm::dot(wo, n_s) < 0 && !CpuBsdf::isTwoSided(mat))
+            n_s = -n_s;
+
+        CpuScatterEvent event;
+        event.frame       = CpuFrame::make(n_s);
+        event.wo          = event.frame.toLocal(wo);
+        event.p           = hit.p;
+        event.uv          = hit.uv;
+        event.materialIdx = hit.materialIdx;
+
+        if (specularBounce) {
+            int32_t lightIdx = cpuScene.getPrimitiveLight(hit.primIdx);
+            if (lightIdx >= 0)
+                color += throughput * cpuScene.evalLight(cpuScene.getLight(lightIdx), hit.n_s, ray.direction);
+        }
+
+        if (depth >= settings.minDepth)
+            color += throughput * sampleOneLight(settings, mat, event, rng);
+
+        CpuBsdfSample sample = bsdf.sample(mat, event, rng);
+        specularBounce       = (sample.flags & RT_BSDF_LOBE_SPECULAR) != 0;
+        if (sample.f == vec3(0) || sample.pdf == 0)
+            break;
+        throughput *= sample.f / sample.pdf;
+
+        ray.direction = event.frame.toWorld(event.wi);
+        ray.origin    = event.p + ray.direction * EPS;
+    }
+    return color;
+}
+
+vec3 CpuPathIntegrator::sampleOneLight(const PassSettings& settings, const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const {
+    uint32_t lightCount = cpuScene.getLightCount();
+    float    lightRand  = rng.next1();
+    vec3     sampleRand = rng.next3();
+    if (lightCount == 0 || CpuBsdf::isSpecular(mat))
+        return vec3(0);
+
+    const RTLight& light      = cpuScene.getLight(std::min(static_cast<uint32_t>(lightRand * lightCount), lightCount - 1));
+    bool           sampleBsdf = settings.sampleBsdf && !IsDeltaLight(light);
+    vec3           result(0);
+
+    if (settings.sampleLight) {
+        CpuLightSample lightSample = cpuScene.sampleLight(light, event.p, sampleRand);
+        if (lightSample.intensity != vec3(0) && lightSample.pdf > 0) {
+            CpuRay shadowRay{event.p, lightSample.wi, EPS, lightSample.dist - EPS};
+            if (!cpuScene.occluded(shadowRay)) {
+                event.wi        = event.frame.toLocal(lightSample.wi);
+                float bsdfPdf   = bsdf.pdf(mat, event);
+                float misWeight = sampleBsdf ? PowerHeuristic(lightSample.pdf, bsdfPdf) : 1.0f;
+                result += lightSample.intensity * bsdf.eval(mat, event) * misWeight / lightSample.pdf;
+            }
+        }
+    }
+
+    if (sampleBsdf) {
+        CpuBsdfSample sample = bsdf.sample(mat, event, rng);
+        //Delta lobes reach lights through the emission the path adds after a specular bounce, not twice
+        if ((sample.flags & RT_BSDF_LOBE_SPECULAR) == 0 && sample.f != vec3(0) && sample.pdf > 0) {
+            vec3   wi = event.frame.toWorld(event.wi);
+            CpuRay ray{event.p + wi * EPS, wi, 0, TMAX};
+            CpuHit lightHit;
+            bool   hit       = cpuScene.intersect(ray, lightHit);
+            bool   sameLight = light.light_type == RT_LIGHT_TYPE_INFINITE ? !hit : hit && lightHit.primIdx == light.prim_idx;
+            if (sameLight) {
+                float lightPdf  = cpuScene.lightPdf(light, event.p, lightHit.p, lightHit.n_s, wi);
+                float misWeight = settings.sampleLight ? PowerHeuristic(sample.pdf, lightPdf) : 1.0f;
+                result += sample.f * cpuScene.evalLight(light, lightHit.n_s, wi) * misWeight / sample.pdf;
+            }
+        }
+    }
+    return result * float(lightCount);
+}
+
+void CpuPathIntegrator::onUpdateGUI() {
+    int  maxDepth = config.max_depth;
+    int  minDepth = config.min_depth;
+    bool changed  = false;
+    ImGui::SliderInt("Min Depth", &minDepth, 0, config.max_depth);
+    ImGui::SliderInt("Max Depth", &maxDepth, 1, 10);
+    if (maxDepth != config.max_depth || minDepth != config.min_depth) {
+        config.max_depth = maxDepth;
+        config.min_depth = minDepth;
+        changed          = true;
+    }
+    changed |= ImGui::Checkbox("Sample BSDF", &config.sample_bsdf);
+    ImGui::SameLine();
+    changed |= ImGui::Checkbox("Sample Light", &config.sample_light);
+    if (changed)
+        restart();
+    ImGui::Text("samples %5d, %.1f ms per pass", sampleCount, lastPassMs);
+}
+
+bool CpuPathIntegrator::resetFrameOnCameraMove() const {
+    return true;
+}
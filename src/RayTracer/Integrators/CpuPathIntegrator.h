@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Integrator.h"
+#include "CpuBsdf.h"
+#include "Common/RenderConfig.h"
+#include "../Utils/CpuScene.h"
+
+#include <atomic>
+#include <future>
+
+/**
+ * Reference path tracer on the cpu threads, the estimator of the PT integrator over a cpu copy of the scene.
+ * Passes of one sample per pixel run in the background on the thread pool, the render threads claim tiles of the image
+ * as they finish the previous one. Every completed pass is averaged into the RT image through a per frame upload buffer,
+ * the frame never waits for a pass. Needs no ray tracing hardware, the ray tracer falls back to it without.
+ */
+class CpuPathIntegrator : public Integrator {
+public:
+    CpuPathIntegrator(Device& device, CpuPathTracingConfig config);
+    ~CpuPathIntegrator() override;
+
+    //No gpu pipelines
+    void init() override {}
+    void initScene(RTSceneEntry& entry) override;
+    void render(RenderGraph& renderGraph) override;
+    void onUpdateGUI() override;
+    bool resetFrameOnCameraMove() const override;
+
+protected:
+    //Everything a pass reads from the main thread, copied when the pass starts
+    struct PassSettings {
+        mat4     viewInverse;
+        mat4     projInverse;
+        uint32_t minDepth;
+        uint32_t maxDepth;
+        bool     sampleBsdf;
+        bool     sampleLight;
+        uint32_t sampleIndex;
+    };
+
+    void startPass();
+    //Stops the running pass at its next tile and waits for it
+    void cancelPass();
+    //Accumulation starts over with the next pass, a running pass still shows its image
+    void restart();
+    //false when the pass was cancelled
+    bool renderPass(const PassSettings& settings);
+    void renderTile(const PassSettings& settings, uint32_t tileIdx);
+    vec3 tracePath(const PassSettings& settings, uint32_t x, uint32_t y) const;
+    vec3 sampleOneLight(const PassSettings& settings, const RTMaterial& mat, CpuScatterEvent& event, CpuRng& rng) const;
+
+    CpuPathTracingConfig config;
+    CpuScene             cpuScene;
+    CpuBsdf              bsdf{cpuScene};
+
+    //Radiance sums of the samples so far, the first sample of an accumulation overwrites them
+    std::vector<vec3> accumulation;
+    //Average written by the pass, swapped with the image the main thread uploads when the pass completes
+    std::vector<vec4> pendingImage;
+    std::vector<vec4> resolved;
+    uint32_t          tileSize{32};
+    uint32_t          tilesX{0};
+    uint32_t          tilesY{0};
+
+    std::future<bool> pass;
+    std::atomic<bool> cancel{false};
+    //The accumulation restarted while the pass ran, its samples do not count
+    bool              passStale{false};
+    uint32_t          sampleCount{0};
+    //Written by the pass, read after it completed
+    float             passMs{0};
+    float             lastPassMs{0};
+
+    //Resolved image versions, a frame in flight copies its buffer again only when it is out of date
+    std::vector<std::unique_ptr<Buffer>> uploadBuffers;
+    std::vector<uint64_t>                uploadVersions;
+    uint64_t                             resolvedVersion{0};
+};
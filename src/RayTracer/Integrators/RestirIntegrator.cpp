@@ -51,7 +51,7 @@ void RestirIntegrator::render(RenderGraph& renderGraph) {
         settings.rTPipelineSettings.maxDepth = 5;
     
     
-        auto output = renderGraph.createTexture(RT_IMAGE_NAME,{width,height,TextureUsage::STORAGE | TextureUsage::TRANSFER_SRC | TextureUsage::SAMPLEABLE,VK_FORMAT_R32G32B32A32_SFLOAT});
+        auto output = renderGraph.createTexture(RT_IMAGE_NAME,{width,height,TextureUsage::STORAGE | TextureUsage::TRANSFER_SRC | TextureUsage::SAMPLEABLE,VK_FORMAT_R32G32B32A32_SFLOAT,true});
         builder.writeTexture(output,TextureUsage::STORAGE);
         renderGraph.getBlackBoard().put(RT_IMAGE_NAME,output); }, [&](RenderPassContext& context) {
             bindRaytracingResources(commandBuffer);
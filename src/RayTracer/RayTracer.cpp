@@ -11,6 +11,7 @@
 #include "Common/ResourceCache.h"
 #include "Common/VkCommon.h"
 #include "Core/Shader/GlslCompiler.h"
+#include "Integrators/CpuPathIntegrator.h"
 #include "Integrators/DDGIIntegrator.h"
 #include "Integrators/PathIntegrator.h"
 #include "Integrators/RestirIntegrator.h"
@@ -43,7 +44,7 @@ void RayTracer::drawFrame(RenderGraph& renderGraph) {
     rtSceneEntry->sceneUboBuffer->uploadData(&sceneUbo, sizeof(sceneUbo));
 
     lastFrameSceneUbo = sceneUbo;
-    renderGraph.createTexture(RT_IMAGE_NAME, {integrators[currentIntegrator]->width, integrators[currentIntegrator]->height, TextureUsage::STORAGE | TextureUsage::TRANSFER_SRC | TextureUsage::SAMPLEABLE | TextureUsage::COLOR_ATTACHMENT, VK_FORMAT_R32G32B32A32_SFLOAT});
+    renderGraph.createTexture(RT_IMAGE_NAME, {integrators[currentIntegrator]->width, integrators[currentIntegrator]->height, TextureUsage::STORAGE | TextureUsage::TRANSFER_SRC | TextureUsage::TRANSFER_DST | TextureUsage::SAMPLEABLE | TextureUsage::COLOR_ATTACHMENT, VK_FORMAT_R32G32B32A32_SFLOAT, true});
     integrators[currentIntegrator]->render(renderGraph);
     if (renderGraph.getBlackBoard().contains(RT_IMAGE_NAME))
         renderGraph.addImageCopyPass(renderGraph.getBlackBoard().getHandle(RT_IMAGE_NAME), renderGraph.getBlackBoard().getHandle(RENDER_VIEW_PORT_IMAGE_NAME));
@@ -96,8 +97,11 @@ void RayTracer::prepare() {
 
     pcPath = std::make_shared<PCPath>();
     
-    integrators[to_string(ePathTracing)] = std::make_unique<PathIntegrator>(*device, config.getPathTracingConfig());
-    integrators[to_string(eDDGI)]        = std::make_unique<DDGIIntegrator>(*device, config.getDDGIConfig());
+    if (device->isRayTracingSupported()) {
+        integrators[to_string(ePathTracing)] = std::make_unique<PathIntegrator>(*device, config.getPathTracingConfig());
+        integrators[to_string(eDDGI)]        = std::make_unique<DDGIIntegrator>(*device, config.getDDGIConfig());
+    }
+    integrators[to_string(eCpuPathTracing)] = std::make_unique<CpuPathIntegrator>(*device, config.getCpuPathTracingConfig());
 
     for (auto& integrator : integrators) {
         integratorNames.push_back(integrator.first);
@@ -105,6 +109,10 @@ void RayTracer::prepare() {
     }
 
     currentIntegrator = to_string(config.getIntegratorType());
+    if (!integrators.contains(currentIntegrator)) {
+        LOGW("Integrator {} is not available on this device, rendering with {}", currentIntegrator, to_string(eCpuPathTracing));
+        currentIntegrator = to_string(eCpuPathTracing);
+    }
 
     sceneLoadingConfig = {.requiredVertexAttribute = {POSITION_ATTRIBUTE_NAME, INDEX_ATTRIBUTE_NAME, NORMAL_ATTRIBUTE_NAME, TEXCOORD_ATTRIBUTE_NAME},
                           .enableMergeDrawCalls    = false,
@@ -159,6 +167,9 @@ int main( int argc, char* argv[] ) {
     else json = JsonUtil::fromFile(FileUtils::getResourcePath("render.json"));
     
     RayTracer rayTracer(json);
+    //Benchmark options follow the render json
+    if (argc > 1)
+        rayTracer.parseCommandLine(argc - 1, argv + 1);
     rayTracer.prepare();
     rayTracer.mainloop();
     return 0;
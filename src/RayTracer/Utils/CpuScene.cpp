@@ -0,0 +1,637 @@
+#include "CpuScene.h"
+
+#include "Common/Log.h"
+#include "Common/Timer.h"
+#include "Core/Device/Device.h"
+#include "Core/RenderContext.h"
+#include "Scene/SgImage.h"
+
+#include <gtc/packing.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+static constexpr float    PI           = 3.14159265359f;
+static constexpr uint32_t BVH_BINS     = 16;
+static constexpr uint32_t BVH_MAX_LEAF = 8;
+
+//Host visible buffers are mapped directly, device local ones go through a staging copy like getTFromGpuBuffer
+template<typename T>
+static std::vector<T> ReadBuffer(Device& device, Buffer& buffer) {
+    if (buffer.getMemoryUsage() != VMA_MEMORY_USAGE_GPU_ONLY)
+        return buffer.getData<T>();
+    Buffer        stagingBuffer(device, buffer.getSize(), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+    CommandBuffer commandBuffer = device.createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    VkBufferCopy  copyRegion{0, 0, buffer.getSize()};
+    vkCmdCopyBuffer(commandBuffer.getHandle(), buffer.getHandle(), stagingBuffer.getHandle(), 1, &copyRegion);
+    g_context->submit(commandBuffer, true);
+    stagingBuffer.invalidate();
+    return stagingBuffer.getData<T>();
+}
+
+//Level 0 of a texture whose cpu data was freed after upload
+struct TextureReadback {
+    SgImage*                image;
+    std::vector<uint8_t>*   data;
+    std::unique_ptr<Buffer> buffer;
+};
+
+//Copies level 0 of every texture into its buffer in a single submit
+static void ReadTextures(Device& device, std::vector<TextureReadback>& readbacks) {
+    if (readbacks.empty())
+        return;
+    CommandBuffer commandBuffer = device.createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    for (auto& readback : readbacks) {
+        auto&                   image = readback.image->getVkImage();
+        VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        image.transitionLayout(commandBuffer, VulkanLayout::TRANSFER_SRC, range);
+        VkBufferImageCopy region{};
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent      = readback.image->getExtent();
+        vkCmdCopyImageToBuffer(commandBuffer.getHandle(), image.getHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer->getHandle(), 1, &region);
+        image.transitionLayout(commandBuffer, VulkanLayout::READ_ONLY, range);
+    }
+    g_context->submit(commandBuffer, true);
+    for (auto& readback : readbacks) {
+        readback.buffer->invalidate();
+        *readback.data = readback.buffer->getData<uint8_t>();
+        readback.data->resize(readback.buffer->getSize());
+    }
+}
+
+static float SrgbToLinear(uint8_t value) {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> result{};
+        for (uint32_t i = 0; i < 256; i++) {
+            float c   = i / 255.0f;
+            result[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return result;
+    }();
+    return table[value];
+}
+
+static float SurfaceArea(const vec3& boundsMin, const vec3& boundsMax) {
+    vec3 extent = boundsMax - boundsMin;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+//Entry distance of the ray into the box, INFINITY on a miss
+static float IntersectBounds(const vec3& boundsMin, const vec3& boundsMax, const CpuRay& ray, const vec3& invDir, float tMax) {
+    vec3  t0    = (boundsMin - ray.origin) * invDir;
+    vec3  t1    = (boundsMax - ray.origin) * invDir;
+    vec3  tNear = glm::min(t0, t1);
+    vec3  tFar  = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, ray.tMin));
+    float exit  = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    return enter <= exit ? enter : INFINITY;
+}
+
+vec4 CpuScene::Texture::fetch(uint32_t x, uint32_t y) const {
+    size_t texel = size_t(y) * width + x;
+    switch (encoding) {
+        case Encoding::UNORM8:
+        case Encoding::SRGB8:
+        case Encoding::BGRA_UNORM8:
+        case Encoding::BGRA_SRGB8: {
+            const uint8_t* c    = &data[texel * 4];
+            bool           bgra = encoding == Encoding::BGRA_UNORM8 || encoding == Encoding::BGRA_SRGB8;
+            uint8_t        r    = bgra ? c[2] : c[0];
+            uint8_t        b    = bgra ? c[0] : c[2];
+            if (encoding == Encoding::SRGB8 || encoding == Encoding::BGRA_SRGB8)
+                return vec4(SrgbToLinear(r), SrgbToLinear(c[1]), SrgbToLinear(b), c[3] / 255.0f);
+            return vec4(r, c[1], b, c[3]) / 255.0f;
+        }
+        case Encoding::HALF: {
+            const auto* h = reinterpret_cast<const uint16_t*>(data.data()) + texel * 4;
+            return vec4(glm::unpackHalf1x16(h[0]), glm::unpackHalf1x16(h[1]), glm::unpackHalf1x16(h[2]), glm::unpackHalf1x16(h[3]));
+        }
+        case Encoding::FLOAT: {
+            const auto* f = reinterpret_cast<const float*>(data.data()) + texel * 4;
+            return vec4(f[0], f[1], f[2], f[3]);
+        }
+        default:
+            return vec4(1);
+    }
+}
+
+void CpuScene::build(Device& device, RTSceneEntry& entry) {
+    Timer timer;
+    timer.start();
+
+    positions  = ReadBuffer<vec3>(device, *entry.vertexBuffer);
+    normals    = ReadBuffer<vec3>(device, *entry.normalBuffer);
+    uvs        = ReadBuffer<vec2>(device, *entry.uvBuffer);
+    indices    = ReadBuffer<uint32_t>(device, *entry.indexBuffer);
+    primitives = entry.primitives;
+    materials  = entry.materials;
+
+    normalMatrices.resize(primitives.size());
+    handedness.resize(primitives.size());
+    triangles.clear();
+    for (uint32_t primIdx = 0; primIdx < primitives.size(); primIdx++) {
+        const auto& prim        = primitives[primIdx];
+        glm::mat3   world       = glm::mat3(prim.world_matrix);
+        normalMatrices[primIdx] = glm::transpose(glm::inverse(world));
+        handedness[primIdx]     = glm::determinant(world) < 0 ? -1.0f : 1.0f;
+        for (uint32_t triangleIdx = 0; triangleIdx < prim.index_count / 3; triangleIdx++) {
+            uint32_t base = prim.index_offset + 3 * triangleIdx;
+            vec3     p0   = prim.world_matrix * vec4(positions[indices[base + 0] + prim.vertex_offset], 1.0f);
+            vec3     p1   = prim.world_matrix * vec4(positions[indices[base + 1] + prim.vertex_offset], 1.0f);
+            vec3     p2   = prim.world_matrix * vec4(positions[indices[base + 2] + prim.vertex_offset], 1.0f);
+            triangles.push_back({p0, p1 - p0, p2 - p0, primIdx, triangleIdx});
+        }
+    }
+    buildBvh();
+    updateLights(entry);
+
+    LOGI("Cpu scene: {} triangles, {} bvh nodes, {} textures in {:.1f} ms", triangles.size(), nodes.size(), textures.size(), timer.stop<Timer::Milliseconds>());
+}
+
+void CpuScene::updateLights(RTSceneEntry& entry) {
+    lights   = entry.lights;
+    envAccel = entry.envAccel;
+
+    textures.clear();
+    //Element addresses are kept by the readbacks
+    textures.reserve(entry.scene->getTextures().size());
+    std::vector<TextureReadback> readbacks;
+    for (const auto& texture : entry.scene->getTextures()) {
+        Texture& copy   = textures.emplace_back();
+        auto     extent = texture->image->getExtent2D();
+        copy.width      = extent.width;
+        copy.height     = extent.height;
+
+        size_t texelSize = 4;
+        switch (texture->image->getFormat()) {
+            case VK_FORMAT_R8G8B8A8_UNORM: copy.encoding = Texture::Encoding::UNORM8; break;
+            case VK_FORMAT_R8G8B8A8_SRGB: copy.encoding = Texture::Encoding::SRGB8; break;
+            case VK_FORMAT_B8G8R8A8_UNORM: copy.encoding = Texture::Encoding::BGRA_UNORM8; break;
+            case VK_FORMAT_B8G8R8A8_SRGB: copy.encoding = Texture::Encoding::BGRA_SRGB8; break;
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+                copy.encoding = Texture::Encoding::HALF;
+                texelSize     = 8;
+                break;
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                copy.encoding = Texture::Encoding::FLOAT;
+                texelSize     = 16;
+                break;
+            default: copy.encoding = Texture::Encoding::NONE; break;
+        }
+
+        //The first mip level starts the data. The loader frees it after the upload except for hdr images, the other
+        //textures read level 0 back from the gpu below. Virtual textures have no full level 0 on either side
+        const auto& data = texture->image->getData();
+        size_t      size = size_t(copy.width) * copy.height * texelSize;
+        if (copy.encoding == Texture::Encoding::NONE || !texture->virtualTexturePath.empty()) {
+            copy.encoding = Texture::Encoding::NONE;
+            continue;
+        }
+        if (data.size() >= size)
+            copy.data.assign(data.begin(), data.begin() + size);
+        else
+            readbacks.push_back({texture->image.get(), &copy.data, std::make_unique<Buffer>(g_context->getDevice(), size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU)});
+    }
+    ReadTextures(g_context->getDevice(), readbacks);
+
+    envLightIdx = int32_t(entry.sceneDesc.envmap_idx);
+    if (envLightIdx >= int32_t(lights.size()) || (envLightIdx >= 0 && !hasTexture(lights[envLightIdx].light_texture_id)))
+        envLightIdx = -1;
+
+    primitiveLights.assign(primitives.size(), -1);
+    areaLights.clear();
+    for (uint32_t lightIdx = 0; lightIdx < lights.size(); lightIdx++) {
+        const auto& light = lights[lightIdx];
+        if (light.light_type != RT_LIGHT_TYPE_AREA || light.prim_idx >= primitives.size())
+            continue;
+        primitiveLights[light.prim_idx] = int32_t(lightIdx);
+        buildAreaLight(light.prim_idx);
+    }
+}
+
+void CpuScene::buildAreaLight(uint32_t primIdx) {
+    const auto&        prim = primitives[primIdx];
+    std::vector<float> areas(prim.index_count / 3);
+    for (uint32_t triangleIdx = 0; triangleIdx < areas.size(); triangleIdx++) {
+        uint32_t base      = prim.index_offset + 3 * triangleIdx;
+        vec3     p0        = prim.world_matrix * vec4(positions[indices[base + 0] + prim.vertex_offset], 1.0f);
+        vec3     p1        = prim.world_matrix * vec4(positions[indices[base + 1] + prim.vertex_offset], 1.0f);
+        vec3     p2        = prim.world_matrix * vec4(positions[indices[base + 2] + prim.vertex_offset], 1.0f);
+        areas[triangleIdx] = 0.5f * glm::length(glm::cross(p1 - p0, p2 - p0));
+    }
+    float area = std::accumulate(areas.begin(), areas.end(), 0.0f);
+    if (area <= 0)
+        return;
+    areaLights[primIdx] = {std::make_unique<Distribution1D>(areas.data(), int(areas.size())), area};
+}
+
+void CpuScene::updateBounds(BvhNode& node) const {
+    node.boundsMin = vec3(INFINITY);
+    node.boundsMax = vec3(-INFINITY);
+    for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+        const auto& tri = triangles[i];
+        node.boundsMin  = glm::min(node.boundsMin, glm::min(tri.p0, glm::min(tri.p0 + tri.e1, tri.p0 + tri.e2)));
+        node.boundsMax  = glm::max(node.boundsMax, glm::max(tri.p0, glm::max(tri.p0 + tri.e1, tri.p0 + tri.e2)));
+    }
+}
+
+void CpuScene::buildBvh() {
+    nodes.clear();
+    if (triangles.empty())
+        return;
+
+    std::vector<vec3> centroids(triangles.size());
+    for (uint32_t i = 0; i < triangles.size(); i++)
+        centroids[i] = triangles[i].p0 + (triangles[i].e1 + triangles[i].e2) / 3.0f;
+
+    nodes.reserve(2 * triangles.size());
+    nodes.push_back({.offset = 0, .count = toUint32(triangles.size())});
+    updateBounds(nodes[0]);
+
+    //Explicit stack of node and depth, traversal stacks are MAX_BVH_DEPTH deep
+    std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};
+    while (!stack.empty()) {
+        auto [nodeIdx, depth] = stack.back();
+        stack.pop_back();
+        if (depth + 1 >= MAX_BVH_DEPTH || !splitNode(nodeIdx, centroids))
+            continue;
+        stack.emplace_back(nodes[nodeIdx].offset, depth + 1);
+        stack.emplace_back(nodes[nodeIdx].offset + 1, depth + 1);
+    }
+}
+
+bool CpuScene::splitNode(uint32_t nodeIdx, std::vector<vec3>& centroids) {
+    BvhNode node = nodes[nodeIdx];
+    if (node.count <= 2)
+        return false;
+
+    vec3 centroidMin(INFINITY), centroidMax(-INFINITY);
+    for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+        centroidMin = glm::min(centroidMin, centroids[i]);
+        centroidMax = glm::max(centroidMax, centroids[i]);
+    }
+
+    struct Bin {
+        vec3     boundsMin{INFINITY};
+        vec3     boundsMax{-INFINITY};
+        uint32_t count{0};
+    };
+
+    float bestCost  = INFINITY;
+    int   bestAxis  = -1;
+    int   bestSplit = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = centroidMax[axis] - centroidMin[axis];
+        if (extent <= 0)
+            continue;
+        float                     scale = BVH_BINS / extent;
+        std::array<Bin, BVH_BINS> bins{};
+        for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+            uint32_t    b   = std::min(BVH_BINS - 1, uint32_t((centroids[i][axis] - centroidMin[axis]) * scale));
+            const auto& tri = triangles[i];
+            bins[b].count++;
+            bins[b].boundsMin = glm::min(bins[b].boundsMin, glm::min(tri.p0, glm::min(tri.p0 + tri.e1, tri.p0 + tri.e2)));
+            bins[b].boundsMax = glm::max(bins[b].boundsMax, glm::max(tri.p0, glm::max(tri.p0 + tri.e1, tri.p0 + tri.e2)));
+        }
+
+        //Left sweep stores the cost of everything before each split, the right sweep completes it
+        std::array<float, BVH_BINS - 1> leftCost{};
+        Bin                             left, right;
+        for (uint32_t s = 0; s < BVH_BINS - 1; s++) {
+            left.count += bins[s].count;
+            left.boundsMin = glm::min(left.boundsMin, bins[s].boundsMin);
+            left.boundsMax = glm::max(left.boundsMax, bins[s].boundsMax);
+            leftCost[s]    = left.count ? left.count * SurfaceArea(left.boundsMin, left.boundsMax) : 0;
+        }
+        for (uint32_t s = BVH_BINS - 1; s > 0; s--) {
+            right.count += bins[s].count;
+            right.boundsMin = glm::min(right.boundsMin, bins[s].boundsMin);
+            right.boundsMax = glm::max(right.boundsMax, bins[s].boundsMax);
+            if (right.count == 0 || right.count == node.count)
+                continue;
+            float cost = leftCost[s - 1] + right.count * SurfaceArea(right.boundsMin, right.boundsMax);
+            if (cost < bestCost) {
+                bestCost  = cost;
+                bestAxis  = axis;
+                bestSplit = int(s);
+            }
+        }
+    }
+
+    if (bestAxis < 0)
+        return false;
+    if (bestCost >= node.count * SurfaceArea(node.boundsMin, node.boundsMax) && node.count <= BVH_MAX_LEAF)
+        return false;
+
+    float    scale = BVH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+    uint32_t i     = node.offset;
+    uint32_t j     = node.offset + node.count;
+    while (i < j) {
+        uint32_t b = std::min(BVH_BINS - 1, uint32_t((centroids[i][bestAxis] - centroidMin[bestAxis]) * scale));
+        if (int(b) < bestSplit) {
+            i++;
+        } else {
+            j--;
+            std::swap(triangles[i], triangles[j]);
+            std::swap(centroids[i], centroids[j]);
+        }
+    }
+    uint32_t leftCount = i - node.offset;
+    if (leftCount == 0 || leftCount == node.count)
+        return false;
+
+    uint32_t leftIdx = toUint32(nodes.size());
+    nodes.push_back({.offset = node.offset, .count = leftCount});
+    nodes.push_back({.offset = node.offset + leftCount, .count = node.count - leftCount});
+    updateBounds(nodes[leftIdx]);
+    updateBounds(nodes[leftIdx + 1]);
+    nodes[nodeIdx].offset = leftIdx;
+    nodes[nodeIdx].count  = 0;
+    return true;
+}
+
+//Möller–Trumbore, u and v weight the second and third vertex like the barycentrics of the hit shader
+bool CpuScene::intersectTriangle(const Triangle& triangle, const CpuRay& ray, float& t, float& u, float& v) const {
+    vec3  pvec = glm::cross(ray.direction, triangle.e2);
+    float det  = glm::dot(triangle.e1, pvec);
+    if (det == 0)
+        return false;
+    float invDet = 1.0f / det;
+    vec3  tvec   = ray.origin - triangle.p0;
+    u            = glm::dot(tvec, pvec) * invDet;
+    if (u < 0 || u > 1)
+        return false;
+    vec3 qvec = glm::cross(tvec, triangle.e1);
+    v         = glm::dot(ray.direction, qvec) * invDet;
+    if (v < 0 || u + v > 1)
+        return false;
+    t = glm::dot(triangle.e2, qvec) * invDet;
+    return t > ray.tMin;
+}
+
+bool CpuScene::intersect(const CpuRay& ray, CpuHit& hit) const {
+    if (nodes.empty())
+        return false;
+
+    vec3     invDir  = 1.0f / ray.direction;
+    float    closest = ray.tMax;
+    uint32_t hitIdx  = UINT32_MAX;
+    float    hitU = 0, hitV = 0;
+
+    uint32_t stack[MAX_BVH_DEPTH];
+    uint32_t stackSize = 0;
+    uint32_t nodeIdx   = 0;
+    if (IntersectBounds(nodes[0].boundsMin, nodes[0].boundsMax, ray, invDir, closest) == INFINITY)
+        return false;
+    while (true) {
+        const BvhNode& node = nodes[nodeIdx];
+        if (node.count > 0) {
+            for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                float t, u, v;
+                if (intersectTriangle(triangles[i], ray, t, u, v) && t < closest) {
+                    closest = t;
+                    hitIdx  = i;
+                    hitU    = u;
+                    hitV    = v;
+                }
+            }
+        } else {
+            //Visit the nearer child first, the farther one waits on the stack
+            uint32_t nearIdx  = node.offset;
+            uint32_t farIdx   = node.offset + 1;
+            float    nearDist = IntersectBounds(nodes[nearIdx].boundsMin, nodes[nearIdx].boundsMax, ray, invDir, closest);
+            float    farDist  = IntersectBounds(nodes[farIdx].boundsMin, nodes[farIdx].boundsMax, ray, invDir, closest);
+            if (farDist < nearDist) {
+                std::swap(nearIdx, farIdx);
+                std::swap(nearDist, farDist);
+            }
+            if (nearDist != INFINITY) {
+                if (farDist != INFINITY)
+                    stack[stackSize++] = farIdx;
+                nodeIdx = nearIdx;
+                continue;
+            }
+        }
+        if (stackSize == 0)
+            break;
+        nodeIdx = stack[--stackSize];
+    }
+
+    if (hitIdx == UINT32_MAX)
+        return false;
+    fillHit(hitIdx, closest, hitU, hitV, hit);
+    return true;
+}
+
+bool CpuScene::occluded(const CpuRay& ray) const {
+    if (nodes.empty())
+        return false;
+
+    vec3     invDir = 1.0f / ray.direction;
+    uint32_t stack[MAX_BVH_DEPTH];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& node = nodes[stack[--stackSize]];
+        if (IntersectBounds(node.boundsMin, node.boundsMax, ray, invDir, ray.tMax) == INFINITY)
+            continue;
+        if (node.count > 0) {
+            for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                float t, u, v;
+                if (intersectTriangle(triangles[i], ray, t, u, v) && t < ray.tMax)
+                    return true;
+            }
+        } else {
+            stack[stackSize++] = node.offset;
+            stack[stackSize++] = node.offset + 1;
+        }
+    }
+    return false;
+}
+
+void CpuScene::fillHit(uint32_t triangleIdx, float t, float u, float v, CpuHit& hit) const {
+    const auto& tri  = triangles[triangleIdx];
+    const auto& prim = primitives[tri.primIdx];
+    uint32_t    base = prim.index_offset + 3 * tri.triangleIdx;
+    uint32_t    i0   = indices[base + 0] + prim.vertex_offset;
+    uint32_t    i1   = indices[base + 1] + prim.vertex_offset;
+    uint32_t    i2   = indices[base + 2] + prim.vertex_offset;
+    vec3        bary = vec3(1.0f - u - v, u, v);
+
+    //cross(v2 - v0, v1 - v0) through the normal matrix, the geometric normal of the hit shader
+    hit.n_g = glm::normalize(glm::cross(tri.e2, tri.e1)) * handedness[tri.primIdx];
+    vec3 n  = normals[i0] * bary.x + normals[i1] * bary.y + normals[i2] * bary.z;
+    n       = normalMatrices[tri.primIdx] * n;
+    hit.n_s = glm::dot(n, n) > 0 ? glm::normalize(n) : hit.n_g;
+    hit.p   = tri.p0 + tri.e1 * u + tri.e2 * v;
+    hit.uv  = uvs[i0] * bary.x + uvs[i1] * bary.y + uvs[i2] * bary.z;
+
+    hit.materialIdx = prim.material_index;
+    hit.triangleIdx = tri.triangleIdx;
+    hit.primIdx     = tri.primIdx;
+    hit.dist        = t;
+}
+
+bool CpuScene::hasTexture(int32_t textureId) const {
+    return textureId >= 0 && textureId < int32_t(textures.size()) && textures[textureId].encoding != Texture::Encoding::NONE;
+}
+
+vec4 CpuScene::sampleTexture(int32_t textureId, vec2 uv) const {
+    if (!hasTexture(textureId) || !std::isfinite(uv.x) || !std::isfinite(uv.y))
+        return vec4(1);
+    const auto& texture = textures[textureId];
+
+    uv          = uv - glm::floor(uv);
+    vec2 st     = uv * vec2(texture.width, texture.height) - 0.5f;
+    vec2 base   = glm::floor(st);
+    vec2 weight = st - base;
+    auto wrap   = [](int value, uint32_t size) {
+        int m = value % int(size);
+        return uint32_t(m < 0 ? m + int(size) : m);
+    };
+    uint32_t x0 = wrap(int(base.x), texture.width);
+    uint32_t x1 = wrap(int(base.x) + 1, texture.width);
+    uint32_t y0 = wrap(int(base.y), texture.height);
+    uint32_t y1 = wrap(int(base.y) + 1, texture.height);
+    return glm::mix(glm::mix(texture.fetch(x0, y0), texture.fetch(x1, y0), weight.x), glm::mix(texture.fetch(x0, y1), texture.fetch(x1, y1), weight.x), weight.y);
+}
+
+vec3 CpuScene::evalLight(const RTLight& light, const vec3& n, const vec3& w) const {
+    if (light.light_type == RT_LIGHT_TYPE_AREA)
+        return glm::dot(n, -w) > 0 ? light.L : vec3(0);
+    if (light.light_type == RT_LIGHT_TYPE_INFINITE) {
+        //envdir_to_uv with the transposed world matrix
+        vec3 wLocal = glm::transpose(glm::mat3(light.world_matrix)) * glm::normalize(w);
+        vec2 uv(std::atan2(wLocal.z, wLocal.x) / (2 * PI) + 0.5f, std::acos(std::clamp(-wLocal.y, -1.0f, 1.0f)) / PI);
+        return vec3(sampleTexture(light.light_texture_id, uv));
+    }
+    if (light.light_type == RT_LIGHT_TYPE_POINT)
+        return light.L;
+    return vec3(0);
+}
+
+vec3 CpuScene::evalEnvironment(const vec3& dir) const {
+    if (envLightIdx < 0)
+        return vec3(0);
+    return evalLight(lights[envLightIdx], vec3(0), dir);
+}
+
+CpuLightSample CpuScene::sampleLight(const RTLight& light, const vec3& p, const vec3& rand) const {
+    CpuLightSample sample;
+    if (light.light_type == RT_LIGHT_TYPE_AREA) {
+        auto it = areaLights.find(light.prim_idx);
+        if (it == areaLights.end())
+            return sample;
+        const auto& prim = primitives[light.prim_idx];
+
+        //Triangle proportional to its area, then uniform on it, uniform_sample_on_mesh
+        float    trianglePdf;
+        uint32_t triangleIdx = it->second.triangles->SampleDiscrete(rand.x, &trianglePdf);
+        uint32_t base        = prim.index_offset + 3 * triangleIdx;
+        uint32_t i0          = indices[base + 0] + prim.vertex_offset;
+        uint32_t i1          = indices[base + 1] + prim.vertex_offset;
+        uint32_t i2          = indices[base + 2] + prim.vertex_offset;
+        float    u           = 1 - std::sqrt(rand.y);
+        float    v           = rand.z * std::sqrt(rand.y);
+        vec3     bary        = vec3(1.0f - u - v, u, v);
+
+        vec3 lightP = light.world_matrix * vec4(positions[i0] * bary.x + positions[i1] * bary.y + positions[i2] * bary.z, 1.0f);
+        vec3 n      = glm::normalize(normalMatrices[light.prim_idx] * (normals[i0] * bary.x + normals[i1] * bary.y + normals[i2] * bary.z));
+
+        sample.wi   = lightP - p;
+        sample.dist = glm::length(sample.wi);
+        if (sample.dist <= 0)
+            return sample;
+        sample.wi /= sample.dist;
+        float cosTheta = glm::dot(n, -sample.wi);
+        if (cosTheta <= 1e-4f)
+            return sample;
+        sample.intensity = light.L;
+        sample.pdf       = sample.dist * sample.dist / (it->second.area * cosTheta);
+    } else if (light.light_type == RT_LIGHT_TYPE_INFINITE) {
+        if (!hasTexture(light.light_texture_id))
+            return sample;
+        const auto& texture = textures[light.light_texture_id];
+        uint32_t    size    = texture.width * texture.height;
+        if (envAccel.size() != size)
+            return sample;
+
+        //Alias table lookup of Environment_sample
+        vec3     xi   = rand;
+        uint32_t idx  = std::min(uint32_t(xi.x * float(size)), size - 1);
+        auto     data = envAccel[idx];
+        uint32_t envIdx;
+        float    pdf;
+        if (xi.y < data.q) {
+            envIdx = idx;
+            xi.y /= data.q;
+            pdf = data.pdf;
+        } else {
+            envIdx = data.alias;
+            xi.y   = (xi.y - data.q) / (1.0f - data.q);
+            pdf    = data.aliasPdf;
+        }
+        float u        = (float(envIdx % texture.width) + xi.y) / float(texture.width);
+        float v        = (float(envIdx / texture.width) + xi.z) / float(texture.height);
+        float phi      = (u - 0.5f) * 2 * PI;
+        float theta    = v * PI;
+        float sinTheta = std::sin(theta);
+        if (sinTheta <= 1e-4f)
+            return sample;
+        vec3 wLocal       = vec3(std::cos(phi) * sinTheta, -std::cos(theta), std::sin(phi) * sinTheta);
+        sample.wi         = glm::normalize(glm::mat3(light.world_matrix) * wLocal);
+        sample.pdf        = pdf * float(size) / (2 * PI * PI * sinTheta);
+        sample.intensity  = vec3(sampleTexture(light.light_texture_id, vec2(u, v)));
+        sample.dist       = 1e10f;
+        sample.isInfinite = true;
+    } else if (light.light_type == RT_LIGHT_TYPE_POINT) {
+        sample.wi   = light.position - p;
+        sample.dist = glm::length(sample.wi);
+        if (sample.dist <= 0)
+            return sample;
+        sample.wi /= sample.dist;
+        sample.intensity = light.L / (sample.dist * sample.dist);
+        sample.pdf       = 1;
+        sample.isDelta   = true;
+    } else if (light.light_type == RT_LIGHT_TYPE_DIRECTIONAL) {
+        sample.wi         = glm::normalize(-light.direction);
+        sample.intensity  = light.L;
+        sample.pdf        = 1;
+        sample.dist       = 1e10f;
+        sample.isInfinite = true;
+        sample.isDelta    = true;
+    }
+    return sample;
+}
+
+float CpuScene::lightPdf(const RTLight& light, const vec3& p, const vec3& lightP, const vec3& n, const vec3& wi) const {
+    if (light.light_type == RT_LIGHT_TYPE_AREA) {
+        auto  it       = areaLights.find(light.prim_idx);
+        float cosTheta = glm::dot(n, -wi);
+        if (it == areaLights.end() || cosTheta <= 1e-4f)
+            return 0;
+        vec3 d = lightP - p;
+        return glm::dot(d, d) / (it->second.area * cosTheta);
+    }
+    if (light.light_type == RT_LIGHT_TYPE_INFINITE) {
+        if (!hasTexture(light.light_texture_id))
+            return 0;
+        const auto& texture = textures[light.light_texture_id];
+        uint32_t    size    = texture.width * texture.height;
+        if (envAccel.size() != size)
+            return 0;
+        vec3  wLocal   = glm::transpose(glm::mat3(light.world_matrix)) * wi;
+        float sinTheta = std::sqrt(std::clamp(1 - wLocal.y * wLocal.y, 0.0f, 1.0f));
+        if (sinTheta <= 1e-4f)
+            return 0;
+        float    u = std::atan2(wLocal.z, wLocal.x) / (2 * PI) + 0.5f;
+        float    v = std::acos(std::clamp(-wLocal.y, -1.0f, 1.0f)) / PI;
+        uint32_t x = std::min(uint32_t(std::max(u, 0.0f) * texture.width), texture.width - 1);
+        uint32_t y = std::min(uint32_t(std::max(v, 0.0f) * texture.height), texture.height - 1);
+        return envAccel[y * texture.width + x].pdf * float(size) / (2 * PI * PI * sinTheta);
+    }
+    //Point and directional lights are deltas, bsdf samples never reach them
+    return 0;
+}
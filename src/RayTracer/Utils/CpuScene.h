@@ -0,0 +1,142 @@
+#pragma once
+
+#include "RTSceneUtil.h"
+#include "Common/Distrib.hpp"
+
+#include <glm.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct CpuRay {
+    vec3  origin;
+    vec3  direction;
+    float tMin{0};
+    float tMax{1e10f};
+};
+
+//Same fields as the HitPayload of the gpu closest hit shader
+struct CpuHit {
+    vec3     n_g;
+    vec3     n_s;
+    vec3     p;
+    vec2     uv;
+    uint32_t materialIdx{0};
+    uint32_t triangleIdx{0};
+    uint32_t primIdx{0};
+    float    dist{0};
+};
+
+struct CpuLightSample {
+    vec3  intensity{0};
+    vec3  wi{0};
+    float pdf{0};
+    float dist{0};
+    bool  isInfinite{false};
+    bool  isDelta{false};
+};
+
+/**
+ * Cpu copy of the geometry, materials, lights, textures and environment alias table of a RTSceneEntry. World space
+ * triangles are kept in a binned SAH bvh. Nothing references the scene after build, so the render threads may query it
+ * while the main thread replaces the environment map of the scene.
+ */
+class CpuScene {
+public:
+    void build(Device& device, RTSceneEntry& entry);
+    //Lights and textures again, after the environment map of the entry changed
+    void updateLights(RTSceneEntry& entry);
+
+    bool intersect(const CpuRay& ray, CpuHit& hit) const;
+    bool occluded(const CpuRay& ray) const;
+
+    const RTMaterial& getMaterial(uint32_t materialIdx) const { return materials[materialIdx]; }
+    const RTLight&    getLight(uint32_t lightIdx) const { return lights[lightIdx]; }
+    uint32_t          getLightCount() const { return toUint32(lights.size()); }
+    //Light of an emissive primitive, -1 otherwise
+    int32_t           getPrimitiveLight(uint32_t primIdx) const { return primitiveLights[primIdx]; }
+    uint32_t          getTriangleCount() const { return toUint32(triangles.size()); }
+
+    //Bilinear repeat lookup of the first mip level, vec4(1) for textures in formats the cpu can not decode
+    vec4 sampleTexture(int32_t textureId, vec2 uv) const;
+    bool hasTexture(int32_t textureId) const;
+
+    //Radiance arriving along w at a light point of normal n, eval_light of the shaders. Area lights emit on the side of
+    //their interpolated normal, the normal sample_li_area_light uses, so hits and light samples agree
+    vec3           evalLight(const RTLight& light, const vec3& n, const vec3& w) const;
+    CpuLightSample sampleLight(const RTLight& light, const vec3& p, const vec3& rand) const;
+    //Solid angle pdf of reaching lightP of normal n from p along wi
+    float          lightPdf(const RTLight& light, const vec3& p, const vec3& lightP, const vec3& n, const vec3& wi) const;
+    //Environment radiance along a missed ray, black without an environment map
+    vec3           evalEnvironment(const vec3& dir) const;
+
+protected:
+    struct Triangle {
+        vec3     p0, e1, e2;
+        uint32_t primIdx;
+        uint32_t triangleIdx;
+    };
+
+    struct BvhNode {
+        vec3     boundsMin;
+        //First triangle of a leaf, left child of an inner node, the right child follows it
+        uint32_t offset;
+        vec3     boundsMax;
+        uint32_t count;
+    };
+
+    struct Texture {
+        enum class Encoding : uint8_t {
+            NONE,
+            UNORM8,
+            SRGB8,
+            BGRA_UNORM8,
+            BGRA_SRGB8,
+            HALF,
+            FLOAT,
+        };
+        std::vector<uint8_t> data;
+        uint32_t             width{0};
+        uint32_t             height{0};
+        Encoding             encoding{Encoding::NONE};
+
+        vec4 fetch(uint32_t x, uint32_t y) const;
+    };
+
+    //Emissive primitive of an area light, triangles are chosen proportional to their world space area
+    struct AreaLight {
+        std::unique_ptr<Distribution1D> triangles;
+        float                           area{0};
+    };
+
+    void buildBvh();
+    //Binned SAH split of a node into two children appended to nodes, false keeps the node a leaf
+    bool splitNode(uint32_t nodeIdx, std::vector<vec3>& centroids);
+    void updateBounds(BvhNode& node) const;
+    bool intersectTriangle(const Triangle& triangle, const CpuRay& ray, float& t, float& u, float& v) const;
+    void fillHit(uint32_t triangleIdx, float t, float u, float v, CpuHit& hit) const;
+    void buildAreaLight(uint32_t primIdx);
+
+    std::vector<vec3>     positions;
+    std::vector<vec3>     normals;
+    std::vector<vec2>     uvs;
+    std::vector<uint32_t> indices;
+
+    std::vector<RTPrimitive> primitives;
+    //Inverse transpose of the world matrix and the sign of its determinant per primitive
+    std::vector<glm::mat3> normalMatrices;
+    std::vector<float>     handedness;
+    std::vector<Triangle>  triangles;
+    std::vector<BvhNode>   nodes;
+
+    std::vector<RTMaterial> materials;
+    std::vector<RTLight>    lights;
+    std::vector<int32_t>    primitiveLights;
+    std::vector<Texture>    textures;
+
+    std::unordered_map<uint32_t, AreaLight> areaLights;
+    std::vector<EnvAccel>                   envAccel;
+    int32_t                                 envLightIdx{-1};
+
+    static constexpr uint32_t MAX_BVH_DEPTH = 64;
+};
@@ -64,8 +64,8 @@ RTLight RTSceneEntryImpl::toRTLight(Scene& scene, const SgLight& light) {
         rtLight.light_texture_id    = light.lightProperties.texture_index;
         rtLight.light_type          = RT_LIGHT_TYPE_INFINITE;
         Texture* tex                = scene.getTextures().operator[](rtLight.light_texture_id).get();
-        auto     aceel              = hdrSampling.createEnvironmentAccel(reinterpret_cast<const float*>(tex->image->getData().data()), tex->image->getExtent2D());
-        infiniteSamplingBuffer      = std::make_unique<Buffer>(device, sizeof(EnvAccel) * aceel.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, aceel.data());
+        envAccel                    = hdrSampling.createEnvironmentAccel(reinterpret_cast<const float*>(tex->image->getData().data()), tex->image->getExtent2D());
+        infiniteSamplingBuffer      = std::make_unique<Buffer>(device, sizeof(EnvAccel) * envAccel.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, envAccel.data());
         sceneDesc.env_sampling_addr = infiniteSamplingBuffer->getDeviceAddress();
         sceneDesc.envmap_idx        = lights.size();
     } else if (light.type == LIGHT_TYPE::Directional) {
@@ -78,6 +78,8 @@ RTLight RTSceneEntryImpl::toRTLight(Scene& scene, const SgLight& light) {
     return rtLight;
 }
 RTSceneEntryImpl::~RTSceneEntryImpl() {
+    if (!device.isRayTracingSupported())
+        return;
     for (auto& blas : blases) {
         vkDestroyAccelerationStructureKHR(device.getHandle(), blas.accel, nullptr);
     }
@@ -148,9 +150,11 @@ void RTSceneEntryImpl::initScene(Scene& scene_) {
 
     // primitives.resize(1);
 
-    buildBLAS();
-
-    buildTLAS();
+    //Without ray tracing support only the cpu integrator runs, it builds its own bvh
+    if (device.isRayTracingSupported()) {
+        buildBLAS();
+        buildTLAS();
+    }
 
     std::unordered_map<uint32_t, std::unique_ptr<Buffer>> primAreaBuffers{};
 
@@ -418,8 +422,8 @@ void RTSceneEntryImpl::updateEnvMap(Device& device, EnvMapUpdateData& data) {
             HDRSampling hdrSampling;
             int lightTextureIdx = lights[sceneDesc.envmap_idx].light_texture_id;
             auto &     hdrTexture = scene->getTextures()[lightTextureIdx];
-            auto aceel           = hdrSampling.createEnvironmentAccel(reinterpret_cast<const float*>(hdrTexture->image->getData().data()), hdrTexture->image->getExtent2D());
-            infiniteSamplingBuffer      = std::make_unique<Buffer>(device, sizeof(EnvAccel) * aceel.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, aceel.data());
+            envAccel             = hdrSampling.createEnvironmentAccel(reinterpret_cast<const float*>(hdrTexture->image->getData().data()), hdrTexture->image->getExtent2D());
+            infiniteSamplingBuffer      = std::make_unique<Buffer>(device, sizeof(EnvAccel) * envAccel.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, envAccel.data());
             sceneDesc.env_sampling_addr = infiniteSamplingBuffer->getDeviceAddress();
         } else {
             // int light_idx = lights.size();
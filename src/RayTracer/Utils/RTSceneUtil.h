@@ -41,6 +41,8 @@ struct RTSceneEntry {
     std::vector<RTLight>     lights;
     std::vector<RTPrimitive> primitives;
     std::vector<RTMaterial>  materials;
+    //Alias table of the environment map, the cpu copy of infiniteSamplingBuffer
+    std::vector<EnvAccel> envAccel;
 
     SceneDesc sceneDesc;
 
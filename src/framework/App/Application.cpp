@@ -30,24 +30,34 @@
 #include "Core/SwapChain.h"
 #include <volk.h>
 
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <numeric>
+
 
 /*
  * Initializes window dimensions and application name
- * Calls initWindow to create the application window       
+ * The window is created in initVk, headless benchmarks run without one
  */
 Application::Application(const char* name,
                          uint32_t    width,
                          uint32_t    height,
                          RenderConfig   _config) : mWidth(width), mHeight(height), mAppName(name), config(_config) {
-    initWindow(name, width, height);
+    benchmarkConfig = config.getBenchmarkConfig();
 }
 Application::Application(const char* name,  std::string configPath) :  mAppName(name), config(configPath) {
     mWidth = config.getWindowWidth();
     mHeight = config.getWindowHeight();
-    initWindow(name, mWidth, mHeight);
+    benchmarkConfig = config.getBenchmarkConfig();
 }
 
 Application::~Application() {
+    //Frames in flight may still reference the scene
+    if (device)
+        device->waitIdle();
+    //Encodes the images still in flight
+    readbackQueue.reset();
     scene.reset();
     camera.reset();
     renderContext.reset();
@@ -75,12 +85,40 @@ void Application::initWindow(const char* name, uint32_t width, uint32_t height)
  * - Select physical device
  * - Create logical device
  */
+void Application::parseCommandLine(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg      = argv[i];
+        bool        hasValue = i + 1 < argc;
+        if (arg == "--headless")
+            benchmarkConfig.headless = true;
+        else if (arg == "--frames" && hasValue)
+            benchmarkConfig.frames = std::stoi(argv[++i]);
+        else if (arg == "--warmup" && hasValue)
+            benchmarkConfig.warmup_frames = std::stoi(argv[++i]);
+        else if (arg == "--camera-path" && hasValue)
+            benchmarkConfig.camera_path = argv[++i];
+        else if (arg == "--benchmark-output" && hasValue)
+            benchmarkConfig.output = argv[++i];
+        else if (arg == "--save-png")
+            benchmarkConfig.save_png = true;
+        else if (arg == "--save-exr")
+            benchmarkConfig.save_exr = true;
+        else
+            LOGW("Unknown command line argument {}", arg);
+    }
+    if (benchmarkConfig.headless && benchmarkConfig.frames <= 0)
+        benchmarkConfig.frames = BenchmarkConfig::HEADLESS_FRAMES;
+}
+
 void Application::prepare() {
 
     initLogger();
 
     initVk();
-    initGUI();
+    readbackQueue = std::make_unique<ReadbackQueue>(*renderContext, renderContext->getFramesInFlight() + 1);
+    //Nothing presents the gui without a swap chain
+    if (window)
+        initGUI();
 
     TextureHelper::Initialize();
     RenderPtrManangr::Initalize();
@@ -99,16 +137,18 @@ void Application::prepare() {
  * - Select physical device
  * - Create logical device
  * - Create render context
- * - Create fence for synchronization
  */
 void Application::initVk() {
+    if (!benchmarkConfig.headless)
+        initWindow(mAppName, mWidth, mHeight);
+
     VK_CHECK_RESULT(volkInitialize());
 
     getRequiredInstanceExtensions();
 
   
     _instance = std::make_unique<Instance>(std::string("vulkanApp"), instanceExtensions, validationLayers);
-    surface   = window->createSurface(*_instance);
+    surface   = window ? window->createSurface(*_instance) : VK_NULL_HANDLE;
 
     uint32_t physical_device_count{0};
     VK_CHECK_RESULT(vkEnumeratePhysicalDevices(_instance->getHandle(), &physical_device_count, nullptr));
@@ -125,7 +165,8 @@ void Application::initVk() {
     VK_CHECK_RESULT(
         vkEnumeratePhysicalDevices(_instance->getHandle(), &physical_device_count, physical_devices.data()));
 
-    addDeviceExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (window)
+        addDeviceExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     addDeviceExtension(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
     addDeviceExtension(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
     addDeviceExtension( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
@@ -136,13 +177,14 @@ void Application::initVk() {
     
     
     device = std::make_unique<Device>(physical_devices[0], surface, _instance->getHandle(), deviceExtensions);
+    //Scene buffers are reached through their device addresses in the bindless mode
+    if (config.useBindless()) {
+        device->getResourceCache().enableBindless();
+        sceneLoadingConfig.bufferAddressAble = device->getResourceCache().getBindlessHeap() != nullptr;
+    }
+    sceneLoadingConfig.virtualTexture = config.useVirtualTexture();
 
     createRenderContext();
-
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    VK_CHECK_RESULT(vkCreateFence(device->getHandle(), &fenceInfo, nullptr, &fence));
 }
 
 void Application::initGUI() {
@@ -157,37 +199,144 @@ void Application::initLogger() {
 }
 
 void Application::getRequiredInstanceExtensions() {
-    uint32_t     glfwExtensionsCount = 0;
-    const char** glfwExtensions      = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
-    for (uint32_t i = 0; i < glfwExtensionsCount; i++) {
-        addInstanceExtension(glfwExtensions[i]);
+    if (window) {
+        uint32_t     glfwExtensionsCount = 0;
+        const char** glfwExtensions      = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+        for (uint32_t i = 0; i < glfwExtensionsCount; i++) {
+            addInstanceExtension(glfwExtensions[i]);
+        }
     }
     if (enableValidationLayers)
         addInstanceExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 }
 
 void Application::createRenderContext() {
-    renderContext = std::make_unique<RenderContext>(*device, surface, *window);
+    VkExtent2D extent = window ? window->getExtent() : VkExtent2D{mWidth, mHeight};
+    renderContext     = std::make_unique<RenderContext>(*device, surface, extent, config.getFramesInFlight());
     g_context     = renderContext.get();
 }
 
 void Application::mainloop() {
+    if (benchmarkConfig.frames > 0) {
+        runBenchmark();
+        return;
+    }
+    //Only the window ends the interactive loop
+    if (!window) {
+        LOGW("No frames to render without a window");
+        return;
+    }
     while (!glfwWindowShouldClose(window->getHandle())) {
         glfwPollEvents();
         update();
     }
 }
 
+static double Percentile(std::vector<double> values, double percentile) {
+    if (values.empty())
+        return 0;
+    auto nth = values.begin() + static_cast<size_t>(percentile * (values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+/**
+ * @brief Renders the configured frames along the camera path and writes the cpu and gpu time of every frame.
+ *
+ * - Frames before the scene finished loading are not counted.
+ * - Warmup frames stay at the start of the camera path and are excluded from the summary.
+ * - The gpu time of a frame is read framesInFlight frames later, the last frames are drained after waitIdle.
+ * - The per pass timings of the last frame are written next to the frame timings.
+ */
+void Application::runBenchmark() {
+    benchmarkRunning = true;
+    if (!benchmarkConfig.camera_path.empty())
+        cameraPath.load(benchmarkConfig.camera_path);
+
+    auto pollWindow = [this] {
+        if (!window)
+            return true;
+        glfwPollEvents();
+        return !glfwWindowShouldClose(window->getHandle());
+    };
+
+    //The first frame after loading replaces the camera in onSceneLoaded
+    while (scene && (sceneFirstLoad || !scene->getLoadCompleteInfo().GetSceneLoaded()) && pollWindow())
+        update();
+
+    const uint32_t warmupFrames   = std::max(benchmarkConfig.warmup_frames, 0);
+    const uint32_t measuredFrames = benchmarkConfig.frames;
+    const uint32_t framesInFlight = renderContext->getFramesInFlight();
+    auto&          profiler       = renderContext->getGpuProfiler();
+    profiler.setEnabled(true);
+
+    std::filesystem::path outputPath = benchmarkConfig.output;
+    std::filesystem::path outputStem = std::filesystem::path(outputPath).replace_extension("");
+
+    std::vector<double> cpuMs, gpuMs;
+    Timer               frameTimer;
+    LOGI("Benchmarking {} frames after {} warmup frames{}", measuredFrames, warmupFrames, renderContext->isHeadless() ? " headless" : "");
+    for (uint32_t frame = 0; frame < warmupFrames + measuredFrames && pollWindow(); frame++) {
+        if (!cameraPath.empty()) {
+            cameraPath.apply(*camera, frame < warmupFrames ? 0 : frame - warmupFrames, measuredFrames);
+            viewUpdated = true;
+        }
+        if (frame + 1 == warmupFrames + measuredFrames) {
+            imageSave.savePng = benchmarkConfig.save_png;
+            imageSave.saveExr = benchmarkConfig.save_exr;
+            imageSave.path    = outputStem.string();
+        }
+
+        frameTimer.start();
+        update();
+        //Includes the wait for the frame resources, the cpu time the application needs per frame
+        cpuMs.push_back(frameTimer.stop<Timer::Milliseconds>());
+        gpuMs.push_back(0);
+        //beginFrame read the queries of the frame recorded framesInFlight frames earlier
+        if (cpuMs.size() > framesInFlight)
+            gpuMs[cpuMs.size() - 1 - framesInFlight] = profiler.getFrameGpuTime();
+    }
+
+    device->waitIdle();
+    const uint32_t recordedFrames = cpuMs.size();
+    const uint32_t pendingFrames  = std::min(framesInFlight, recordedFrames);
+    for (uint32_t i = 0; i < pendingFrames; i++) {
+        profiler.beginFrame((renderContext->getActiveFrameIndex() + framesInFlight - pendingFrames + i) % framesInFlight);
+        gpuMs[recordedFrames - pendingFrames + i] = profiler.getFrameGpuTime();
+    }
+    benchmarkRunning = false;
+    readbackQueue->wait();
+
+    std::ofstream file(outputPath);
+    if (!file.is_open()) {
+        LOGE("Failed to open {} for writing", outputPath.string());
+        return;
+    }
+    file << "frame,warmup,cpu_ms,gpu_ms\n";
+    for (uint32_t frame = 0; frame < recordedFrames; frame++)
+        file << std::format("{},{},{:.4f},{:.4f}\n", frame, frame < warmupFrames ? 1 : 0, cpuMs[frame], gpuMs[frame]);
+    profiler.exportCsv(outputStem.string() + "_passes.csv");
+
+    if (recordedFrames <= warmupFrames) {
+        LOGW("Benchmark stopped during warmup after {} frames", recordedFrames);
+        return;
+    }
+    std::vector<double> measuredCpu(cpuMs.begin() + warmupFrames, cpuMs.end());
+    std::vector<double> measuredGpu(gpuMs.begin() + warmupFrames, gpuMs.end());
+    auto                mean = [](const std::vector<double>& values) { return std::accumulate(values.begin(), values.end(), 0.0) / values.size(); };
+    LOGI("Benchmark {} frames written to {}", measuredCpu.size(), outputPath.string());
+    LOGI("  cpu ms mean {:.3f} median {:.3f} p95 {:.3f} max {:.3f}", mean(measuredCpu), Percentile(measuredCpu, 0.5), Percentile(measuredCpu, 0.95), Percentile(measuredCpu, 1.0));
+    LOGI("  gpu ms mean {:.3f} median {:.3f} p95 {:.3f} max {:.3f}", mean(measuredGpu), Percentile(measuredGpu, 0.5), Percentile(measuredGpu, 0.95), Percentile(measuredGpu, 1.0));
+}
+
 /**
  * @brief Updates the application state.
  * 
  * - Calculates the delta time since the last frame.
  * - Checks if the application is focused;
  * - Calls the onViewUpdated() method.
+ * - Begins a new frame in the render context, which waits only for the frame that used the same frame resources.
  * - Updates the scene and GUI.
- * - Begins a new frame in the render context.
- * - Waits for the fence to ensure synchronization.
- * - Resets the fence for the next frame.
  * ------------------------- Render Graph -------------------------
  * - Creates a render graph and imports the current hardware texture.
  * - Draws the frame and renders the post-process pass.
@@ -197,7 +346,7 @@ void Application::mainloop() {
  * - Adds the GUI pass to the render graph.
  * - Executes the render graph using the graphic command buffer.
  * ------------------------- Render Graph -------------------------
- * - Submits the command buffer and presents the frame.
+ * - Submits the command buffer and presents the frame without waiting for the gpu.
  * - Resets the image save state.
  * - Updates the camera based on the delta time.
  */
@@ -205,7 +354,7 @@ void Application::mainloop() {
 void Application::update() {
 
     deltaTime = timer.tick<Timer::Seconds>();
-    if (!m_focused)
+    if (!m_focused && !benchmarkRunning)
         return;
 
     if (viewUpdated) {
@@ -214,16 +363,16 @@ void Application::update() {
     }
 
     if(reloadShader) {
+        //Pipelines of the frames in flight are destroyed with the shaders
+        device->waitIdle();
         device->getResourceCache().reloadShaders();
         reloadShader = false;
     }
 
-    updateGUI();
-
+    //The gui uploads its vertices into the buffer pools of the frame, they are recycled by beginFrame
     renderContext->beginFrame();
 
-    vkWaitForFences(device->getHandle(), 1, &fence, VK_TRUE, UINT64_MAX);
-    vkResetFences(device->getHandle(), 1, &fence);
+    updateGUI();
 
     RenderGraph graph(*device);
     graph.importTexture(RENDER_VIEW_PORT_IMAGE_NAME, &renderContext->getCurHwtexture());
@@ -241,11 +390,12 @@ void Application::update() {
     graph.addImageCopyPass(graph.getBlackBoard().getHandle(mPresentTexture), graph.getBlackBoard().getHandle(RENDER_VIEW_PORT_IMAGE_NAME));
     handleSaveImage(graph);
 
-    gui->addGuiPass(graph);
+    if (gui)
+        gui->addGuiPass(graph);
 
     graph.execute(renderContext->getGraphicCommandBuffer());
 
-    renderContext->submitAndPresent(renderContext->getGraphicCommandBuffer(), fence);
+    renderContext->submitAndPresent(renderContext->getGraphicCommandBuffer());
 
     resetImageSave();
 
@@ -254,6 +404,8 @@ void Application::update() {
     if (camera->moving()) {
         viewUpdated = true;
     }
+    if (recordCameraPath)
+        cameraPath.record(*camera);
 
     perFrameUpdate();
 
@@ -264,6 +416,9 @@ void Application::perFrameUpdate() {
 
 void Application::updateScene() {
     if (sceneAsync != nullptr && sceneAsync->getLoadCompleteInfo().GetSceneLoaded() ) {
+        //The frames in flight still read the buffers of the old view and scene, the view goes first as it points into the scene
+        g_context->deferRelease(std::move(view));
+        g_context->deferRelease(std::move(scene));
         scene = std::move(sceneAsync);
         onSceneLoaded();
         sceneAsync = nullptr;
@@ -298,9 +453,41 @@ void Application::updateGUI() {
     ImGui::Text("%.2f ms/frame ", 1000.f * deltaTime);
     ImGui::NextColumn();
     ImGui::Text(" %d fps", toUint32(1.f / deltaTime));
+    const auto& compileStats = RenderGraph::getCompileStats();
+    ImGui::Text("render graph compile: %s %.3f ms", compileStats.cacheHit ? "cache hit" : "cache miss", compileStats.compileTime);
+    const auto& poolStats = device->getResourceCache().getTransientResourcePool().getStats();
+    ImGui::Text("transient textures: %d -> %d pooled", poolStats.requestedTextures, poolStats.pooledTextures);
+    const auto& pipelineCacheStats = device->getResourceCache().getPipelineCacheStats();
+    if (pipelineCacheStats.loadedFromDisk)
+        ImGui::Text("pipelines: %d created in %.2f ms (%zu bytes cache loaded)", pipelineCacheStats.createdPipelines, pipelineCacheStats.createTime, pipelineCacheStats.loadedBytes);
+    else
+        ImGui::Text("pipelines: %d created in %.2f ms (no pipeline cache)", pipelineCacheStats.createdPipelines, pipelineCacheStats.createTime);
+    const auto& barrierStats = RenderGraph::getBarrierStats();
+    ImGui::Text("barriers: %d image %d buffer in %d batches, %d split, %d skipped", barrierStats.imageBarriers, barrierStats.bufferBarriers, barrierStats.barrierBatches, barrierStats.splitBarriers, barrierStats.skippedBarriers);
+    ImGui::Text("async compute: %d passes, %d queue transfers", barrierStats.asyncComputePasses, barrierStats.queueTransfers);
+    if (ImGui::Button("dump barrier plan"))
+        RenderGraph::requestBarrierPlanDump();
+    const auto& descriptorStats = renderContext->getDescriptorStats();
+    ImGui::Text("descriptors: %d writes, %d binds, %d skipped binds, %d/%d sets cached", descriptorStats.descriptorWrites, descriptorStats.descriptorSetBinds, descriptorStats.skippedBinds, descriptorStats.cachedSets, descriptorStats.cachedSets + descriptorStats.createdSets);
+    if (const auto* bindlessHeap = device->getResourceCache().getBindlessHeap())
+        ImGui::Text("bindless: %d textures resident", bindlessHeap->getResidentTextureCount());
+    bool parallelRecording = renderContext->getParallelRecording();
+    if (ImGui::Checkbox("parallel recording", &parallelRecording))
+        renderContext->setParallelRecording(parallelRecording);
     ImGui::Checkbox("save png", &imageSave.savePng);
     ImGui::Checkbox("save exr", &imageSave.saveExr);
+    //Every frame is saved while checked, png and exr select the formats
+    if (ImGui::Checkbox("capture sequence", &imageSave.captureSequence))
+        imageSave.sequenceFrame = 0;
+    if (imageSave.captureSequence)
+        ImGui::Text("captured %d frames, %d readback stalls", imageSave.sequenceFrame, readbackQueue->getStallCount());
     ImGui::Checkbox("save camera config", &saveCamera);
+    if (ImGui::Checkbox("record camera path", &recordCameraPath)) {
+        if (recordCameraPath)
+            cameraPath.clear();
+        else
+            cameraPath.save(benchmarkConfig.camera_path.empty() ? "camera_path.json" : benchmarkConfig.camera_path);
+    }
     ImGui::Checkbox("reload shader", &reloadShader);
 
     auto file = gui->showFileDialog("Select gltf or json file", {".gltf", ".json"});
@@ -331,6 +518,11 @@ void Application::updateGUI() {
     ImGui::Begin("app sepcify", nullptr, ImGuiWindowFlags_NoMove);
     onUpdateGUI();
     ImGui::End();
+    ImGui::Separator();
+
+    ImGui::Begin("gpu profiler", nullptr, ImGuiWindowFlags_NoMove);
+    renderContext->getGpuProfiler().updateGui();
+    ImGui::End();
     
     ImGui::Separator();
     
@@ -362,22 +554,12 @@ void Application::updateGUI() {
 }
 
 void Application::resetImageSave() {
-    if (imageSave.savePng | imageSave.saveExr) {
-
-        auto width  = g_context->getViewPortExtent().width;
-        auto height = g_context->getViewPortExtent().height;
-
-        std::shared_ptr<std::vector<uint8_t>> data   = std::make_shared<std::vector<uint8_t>>(imageSave.buffer->getSize());
-        auto                                  mapped = imageSave.buffer->map();
-        memcpy(data->data(), mapped, data->size());
-        imageSave.buffer->unmap();
-
-        auto sceneFolderPath = scene->getPath().parent_path().string();
-        auto imagePath = sceneFolderPath + "/output";
-        ImageIO::saveImage(imagePath.c_str(), data, width, height, 4, imageSave.savePng, imageSave.saveExr);
-
+    //Encodes the images of the frames the gpu finished, never waits for the frame just submitted
+    readbackQueue->poll();
+    if (!imageSave.captureSequence) {
         imageSave.saveExr = false;
         imageSave.savePng = false;
+        imageSave.path.clear();
     }
 
     if (saveCamera) {
@@ -388,41 +570,48 @@ void Application::resetImageSave() {
 }
 
 void Application::handleSaveImage(RenderGraph& graph) {
-    if (imageSave.saveExr | imageSave.savePng) {
-        graph.addComputePass(
-            "image to file ",
-            [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
-                RenderGraphHandle image;
-                if(imageSave.savePng)
-                    image = graph.getBlackBoard().getHandle(getLdrImageToSave());
-                else {
-                     image = graph.getBlackBoard().getHandle(getHdrImageToSave());
-                }
-                builder.readTexture(image, TextureUsage::TRANSFER_SRC);
+    if (!(imageSave.saveExr | imageSave.savePng))
+        return;
+
+    std::string imagePath = imageSave.path;
+    if (imagePath.empty())
+        imagePath = (scene ? scene->getPath().parent_path().string() : std::string(".")) + "/output";
+    if (imageSave.captureSequence)
+        imagePath = std::format("{}_{:05d}", imagePath, imageSave.sequenceFrame++);
+
+    struct Readback {
+        std::string image;
+        bool        ldr;
+        bool        hdr;
+    };
+    //One readback per image, both files come from the same copy when the ldr and hdr images are the same
+    std::vector<Readback> readbacks;
+    if (imageSave.savePng && imageSave.saveExr && getLdrImageToSave() == getHdrImageToSave()) {
+        readbacks.push_back({getLdrImageToSave(), true, true});
+    } else {
+        if (imageSave.savePng)
+            readbacks.push_back({getLdrImageToSave(), true, false});
+        if (imageSave.saveExr)
+            readbacks.push_back({getHdrImageToSave(), false, true});
+    }
 
+    graph.addComputePass(
+        "image to file ",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            for (const auto& readback : readbacks) {
+                auto image = graph.getBlackBoard().getHandle(readback.image);
+                builder.readTexture(image, TextureUsage::TRANSFER_SRC);
                 //Not really write to image. Avoid pass cut
                 builder.writeTexture(image, TextureUsage::TRANSFER_SRC);
-            },
-            [&](RenderPassContext& context) {
-                auto& swapchainImage = graph.getBlackBoard().getHwImage(imageSave.savePng ? getLdrImageToSave() : getHdrImageToSave());
-                auto  width          = swapchainImage.getExtent2D().width;
-                auto  height         = swapchainImage.getExtent2D().height;
-                auto  stride = imageSave.savePng ? 4 : 16;
-                if (imageSave.buffer == nullptr || imageSave.buffer->getSize() < width * height * stride) {
-                    imageSave.buffer = std::make_unique<Buffer>(*device, swapchainImage.getExtent2D().width * swapchainImage.getExtent2D().height * stride, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-                }
-                VkBufferImageCopy region = {.bufferOffset      = 0,
-                                            .bufferRowLength   = 0,
-                                            .bufferImageHeight = 0,
-                                            .imageSubresource  = {.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-                                                                  .mipLevel       = 0,
-                                                                  .baseArrayLayer = 0,
-                                                                  .layerCount     = 1},
-                                            .imageOffset       = {0, 0, 0},
-                                            .imageExtent       = {width, height, 1}};
-                vkCmdCopyImageToBuffer(context.commandBuffer.getHandle(), swapchainImage.getVkImage().getHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, imageSave.buffer->getHandle(), 1, &region);
-            });
-    }
+            }
+        },
+        [this, &graph, readbacks, imagePath](RenderPassContext& context) {
+            for (const auto& readback : readbacks) {
+                readbackQueue->copyImage(context.commandBuffer, graph.getBlackBoard().getHwImage(readback.image), [imagePath, ldr = readback.ldr, hdr = readback.hdr](const ReadbackImage& image) {
+                    ImageIO::saveImage(imagePath, image.data, image.format, image.extent.width, image.extent.height, ldr, hdr);
+                });
+            }
+        });
 }
 
 void Application::setFocused(bool focused) {
@@ -619,6 +808,8 @@ void Application::onSceneLoaded() {
     initView();
     Config::GetInstance().CameraFromConfig(*camera,scene->getName());
     sceneFirstLoad = false;
+    //Every descriptor set written with the old scene buffers is stale
+    g_context->invalidateDescriptorSetCache();
 
     
 }
@@ -5,6 +5,7 @@
 #include "Core/Device/Device.h"
 #include "PlatForm/Window.h"
 #include "Core/RenderContext.h"
+#include "Core/ReadbackQueue.h"
 #include "Scene/Compoments/Camera.h"
 #include "Gui/InputEvent.h"
 #include "Gui/Gui.h"
@@ -16,6 +17,7 @@
 #include "Core/View.h"
 #include "RenderPasses/RenderPassBase.h"
 #include "Scene/SceneLoader/SceneLoadingConfig.h"
+#include "Scene/Compoments/CameraPath.h"
 
 // #ifdef _WIN32
 // #include <minwindef.h>
@@ -26,6 +28,7 @@
 #define EXAMPLE_MAIN                  \
     int main(int argc, char** argv) { \
         Example app;                  \
+        app.parseCommandLine(argc, argv); \
         app.prepare();                \
         app.mainloop();               \
         return 0;                     \
@@ -34,6 +37,7 @@
 #define MAIN(APP_NAME)        \
     int main(int argc, char** argv) { \
         APP_NAME app;             \
+        app.parseCommandLine(argc, argv); \
         app.prepare();                \
         app.mainloop();               \
         return 0;                     \
@@ -60,10 +64,16 @@ public:
     }
     virtual ~Application();
 
+    /**
+     * @brief Benchmark options overriding the render config, must be called before prepare().
+     * --headless --frames N --warmup N --camera-path file --benchmark-output file --save-png --save-exr
+     */
+    void         parseCommandLine(int argc, char** argv);
     virtual void prepare();
     virtual void inputEvent(const InputEvent& inputEvent);
 
     void         setFocused(bool focused);
+    //Runs the benchmark instead of the interactive loop when benchmark frames are configured
     void         mainloop();
     void         onResize(uint32_t width, uint32_t height);
     void         initView();
@@ -96,6 +106,7 @@ protected:
 
     void handleSaveImage(RenderGraph& graph);
     void resetImageSave();
+    void runBenchmark();
     //void loadScene(const std::string & path);
 protected:
     VmaAllocator _allocator{};
@@ -139,12 +150,22 @@ protected:
     struct ImageSave {
         bool                    savePng = false;
         bool                    saveExr = false;
-        std::unique_ptr<Buffer> buffer{nullptr};
+        //Keeps saving every frame with the frame index appended to the path
+        bool                    captureSequence = false;
+        uint32_t                sequenceFrame   = 0;
+        //Without extension, the output folder of the scene when empty
+        std::string             path;
     } imageSave;
+    std::unique_ptr<ReadbackQueue> readbackQueue;
 
     bool saveCamera{false};
     bool reloadShader{false};
 
+    BenchmarkConfig benchmarkConfig;
+    bool            benchmarkRunning{false};
+    CameraPath      cameraPath;
+    bool            recordCameraPath{false};
+
     void handleMouseMove(float x, float y);
 
 protected:
@@ -157,7 +178,6 @@ private:
     const char*               mAppName;
     std::unique_ptr<PassBase> mPostProcessPass{};
     //Camera related  variable end
-    VkFence   fence{VK_NULL_HANDLE};
 #ifdef NOEBUG
     const bool enableValidationLayers = false;
 #else
@@ -5,11 +5,13 @@ using IntegratorKey = std::string;
 static const IntegratorKey kPathIntegrator     = "path";
 static const IntegratorKey kRestirDIIntegrator = "restir";
 static const IntegratorKey kDDGIIntegrator     = "ddgi";
+static const IntegratorKey kCpuPathIntegrator  = "cpu_path";
 
 static const std::unordered_map<EIntegraotrType, IntegratorKey> kIntegratorTypeToString = {
     {ePathTracing, kPathIntegrator},
     {eDDGI, kDDGIIntegrator},
-    {eRestirDI, kRestirDIIntegrator}
+    {eRestirDI, kRestirDIIntegrator},
+    {eCpuPathTracing, kCpuPathIntegrator}
 };
 
 std::string to_string(EIntegraotrType type) {
@@ -26,6 +28,9 @@ DDGIConfig RenderConfig::getDDGIConfig() const {
 PathTracingConfig RenderConfig::getPathTracingConfig() const {
     return pathTracingConfig;
 }
+CpuPathTracingConfig RenderConfig::getCpuPathTracingConfig() const {
+    return cpuPathTracingConfig;
+}
 EIntegraotrType RenderConfig::getIntegratorType() const {
     return mIntegratorType;
 }
@@ -42,6 +47,18 @@ int RenderConfig::getWindowWidth() const {
 int RenderConfig::getWindowHeight() const {
     return window_height;
 }
+bool RenderConfig::useBindless() const {
+    return bindless;
+}
+bool RenderConfig::useVirtualTexture() const {
+    return virtualTexture;
+}
+int RenderConfig::getFramesInFlight() const {
+    return framesInFlight;
+}
+BenchmarkConfig RenderConfig::getBenchmarkConfig() const {
+    return benchmarkConfig;
+}
 std::vector<SgLight> RenderConfig::getLights() const {
     return lights;
 }
@@ -106,6 +123,14 @@ void RenderConfig::init() {
             ddgiConfig.probe_counts = GetOptional(integratorJson, "probe_counts", ddgiConfig.probe_counts);
         } else if (integratorTypeStr == kRestirDIIntegrator) {
             // integratorType = eRestirDI;
+        } else if (integratorTypeStr == kCpuPathIntegrator) {
+            cpuPathTracingConfig.min_depth    = GetOptional(integratorJson, "min_depth", cpuPathTracingConfig.min_depth);
+            cpuPathTracingConfig.max_depth    = GetOptional(integratorJson, "max_depth", cpuPathTracingConfig.max_depth);
+            cpuPathTracingConfig.sample_bsdf  = GetOptional(integratorJson, "sample_bsdf", cpuPathTracingConfig.sample_bsdf);
+            cpuPathTracingConfig.sample_light = GetOptional(integratorJson, "sample_light", cpuPathTracingConfig.sample_light);
+            cpuPathTracingConfig.tile_size    = GetOptional(integratorJson, "tile_size", cpuPathTracingConfig.tile_size);
+            cpuPathTracingConfig.threads      = GetOptional(integratorJson, "threads", cpuPathTracingConfig.threads);
+            cpuPathTracingConfig.max_samples  = GetOptional(integratorJson, "max_samples", cpuPathTracingConfig.max_samples);
         }
     }
 
@@ -117,11 +142,29 @@ void RenderConfig::init() {
         mIntegratorType = eDDGI;
     } else if (integratorType == kRestirDIIntegrator) {
         mIntegratorType = eRestirDI;
+    } else if (integratorType == kCpuPathIntegrator) {
+        mIntegratorType = eCpuPathTracing;
     }
 
     {
         scenePath = json["scene_path"].get<std::string>();
+        bindless  = GetOptional(json, "bindless", bindless);
+        virtualTexture = GetOptional(json, "virtual_texture", virtualTexture);
+        framesInFlight = GetOptional(json, "frames_in_flight", framesInFlight);
         if(json.contains("lights"))
            loadLightsFromJsonPart(json["lights"], lights);
     }
+
+    if (json.contains("benchmark")) {
+        const auto& benchmarkJson       = json["benchmark"];
+        benchmarkConfig.headless        = GetOptional(benchmarkJson, "headless", benchmarkConfig.headless);
+        benchmarkConfig.frames          = GetOptional(benchmarkJson, "frames", benchmarkConfig.frames);
+        benchmarkConfig.warmup_frames   = GetOptional(benchmarkJson, "warmup_frames", benchmarkConfig.warmup_frames);
+        benchmarkConfig.camera_path     = GetOptional(benchmarkJson, "camera_path", benchmarkConfig.camera_path);
+        benchmarkConfig.output          = GetOptional(benchmarkJson, "output", benchmarkConfig.output);
+        benchmarkConfig.save_png        = GetOptional(benchmarkJson, "save_png", benchmarkConfig.save_png);
+        benchmarkConfig.save_exr        = GetOptional(benchmarkJson, "save_exr", benchmarkConfig.save_exr);
+    }
+    if (benchmarkConfig.headless && benchmarkConfig.frames <= 0)
+        benchmarkConfig.frames = BenchmarkConfig::HEADLESS_FRAMES;
 }
\ No newline at end of file
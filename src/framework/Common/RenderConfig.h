@@ -30,10 +30,42 @@ struct PathTracingConfig {
     bool sample_light = true;
 };
 
+//Reference path tracer on the cpu, renders on machines without ray tracing hardware
+struct CpuPathTracingConfig {
+    int min_depth = 1;
+    int max_depth = 5;
+    bool sample_bsdf = true;
+    bool sample_light = true;
+    //Width and height of the tiles the render threads claim
+    int tile_size = 32;
+    //Pool threads a pass renders on, 0 for all but two which stay free for loading and the other pool tasks
+    int threads = 0;
+    //Samples per pixel after which refinement stops, 0 never stops
+    int max_samples = 0;
+};
+
+//Renders a fixed number of frames and writes their timings, optionally without a window for CI
+struct BenchmarkConfig {
+    //Nothing would ever close a headless application, it renders this many frames when none are configured
+    static constexpr int HEADLESS_FRAMES = 300;
+
+    bool headless = false;
+    //0 runs the interactive main loop
+    int frames = 0;
+    //Not part of the statistics, lets pipelines and caches settle
+    int warmup_frames = 16;
+    std::string camera_path;
+    std::string output = "benchmark.csv";
+    //The last frame is written next to the output for image diffs
+    bool save_png = false;
+    bool save_exr = false;
+};
+
 enum EIntegraotrType {
     ePathTracing,
     eDDGI,
     eRestirDI,
+    eCpuPathTracing,
 };
  
 
@@ -45,6 +77,7 @@ public:
     RenderConfig() = default;
     DDGIConfig getDDGIConfig() const;
     PathTracingConfig getPathTracingConfig() const;
+    CpuPathTracingConfig getCpuPathTracingConfig() const;
     EIntegraotrType getIntegratorType() const;
     void getSceneLoadingConfig(SceneLoadingConfig& config) const;
     std::string getScenePath() const;
@@ -53,15 +86,25 @@ public:
     void init();
     int getWindowWidth() const;
     int getWindowHeight() const;
+    bool useBindless() const;
+    bool useVirtualTexture() const;
+    //Frames the cpu may record ahead of the gpu, 1 serializes cpu and gpu
+    int getFramesInFlight() const;
+    BenchmarkConfig getBenchmarkConfig() const;
     std::vector<SgLight> getLights() const;
 protected:
     DDGIConfig ddgiConfig{};
     PathTracingConfig pathTracingConfig{};
+    CpuPathTracingConfig cpuPathTracingConfig{};
     EIntegraotrType mIntegratorType{};
     // SceneLoadingConfig sceneLoadingConfig{};
     std::string scenePath;
     int window_width = 1920;
     int window_height = 1080;
+    bool bindless = false;
+    bool virtualTexture = false;
+    int framesInFlight = 2;
+    BenchmarkConfig benchmarkConfig{};
     Json json;
     std::vector<SgLight> lights;
 };
@@ -1,6 +1,10 @@
 #include "ResourceCache.h"
 #include "Core/ResourceCachingHelper.h"
 #include "Core/Device/Device.h"
+#include "Common/FIleUtils.h"
+
+#include <cstring>
+#include <filesystem>
 
 ResourceCache* ResourceCache::cache = nullptr;
 
@@ -88,7 +92,18 @@ DescriptorSet& ResourceCache::requestDescriptorSet(const DescriptorLayout&
                                                    const BindingMap<VkDescriptorBufferInfo>&                       bufferInfos,
                                                    const BindingMap<VkDescriptorImageInfo>&                        imageInfos,
                                                    const BindingMap<VkWriteDescriptorSetAccelerationStructureKHR>& accelerations) {
-    return requestResource(device, descriptorSetMutex, state.descriptorSets, descriptorSetLayout, descriptorPool, bufferInfos, imageInfos, accelerations);
+    //Written sets are deduplicated by the descriptor set cache of RenderContext, every request allocates a new set
+    //so releasing one never frees a set another cache entry still points to
+    std::lock_guard<std::mutex> guard(descriptorSetMutex);
+    DescriptorSet               descriptorSet(device, descriptorSetLayout, descriptorPool, bufferInfos, imageInfos, accelerations);
+    const auto                  handle = descriptorSet.getHandle();
+    return state.descriptorSets.emplace(handle, std::move(descriptorSet)).first->second;
+}
+
+void ResourceCache::releaseDescriptorSets(const std::vector<VkDescriptorSet>& descriptorSets) {
+    std::lock_guard<std::mutex> guard(descriptorSetMutex);
+    for (const auto descriptorSet : descriptorSets)
+        state.descriptorSets.erase(descriptorSet);
 }
 
 DescriptorPool& ResourceCache::requestDescriptorPool(const DescriptorLayout& layout, uint32_t poolSize) {
@@ -107,11 +122,143 @@ Sampler& ResourceCache::requestSampler(VkSamplerAddressMode sampleMode, VkFilter
     return requestResource(device, samplerMutex, state.samplers, sampleMode, filter, maxLod, addressModeU, addressModeV, addressModeW);
 }
 
-Shader& ResourceCache::requestShaderModule(const ShaderKey&key, VkShaderStageFlagBits stage) {
-    return requestResource(device, shaderMutex, state.shader_modules, key, stage);
+Shader& ResourceCache::requestShaderModule(const ShaderKey&key, VkShaderStageFlagBits stage, uint64_t sourceHash) {
+    //The source hash is not part of the key, the module of a key is the same whichever way it was loaded
+    std::lock_guard<std::mutex> guard(shaderMutex);
+    size_t                      hash{0U};
+    hash_param(hash, key, stage);
+    if (auto res = state.shader_modules.find(hash); res != state.shader_modules.end()) {
+        return res->second;
+    }
+    Shader resource(device, key, stage, sourceHash);
+    auto   res_it = state.shader_modules.emplace(hash, std::move(resource));
+    return res_it.first->second;
+}
+
+std::vector<Shader*> ResourceCache::requestShaderModules(const ShaderPipelineKey& keys) {
+    const auto resolvedKeys = resolveShaderKeys(keys);
+    const auto sourceHashes = Shader::compileShaders(resolvedKeys);
+    std::vector<Shader*> shaders;
+    shaders.reserve(resolvedKeys.size());
+    for (size_t i = 0; i < resolvedKeys.size(); i++)
+        shaders.push_back(&requestShaderModule(resolvedKeys[i], VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM, sourceHashes[i]));
+    return shaders;
+}
+
+ShaderPipelineKey ResourceCache::resolveShaderKeys(const ShaderPipelineKey& keys) const {
+    if (!bindlessHeap)
+        return keys;
+    ShaderPipelineKey resolvedKeys = keys;
+    for (auto& key : resolvedKeys)
+        key.variant.add_define("BINDLESS");
+    return resolvedKeys;
+}
+
+void ResourceCache::enableBindless() {
+    if (bindlessHeap)
+        return;
+    if (!device.isBindlessSupported()) {
+        LOGW("Bindless mode is not supported by the device");
+        return;
+    }
+    CHECK_RESULT(state.shader_modules.empty())
+    bindlessHeap = std::make_unique<BindlessDescriptorHeap>(device);
+}
+
+ResourceCache::ResourceCache(Device& device) : device(device), transientResourcePool(device) {
+    loadPipelineCache();
+}
+
+ResourceCache::~ResourceCache() {
+    savePipelineCache();
+    vkDestroyPipelineCache(device.getHandle(), pipelineCache, nullptr);
 }
 
-ResourceCache::ResourceCache(Device& device) : device(device) {
+static const std::string PIPELINE_CACHE_PATH  = FileUtils::getShaderPath("spvcachedFiles/pipeline.cache");
+static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43504B59;// "YKPC"
+
+//Prepended to the driver blob, the driver version is not part of the vulkan cache header
+struct PipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+};
+
+static PipelineCacheFileHeader GetPipelineCacheFileHeader(const VkPhysicalDeviceProperties& properties) {
+    PipelineCacheFileHeader header{};
+    header.magic         = PIPELINE_CACHE_MAGIC;
+    header.vendorID      = properties.vendorID;
+    header.deviceID      = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+}
+
+void ResourceCache::loadPipelineCache() {
+    const auto           expected = GetPipelineCacheFileHeader(device.getProperties());
+    std::vector<uint8_t> data;
+
+    if (std::ifstream in(PIPELINE_CACHE_PATH, std::ios::binary); in) {
+        auto header = FileUtils::streamRead<PipelineCacheFileHeader>(in);
+        if (!in || header.magic != expected.magic || header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+            header.driverVersion != expected.driverVersion || memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            LOGW("Pipeline cache {} was created by another device or driver, ignoring it", PIPELINE_CACHE_PATH);
+        } else if (std::error_code error; header.dataSize != std::filesystem::file_size(PIPELINE_CACHE_PATH, error) - sizeof(PipelineCacheFileHeader) || error) {
+            //Checked before allocating, a corrupt size must not turn into a huge allocation or a short read
+            LOGW("Pipeline cache {} is truncated or corrupt, ignoring it", PIPELINE_CACHE_PATH);
+        } else {
+            data.resize(header.dataSize);
+            FileUtils::streamRead(in, data);
+            if (!in || data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+                LOGW("Pipeline cache {} is truncated, ignoring it", PIPELINE_CACHE_PATH);
+                data.clear();
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData    = data.data();
+    if (vkCreatePipelineCache(device.getHandle(), &createInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        LOGW("Failed to create pipeline cache from {}, starting with an empty cache", PIPELINE_CACHE_PATH);
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData    = nullptr;
+        data.clear();
+        VK_CHECK_RESULT(vkCreatePipelineCache(device.getHandle(), &createInfo, nullptr, &pipelineCache));
+    }
+
+    pipelineCacheStats.loadedFromDisk = !data.empty();
+    pipelineCacheStats.loadedBytes    = data.size();
+    if (pipelineCacheStats.loadedFromDisk)
+        LOGI("Pipeline cache loaded from {} ({} bytes)", PIPELINE_CACHE_PATH, data.size());
+}
+
+void ResourceCache::savePipelineCache() {
+    if (pipelineCache == VK_NULL_HANDLE)
+        return;
+
+    size_t dataSize = 0;
+    VK_CHECK_RESULT(vkGetPipelineCacheData(device.getHandle(), pipelineCache, &dataSize, nullptr));
+    std::vector<uint8_t> data(dataSize);
+    VK_CHECK_RESULT(vkGetPipelineCacheData(device.getHandle(), pipelineCache, &dataSize, data.data()));
+
+    auto header     = GetPipelineCacheFileHeader(device.getProperties());
+    header.dataSize = dataSize;
+
+    std::filesystem::create_directories(std::filesystem::path(PIPELINE_CACHE_PATH).parent_path());
+    std::ofstream out(PIPELINE_CACHE_PATH, std::ios::binary);
+    if (!out) {
+        LOGW("Failed to write pipeline cache {}", PIPELINE_CACHE_PATH);
+        return;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data.data()), dataSize);
+
+    LOGI("Pipeline cache saved to {} ({} bytes), {} pipelines created in {} ms {}",
+         PIPELINE_CACHE_PATH, dataSize, pipelineCacheStats.createdPipelines, pipelineCacheStats.createTime, pipelineCacheStats.loadedFromDisk ? "with the cache" : "without cache");
 }
 
 Pipeline& ResourceCache::requestPipeline(const PipelineState& pipelineState) {
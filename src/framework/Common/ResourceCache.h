@@ -17,9 +17,11 @@
 #include "Core/Pipeline.h"
 #include "Core/RenderTarget.h"
 #include "Core/ResourceCachingHelper.h"
+#include "Core/Descriptor/BindlessDescriptorHeap.h"
 #include "Core/Descriptor/DescriptorLayout.h"
 #include "Core/Descriptor/DescriptorPool.h"
 #include "Core/Descriptor/DescriptorSet.h"
+#include "RenderGraph/TransientResourcePool.h"
 
 //A resource cache  system
 //Mainly from vulkan-samples
@@ -35,7 +37,7 @@ struct ResourceCacheState {
 
     std::unordered_map<std::size_t, DescriptorPool> descriptor_pools;
 
-    std::unordered_map<std::size_t, DescriptorSet> descriptorSets;
+    std::unordered_map<VkDescriptorSet, DescriptorSet> descriptorSets;
 
     std::unordered_map<std::size_t, RenderPass> render_passes;
 
@@ -48,6 +50,14 @@ struct ResourceCacheState {
     std::unordered_map<std::size_t, Sampler> samplers;
 };
 
+struct PipelineCacheStats {
+    bool     loadedFromDisk{false};
+    size_t   loadedBytes{0};
+    uint32_t createdPipelines{0};
+    //Pipeline creation time of this run, in ms
+    double createTime{0};
+};
+
 template<class T, class... A>
 T& requestResource(Device& device, std::unordered_map<std::size_t, T>& resources, A&... args) {
     std::size_t hash{0U};
@@ -93,7 +103,7 @@ T& requestResource(Device& device, const std::string& name, std::unordered_map<s
 class ResourceCache {
 public:
     // std::unordered_map<Rende>
-    ~ResourceCache() = default;
+    ~ResourceCache();
 
     static ResourceCache& getResourceCache();
 
@@ -125,13 +135,18 @@ public:
                                         const BindingMap<VkDescriptorBufferInfo>&                       bufferInfos,
                                         const BindingMap<VkDescriptorImageInfo>&                        imageInfos,
                                         const BindingMap<VkWriteDescriptorSetAccelerationStructureKHR>& accelerations);
+    //Frees the sets back to their pools, the caller makes sure no pending command buffer uses them
+    void releaseDescriptorSets(const std::vector<VkDescriptorSet>& descriptorSets);
 
     DescriptorPool& requestDescriptorPool(const DescriptorLayout& layout,
                                           uint32_t                poolSize = DescriptorPool::MAX_SETS_PER_POOL);
 
     Buffer& requestNamedBuffer(const std::string& name, uint64_t bufferSize, VkBufferUsageFlags bufferUsage, VmaMemoryUsage memoryUsage);
 
-    Shader&         requestShaderModule(const ShaderKey& path, VkShaderStageFlagBits stage = VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM);
+    //sourceHash is passed through to the shader when it is created, see Shader::compileShaders
+    Shader&         requestShaderModule(const ShaderKey& path, VkShaderStageFlagBits stage = VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM, uint64_t sourceHash = 0);
+    //Compiles the uncached shaders in parallel before requesting the modules
+    std::vector<Shader*> requestShaderModules(const ShaderPipelineKey& keys);
     PipelineLayout& requestPipelineLayout(const ShaderPipelineKey& shaderPaths);
 
     Sampler& requestSampler(VkSamplerAddressMode sampleMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VkFilter filter = VK_FILTER_LINEAR, float maxLod = 1, VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT, VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT, VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT);
@@ -151,6 +166,11 @@ public:
     void reloadShaders() {
         state.shader_modules.clear();
         state.pipelines.clear();
+        ShaderPipelineKey shaderKeys;
+        for (auto& pipeline : state.pipeline_layouts) {
+            shaderKeys.insert(shaderKeys.end(), pipeline.second.getShaderKeys().begin(), pipeline.second.getShaderKeys().end());
+        }
+        Shader::compileShaders(resolveShaderKeys(shaderKeys));
         for(auto & pipeline : state.pipeline_layouts) {
             pipeline.second.recreate();
         }
@@ -188,13 +208,48 @@ public:
         return state;
     }
 
+    TransientResourcePool& getTransientResourcePool() {
+        return transientResourcePool;
+    }
+
+    VkPipelineCache getPipelineCache() const {
+        return pipelineCache;
+    }
+
+    //Called by Pipeline while pipelineMutex is held
+    void recordPipelineCreation(double createTime) {
+        pipelineCacheStats.createdPipelines++;
+        pipelineCacheStats.createTime += createTime;
+    }
+
+    const PipelineCacheStats& getPipelineCacheStats() const {
+        return pipelineCacheStats;
+    }
+
+    //Write the pipeline cache next to the spv cache so the next run can skip pipeline compilation
+    void savePipelineCache();
+
+    //Must be called before any shader is requested, shaders are then compiled with BINDLESS defined
+    void enableBindless();
+
+    //nullptr unless the bindless mode is enabled
+    BindlessDescriptorHeap* getBindlessHeap() const {
+        return bindlessHeap.get();
+    }
+
 private:
+    ShaderPipelineKey resolveShaderKeys(const ShaderPipelineKey& keys) const;
+
+    void loadPipelineCache();
+
     static ResourceCache* cache;
 
     ResourceCacheState state;
 
     Device& device;
 
+    TransientResourcePool transientResourcePool;
+
     std::mutex renderPassMutex;
 
     std::mutex descriptorLayoutMutex;
@@ -217,5 +272,9 @@ private:
 
     std::mutex samplerMutex;
 
-    VkPipelineCache pipelineCache;
+    VkPipelineCache pipelineCache{VK_NULL_HANDLE};
+
+    PipelineCacheStats pipelineCacheStats;
+
+    std::unique_ptr<BindlessDescriptorHeap> bindlessHeap;
 };
\ No newline at end of file
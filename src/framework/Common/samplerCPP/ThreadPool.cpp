@@ -1,4 +1,10 @@
 #include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
 ctpl::thread_pool& ThreadPool::GetThreadPool() {
     if (thread_pool == nullptr) {
         thread_pool = std::make_unique<ctpl::thread_pool>(std::thread::hardware_concurrency());
@@ -6,4 +12,27 @@ ctpl::thread_pool& ThreadPool::GetThreadPool() {
     return *thread_pool;
 }
 
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job, uint32_t maxThreads) {
+    struct State {
+        std::atomic<uint32_t> next{0};
+        std::atomic<uint32_t> done{0};
+    };
+    auto state = std::make_shared<State>();
+    auto run   = [state, count, &job] {
+        for (uint32_t i = state->next++; i < count; i = state->next++) {
+            job(i);
+            state->done++;
+        }
+    };
+
+    auto& pool    = GetThreadPool();
+    int   threads = maxThreads == 0 ? pool.size() : std::min<int>(pool.size(), maxThreads);
+    int   helpers = std::min<int>(threads, static_cast<int>(count)) - 1;
+    for (int i = 0; i < helpers; i++)
+        pool.push([run](int) { run(); });
+    run();
+    while (state->done < count)
+        std::this_thread::yield();
+}
+
 std::unique_ptr<ctpl::thread_pool> ThreadPool::thread_pool = nullptr;
@@ -1,11 +1,16 @@
 #pragma once
 #include "ctpl_stl.h"
 
+#include <functional>
+
 class ThreadPool {
 public:
     static ctpl::thread_pool& GetThreadPool();
+    //Runs job(i) for every i in [0, count) on the shared pool, on at most maxThreads threads when not 0.
+    //Idle threads claim the next job as they finish, so uneven jobs still keep every thread busy.
+    //The calling thread takes jobs too and only waits for jobs already taken, so it is safe to call from a pool task
+    static void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job, uint32_t maxThreads = 0);
 
 protected:
     static std::unique_ptr<ctpl::thread_pool> thread_pool;
 };
-
@@ -11,6 +11,10 @@ void* Buffer::map() {
     return dstData;
 }
 
+void Buffer::invalidate(VkDeviceSize offset, VkDeviceSize size) {
+    vmaInvalidateAllocation(_allocator, _bufferAllocation, offset, size);
+}
+
 VkDeviceSize Buffer::getDeviceAddress() const {
     VkBufferDeviceAddressInfo info = {VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
     info.buffer                    = _buffer;
@@ -19,6 +19,8 @@ public:
     void  uploadData(const void* srcData, uint64_t size = -1, uint64_t offset = 0);
     void* map();
     void  unmap();
+    //Makes gpu writes visible to a mapping of host visible memory that is not coherent
+    void  invalidate(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
     
     template<typename T>
     std::vector<T> getData() {
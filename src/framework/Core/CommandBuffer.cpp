@@ -19,26 +19,24 @@ void CommandBuffer::beginRecord(VkCommandBufferUsageFlags usage) {
 }
 
 void CommandBuffer::bindVertexBuffer(std::vector<const Buffer*>&      buffers,
-                                     const std::vector<VkDeviceSize>& offsets) const {
-    std::vector<VkBuffer> bufferHandles(buffers.size());
-    std::transform(buffers.begin(), buffers.end(), bufferHandles.begin(), [](const Buffer*& buffer) { return buffer->getHandle(); });
-
-    vkCmdBindVertexBuffers(mCommandBuffer, 0, static_cast<uint32_t>(bufferHandles.size()), bufferHandles.data(), offsets.data());
+                                     const std::vector<VkDeviceSize>& offsets) {
+    bindVertexBuffer(0, buffers, offsets);
 }
 
 void CommandBuffer::bindVertexBuffer(const Buffer& vertexBuffer) {
-    std::vector<VkBuffer>     bufferHandles{vertexBuffer.getHandle()};
-    std::vector<VkDeviceSize> offsets{0};
-    vkCmdBindVertexBuffers(mCommandBuffer, 0, static_cast<uint32_t>(bufferHandles.size()), bufferHandles.data(), offsets.data());
+    std::vector<const Buffer*> buffers{&vertexBuffer};
+    bindVertexBuffer(0, buffers, {0});
 }
 
-void CommandBuffer::bindVertexBuffer(uint32_t firstBinding, std::vector<const Buffer*>& buffers, const std::vector<VkDeviceSize>& offsets) const {
+void CommandBuffer::bindVertexBuffer(uint32_t firstBinding, std::vector<const Buffer*>& buffers, const std::vector<VkDeviceSize>& offsets) {
     std::vector<VkBuffer> bufferHandles(buffers.size());
     std::transform(buffers.begin(), buffers.end(), bufferHandles.begin(), [](const Buffer*& buffer) { return buffer->getHandle(); });
 
     vkCmdBindVertexBuffers(mCommandBuffer, firstBinding, static_cast<uint32_t>(bufferHandles.size()), bufferHandles.data(), offsets.data());
+    for (uint32_t i = 0; i < bufferHandles.size(); i++)
+        mVertexBuffers[firstBinding + i] = {bufferHandles[i], offsets[i]};
 }
-void CommandBuffer::bindVertexBuffer(uint32_t firstBinding, Buffer& buffer, VkDeviceSize offset) const {
+void CommandBuffer::bindVertexBuffer(uint32_t firstBinding, Buffer& buffer, VkDeviceSize offset) {
     std::vector<const Buffer*> buffers = {&buffer};
     bindVertexBuffer(firstBinding, buffers, {offset});
 }
@@ -46,6 +44,15 @@ void CommandBuffer::bindVertexBuffer(uint32_t firstBinding, Buffer& buffer, VkDe
 void CommandBuffer::bindIndicesBuffer(const Buffer& buffer, VkDeviceSize offset, VkIndexType indexType) {
     // auto bufferHandles = getHandles<Buffer,VkBuffer>(buffers);
     vkCmdBindIndexBuffer(mCommandBuffer, buffer.getHandle(), offset, indexType);
+    mIndexBuffer = {buffer.getHandle(), offset, indexType};
+}
+
+void CommandBuffer::drawIndexedIndirectCount(const Buffer& buffer, VkDeviceSize offset, const Buffer& countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount) {
+    vkCmdDrawIndexedIndirectCount(mCommandBuffer, buffer.getHandle(), offset, countBuffer.getHandle(), countBufferOffset, maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void CommandBuffer::drawIndirectCount(const Buffer& buffer, VkDeviceSize offset, const Buffer& countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount) {
+    vkCmdDrawIndirectCount(mCommandBuffer, buffer.getHandle(), offset, countBuffer.getHandle(), countBufferOffset, maxDrawCount, sizeof(VkDrawIndirectCommand));
 }
 
 void CommandBuffer::bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, const std::vector<DescriptorSet>& descriptorSets, const std::vector<uint32_t>& dynamicOffsets) {
@@ -74,7 +81,8 @@ void CommandBuffer::endRenderPass() {
 }
 
 CommandBuffer::~CommandBuffer() {
-    vkFreeCommandBuffers(mDevice, mCommandPool, 1, &mCommandBuffer);
+    if (mCommandPool != VK_NULL_HANDLE)
+        vkFreeCommandBuffers(mDevice, mCommandPool, 1, &mCommandBuffer);
 }
 
 void CommandBuffer::beginRenderPass(RenderPass& render_pass, FrameBuffer& frameBuffer, const std::vector<VkClearValue>& clear_values, VkSubpassContents contents) {
@@ -91,7 +99,7 @@ void CommandBuffer::beginRenderPass(RenderPass& render_pass, FrameBuffer& frameB
 
     VkClearValue v{.color = {1, 0, 0}};
 
-    vkCmdBeginRenderPass(mCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(mCommandBuffer, &renderPassInfo, contents);
 }
 
 void CommandBuffer::bindPipeline(const Pipeline& pipeline, VkPipelineBindPoint bindPoint) const {
@@ -100,13 +108,35 @@ void CommandBuffer::bindPipeline(const Pipeline& pipeline, VkPipelineBindPoint b
 
 void CommandBuffer::setViewport(uint32_t firstViewport, const std::vector<VkViewport>& viewports) {
     vkCmdSetViewport(getHandle(), firstViewport, toUint32(viewports.size()), viewports.data());
+    if (firstViewport == 0)
+        mViewports = viewports;
 }
 
 void CommandBuffer::setScissor(uint32_t firstScissor, const std::vector<VkRect2D>& scissors) {
     vkCmdSetScissor(getHandle(), firstScissor, toUint32(scissors.size()), scissors.data());
+    if (firstScissor == 0)
+        mScissors = scissors;
 }
 
 void CommandBuffer::bindVertexBuffer(const Buffer& buffer, VkDeviceSize offset) {
     std::vector<const Buffer*> buffers = {&buffer};
     bindVertexBuffer(buffers, {offset});
 }
+
+void CommandBuffer::inheritDynamicState(const CommandBuffer& source) {
+    const auto viewports     = source.mViewports;
+    const auto scissors      = source.mScissors;
+    const auto vertexBuffers = source.mVertexBuffers;
+    const auto indexBuffer   = source.mIndexBuffer;
+
+    if (!viewports.empty())
+        setViewport(0, viewports);
+    if (!scissors.empty())
+        setScissor(0, scissors);
+    for (const auto& [binding, vertexBuffer] : vertexBuffers)
+        vkCmdBindVertexBuffers(mCommandBuffer, binding, 1, &vertexBuffer.buffer, &vertexBuffer.offset);
+    mVertexBuffers = vertexBuffers;
+    if (indexBuffer.buffer != VK_NULL_HANDLE)
+        vkCmdBindIndexBuffer(mCommandBuffer, indexBuffer.buffer, indexBuffer.offset, indexBuffer.indexType);
+    mIndexBuffer = indexBuffer;
+}
@@ -49,10 +49,10 @@ public:
     void bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, const std::vector<DescriptorSet>& descriptorSets, const std::vector<uint32_t>& dynamicOffsets);
     void bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, const std::vector<DescriptorSet*>& descriptorSets, const std::vector<uint32_t>& dynamicOffsets);
 
-    void bindVertexBuffer(std::vector<const Buffer*>& buffers, const std::vector<VkDeviceSize>& offsets) const;
+    void bindVertexBuffer(std::vector<const Buffer*>& buffers, const std::vector<VkDeviceSize>& offsets);
 
-    void bindVertexBuffer(uint32_t firstBinding, std::vector<const Buffer*>& buffers, const std::vector<VkDeviceSize>& offsets) const;
-    void bindVertexBuffer(uint32_t firstBinding, Buffer& buffer, VkDeviceSize offset) const;
+    void bindVertexBuffer(uint32_t firstBinding, std::vector<const Buffer*>& buffers, const std::vector<VkDeviceSize>& offsets);
+    void bindVertexBuffer(uint32_t firstBinding, Buffer& buffer, VkDeviceSize offset);
 
     void bindVertexBuffer(const Buffer& buffer);
 
@@ -76,6 +76,9 @@ public:
         vkCmdDrawIndexed(mCommandBuffer, index_count, instance_count, first_index, vertex_offset, first_instance);
     }
 
+    void drawIndexedIndirectCount(const Buffer& buffer, VkDeviceSize offset, const Buffer& countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount);
+    void drawIndirectCount(const Buffer& buffer, VkDeviceSize offset, const Buffer& countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount);
+
     void setViewport(uint32_t firstViewport, const std::vector<VkViewport>& viewports);
 
     void setScissor(uint32_t firstScissor, const std::vector<VkRect2D>& scissors);
@@ -94,9 +97,36 @@ public:
 
     VkQueueFlags getQueueFlag() const { return mQueueFlag; }
 
+    //Dynamic viewport and scissor set last, secondary command buffers do not inherit them
+    const std::vector<VkViewport>& getViewports() const { return mViewports; }
+    const std::vector<VkRect2D>&   getScissors() const { return mScissors; }
+
+    //Records the viewports, scissors, vertex and index buffers set last on source, source may be this command buffer
+    void inheritDynamicState(const CommandBuffer& source);
+
 protected:
+    //Redirects a non owning wrapper between the secondary command buffers it records
+    friend class ParallelCommandRecorder;
+    //Continues a split graphics submission in a new command buffer behind the same wrapper
+    friend class RenderContext;
+
     VkQueueFlags    mQueueFlag{VK_QUEUE_GRAPHICS_BIT};
     VkCommandBuffer mCommandBuffer;
     VkDevice        mDevice;
-    VkCommandPool   mCommandPool;
+    VkCommandPool   mCommandPool;// VK_NULL_HANDLE if the command buffer is not owned by the wrapper
+
+    std::vector<VkViewport> mViewports;
+    std::vector<VkRect2D>   mScissors;
+
+    struct VertexBufferBinding {
+        VkBuffer     buffer{VK_NULL_HANDLE};
+        VkDeviceSize offset{0};
+    };
+    struct IndexBufferBinding {
+        VkBuffer     buffer{VK_NULL_HANDLE};
+        VkDeviceSize offset{0};
+        VkIndexType  indexType{VK_INDEX_TYPE_UINT16};
+    };
+    std::map<uint32_t, VertexBufferBinding> mVertexBuffers;// by binding
+    IndexBufferBinding                      mIndexBuffer;
 };
\ No newline at end of file
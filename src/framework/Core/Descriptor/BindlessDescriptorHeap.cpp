@@ -0,0 +1,127 @@
+#include "BindlessDescriptorHeap.h"
+
+#include "DescriptorLayout.h"
+#include "Core/Buffer.h"
+#include "Core/Device/Device.h"
+#include "Core/Images/ImageView.h"
+#include "Core/Images/Sampler.h"
+#include "Core/ResourceCachingHelper.h"
+
+#include <format>
+
+static_assert(sizeof(BindlessSceneAddresses) % 16 == 0, "BindlessSceneAddresses must match its std140 layout");
+
+static BindlessDescriptorHeap* sInstance = nullptr;
+
+size_t BindlessDescriptorHeap::TextureKey::Hash::operator()(const TextureKey& key) const {
+    size_t hash = 0;
+    hash_combine(hash, key.view);
+    hash_combine(hash, key.sampler);
+    return hash;
+}
+
+BindlessDescriptorHeap* BindlessDescriptorHeap::getInstance() {
+    return sInstance;
+}
+
+BindlessDescriptorHeap::BindlessDescriptorHeap(Device& device) : device(device) {
+    //Entries of the texture array are written while command buffers using other entries may be pending
+    constexpr VkDescriptorBindingFlags textureBindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                                             VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                             VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+    layout = std::make_unique<DescriptorLayout>(device);
+    layout->addBinding(VK_SHADER_STAGE_ALL, BINDLESS_TEXTURE_BINDING, MAX_BINDLESS_TEXTURES, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textureBindingFlags);
+    layout->addBinding(VK_SHADER_STAGE_ALL, BINDLESS_SCENE_BINDING, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0);
+    layout->createLayout(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_BINDLESS_TEXTURES},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}};
+
+    VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets       = 1;
+    poolInfo.poolSizeCount = toUint32(poolSizes.size());
+    poolInfo.pPoolSizes    = poolSizes.data();
+    VK_CHECK_RESULT(vkCreateDescriptorPool(device.getHandle(), &poolInfo, nullptr, &pool))
+
+    VkDescriptorSetLayout       setLayout = layout->getHandle();
+    VkDescriptorSetAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocateInfo.descriptorPool     = pool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts        = &setLayout;
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(device.getHandle(), &allocateInfo, &descriptorSet))
+
+    //The scene uniform is written before the set is ever bound, only its content changes afterwards
+    sceneBuffer = std::make_unique<Buffer>(device, sizeof(BindlessSceneAddresses), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    setSceneAddresses({});
+
+    VkDescriptorBufferInfo bufferInfo{sceneBuffer->getHandle(), 0, sizeof(BindlessSceneAddresses)};
+    VkWriteDescriptorSet   write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet          = descriptorSet;
+    write.dstBinding      = BINDLESS_SCENE_BINDING;
+    write.descriptorCount = 1;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    write.pBufferInfo     = &bufferInfo;
+    vkUpdateDescriptorSets(device.getHandle(), 1, &write, 0, nullptr);
+
+    LOGI("Bindless descriptor heap created with {} texture slots", MAX_BINDLESS_TEXTURES);
+    sInstance = this;
+}
+
+BindlessDescriptorHeap::~BindlessDescriptorHeap() {
+    sInstance = nullptr;
+    vkDestroyDescriptorPool(device.getHandle(), pool, nullptr);
+    vkDestroyDescriptorSetLayout(device.getHandle(), layout->getHandle(), nullptr);
+}
+
+uint32_t BindlessDescriptorHeap::registerTexture(const ImageView& view, const Sampler& sampler) {
+    const TextureKey key{view.getHandle(), sampler.getHandle()};
+
+    std::lock_guard<std::mutex> guard(textureMutex);
+    if (auto it = textureIndices.find(key); it != textureIndices.end())
+        return it->second;
+
+    uint32_t textureIndex;
+    if (!freeTextureIndices.empty()) {
+        textureIndex = freeTextureIndices.back();
+        freeTextureIndices.pop_back();
+    } else if (textureCount < MAX_BINDLESS_TEXTURES) {
+        textureIndex = textureCount++;
+    } else {
+        throw std::runtime_error(std::format("Bindless descriptor heap is full, {} textures", MAX_BINDLESS_TEXTURES));
+    }
+
+    //A freed slot is only used by command buffers that sampled the destroyed view, which have completed
+    VkDescriptorImageInfo imageInfo{sampler.getHandle(), view.getHandle(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkWriteDescriptorSet  write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet          = descriptorSet;
+    write.dstBinding      = BINDLESS_TEXTURE_BINDING;
+    write.dstArrayElement = textureIndex;
+    write.descriptorCount = 1;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo      = &imageInfo;
+    vkUpdateDescriptorSets(device.getHandle(), 1, &write, 0, nullptr);
+
+    textureIndices.emplace(key, textureIndex);
+    return textureIndex;
+}
+
+void BindlessDescriptorHeap::unregisterTexture(VkImageView view) {
+    std::lock_guard<std::mutex> guard(textureMutex);
+    std::erase_if(textureIndices, [&](const auto& entry) {
+        if (entry.first.view != view)
+            return false;
+        freeTextureIndices.push_back(entry.second);
+        return true;
+    });
+}
+
+void BindlessDescriptorHeap::setSceneAddresses(const BindlessSceneAddresses& addresses) {
+    sceneBuffer->uploadData(&addresses, sizeof(BindlessSceneAddresses), 0);
+}
+
+DescriptorLayout& BindlessDescriptorHeap::getDescriptorLayout() const {
+    return *layout;
+}
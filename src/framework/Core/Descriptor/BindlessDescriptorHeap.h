@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Core/Vulkan.h"
+#include "../shaders/bindless.glsl"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class Device;
+class Buffer;
+class DescriptorLayout;
+class ImageView;
+class Sampler;
+
+/**
+ * One persistent descriptor set shared by every pipeline layout that declares set BINDLESS_SET.
+ * Textures are written once into a partially bound, update after bind array and addressed by index from shaders,
+ * scene buffers are reached through the device addresses stored in the BindlessSceneAddresses uniform.
+ */
+class BindlessDescriptorHeap {
+public:
+    BindlessDescriptorHeap(Device& device);
+    ~BindlessDescriptorHeap();
+
+    //Returns the heap index of the texture, a view and sampler pair is only written the first time it is registered.
+    //Throws when every slot is taken
+    uint32_t registerTexture(const ImageView& view, const Sampler& sampler);
+    //Frees the slots written with the view for reuse, called when the view is destroyed
+    void     unregisterTexture(VkImageView view);
+    void     setSceneAddresses(const BindlessSceneAddresses& addresses);
+
+    DescriptorLayout& getDescriptorLayout() const;
+    VkDescriptorSet   getHandle() const { return descriptorSet; }
+    //Every index handed out is below the texture count, freed slots included
+    uint32_t          getTextureCount() const { return textureCount; }
+    uint32_t          getResidentTextureCount() const { return textureCount - freeTextureIndices.size(); }
+
+    //The heap while bindless mode is enabled, ImageView reaches it on destruction
+    static BindlessDescriptorHeap* getInstance();
+
+private:
+    Device& device;
+
+    std::unique_ptr<DescriptorLayout> layout;
+    VkDescriptorPool                  pool{VK_NULL_HANDLE};
+    VkDescriptorSet                   descriptorSet{VK_NULL_HANDLE};
+    std::unique_ptr<Buffer>           sceneBuffer;
+
+    struct TextureKey {
+        VkImageView view{VK_NULL_HANDLE};
+        VkSampler   sampler{VK_NULL_HANDLE};
+
+        bool operator==(const TextureKey&) const = default;
+
+        struct Hash {
+            size_t operator()(const TextureKey& key) const;
+        };
+    };
+
+    std::mutex                                                 textureMutex;
+    std::unordered_map<TextureKey, uint32_t, TextureKey::Hash> textureIndices;
+    std::vector<uint32_t>                                      freeTextureIndices;// slots of destroyed views, reused first
+    uint32_t                                                   textureCount{0};   // slots ever written
+};
@@ -170,8 +170,7 @@ void DescriptorLayout::addBinding(VkShaderStageFlags       stageFlags,
 }
 
 void DescriptorLayout::createLayout(VkDescriptorSetLayoutCreateFlags flags) {
-    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
-    std::vector<VkDescriptorBindingFlags>     bindingFlags;
+    std::vector<VkDescriptorBindingFlags> bindingFlags;
     layoutBindings.reserve(_descBindingInfos.size());
     bindingFlags.reserve(_descBindingInfos.size());
 
@@ -192,8 +191,8 @@ void DescriptorLayout::createLayout(VkDescriptorSetLayoutCreateFlags flags) {
     descSetLayoutInfo.sType                           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     descSetLayoutInfo.bindingCount                    = static_cast<uint32_t>(layoutBindings.size());
     descSetLayoutInfo.pBindings                       = layoutBindings.data();
-    // descSetLayoutInfo.pNext = &flagsInfo;
-    descSetLayoutInfo.flags = flags;
+    descSetLayoutInfo.pNext                           = &flagsInfo;
+    descSetLayoutInfo.flags                           = flags;
     VK_CHECK_RESULT(vkCreateDescriptorSetLayout(_deivce.getHandle(), &descSetLayoutInfo, nullptr, &_layout));
 }
 
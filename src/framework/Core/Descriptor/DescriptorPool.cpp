@@ -26,36 +26,52 @@ DescriptorPool::DescriptorPool(Device &device, const DescriptorLayout &layout, u
 
 
 VkDescriptorSet DescriptorPool::allocate() {
-    if (pools.size() <= curPoolIdx || poolCounts[curPoolIdx - 1] < maxPoolSets) {
+    curPoolIdx = std::ranges::find_if(poolCounts, [this](uint32_t count) { return count < maxPoolSets; }) - poolCounts.begin();
+    if (curPoolIdx == pools.size()) {
+        std::vector<VkDescriptorPoolSize> setPoolSizes = poolSizes;
+        for (auto &poolSize: setPoolSizes)
+            poolSize.descriptorCount *= maxPoolSets;
+
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = poolSizes.size();
-        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+        poolInfo.poolSizeCount = setPoolSizes.size();
+        poolInfo.pPoolSizes = setPoolSizes.data();
 
         poolInfo.maxSets = maxPoolSets;
         pools.push_back(VK_NULL_HANDLE);
-        VK_CHECK_RESULT(vkCreateDescriptorPool(device.getHandle(), &poolInfo, nullptr, &pools[curPoolIdx++]))
+        poolCounts.push_back(0);
+        VK_CHECK_RESULT(vkCreateDescriptorPool(device.getHandle(), &poolInfo, nullptr, &pools[curPoolIdx]))
     }
 
     VkDescriptorSetLayout setLayout = layout.getHandle();
 
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = pools[curPoolIdx - 1];
+    allocInfo.descriptorPool = pools[curPoolIdx];
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts = &setLayout;
 
-    poolCounts.push_back(0);
-
     VkDescriptorSet descriptor;
     VK_CHECK_RESULT(vkAllocateDescriptorSets(device.getHandle(), &allocInfo, &descriptor))
     if(descriptor == VK_NULL_HANDLE)
     {
         LOGE("Allocate  descriptor set failed");
     }
+    poolCounts[curPoolIdx]++;
+    setPools[descriptor] = curPoolIdx;
     return descriptor;
 }
 
+void DescriptorPool::free(VkDescriptorSet descriptorSet) {
+    auto it = setPools.find(descriptorSet);
+    if (it == setPools.end())
+        return;
+    VK_CHECK_RESULT(vkFreeDescriptorSets(device.getHandle(), pools[it->second], 1, &descriptorSet))
+    poolCounts[it->second]--;
+    setPools.erase(it);
+}
+
 const DescriptorLayout &DescriptorPool::getDescriptorLayout() const {
     return layout;
 }
@@ -2,6 +2,8 @@
 
 #include "Core/Vulkan.h"
 
+#include <unordered_map>
+
 class DescriptorLayout;
 
 class Device;
@@ -12,7 +14,9 @@ public:
 
     DescriptorPool(Device &device, const DescriptorLayout &layout, uint32_t poolSize = MAX_SETS_PER_POOL);
 
+    //Not thread safe, RenderContext allocates and frees descriptor sets under its descriptor set cache lock
     VkDescriptorSet allocate();
+    void            free(VkDescriptorSet descriptorSet);
 
     const DescriptorLayout &getDescriptorLayout() const;
 
@@ -26,4 +30,7 @@ private:
     std::vector<VkDescriptorPool> pools;
     uint32_t maxPoolSets;
     uint32_t curPoolIdx{0};
+
+    //Pool index of each allocated set
+    std::unordered_map<VkDescriptorSet, uint32_t> setPools;
 };
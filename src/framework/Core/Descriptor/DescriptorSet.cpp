@@ -7,9 +7,8 @@
 #include "Core/Device/Device.h"
 
 DescriptorSet::~DescriptorSet() {
-    if (_descriptorSet != VK_NULL_HANDLE) {
-        //  vkFreeDescriptorSets(_device.getHandle(), , 1, &_descriptorSet);
-    }
+    if (_descriptorSet != VK_NULL_HANDLE)
+        descriptorPool->free(_descriptorSet);
 }
 
 // template<class T>
@@ -146,7 +145,7 @@ bool DescriptorSet::operator==(const DescriptorSet& desc) const {
     return true;
 }
 
-void DescriptorSet::update(const std::vector<uint32_t>& bindings_to_update) {
+uint32_t DescriptorSet::update(const std::vector<uint32_t>& bindings_to_update) {
     // vkUpdateDescriptorSets(_device.getHandle(), 1, &writeSet, 0, nullptr);
     std::vector<VkWriteDescriptorSet> write_operations;
     std::vector<size_t>               write_operation_hashes;
@@ -207,4 +206,5 @@ void DescriptorSet::update(const std::vector<uint32_t>& bindings_to_update) {
         mUpdatedBindings[write_pos_hashes[i]] = write_operation_hashes[i];
     }
     // LOGI("mUpdatedBindings 2 {}", mUpdatedBindings.size())
+    return toUint32(write_operations.size());
 }
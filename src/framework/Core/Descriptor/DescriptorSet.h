@@ -28,7 +28,8 @@ public:
     DescriptorSet(DescriptorSet&&);
 
     bool operator==(const DescriptorSet&) const;
-    void update(const std::vector<uint32_t>& bindings_to_update);
+    //Returns the number of descriptor writes issued
+    uint32_t update(const std::vector<uint32_t>& bindings_to_update);
 
     ~DescriptorSet();
 
@@ -42,5 +43,5 @@ private:
     BindingMap<VkDescriptorImageInfo>                        imageInfos;
     BindingMap<VkWriteDescriptorSetAccelerationStructureKHR> accelerations;
     const DescriptorLayout*                                  descriptorSetLayout;
-    const DescriptorPool*                                    descriptorPool;
+    DescriptorPool*                                          descriptorPool;
 };
\ No newline at end of file
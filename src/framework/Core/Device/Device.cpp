@@ -130,6 +130,45 @@ Device::Device(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkInstance
     features12.runtimeDescriptorArray           = VK_TRUE;
     features12.bufferDeviceAddress              = VK_TRUE;
     features12.descriptorIndexing               = VK_TRUE;
+    features12.timelineSemaphore                = VK_TRUE;
+
+    //Features of the bindless descriptor heap, enabled only when the whole set is supported
+    VkPhysicalDeviceVulkan12Features supportedFeatures12{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    VkPhysicalDeviceFeatures2        supportedFeatures2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    supportedFeatures2.pNext = &supportedFeatures12;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+    bindlessSupported = supportedFeatures12.descriptorBindingPartiallyBound &&
+                        supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind &&
+                        supportedFeatures12.descriptorBindingUpdateUnusedWhilePending &&
+                        supportedFeatures12.shaderSampledImageArrayNonUniformIndexing &&
+                        supportedFeatures12.bufferDeviceAddress;
+    if (bindlessSupported) {
+        features12.descriptorBindingPartiallyBound              = VK_TRUE;
+        features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features12.descriptorBindingUpdateUnusedWhilePending    = VK_TRUE;
+        features12.shaderSampledImageArrayNonUniformIndexing    = VK_TRUE;
+    }
+
+    drawIndirectCountSupported = supportedFeatures12.drawIndirectCount &&
+                                 supportedFeatures2.features.multiDrawIndirect &&
+                                 supportedFeatures2.features.drawIndirectFirstInstance;
+    if (drawIndirectCountSupported) {
+        features12.drawIndirectCount                        = VK_TRUE;
+        device_features2.features.multiDrawIndirect         = VK_TRUE;
+        device_features2.features.drawIndirectFirstInstance = VK_TRUE;
+    }
+
+    bufferInt64AtomicsSupported = supportedFeatures12.shaderBufferInt64Atomics && supportedFeatures2.features.shaderInt64;
+    if (bufferInt64AtomicsSupported)
+        features12.shaderBufferInt64Atomics = VK_TRUE;
+
+    textureCompressionBCSupported = supportedFeatures2.features.textureCompressionBC;
+    if (textureCompressionBCSupported)
+        device_features2.features.textureCompressionBC = VK_TRUE;
+
+    pipelineStatisticsQuerySupported = supportedFeatures2.features.pipelineStatisticsQuery;
+    if (pipelineStatisticsQuerySupported)
+        device_features2.features.pipelineStatisticsQuery = VK_TRUE;
 
     VkPhysicalDeviceSynchronization2FeaturesKHR syncronization2_features = {
         VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR};
@@ -152,6 +191,7 @@ Device::Device(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkInstance
         LOGI("Enabled Mesh Shader Extension");
     }
 
+    rayTracingSupported = enableExtension(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME) && enableExtension(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME);
     if (enableExtension(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME)) {
         VkPhysicalDeviceRayTracingPipelineFeaturesKHR rt_fts{
             VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR};
@@ -214,7 +254,8 @@ Device::Device(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkInstance
     queues.resize(queueFamilyCount);
     for (uint32_t queueFamilyIndex = 0; queueFamilyIndex < queueFamilyCount; queueFamilyIndex++) {
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, queueFamilyIndex, surface, &presentSupport);
+        if (surface != VK_NULL_HANDLE)
+            vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, queueFamilyIndex, surface, &presentSupport);
         for (uint32_t i = 0; i < queueCreateInfos[queueFamilyIndex].queueCount; i++) {
             const VkQueueFamilyProperties& queueFamilyProp = queueFamilyProperties[queueFamilyIndex];
             queues[queueFamilyIndex].emplace_back(
@@ -224,6 +265,26 @@ Device::Device(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkInstance
 
     commandPools.emplace(VK_QUEUE_GRAPHICS_BIT, CommandPool(*this, getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0).getFamilyIndex(), CommandBuffer::ResetMode::AlwaysAllocate));
     commandPools.emplace(VK_QUEUE_TRANSFER_BIT, CommandPool(*this, getQueueByFlag(VK_QUEUE_TRANSFER_BIT, 0).getFamilyIndex(), CommandBuffer::ResetMode::AlwaysAllocate));
+
+    //A compute family without graphics support runs render graph compute passes concurrently with the graphics queue
+    for (const auto& queueFamily : queues) {
+        const auto queueFlags = queueFamily[0]->getProp().queueFlags;
+        if ((queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            asyncComputeQueue = queueFamily[0].get();
+            commandPools.emplace(VK_QUEUE_COMPUTE_BIT, CommandPool(*this, asyncComputeQueue->getFamilyIndex(), CommandBuffer::ResetMode::AlwaysAllocate));
+            LOGI("Async compute queue family {}", asyncComputeQueue->getFamilyIndex());
+            break;
+        }
+    }
+    //A transfer family without graphics or compute support streams uploads concurrently with rendering
+    for (const auto& queueFamily : queues) {
+        const auto queueFlags = queueFamily[0]->getProp().queueFlags;
+        if ((queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            dedicatedTransferQueue = queueFamily[0].get();
+            LOGI("Dedicated transfer queue family {}", dedicatedTransferQueue->getFamilyIndex());
+            break;
+        }
+    }
     //Init Cache
     cache = new ResourceCache(*this);
     ResourceCache::initCache(*this);
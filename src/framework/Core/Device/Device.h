@@ -23,6 +23,22 @@ public:
 
     Queue&       getQueueByFlag(VkQueueFlagBits requiredFlag, uint32_t queueIndex);
     const Queue& getPresentQueue(uint32_t queueIndex);
+    //Queue of a compute only family, nullptr if the device does not expose one
+    Queue* getAsyncComputeQueue() const { return asyncComputeQueue; }
+    //Queue of a transfer only family, nullptr if the device does not expose one
+    Queue* getDedicatedTransferQueue() const { return dedicatedTransferQueue; }
+    //Partially bound update after bind descriptor arrays and buffer device addresses, required by the bindless mode
+    bool         isBindlessSupported() const { return bindlessSupported; }
+    //Multi draw indirect with a gpu written draw count and first instance, required by the gpu driven draw path
+    bool         isDrawIndirectCountSupported() const { return drawIndirectCountSupported; }
+    //64 bit atomics on storage buffers, required by the visibility buffer of the nanite software rasterizer
+    bool         isBufferInt64AtomicsSupported() const { return bufferInt64AtomicsSupported; }
+    //Sampling of BC1-BC7 images, required by cooked textures
+    bool         isTextureCompressionBCSupported() const { return textureCompressionBCSupported; }
+    //Primitive and invocation counters of the gpu profiler
+    bool         isPipelineStatisticsQuerySupported() const { return pipelineStatisticsQuerySupported; }
+    //Ray tracing pipelines and acceleration structures, required by the gpu integrators of the ray tracer
+    bool         isRayTracingSupported() const { return rayTracingSupported; }
     CommandPool& getCommandPool(VkQueueFlags queueFlags = VK_QUEUE_GRAPHICS_BIT) { return commandPools.at(queueFlags); }
 
     inline VmaAllocator  getMemoryAllocator() const { return allocator; }
@@ -49,6 +65,14 @@ protected:
 
     std::unordered_map<VkQueueFlags, CommandPool> commandPools;
     std::unique_ptr<CommandPool>                  commandPool;
+    Queue*                                        asyncComputeQueue{nullptr};
+    Queue*                                        dedicatedTransferQueue{nullptr};
+    bool                                          bindlessSupported{false};
+    bool                                          drawIndirectCountSupported{false};
+    bool                                          textureCompressionBCSupported{false};
+    bool                                          bufferInt64AtomicsSupported{false};
+    bool                                          pipelineStatisticsQuerySupported{false};
+    bool                                          rayTracingSupported{false};
     ResourceCache*                                cache;
 
     bool isExtensionSupported(const std::string& extensionName);
@@ -0,0 +1,249 @@
+#include "GpuProfiler.h"
+
+#include "Core/CommandBuffer.h"
+#include "Core/Device/Device.h"
+#include "Common/Log.h"
+
+#include <imgui.h>
+
+#include <format>
+#include <fstream>
+
+//Order of the results follows the bit order of the flags
+static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+                                                                     VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                                                                     VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+                                                                     VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+static constexpr uint32_t PIPELINE_STATISTICS_COUNT = 4;
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+GpuProfiler::GpuProfiler(Device& device, uint32_t framesInFlight) : device(device) {
+    const auto& limits  = device.getProperties().limits;
+    timestampsSupported = limits.timestampComputeAndGraphics;
+    statisticsSupported = device.isPipelineStatisticsQuerySupported();
+    timestampPeriodMs   = limits.timestampPeriod * 1e-6;
+
+    frames.resize(framesInFlight);
+    for (auto& frame : frames) {
+        VkQueryPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        if (timestampsSupported) {
+            poolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+            poolInfo.queryCount = MAX_PASSES * 2;
+            VK_CHECK_RESULT(vkCreateQueryPool(device.getHandle(), &poolInfo, nullptr, &frame.timestampPool));
+        }
+        if (statisticsSupported) {
+            poolInfo.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            poolInfo.queryCount         = MAX_PASSES;
+            poolInfo.pipelineStatistics = PIPELINE_STATISTICS;
+            VK_CHECK_RESULT(vkCreateQueryPool(device.getHandle(), &poolInfo, nullptr, &frame.statisticsPool));
+        }
+    }
+    if (!timestampsSupported)
+        LOGW("Device does not support timestamps on graphics and compute queues, the profiler only measures cpu time");
+}
+
+GpuProfiler::~GpuProfiler() {
+    for (auto& frame : frames) {
+        if (frame.timestampPool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(device.getHandle(), frame.timestampPool, nullptr);
+        if (frame.statisticsPool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(device.getHandle(), frame.statisticsPool, nullptr);
+    }
+}
+
+void GpuProfiler::beginFrame(uint32_t frameSlot) {
+    this->frameSlot = frameSlot;
+    auto& frame     = frames[frameSlot];
+    if (!frame.passes.empty())
+        collect(frame);
+    frame.passes.clear();
+    frame.timestampCount  = 0;
+    frame.statisticsCount = 0;
+    frame.reset           = false;
+    frame.activePass      = -1;
+}
+
+void GpuProfiler::collect(FrameQueries& frame) {
+    std::vector<uint64_t> timestamps(frame.timestampCount);
+    std::vector<uint64_t> statistics(frame.statisticsCount * PIPELINE_STATISTICS_COUNT);
+    //The frame fence has signalled, VK_NOT_READY only happens when the frame was never submitted
+    bool timestampsValid = frame.timestampCount > 0 &&
+                           vkGetQueryPoolResults(device.getHandle(), frame.timestampPool, 0, frame.timestampCount, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+    bool statisticsValid = frame.statisticsCount > 0 &&
+                           vkGetQueryPoolResults(device.getHandle(), frame.statisticsPool, 0, frame.statisticsCount, statistics.size() * sizeof(uint64_t), statistics.data(), sizeof(uint64_t) * PIPELINE_STATISTICS_COUNT, VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+
+    uint64_t frameBegin = UINT64_MAX, frameEnd = 0;
+    if (timestampsValid) {
+        for (uint32_t i = 0; i < frame.timestampCount; i += 2) {
+            frameBegin = std::min(frameBegin, timestamps[i]);
+            frameEnd   = std::max(frameEnd, timestamps[i + 1]);
+        }
+    }
+
+    results.clear();
+    for (const auto& pass : frame.passes) {
+        GpuPassTiming& timing = results.emplace_back();
+        timing.name           = pass.name;
+        timing.cpuBeginMs     = pass.cpuBeginMs;
+        timing.cpuMs          = pass.cpuMs;
+        timing.asyncCompute   = pass.asyncCompute;
+        if (timestampsValid && pass.timestampQuery >= 0) {
+            uint64_t begin    = timestamps[pass.timestampQuery];
+            uint64_t end      = timestamps[pass.timestampQuery + 1];
+            timing.hasGpuTime = true;
+            timing.gpuBeginMs = (begin - frameBegin) * timestampPeriodMs;
+            timing.gpuMs      = (end - begin) * timestampPeriodMs;
+        }
+        if (statisticsValid && pass.statisticsQuery >= 0) {
+            const uint64_t* counters   = statistics.data() + pass.statisticsQuery * PIPELINE_STATISTICS_COUNT;
+            timing.hasStatistics       = true;
+            timing.inputPrimitives     = counters[0];
+            timing.clippingPrimitives  = counters[1];
+            timing.fragmentInvocations = counters[2];
+            timing.computeInvocations  = counters[3];
+        }
+    }
+    frameGpuMs = timestampsValid ? (frameEnd - frameBegin) * timestampPeriodMs : 0;
+}
+
+void GpuProfiler::resetQueries(CommandBuffer& commandBuffer) {
+    auto& frame    = frames[frameSlot];
+    frame.cpuStart = std::chrono::steady_clock::now();
+    if (!enabled || frame.reset)
+        return;
+    if (frame.timestampPool != VK_NULL_HANDLE)
+        vkCmdResetQueryPool(commandBuffer.getHandle(), frame.timestampPool, 0, MAX_PASSES * 2);
+    if (frame.statisticsPool != VK_NULL_HANDLE)
+        vkCmdResetQueryPool(commandBuffer.getHandle(), frame.statisticsPool, 0, MAX_PASSES);
+    frame.reset = true;
+}
+
+void GpuProfiler::beginPass(CommandBuffer& commandBuffer, const std::string& name, bool gpuQueries, bool statistics) {
+    auto& frame = frames[frameSlot];
+    if (!enabled || frame.passes.size() >= MAX_PASSES)
+        return;
+
+    frame.activePass  = frame.passes.size();
+    PassRecord& pass  = frame.passes.emplace_back();
+    pass.name         = name;
+    pass.asyncCompute = !gpuQueries;
+    pass.cpuBeginMs   = MillisecondsSince(frame.cpuStart);
+    if (!gpuQueries || !frame.reset)
+        return;
+
+    if (frame.timestampPool != VK_NULL_HANDLE) {
+        pass.timestampQuery = frame.timestampCount;
+        frame.timestampCount += 2;
+        vkCmdWriteTimestamp2(commandBuffer.getHandle(), VK_PIPELINE_STAGE_2_NONE, frame.timestampPool, pass.timestampQuery);
+    }
+    if (statistics && frame.statisticsPool != VK_NULL_HANDLE) {
+        pass.statisticsQuery = frame.statisticsCount++;
+        vkCmdBeginQuery(commandBuffer.getHandle(), frame.statisticsPool, pass.statisticsQuery, 0);
+    }
+}
+
+void GpuProfiler::endPass(CommandBuffer& commandBuffer) {
+    auto& frame = frames[frameSlot];
+    if (frame.activePass < 0)
+        return;
+
+    PassRecord& pass = frame.passes[frame.activePass];
+    frame.activePass = -1;
+    if (pass.statisticsQuery >= 0)
+        vkCmdEndQuery(commandBuffer.getHandle(), frame.statisticsPool, pass.statisticsQuery);
+    if (pass.timestampQuery >= 0)
+        vkCmdWriteTimestamp2(commandBuffer.getHandle(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame.timestampPool, pass.timestampQuery + 1);
+    pass.cpuMs = MillisecondsSince(frame.cpuStart) - pass.cpuBeginMs;
+}
+
+void GpuProfiler::updateGui() {
+    ImGui::Checkbox("profile passes", &enabled);
+    ImGui::SameLine();
+    if (ImGui::Button("export csv"))
+        exportCsv("gpu_profile.csv");
+    ImGui::SameLine();
+    if (ImGui::Button("export trace"))
+        exportChromeTrace("gpu_profile.json");
+    ImGui::Text("gpu frame: %.3f ms (%d frames old)", frameGpuMs, static_cast<int>(frames.size()));
+
+    if (!ImGui::BeginTable("passes", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit))
+        return;
+    ImGui::TableSetupColumn("pass");
+    ImGui::TableSetupColumn("gpu ms");
+    ImGui::TableSetupColumn("cpu ms");
+    ImGui::TableSetupColumn("primitives");
+    ImGui::TableSetupColumn("clipped");
+    ImGui::TableSetupColumn("invocations");
+    ImGui::TableHeadersRow();
+    for (const auto& timing : results) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%s%s", timing.name.c_str(), timing.asyncCompute ? " (async)" : "");
+        ImGui::TableNextColumn();
+        if (timing.hasGpuTime)
+            ImGui::Text("%.3f", timing.gpuMs);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", timing.cpuMs);
+        if (!timing.hasStatistics)
+            continue;
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(timing.inputPrimitives));
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(timing.clippingPrimitives));
+        ImGui::TableNextColumn();
+        //Fragment and compute invocations, a pass is almost always only one of the two
+        ImGui::Text("%llu", static_cast<unsigned long long>(timing.fragmentInvocations + timing.computeInvocations));
+    }
+    ImGui::EndTable();
+}
+
+bool GpuProfiler::exportCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LOGE("Failed to open {} for writing", path);
+        return false;
+    }
+    file << "pass,async_compute,gpu_begin_ms,gpu_ms,cpu_begin_ms,cpu_ms,input_primitives,clipping_primitives,fragment_invocations,compute_invocations\n";
+    for (const auto& timing : results) {
+        file << std::format("\"{}\",{},{:.4f},{:.4f},{:.4f},{:.4f},{},{},{},{}\n", timing.name, timing.asyncCompute ? 1 : 0, timing.gpuBeginMs, timing.gpuMs, timing.cpuBeginMs, timing.cpuMs,
+                            timing.inputPrimitives, timing.clippingPrimitives, timing.fragmentInvocations, timing.computeInvocations);
+    }
+    LOGI("Pass timings written to {}", path);
+    return true;
+}
+
+static std::string EscapeJson(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool GpuProfiler::exportChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LOGE("Failed to open {} for writing", path);
+        return false;
+    }
+    //Complete events in microseconds, tid 0 is the cpu recording and tid 1 the gpu execution
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"cpu record\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"gpu\"}}";
+    for (const auto& timing : results) {
+        auto name = EscapeJson(timing.name);
+        file << std::format(",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":{:.3f},\"dur\":{:.3f}}}", name, timing.cpuBeginMs * 1000.0, timing.cpuMs * 1000.0);
+        if (!timing.hasGpuTime)
+            continue;
+        file << std::format(",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"input_primitives\":{},\"clipping_primitives\":{},\"fragment_invocations\":{},\"compute_invocations\":{}}}}}",
+                            name, timing.gpuBeginMs * 1000.0, timing.gpuMs * 1000.0, timing.inputPrimitives, timing.clippingPrimitives, timing.fragmentInvocations, timing.computeInvocations);
+    }
+    file << "\n]}\n";
+    LOGI("Pass trace written to {}", path);
+    return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Core/Vulkan.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class CommandBuffer;
+class Device;
+
+struct GpuPassTiming {
+    std::string name;
+    //Start of the pass relative to the first pass of the frame
+    double   gpuBeginMs{0};
+    double   gpuMs{0};
+    double   cpuBeginMs{0};
+    double   cpuMs{0};
+    bool     hasGpuTime{false};
+    bool     hasStatistics{false};
+    bool     asyncCompute{false};
+    uint64_t inputPrimitives{0};
+    uint64_t clippingPrimitives{0};
+    uint64_t fragmentInvocations{0};
+    uint64_t computeInvocations{0};
+};
+
+/**
+ * Per pass gpu timestamps, pipeline statistics and cpu record time of the render graph.
+ * Every frame in flight owns its query pools, the results of a frame are read when its frame resources are reused,
+ * the fence of the frame has signalled by then and reading never stalls. The results shown are framesInFlight old.
+ * Async compute passes only get their cpu time, the queries are reset and written on the graphics queue.
+ */
+class GpuProfiler {
+public:
+    static constexpr uint32_t MAX_PASSES = 256;
+
+    GpuProfiler(Device& device, uint32_t framesInFlight);
+    ~GpuProfiler();
+
+    //Collects the queries frameSlot wrote framesInFlight frames ago
+    void beginFrame(uint32_t frameSlot);
+    //Right after the frame command buffer began, before the first pass
+    void resetQueries(CommandBuffer& commandBuffer);
+    //statistics is false for passes executing secondary command buffers, queries can not be inherited
+    void beginPass(CommandBuffer& commandBuffer, const std::string& name, bool gpuQueries, bool statistics);
+    void endPass(CommandBuffer& commandBuffer);
+
+    //Passes of the last completed frame in execution order
+    const std::vector<GpuPassTiming>& getResults() const { return results; }
+    double                            getFrameGpuTime() const { return frameGpuMs; }
+    bool                              isEnabled() const { return enabled; }
+    void                              setEnabled(bool enable) { enabled = enable; }
+
+    void updateGui();
+    bool exportCsv(const std::string& path) const;
+    //chrome://tracing and Perfetto format, the cpu record and the gpu execution of every pass on their own track
+    bool exportChromeTrace(const std::string& path) const;
+
+private:
+    struct PassRecord {
+        std::string name;
+        double      cpuBeginMs{0};
+        double      cpuMs{0};
+        int32_t     timestampQuery{-1};
+        int32_t     statisticsQuery{-1};
+        bool        asyncCompute{false};
+    };
+
+    struct FrameQueries {
+        VkQueryPool             timestampPool{VK_NULL_HANDLE};
+        VkQueryPool             statisticsPool{VK_NULL_HANDLE};
+        std::vector<PassRecord> passes;
+        uint32_t                timestampCount{0};
+        uint32_t                statisticsCount{0};
+        //Queries are only written and read back after the reset was recorded in the frame
+        bool                                  reset{false};
+        int32_t                               activePass{-1};
+        std::chrono::steady_clock::time_point cpuStart;
+    };
+
+    void collect(FrameQueries& frame);
+
+    Device&                   device;
+    std::vector<FrameQueries> frames;
+    uint32_t                  frameSlot{0};
+    double                    timestampPeriodMs{0};
+    bool                      timestampsSupported{false};
+    bool                      statisticsSupported{false};
+    bool                      enabled{true};
+
+    std::vector<GpuPassTiming> results;
+    double                     frameGpuMs{0};
+};
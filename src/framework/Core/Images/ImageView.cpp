@@ -6,6 +6,7 @@
 #include "Image.h"
 #include "ImageUtil.h"
 #include "Common/VkUtils.h"
+#include "Core/Descriptor/BindlessDescriptorHeap.h"
 
 
 ImageView::ImageView(Image& image, VkImageViewType view_type, VkFormat format, uint32_t mip_level, uint32_t base_array_layer, uint32_t n_mip_levels, uint32_t n_array_layers) : image(image),
@@ -51,11 +52,14 @@ const VkImageSubresourceRange& ImageView::getSubResourceRange() const {
 }
 
 ImageView::~ImageView() {
-    if (_view != VK_NULL_HANDLE)
-        vkDestroyImageView(_device.getHandle(), _view, nullptr);
+    if (_view == VK_NULL_HANDLE)
+        return;
+    if (auto* bindlessHeap = BindlessDescriptorHeap::getInstance())
+        bindlessHeap->unregisterTexture(_view);
+    vkDestroyImageView(_device.getHandle(), _view, nullptr);
 }
 
-ImageView::ImageView(ImageView&& other) : image(other.image), _device(other._device), _format(other._format),
+ImageView::ImageView(ImageView&& other) : image(other.image), _device(other._device), _view(other._view), _format(other._format),
                                           subResourceRange(other.subResourceRange) {
     other._view = VK_NULL_HANDLE;
 }
@@ -0,0 +1,144 @@
+#include "ParallelCommandRecorder.h"
+
+#include "Core/CommandBuffer.h"
+#include "Core/Device/Device.h"
+#include "Core/FrameBuffer.h"
+#include "Core/RenderContext.h"
+#include "Core/RenderPass.h"
+#include "Common/samplerCPP/ThreadPool.h"
+
+#include <algorithm>
+
+ParallelCommandRecorder::ParallelCommandRecorder(Device& device) : device(device) {
+    threadPools.resize(ThreadPool::GetThreadPool().size() + 1);
+    for (auto& threadPool : threadPools) {
+        VkCommandPoolCreateInfo info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        info.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        info.queueFamilyIndex = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0).getFamilyIndex();
+        VK_CHECK_RESULT(vkCreateCommandPool(device.getHandle(), &info, nullptr, &threadPool.pool));
+    }
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder() {
+    for (auto& threadPool : threadPools)
+        vkDestroyCommandPool(device.getHandle(), threadPool.pool, nullptr);
+}
+
+void ParallelCommandRecorder::reset() {
+    for (auto& threadPool : threadPools) {
+        if (threadPool.usedCount == 0)
+            continue;
+        VK_CHECK_RESULT(vkResetCommandPool(device.getHandle(), threadPool.pool, 0));
+        threadPool.usedCount = 0;
+    }
+}
+
+VkCommandBuffer ParallelCommandRecorder::requestCommandBuffer(uint32_t threadIndex) {
+    auto& threadPool = threadPools[threadIndex];
+    if (threadPool.usedCount == threadPool.commandBuffers.size()) {
+        VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.commandPool        = threadPool.pool;
+        allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocateInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(device.getHandle(), &allocateInfo, &commandBuffer));
+        threadPool.commandBuffers.push_back(commandBuffer);
+    }
+    return threadPool.commandBuffers[threadPool.usedCount++];
+}
+
+void ParallelCommandRecorder::beginSecondary(VkCommandBuffer commandBuffer) const {
+    VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+}
+
+void ParallelCommandRecorder::beginSubpass(CommandBuffer& primary, const RenderPass& renderPass, const FrameBuffer& frameBuffer, uint32_t subpass) {
+    this->primary               = &primary;
+    inheritanceInfo.renderPass  = renderPass.getHandle();
+    inheritanceInfo.subpass     = subpass;
+    inheritanceInfo.framebuffer = frameBuffer.getHandle();
+
+    if (!cursor)
+        cursor = std::make_unique<CommandBuffer>(device.getHandle(), VK_NULL_HANDLE, VK_NULL_HANDLE, VK_QUEUE_GRAPHICS_BIT);
+    cursor->mViewports     = primary.getViewports();
+    cursor->mScissors      = primary.getScissors();
+    cursor->mVertexBuffers = {};
+    cursor->mIndexBuffer   = {};
+    nextCursor();
+}
+
+void ParallelCommandRecorder::nextCursor() {
+    cursor->mCommandBuffer = requestCommandBuffer(threadPools.size() - 1);
+    beginSecondary(cursor->mCommandBuffer);
+    cursor->inheritDynamicState(*cursor);
+}
+
+CommandBuffer& ParallelCommandRecorder::getCommandBuffer() {
+    return *cursor;
+}
+
+void ParallelCommandRecorder::record(uint32_t itemCount, const RecordFunc& recordFunc) {
+    auto&          threadPool = ThreadPool::GetThreadPool();
+    const uint32_t chunkCount = std::clamp(itemCount / MIN_ITEMS_PER_CHUNK, 1u, static_cast<uint32_t>(threadPool.size()));
+    if (chunkCount == 1) {
+        recordFunc(*cursor, 0, itemCount);
+        return;
+    }
+
+    //The pass state is flushed once on the cursor, every chunk starts from the flushed binding context and only
+    //binds its pipeline and descriptor sets again. Push constants are consumed by the flush, chunks get them too
+    const auto pushConstants = g_context->getBindingContext().storePushConstants;
+    g_context->flush(*cursor);
+    BindingContext bindingContext     = g_context->getBindingContext();
+    bindingContext.storePushConstants = pushConstants;
+
+    cursor->endRecord();
+    segments.push_back(cursor->getHandle());
+
+    //Every chunk records with its own command pool, allocated here since a pool is only used by one thread at a time
+    std::vector<VkCommandBuffer> chunkCommandBuffers(chunkCount);
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+        chunkCommandBuffers[chunk] = requestCommandBuffer(chunk);
+
+    //The recording thread takes chunks too, it never blocks on tasks queued behind others on the shared pool
+    ThreadPool::ParallelFor(chunkCount, [&](uint32_t chunk) {
+        const uint32_t begin           = uint64_t(itemCount) * chunk / chunkCount;
+        const uint32_t end             = uint64_t(itemCount) * (chunk + 1) / chunkCount;
+        const auto     vkCommandBuffer = chunkCommandBuffers[chunk];
+        beginSecondary(vkCommandBuffer);
+
+        //Secondary command buffers inherit no state, viewports, scissors and geometry bound before the draw list are set again
+        CommandBuffer commandBuffer(device.getHandle(), VK_NULL_HANDLE, vkCommandBuffer, VK_QUEUE_GRAPHICS_BIT);
+        commandBuffer.inheritDynamicState(*cursor);
+
+        //The recording thread runs chunks too, its own binding context is restored afterwards
+        BindingContext* previousBindingContext = RenderContext::getThreadBindingContext();
+        BindingContext  threadBindingContext   = bindingContext;
+        RenderContext::setThreadBindingContext(&threadBindingContext);
+        g_context->rebindFlushedState(commandBuffer);
+        recordFunc(commandBuffer, begin, end);
+        RenderContext::setThreadBindingContext(previousBindingContext);
+
+        commandBuffer.endRecord();
+    });
+    segments.insert(segments.end(), chunkCommandBuffers.begin(), chunkCommandBuffers.end());
+
+    //Commands recorded after the draw list continue in a new secondary command buffer with the same state
+    nextCursor();
+    g_context->getBindingContext().storePushConstants = pushConstants;
+    g_context->rebindFlushedState(*cursor);
+}
+
+void ParallelCommandRecorder::endSubpass() {
+    cursor->endRecord();
+    segments.push_back(cursor->getHandle());
+    vkCmdExecuteCommands(primary->getHandle(), segments.size(), segments.data());
+    segments.clear();
+    primary = nullptr;
+}
+
+bool ParallelCommandRecorder::isRecording() const {
+    return primary != nullptr;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Core/Vulkan.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+class Device;
+class CommandBuffer;
+class RenderPass;
+class FrameBuffer;
+
+/**
+ * Records a render pass subpass into secondary command buffers.
+ * The recording thread writes into a cursor command buffer, record() splits a draw list into chunks recorded on
+ * the thread pool with per chunk command pools, and endSubpass() executes everything in recording order.
+ */
+class ParallelCommandRecorder {
+public:
+    using RecordFunc = std::function<void(CommandBuffer& commandBuffer, uint32_t begin, uint32_t end)>;
+
+    static constexpr uint32_t MIN_ITEMS_PER_CHUNK = 64;
+
+    ParallelCommandRecorder(Device& device);
+    ~ParallelCommandRecorder();
+
+    //Recycle all command buffers, the frame that used them must have completed
+    void reset();
+
+    //Called after the render pass began with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    void           beginSubpass(CommandBuffer& primary, const RenderPass& renderPass, const FrameBuffer& frameBuffer, uint32_t subpass);
+    CommandBuffer& getCommandBuffer();
+    //Record items [0,itemCount) in parallel, each chunk starts with the pass state flushed once on the calling thread
+    void record(uint32_t itemCount, const RecordFunc& recordFunc);
+    void endSubpass();
+
+    bool isRecording() const;
+
+private:
+    struct ThreadCommandPool {
+        VkCommandPool                pool{VK_NULL_HANDLE};
+        std::vector<VkCommandBuffer> commandBuffers;
+        uint32_t                     usedCount{0};
+    };
+
+    VkCommandBuffer requestCommandBuffer(uint32_t threadIndex);
+    void            beginSecondary(VkCommandBuffer commandBuffer) const;
+    void            nextCursor();
+
+    Device& device;
+
+    //One pool per chunk of a draw list, at most one per worker of the thread pool, the last one belongs to the cursor
+    std::vector<ThreadCommandPool> threadPools;
+
+    CommandBuffer*                 primary{nullptr};
+    std::unique_ptr<CommandBuffer> cursor;
+    std::vector<VkCommandBuffer>   segments;
+    VkCommandBufferInheritanceInfo inheritanceInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+};
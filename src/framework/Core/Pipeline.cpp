@@ -4,9 +4,15 @@
 #include "RenderPass.h"
 #include "Core/Device/Device.h"
 #include "RayTracing/SbtWarpper.h"
+#include "Common/ResourceCache.h"
+#include "Common/Timer.h"
 #include <array>
 
 Pipeline::Pipeline(Device& device, const PipelineState& pipelineState) : device(device) {
+    Timer createTimer;
+    createTimer.start();
+    auto pipelineCache = device.getResourceCache().getPipelineCache();
+
     auto                                         type    = pipelineState.getPipelineType();
     auto&                                        shaders = pipelineState.getPipelineLayout().getShaders();
     std::vector<VkPipelineShaderStageCreateInfo> stageCreateInfos;
@@ -132,8 +138,7 @@ Pipeline::Pipeline(Device& device, const PipelineState& pipelineState) : device(
         createInfo.renderPass = pipelineState.getRenderPass()->getHandle();
         createInfo.subpass    = pipelineState.getSubpassIndex();
 
-        //todo add pipeline cache
-        VK_CHECK_RESULT(vkCreateGraphicsPipelines(device.getHandle(), nullptr, 1, &createInfo, nullptr, &pipeline))
+        VK_CHECK_RESULT(vkCreateGraphicsPipelines(device.getHandle(), pipelineCache, 1, &createInfo, nullptr, &pipeline))
 
         LOGI("Graphics pipeline created");
     } else if (type == PIPELINE_TYPE::E_RAY_TRACING) {
@@ -201,7 +206,7 @@ Pipeline::Pipeline(Device& device, const PipelineState& pipelineState) : device(
         pipeline_CI.maxPipelineRayRecursionDepth = settings.maxDepth;
         pipeline_CI.layout                       = pipelineState.getPipelineLayout().getHandle();
         pipeline_CI.flags                        = 0;
-        VK_CHECK_RESULT(vkCreateRayTracingPipelinesKHR(device.getHandle(), {}, {}, 1, &pipeline_CI, nullptr, &pipeline));
+        VK_CHECK_RESULT(vkCreateRayTracingPipelinesKHR(device.getHandle(), {}, pipelineCache, 1, &pipeline_CI, nullptr, &pipeline));
 
         LOGI("Ray tracing pipeline created");
 
@@ -213,8 +218,10 @@ Pipeline::Pipeline(Device& device, const PipelineState& pipelineState) : device(
         VkComputePipelineCreateInfo createInfo{.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
         createInfo.layout = pipelineState.getPipelineLayout().getHandle();
         createInfo.stage  = stageCreateInfos[0];
-        VK_CHECK_RESULT(vkCreateComputePipelines(device.getHandle(), nullptr, 1, &createInfo, nullptr, &pipeline))
+        VK_CHECK_RESULT(vkCreateComputePipelines(device.getHandle(), pipelineCache, 1, &createInfo, nullptr, &pipeline))
 
         LOGI("Compute pipeline created");
     }
+
+    device.getResourceCache().recordPipelineCreation(createTimer.stop<Timer::Milliseconds>());
 }
\ No newline at end of file
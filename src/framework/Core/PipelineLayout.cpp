@@ -8,10 +8,8 @@
 
 
 PipelineLayout::PipelineLayout(Device& device, const ShaderPipelineKey& shaderKeys) : device(device),shaderKeys(shaderKeys) {
-    shaders.reserve(shaderKeys.size());
-    for (auto& shaderKey : shaderKeys) {
-        shaders.emplace_back(&device.getResourceCache().requestShaderModule(shaderKey));
-    }
+    auto shaderModules = device.getResourceCache().requestShaderModules(shaderKeys);
+    shaders.assign(shaderModules.begin(), shaderModules.end());
 
     create();
 }
@@ -49,8 +47,10 @@ void PipelineLayout::create() {
 
     std::vector<VkDescriptorSetLayout> vkDescriptorSetLayouts;
 
+    auto* bindlessHeap = device.getResourceCache().getBindlessHeap();
     for (const auto& shaderSet : shaderSets) {
-        auto& descriptorSetLayout = device.getResourceCache().requestDescriptorLayout(shaderSet.first, shaderSet.second);
+        //The bindless set always uses the layout of the global heap so its single descriptor set is compatible
+        auto& descriptorSetLayout = bindlessHeap && shaderSet.first == BINDLESS_SET ? bindlessHeap->getDescriptorLayout() : device.getResourceCache().requestDescriptorLayout(shaderSet.first, shaderSet.second);
 
         descriptorLayouts[shaderSet.first] = &descriptorSetLayout;
         vkDescriptorSetLayouts.push_back(descriptorSetLayout.getHandle());
@@ -131,13 +131,15 @@ VkShaderStageFlags PipelineLayout::getPushConstantRangeStage(uint32_t size) cons
 const std::map<std::uint32_t, std::vector<ShaderResource>>& PipelineLayout::getShaderSets() const {
     return shaderSets;
 }
+const ShaderPipelineKey& PipelineLayout::getShaderKeys() const {
+    return shaderKeys;
+}
+
 void PipelineLayout::recreate() {
     vkDestroyPipelineLayout(device.getHandle(), layout, nullptr);
     shaders.clear();
-    shaders.reserve(shaderKeys.size());
-    for (auto& shaderKey : shaderKeys) {
-        shaders.emplace_back(&device.getResourceCache().requestShaderModule(shaderKey));
-    }
+    auto shaderModules = device.getResourceCache().requestShaderModules(shaderKeys);
+    shaders.assign(shaderModules.begin(), shaderModules.end());
     create();
     recreated = true;
 }
\ No newline at end of file
@@ -26,6 +26,7 @@ public:
     VkShaderStageFlags getPushConstantRangeStage(uint32_t size) const;
 
     const std::map<std::uint32_t, std::vector<ShaderResource>>& getShaderSets() const;
+    const ShaderPipelineKey&                                    getShaderKeys() const;
     void recreate();
 private:
     void create();
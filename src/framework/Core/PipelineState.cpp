@@ -297,6 +297,11 @@ PipelineState& PipelineState::clearDirty() {
     return *this;
 }
 
+PipelineState& PipelineState::setDirty() {
+    dirty = true;
+    return *this;
+}
+
 const RTPipelineSettings& PipelineState::getrTPipelineSettings() const {
     return rTPipelineSettings;
 }
@@ -205,6 +205,8 @@ public:
 
     PipelineState& clearDirty();
 
+    PipelineState& setDirty();
+
 private:
     const PipelineLayout* pipelineLayout{nullptr};
 
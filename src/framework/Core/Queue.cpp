@@ -18,7 +18,7 @@ Queue::Queue(Device* device, int familyIndex, int queueIndex, bool canPresent, c
 
 void Queue::submit(const std::vector<VkSubmitInfo>& submit_infos, VkFence fence) const
 {
-
+    std::lock_guard<std::mutex> lock(mutex);
     auto result = vkQueueSubmit(_queue, uint32_t(submit_infos.size()), submit_infos.data(), fence);
     if (result != VK_SUCCESS)
     {
@@ -30,10 +30,12 @@ void Queue::submit(const std::vector<VkSubmitInfo>& submit_infos, VkFence fence)
 
 VkResult Queue::present(const VkPresentInfoKHR& presentInfo) const
 {
+    std::lock_guard<std::mutex> lock(mutex);
     return vkQueuePresentKHR(_queue, &presentInfo);
 }
 
 void Queue::wait()
 {
+    std::lock_guard<std::mutex> lock(mutex);
     vkQueueWaitIdle(_queue);
 }
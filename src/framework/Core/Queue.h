@@ -2,6 +2,8 @@
 
 #include "Core/Vulkan.h"
 
+#include <mutex>
+
 class Device;
 
 
@@ -18,6 +20,10 @@ public:
 
     Queue(Device *device, int familyIndex, int queueIndex, bool canPresent, const VkQueueFamilyProperties &prop);
 
+    //Owned by the device and only used by reference, a copy would submit beside the lock of the original
+    Queue(const Queue &) = delete;
+    Queue &operator=(const Queue &) = delete;
+
 
     inline bool supportPresent() const { return canPresent; }
 
@@ -38,4 +44,6 @@ protected:
     VkQueue _queue;
     Device *_device;
     VkQueueFamilyProperties properties{};
+    //Queues are externally synchronized, the loading threads submit uploads beside the render thread
+    mutable std::mutex mutex;
 };
@@ -0,0 +1,131 @@
+#include "ReadbackQueue.h"
+
+#include "Core/Buffer.h"
+#include "Core/CommandBuffer.h"
+#include "Core/RenderContext.h"
+#include "Common/Log.h"
+#include "Scene/Images/MipMapGenerator.h"
+#include "Scene/SgImage.h"
+
+ReadbackQueue::ReadbackQueue(RenderContext& context, uint32_t slotCount, uint32_t encoderThreads) : context(context), encoders(encoderThreads) {
+    for (uint32_t i = 0; i < std::max(slotCount, 1u); i++)
+        slots.emplace_back(std::make_unique<Slot>());
+}
+
+ReadbackQueue::~ReadbackQueue() {
+    wait();
+    encoders.stop(true);
+    for (auto& slot : slots)
+        release(*slot);
+}
+
+bool ReadbackQueue::copyImage(CommandBuffer& commandBuffer, const SgImage& image, Callback callback) {
+    const VkExtent2D extent    = image.getExtent2D();
+    const uint32_t   texelSize = MipMapGenerator::getTexelSize(image.getFormat());
+    if (texelSize == 0) {
+        LOGE("Reading back images of format {} is not supported", static_cast<int>(image.getFormat()));
+        return false;
+    }
+
+    Slot& slot    = acquireSlot(VkDeviceSize(extent.width) * extent.height * texelSize);
+    slot.image    = {.format = image.getFormat(), .extent = extent, .frameNumber = context.getFrameNumber()};
+    slot.callback = std::move(callback);
+    slot.state    = SlotState::PENDING;
+
+    VkBufferImageCopy region = {.bufferOffset      = 0,
+                                .bufferRowLength   = 0,
+                                .bufferImageHeight = 0,
+                                .imageSubresource  = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+                                .imageOffset       = {0, 0, 0},
+                                .imageExtent       = {extent.width, extent.height, 1}};
+    vkCmdCopyImageToBuffer(commandBuffer.getHandle(), image.getVkImage().getHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer->getHandle(), 1, &region);
+
+    //The fence wait alone does not make the copy visible to host reads
+    VkMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask  = VK_PIPELINE_STAGE_2_HOST_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    VkDependencyInfo dependencyInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(commandBuffer.getHandle(), &dependencyInfo);
+    return true;
+}
+
+ReadbackQueue::Slot& ReadbackQueue::acquireSlot(VkDeviceSize size) {
+    uint32_t index = nextSlot;
+    while (slots[index]->state != SlotState::FREE) {
+        index = (index + 1) % slots.size();
+        if (index == nextSlot)
+            break;
+    }
+
+    if (slots[index]->state != SlotState::FREE) {
+        stalls++;
+        //Slots are taken in order, nextSlot holds the oldest copy
+        Slot& oldest = *slots[nextSlot];
+        if (oldest.state == SlotState::PENDING && oldest.image.frameNumber == context.getFrameNumber()) {
+            //Every slot was taken by this frame, nothing completes before its submit
+            index = slots.size();
+            slots.emplace_back(std::make_unique<Slot>());
+        } else {
+            if (oldest.state == SlotState::PENDING) {
+                context.waitForFrame(oldest.image.frameNumber);
+                dispatch(oldest);
+            }
+            oldest.state.wait(SlotState::ENCODING);
+        }
+    }
+    nextSlot = (index + 1) % slots.size();
+
+    Slot& slot = *slots[index];
+    if (!slot.buffer || slot.buffer->getSize() < size) {
+        release(slot);
+        slot.buffer = std::make_unique<Buffer>(context.getDevice(), size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+        slot.mapped = static_cast<uint8_t*>(slot.buffer->map());
+    }
+    return slot;
+}
+
+void ReadbackQueue::poll() {
+    for (auto& slot : slots) {
+        if (slot->state == SlotState::PENDING && context.isFrameComplete(slot->image.frameNumber))
+            dispatch(*slot);
+    }
+}
+
+void ReadbackQueue::wait() {
+    for (auto& slot : slots) {
+        if (slot->state != SlotState::PENDING)
+            continue;
+        if (context.waitForFrame(slot->image.frameNumber)) {
+            dispatch(*slot);
+        } else {
+            LOGW("Dropping the readback of frame {}, the frame was never submitted", slot->image.frameNumber);
+            slot->callback = nullptr;
+            slot->state    = SlotState::FREE;
+        }
+    }
+    for (auto& slot : slots)
+        slot->state.wait(SlotState::ENCODING);
+}
+
+void ReadbackQueue::dispatch(Slot& slot) {
+    slot.buffer->invalidate();
+    slot.image.data = slot.mapped;
+    slot.state      = SlotState::ENCODING;
+    encoders.push([&slot](int) {
+        slot.callback(slot.image);
+        slot.callback = nullptr;
+        slot.state    = SlotState::FREE;
+        slot.state.notify_all();
+    });
+}
+
+void ReadbackQueue::release(Slot& slot) {
+    if (slot.buffer)
+        slot.buffer->unmap();
+    slot.buffer.reset();
+    slot.mapped = nullptr;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Core/Vulkan.h"
+#include "ctpl_stl.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class Buffer;
+class CommandBuffer;
+class RenderContext;
+class SgImage;
+
+struct ReadbackImage {
+    const uint8_t* data{nullptr};
+    VkFormat       format{VK_FORMAT_UNDEFINED};
+    VkExtent2D     extent{};
+    uint64_t       frameNumber{0};
+};
+
+/**
+ * Copies images of a frame into a ring of persistently mapped host buffers. A slot is handed to the encoder threads
+ * once the fence of its frame signalled and returns to the ring when its callback finished, the render loop only
+ * waits when every slot is still in use, so capturing every frame is throttled to the encoding speed instead of dropping frames.
+ */
+class ReadbackQueue {
+public:
+    //Runs on an encoder thread, data is only valid during the call
+    using Callback = std::function<void(const ReadbackImage& image)>;
+
+    ReadbackQueue(RenderContext& context, uint32_t slotCount, uint32_t encoderThreads = 2);
+    ~ReadbackQueue();
+
+    //Records the copy of a whole image in TRANSFER_SRC layout into the frame command buffer
+    bool copyImage(CommandBuffer& commandBuffer, const SgImage& image, Callback callback);
+    //Hands the slots of completed frames to the encoders, called once per frame after the submit
+    void poll();
+    //Blocks until every submitted copy was encoded
+    void wait();
+
+    //Copies that had to wait for a busy slot
+    uint32_t getStallCount() const { return stalls; }
+
+private:
+    enum class SlotState : uint8_t {
+        FREE,
+        PENDING,
+        ENCODING,
+    };
+
+    struct Slot {
+        std::unique_ptr<Buffer> buffer;
+        uint8_t*                mapped{nullptr};
+        std::atomic<SlotState>  state{SlotState::FREE};
+        ReadbackImage           image;
+        Callback                callback;
+    };
+
+    Slot& acquireSlot(VkDeviceSize size);
+    void  dispatch(Slot& slot);
+    void  release(Slot& slot);
+
+    RenderContext& context;
+    //Slots are referenced by the encoder tasks and never move
+    std::vector<std::unique_ptr<Slot>> slots;
+    uint32_t                           nextSlot{0};
+    uint32_t                           stalls{0};
+    ctpl::thread_pool                  encoders;
+};
@@ -13,7 +13,6 @@
 #include "Core/FrameBuffer.h"
 #include "Core/Buffer.h"
 
-#include "PlatForm/Window.h"
 #include "Common/ResourceCache.h"
 #include "Common/VkCommon.h"
 #include "IO/ImageIO.h"
@@ -22,26 +21,108 @@
 #include "RayTracing/Accel.h"
 #include "RayTracing/SbtWarpper.h"
 
+#include <algorithm>
 #include <unordered_set>
 
 RenderContext* g_context = nullptr;
 
+//Binding state of a thread recording secondary command buffers, null on the main recording thread
+static thread_local BindingContext* threadBindingContext = nullptr;
+
+void BindingContext::markDirty() {
+    pipelineState.setDirty();
+    descriptor_set_layout_binding_state.clear();
+    for (auto& [set, resourceSet] : resourceSets)
+        resourceSet.setDirty();
+    resourceSetsDirty = true;
+    boundDescriptorSets.clear();
+    boundPipelineLayout = VK_NULL_HANDLE;
+    boundPipeline       = VK_NULL_HANDLE;
+}
+
 void FrameResource::reset() {
+    VK_CHECK_RESULT(vkWaitForFences(device.getHandle(), 1, &fence, VK_TRUE, UINT64_MAX));
+    VK_CHECK_RESULT(vkResetFences(device.getHandle(), 1, &fence));
+
+    deferredReleases.clear();
+
+    VK_CHECK_RESULT(vkResetCommandPool(device.getHandle(), graphicCommandPool, 0));
+    if (computeCommandPool != VK_NULL_HANDLE)
+        VK_CHECK_RESULT(vkResetCommandPool(device.getHandle(), computeCommandPool, 0));
+    usedSpareGraphicCommandBuffers = 0;
     for (auto& it : bufferPools)
         it.second->reset();
+    parallelCommandRecorder->reset();
+}
+
+VkCommandBuffer FrameResource::requestSpareGraphicCommandBuffer() {
+    if (usedSpareGraphicCommandBuffers == spareGraphicCommandBuffers.size()) {
+        VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.commandPool        = graphicCommandPool;
+        allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(device.getHandle(), &allocateInfo, &spareGraphicCommandBuffers.emplace_back()));
+    }
+    return spareGraphicCommandBuffers[usedSpareGraphicCommandBuffers++];
+}
+
+static VkCommandPool CreateFrameCommandPool(Device& device, uint32_t queueFamilyIndex) {
+    VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    VkCommandPool pool{VK_NULL_HANDLE};
+    VK_CHECK_RESULT(vkCreateCommandPool(device.getHandle(), &poolInfo, nullptr, &pool));
+    return pool;
 }
 
-FrameResource::FrameResource(Device& device) {
+static std::unique_ptr<CommandBuffer> AllocateFrameCommandBuffer(Device& device, VkCommandPool pool, VkQueueFlags queueFlags) {
+    VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocateInfo.commandPool        = pool;
+    allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device.getHandle(), &allocateInfo, &commandBuffer));
+    return std::make_unique<CommandBuffer>(device.getHandle(), pool, commandBuffer, queueFlags);
+}
+
+FrameResource::FrameResource(Device& device) : device(device) {
     for (auto& it : supported_usage_map) {
         bufferPools.emplace(
             it.first,
             std::move(std::make_unique<BufferPool>(device, BUFFER_POOL_BLOCK_SIZE * it.second * 1024, it.first)));
     }
+    parallelCommandRecorder = std::make_unique<ParallelCommandRecorder>(device);
+
+    VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VK_CHECK_RESULT(vkCreateFence(device.getHandle(), &fenceInfo, nullptr, &fence));
+    VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    VK_CHECK_RESULT(vkCreateSemaphore(device.getHandle(), &semaphoreInfo, nullptr, &imageAcquiredSem));
+
+    graphicCommandPool   = CreateFrameCommandPool(device, device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0).getFamilyIndex());
+    graphicCommandBuffer = AllocateFrameCommandBuffer(device, graphicCommandPool, VK_QUEUE_GRAPHICS_BIT);
+    frameGraphicCommandBuffer = graphicCommandBuffer->getHandle();
+    if (auto* computeQueue = device.getAsyncComputeQueue()) {
+        computeCommandPool   = CreateFrameCommandPool(device, computeQueue->getFamilyIndex());
+        computeCommandBuffer = AllocateFrameCommandBuffer(device, computeCommandPool, VK_QUEUE_COMPUTE_BIT);
+    }
 }
 
-RenderContext::RenderContext(Device& device, VkSurfaceKHR surface, Window& window)
-    : device(device) {
-    swapchain = std::make_unique<SwapChain>(device, surface, window.getExtent());
+FrameResource::~FrameResource() {
+    deferredReleases.clear();
+    graphicCommandBuffer.reset();
+    computeCommandBuffer.reset();
+    vkDestroyCommandPool(device.getHandle(), graphicCommandPool, nullptr);
+    if (computeCommandPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(device.getHandle(), computeCommandPool, nullptr);
+    vkDestroySemaphore(device.getHandle(), imageAcquiredSem, nullptr);
+    vkDestroyFence(device.getHandle(), fence, nullptr);
+}
+
+RenderContext::RenderContext(Device& device, VkSurfaceKHR surface, VkExtent2D extent, uint32_t framesInFlight)
+    : device(device), surfaceExtent(extent) {
+    if (surface != VK_NULL_HANDLE)
+        swapchain = std::make_unique<SwapChain>(device, surface, extent);
     if (swapchain) {
         surfaceExtent = swapchain->getExtent();
 
@@ -51,51 +132,93 @@ RenderContext::RenderContext(Device& device, VkSurfaceKHR surface, Window& windo
             hwTextures.emplace_back(device, image_handle, extent, swapchain->getImageFormat(), swapchain->getUseage());
         }
     }
+    createRenderFinishedSemaphores();
 
-    VkSemaphoreCreateInfo semaphoreCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-    VK_CHECK_RESULT(
-        vkCreateSemaphore(device.getHandle(), &semaphoreCreateInfo, nullptr, &semaphores.renderFinishedSem));
-    VK_CHECK_RESULT(
-        vkCreateSemaphore(device.getHandle(), &semaphoreCreateInfo, nullptr, &semaphores.presentFinishedSem));
-    VK_CHECK_RESULT(
-        vkCreateSemaphore(device.getHandle(), &semaphoreCreateInfo, nullptr, &semaphores.graphicFinishedSem));
-    VK_CHECK_RESULT(
-        vkCreateSemaphore(device.getHandle(), &semaphoreCreateInfo, nullptr, &semaphores.computeFinishedSem));
-
-    VkSubmitInfo submit_info         = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
-    submit_info.signalSemaphoreCount = 1;
-    submit_info.pSignalSemaphores    = &semaphores.computeFinishedSem;
-    device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0).submit({submit_info}, VK_NULL_HANDLE);
-
-    VkCommandBufferAllocateInfo allocateInfo{};
-    allocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocateInfo.commandPool        = device.getCommandPool().getHandle();
-    allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocateInfo.commandBufferCount = getSwapChainImageCount();
-
-    std::vector<VkCommandBuffer> vkGraphicCommandBuffers(getSwapChainImageCount());
-    VK_CHECK_RESULT(vkAllocateCommandBuffers(device.getHandle(), &allocateInfo, vkGraphicCommandBuffers.data()))
-
-    for (uint32_t i = 0; i < getSwapChainImageCount(); i++) {
+    //More frames than swap chain images would only wait in acquire
+    if (swapchain)
+        framesInFlight = std::min(framesInFlight, getSwapChainImageCount());
+    this->framesInFlight = std::max(framesInFlight, 1u);
+    for (uint32_t i = 0; i < this->framesInFlight; i++)
         frameResources.emplace_back(std::make_unique<FrameResource>(device));
-        frameResources.back()->graphicCommandBuffer = std::make_unique<CommandBuffer>(device.getHandle(), device.getCommandPool().getHandle(), vkGraphicCommandBuffers[i], VK_QUEUE_GRAPHICS_BIT);
+    gpuProfiler = std::make_unique<GpuProfiler>(device, this->framesInFlight);
+
+    if (device.getAsyncComputeQueue()) {
+        VkSemaphoreTypeCreateInfo timelineCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        timelineCreateInfo.initialValue  = 0;
+        VkSemaphoreCreateInfo timelineSemaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        timelineSemaphoreInfo.pNext = &timelineCreateInfo;
+        VK_CHECK_RESULT(vkCreateSemaphore(device.getHandle(), &timelineSemaphoreInfo, nullptr, &computeTimelineSem));
+        VK_CHECK_RESULT(vkCreateSemaphore(device.getHandle(), &timelineSemaphoreInfo, nullptr, &graphicsTimelineSem));
     }
 
     maxPushConstantSize = device.getProperties().limits.maxPushConstantsSize;
-    virtualViewport     = std::make_unique<VirtualViewport>(device, VkExtent2D{1920, 1080}, getSwapChainImageCount());
+    virtualViewport     = std::make_unique<VirtualViewport>(device, VkExtent2D{1920, 1080}, this->framesInFlight);
+}
+
+RenderContext::~RenderContext() {
+    device.waitIdle();
+    frameResources.clear();
+    gpuProfiler.reset();
+    for (auto semaphore : renderFinishedSems)
+        vkDestroySemaphore(device.getHandle(), semaphore, nullptr);
+    if (computeTimelineSem != VK_NULL_HANDLE)
+        vkDestroySemaphore(device.getHandle(), computeTimelineSem, nullptr);
+    if (graphicsTimelineSem != VK_NULL_HANDLE)
+        vkDestroySemaphore(device.getHandle(), graphicsTimelineSem, nullptr);
+}
+
+void RenderContext::createRenderFinishedSemaphores() {
+    VkSemaphoreCreateInfo semaphoreCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    while (renderFinishedSems.size() < hwTextures.size()) {
+        VkSemaphore semaphore{VK_NULL_HANDLE};
+        VK_CHECK_RESULT(vkCreateSemaphore(device.getHandle(), &semaphoreCreateInfo, nullptr, &semaphore));
+        renderFinishedSems.push_back(semaphore);
+    }
 }
 
 void RenderContext::beginFrame() {
+    auto& frameResource = *frameResources[activeFrameIndex];
+    //The frame submission waited for the async compute work of the frame, so the fence covers it
+    frameResource.reset();
+    {
+        //Every frame up to framesInFlight frames ago has completed, their descriptor sets can be freed
+        std::lock_guard<std::mutex>  guard(descriptorSetCacheMutex);
+        std::vector<VkDescriptorSet> releasedSets;
+
+        auto release = [&](const CachedDescriptorSet& cachedSet) {
+            if (cachedSet.lastUsedFrame + getFramesInFlight() > getFrameNumber())
+                return false;
+            releasedSets.push_back(cachedSet.descriptorSet->getHandle());
+            return true;
+        };
+        std::erase_if(descriptorSetCache, [&](const auto& entry) { return release(entry.second); });
+        std::erase_if(retiredDescriptorSets, release);
+        if (!releasedSets.empty())
+            device.getResourceCache().releaseDescriptorSets(releasedSets);
+    }
+    frameResource.computeTimelineValue = 0;
+    frameResource.graphicCommandBuffer->mCommandBuffer = frameResource.frameGraphicCommandBuffer;
+    completedFrames = std::max(completedFrames, frameResource.submittedFrame);
+    device.getResourceCache().getTransientResourcePool().beginFrame(activeFrameIndex);
+    gpuProfiler->beginFrame(activeFrameIndex);
+
     if (swapchain) {
-        VK_CHECK_RESULT(swapchain->acquireNextImage(activeFrameIndex, semaphores.presentFinishedSem, VK_NULL_HANDLE));
+        VK_CHECK_RESULT(swapchain->acquireNextImage(swapChainImageIndex, frameResource.imageAcquiredSem, VK_NULL_HANDLE));
     }
     frameActive = true;
 
-    frameResources[activeFrameIndex]->reset();
+    descriptorStats.descriptorWrites   = frameDescriptorCounters.descriptorWrites.exchange(0);
+    descriptorStats.descriptorSetBinds = frameDescriptorCounters.descriptorSetBinds.exchange(0);
+    descriptorStats.skippedBinds       = frameDescriptorCounters.skippedBinds.exchange(0);
+    descriptorStats.cachedSets         = frameDescriptorCounters.cachedSets.exchange(0);
+    descriptorStats.createdSets        = frameDescriptorCounters.createdSets.exchange(0);
+
     clearPassResources();
 
     auto& commandBuffer = getGraphicCommandBuffer();
-    commandBuffer.beginRecord(0);
+    commandBuffer.beginRecord(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    gpuProfiler->resetQueries(commandBuffer);
 
     commandBuffer.setViewport(0, {vkCommon::initializers::viewport(float(getViewPortExtent().width), float(getViewPortExtent().height), 0.0f, 1.0f, flipViewport)});
     commandBuffer.setScissor(0, {vkCommon::initializers::rect2D(float(getViewPortExtent().width), float(getViewPortExtent().height), 0, 0)});
@@ -111,28 +234,98 @@ uint32_t RenderContext::getActiveFrameIndex() const {
     return activeFrameIndex;
 }
 
-void RenderContext::submitAndPresent(CommandBuffer& commandBuffer, VkFence fence) {
-    getSwapChainImage().getVkImage().transitionLayout(commandBuffer, VulkanLayout::PRESENT);
+uint32_t RenderContext::getFramesInFlight() const {
+    return framesInFlight;
+}
+
+uint64_t RenderContext::getFrameNumber() const {
+    return submittedFrames + 1;
+}
+
+bool RenderContext::isFrameComplete(uint64_t frameNumber) {
+    if (frameNumber <= completedFrames)
+        return true;
+    for (const auto& frameResource : frameResources) {
+        if (frameResource->submittedFrame != frameNumber)
+            continue;
+        if (vkGetFenceStatus(device.getHandle(), frameResource->fence) != VK_SUCCESS)
+            return false;
+        completedFrames = frameNumber;
+        return true;
+    }
+    return false;
+}
+
+bool RenderContext::waitForFrame(uint64_t frameNumber) {
+    if (frameNumber <= completedFrames)
+        return true;
+    for (const auto& frameResource : frameResources) {
+        if (frameResource->submittedFrame != frameNumber)
+            continue;
+        VK_CHECK_RESULT(vkWaitForFences(device.getHandle(), 1, &frameResource->fence, VK_TRUE, UINT64_MAX));
+        completedFrames = frameNumber;
+        return true;
+    }
+    return false;
+}
+
+void RenderContext::deferRelease(std::shared_ptr<void>&& resource) {
+    if (resource)
+        frameResources[activeFrameIndex]->deferredReleases.push_back(std::move(resource));
+}
+
+void RenderContext::submitAndPresent(CommandBuffer& commandBuffer) {
+    if (swapchain)
+        getSwapChainImage().getVkImage().transitionLayout(commandBuffer, VulkanLayout::PRESENT);
     commandBuffer.endRecord();
 
-    auto queue = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0);
+    auto& frameResource = *frameResources[activeFrameIndex];
+    auto& queue         = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0);
 
-    VkSubmitInfo         submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    VkSemaphore          waitSems[]   = {semaphores.presentFinishedSem};
-    VkSemaphore          signalSems[] = {semaphores.renderFinishedSem};
+    VkSubmitInfo                      submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<VkSemaphore>          waitSems;
+    std::vector<uint64_t>             waitValues;
+    if (swapchain) {
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        waitSems.push_back(frameResource.imageAcquiredSem);
+        waitValues.push_back(0);
+    }
 
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores    = waitSems;
-    submitInfo.pWaitDstStageMask  = waitStages;
+    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    if (pendingComputeWait.waitStages) {
+        waitSems.push_back(computeTimelineSem);
+        waitStages.push_back(pendingComputeWait.waitStages);
+        waitValues.push_back(pendingComputeWait.timelineValue);
+        timelineInfo.waitSemaphoreValueCount = waitValues.size();
+        timelineInfo.pWaitSemaphoreValues    = waitValues.data();
+        submitInfo.pNext                     = &timelineInfo;
+        pendingComputeWait                   = {};
+    }
 
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores    = signalSems;
+    submitInfo.waitSemaphoreCount = waitSems.size();
+    submitInfo.pWaitSemaphores    = waitSems.data();
+    submitInfo.pWaitDstStageMask  = waitStages.data();
+
+    if (swapchain) {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores    = &renderFinishedSems[swapChainImageIndex];
+    }
 
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers    = commandBuffer.getHandlePointer();
 
-    queue.submit({submitInfo}, fence);
+    std::vector<VkSubmitInfo>     submitInfos{submitInfo};
+    VkSubmitInfo                  asyncComputeSubmitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    VkTimelineSemaphoreSubmitInfo asyncComputeTimelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    if ((frameResource.computeTimelineValue != 0 || queueAcquireCommandBuffer) &&
+        fillAsyncComputeBatch(asyncComputeSubmitInfo, asyncComputeTimelineInfo, true))
+        submitInfos.push_back(asyncComputeSubmitInfo);
+
+    //The frame fence is the only cpu wait, the next use of these frame resources blocks on it
+    queue.submit(submitInfos, frameResource.fence);
+    queueAcquireCommandBuffer.reset();
+    frameResource.submittedFrame = ++submittedFrames;
 
     if (swapchain) {
         VkSwapchainKHR vk_swapchain = swapchain->getHandle();
@@ -140,23 +333,22 @@ void RenderContext::submitAndPresent(CommandBuffer& commandBuffer, VkFence fence
         VkPresentInfoKHR present_info{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
 
         present_info.waitSemaphoreCount = 1;
-        present_info.pWaitSemaphores    = &semaphores.renderFinishedSem;
+        present_info.pWaitSemaphores    = &renderFinishedSems[swapChainImageIndex];
         present_info.swapchainCount     = 1;
         present_info.pSwapchains        = &vk_swapchain;
-        present_info.pImageIndices      = &activeFrameIndex;
+        present_info.pImageIndices      = &swapChainImageIndex;
 
         if (queue.present(present_info) == VK_ERROR_OUT_OF_DATE_KHR) {
             handleSurfaceChanges();
         }
-
-        frameActive = false;
     }
-    queue.wait();
+    frameActive = false;
+    activeFrameIndex = (activeFrameIndex + 1) % framesInFlight;
 }
 
 void RenderContext::submit(CommandBuffer& commandBuffer, bool waiteFence, VkQueueFlagBits queueFlags) {
     commandBuffer.endRecord();
-    auto queue = device.getQueueByFlag(queueFlags, 0);
+    auto& queue = device.getQueueByFlag(queueFlags, 0);
 
     VkSubmitInfo         submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
@@ -164,19 +356,157 @@ void RenderContext::submit(CommandBuffer& commandBuffer, bool waiteFence, VkQueu
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers    = commandBuffer.getHandlePointer();
 
+    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    if (queueFlags == VK_QUEUE_GRAPHICS_BIT && pendingComputeWait.waitStages) {
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues    = &pendingComputeWait.timelineValue;
+        submitInfo.pNext                     = &timelineInfo;
+        submitInfo.waitSemaphoreCount        = 1;
+        submitInfo.pWaitSemaphores           = &computeTimelineSem;
+        submitInfo.pWaitDstStageMask         = &pendingComputeWait.waitStages;
+    }
+
     VkFence fence = VK_NULL_HANDLE;
     if (waiteFence) {
         VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
         vkCreateFence(device.getHandle(), &fenceInfo, nullptr, &fence);
     }
 
-    queue.submit({submitInfo}, fence);
+    //Immediate submissions read their results right after, including async compute passes nothing on graphics waited for
+    std::vector<VkSubmitInfo>     submitInfos{submitInfo};
+    VkSubmitInfo                  asyncComputeSubmitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    VkTimelineSemaphoreSubmitInfo asyncComputeTimelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    if (fillAsyncComputeBatch(asyncComputeSubmitInfo, asyncComputeTimelineInfo, queueFlags == VK_QUEUE_GRAPHICS_BIT))
+        submitInfos.push_back(asyncComputeSubmitInfo);
+
+    queue.submit(submitInfos, fence);
     queue.wait();
+    if (submitInfo.pNext)
+        pendingComputeWait = {};
+    if (queueFlags == VK_QUEUE_GRAPHICS_BIT)
+        queueAcquireCommandBuffer.reset();
     if (waiteFence) {
         vkWaitForFences(device.getHandle(), 1, &fence, VK_TRUE, UINT64_MAX);
     }
 }
 
+bool RenderContext::fillAsyncComputeBatch(VkSubmitInfo& submitInfo, VkTimelineSemaphoreSubmitInfo& timelineInfo, bool graphicsQueue) {
+    static constexpr VkPipelineStageFlags waitStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    if (computeTimelineValue == 0)
+        return false;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues    = &computeTimelineValue;
+    submitInfo.pNext                     = &timelineInfo;
+    submitInfo.waitSemaphoreCount        = 1;
+    submitInfo.pWaitSemaphores           = &computeTimelineSem;
+    submitInfo.pWaitDstStageMask         = &waitStages;
+    if (graphicsQueue && queueAcquireCommandBuffer) {
+        queueAcquireCommandBuffer->endRecord();
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = queueAcquireCommandBuffer->getHandlePointer();
+    }
+    return true;
+}
+
+bool RenderContext::supportAsyncCompute() const {
+    return computeTimelineSem != VK_NULL_HANDLE;
+}
+
+uint64_t RenderContext::submitAsyncCompute(CommandBuffer& commandBuffer, uint64_t graphicsTimelineValue) {
+    commandBuffer.endRecord();
+
+    const uint64_t signalValue = ++computeTimelineValue;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &signalValue;
+
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = commandBuffer.getHandlePointer();
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &computeTimelineSem;
+
+    //The queue ownership acquires at the start of the command buffer wait for the releases of the graphics queue
+    const VkPipelineStageFlags waitStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    if (graphicsTimelineValue != 0) {
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues    = &graphicsTimelineValue;
+        submitInfo.waitSemaphoreCount        = 1;
+        submitInfo.pWaitSemaphores           = &graphicsTimelineSem;
+        submitInfo.pWaitDstStageMask         = &waitStages;
+    }
+
+    device.getAsyncComputeQueue()->submit({submitInfo}, VK_NULL_HANDLE);
+    frameResources[activeFrameIndex]->computeTimelineValue = signalValue;
+    return signalValue;
+}
+
+void RenderContext::waitAsyncCompute(uint64_t timelineValue, VkPipelineStageFlags waitStages) {
+    pendingComputeWait.timelineValue = std::max(pendingComputeWait.timelineValue, timelineValue);
+    pendingComputeWait.waitStages |= waitStages;
+}
+
+uint64_t RenderContext::splitGraphicSubmission(CommandBuffer& commandBuffer) {
+    commandBuffer.endRecord();
+    auto& queue = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0);
+
+    const uint64_t signalValue = ++graphicsTimelineValue;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &signalValue;
+
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = commandBuffer.getHandlePointer();
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &graphicsTimelineSem;
+    if (pendingComputeWait.waitStages) {
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues    = &pendingComputeWait.timelineValue;
+        submitInfo.waitSemaphoreCount        = 1;
+        submitInfo.pWaitSemaphores           = &computeTimelineSem;
+        submitInfo.pWaitDstStageMask         = &pendingComputeWait.waitStages;
+    }
+    queue.submit({submitInfo}, VK_NULL_HANDLE);
+    pendingComputeWait = {};
+
+    auto& frameResource = *frameResources[activeFrameIndex];
+    if (&commandBuffer == frameResource.graphicCommandBuffer.get() || commandBuffer.mCommandPool == VK_NULL_HANDLE) {
+        commandBuffer.mCommandBuffer = frameResource.requestSpareGraphicCommandBuffer();
+    } else {
+        //The submitted part of an owning wrapper is freed with the frame, the wrapper owns its continuation
+        deferRelease(std::make_shared<CommandBuffer>(device.getHandle(), commandBuffer.mCommandPool, commandBuffer.getHandle(), commandBuffer.getQueueFlag()));
+        VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.commandPool        = commandBuffer.mCommandPool;
+        allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(device.getHandle(), &allocateInfo, &commandBuffer.mCommandBuffer));
+    }
+
+    //Dynamic state does not carry over to the new command buffer
+    const auto viewports = commandBuffer.getViewports();
+    const auto scissors  = commandBuffer.getScissors();
+    commandBuffer.beginRecord(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    if (!viewports.empty())
+        commandBuffer.setViewport(0, viewports);
+    if (!scissors.empty())
+        commandBuffer.setScissor(0, scissors);
+    return signalValue;
+}
+
+CommandBuffer& RenderContext::getQueueAcquireCommandBuffer() {
+    if (!queueAcquireCommandBuffer) {
+        auto handle               = frameResources[activeFrameIndex]->requestSpareGraphicCommandBuffer();
+        queueAcquireCommandBuffer = std::make_unique<CommandBuffer>(device.getHandle(), VK_NULL_HANDLE, handle, VK_QUEUE_GRAPHICS_BIT);
+        queueAcquireCommandBuffer->beginRecord(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    }
+    return *queueAcquireCommandBuffer;
+}
+
 VkExtent2D RenderContext::getViewPortExtent() const {
     return virtualViewport->getExtent();
 }
@@ -190,7 +520,11 @@ VkExtent2D RenderContext::getSwapChainExtent() const {
     return surfaceExtent;
 }
 uint32_t RenderContext::getSwapChainImageCount() const {
-    return swapchain->getImageCount();
+    return swapchain ? swapchain->getImageCount() : 0;
+}
+
+bool RenderContext::isHeadless() const {
+    return swapchain == nullptr;
 }
 
 void RenderContext::setActiveFrameIdx(int idx) {
@@ -202,14 +536,15 @@ bool RenderContext::isPrepared() const {
 }
 
 PipelineState& RenderContext::getPipelineState() {
-    return pipelineState;
+    auto& bindingContext = getBindingContext();
+    return bindingContext.pipelineState;
 }
 
 SgImage& RenderContext::getCurHwtexture() {
     return virtualViewport->getImage(activeFrameIndex);
 }
 SgImage& RenderContext::getSwapChainImage() {
-    return hwTextures[activeFrameIndex];
+    return hwTextures[swapChainImageIndex];
 }
 
 // RenderContext & RenderContext::bindBuffer(uint32_t setId, const Buffer& buffer, VkDeviceSize offset, VkDeviceSize range,
@@ -220,42 +555,47 @@ SgImage& RenderContext::getSwapChainImage() {
 // }
 
 RenderContext& RenderContext::bindBuffer(uint32_t binding, const Buffer& buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t setId, uint32_t array_element) {
+    auto& bindingContext = getBindingContext();
     if (range == 0) range = buffer.getSize();
     if (setId == -1)
         setId = static_cast<uint32_t>(DescriptorSetPoints::UNIFORM);
-    resourceSets[setId].bindBuffer(buffer, offset, range, binding, array_element);
-    resourceSetsDirty = true;
+    bindingContext.resourceSets[setId].bindBuffer(buffer, offset, range, binding, array_element);
+    bindingContext.resourceSetsDirty = true;
     return *this;
 }
 
 RenderContext& RenderContext::bindAcceleration(uint32_t binding, const Accel& acceleration, uint32_t setId, uint32_t array_element) {
+    auto& bindingContext = getBindingContext();
     if (setId == -1)
         setId = static_cast<uint32_t>(DescriptorSetPoints::ACCELERATION);
-    resourceSets[setId].bindAccel(acceleration, binding, array_element);
-    resourceSetsDirty = true;
+    bindingContext.resourceSets[setId].bindAccel(acceleration, binding, array_element);
+    bindingContext.resourceSetsDirty = true;
     return *this;
 }
 
 RenderContext& RenderContext::bindImageSampler(uint32_t binding, const ImageView& view, const Sampler& sampler, uint32_t setId, uint32_t array_element) {
+    auto& bindingContext = getBindingContext();
     if (setId == -1)
         setId = static_cast<uint32_t>(DescriptorSetPoints::SAMPLER);
-    resourceSets[setId].bindImage(view, sampler, binding, array_element);
-    resourceSetsDirty = true;
+    bindingContext.resourceSets[setId].bindImage(view, sampler, binding, array_element);
+    bindingContext.resourceSetsDirty = true;
     return *this;
 }
 
 RenderContext& RenderContext::bindImage(uint32_t binding, const ImageView& view, uint32_t setId, uint32_t array_element) {
+    auto& bindingContext = getBindingContext();
     if (setId == -1)
         setId = static_cast<uint32_t>(DescriptorSetPoints::INPUT);
-    resourceSets[setId].bindInput(view, binding, array_element);
-    resourceSetsDirty = true;
+    bindingContext.resourceSets[setId].bindInput(view, binding, array_element);
+    bindingContext.resourceSetsDirty = true;
     return *this;
 }
 RenderContext& RenderContext::bindSampler(uint32_t binding, const Sampler& sampler, uint32_t setId, uint32_t array_element) {
+    auto& bindingContext = getBindingContext();
     if (setId == -1)
         setId = static_cast<uint32_t>(DescriptorSetPoints::SAMPLER);
-    resourceSets[setId].bindSampler(sampler, binding, array_element);
-    resourceSetsDirty = true;
+    bindingContext.resourceSets[setId].bindSampler(sampler, binding, array_element);
+    bindingContext.resourceSetsDirty = true;
     return *this;
 }
 
@@ -288,10 +628,11 @@ RenderContext& RenderContext::bindView(const View& view) {
 }
 
 RenderContext& RenderContext::bindPrimitiveGeom(CommandBuffer& commandBuffer, const Primitive& primitive) {
+    auto& bindingContext = getBindingContext();
     VertexInputState vertexInputState;
     uint32_t         maxLoaction = 0;
 
-    for (const auto& inputResource : pipelineState.getPipelineLayout().getShaderResources(ShaderResourceType::Input,
+    for (const auto& inputResource : bindingContext.pipelineState.getPipelineLayout().getShaderResources(ShaderResourceType::Input,
                                                                                           VK_SHADER_STAGE_VERTEX_BIT)) {
         auto inputResourceName = inputResource.name;
         //resource name in shader is in_XXX,so we need to remove the prefix
@@ -328,13 +669,13 @@ RenderContext& RenderContext::bindPrimitiveGeom(CommandBuffer& commandBuffer, co
     }
     if (primitive.hasIndexBuffer())
         commandBuffer.bindIndicesBuffer(primitive.getIndexBuffer(), 0, primitive.getIndexType());
-    InputAssemblyState inputAssemblyState = pipelineState.getInputAssemblyState();
+    InputAssemblyState inputAssemblyState = bindingContext.pipelineState.getInputAssemblyState();
     inputAssemblyState.topology           = GetVkPrimitiveTopology(primitive.primitiveType);
 
     // vertexInputState.attributes.push_back({.location = maxLoaction + 1, .binding = maxLoaction + 1, .format = VK_FORMAT_R32_UINT, .offset = 0});
     //  vertexInputState.bindings.push_back({.binding = maxLoaction + 1, .stride = sizeof(uint32_t), .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE});
 
-    pipelineState.setVertexInputState(vertexInputState).setInputAssemblyState(inputAssemblyState);
+    bindingContext.pipelineState.setVertexInputState(vertexInputState).setInputAssemblyState(inputAssemblyState);
 
     //  bindPushConstants(primitive);
     // bindBuffer(static_cast<uint32_t>(UniformBindingPoints::PRIM_INFO), primitive.getUniformBuffer(), 0, sizeof(PerPrimitiveUniform));
@@ -343,9 +684,10 @@ RenderContext& RenderContext::bindPrimitiveGeom(CommandBuffer& commandBuffer, co
 }
 
 RenderContext& RenderContext::bindScene(CommandBuffer& commandBuffer, const Scene& scene) {
+    auto& bindingContext = getBindingContext();
     VertexInputState vertexInputState;
     uint32_t         maxLoaction = 0;
-    for (const auto& inputResource : pipelineState.getPipelineLayout().getShaderResources(ShaderResourceType::Input,
+    for (const auto& inputResource : bindingContext.pipelineState.getPipelineLayout().getShaderResources(ShaderResourceType::Input,
                                                                                           VK_SHADER_STAGE_VERTEX_BIT)) {
         auto inputResourceName = inputResource.name;
         //resource name in shader is in_XXX,so we need to remove the prefix
@@ -390,7 +732,7 @@ RenderContext& RenderContext::bindScene(CommandBuffer& commandBuffer, const Scen
 
     commandBuffer.bindIndicesBuffer(scene.getIndexBuffer(), 0, scene.getIndexType());
 
-    pipelineState.setVertexInputState(vertexInputState);
+    bindingContext.pipelineState.setVertexInputState(vertexInputState);
 
     bindBuffer(static_cast<uint32_t>(UniformBindingPoints::PRIM_INFO), scene.getUniformBuffer(), 0, scene.getUniformBuffer().getSize());
     return *this;
@@ -401,11 +743,13 @@ RenderContext& RenderContext::bindPrimitiveShading(CommandBuffer& commandBuffer,
 }
 
 const std::unordered_map<uint32_t, ResourceSet>& RenderContext::getResourceSets() const {
-    return resourceSets;
+    auto& bindingContext = getBindingContext();
+    return bindingContext.resourceSets;
 }
 
 VkPipelineBindPoint RenderContext::getPipelineBindPoint() const {
-    switch (pipelineState.getPipelineType()) {
+    auto& bindingContext = getBindingContext();
+    switch (bindingContext.pipelineState.getPipelineType()) {
         case PIPELINE_TYPE::E_GRAPHICS:
             return VK_PIPELINE_BIND_POINT_GRAPHICS;
         case PIPELINE_TYPE::E_COMPUTE:
@@ -419,46 +763,55 @@ VkPipelineBindPoint RenderContext::getPipelineBindPoint() const {
 }
 
 void RenderContext::flushDescriptorState(CommandBuffer& commandBuffer, VkPipelineBindPoint pipeline_bind_point) {
-    auto& pipelineLayout = pipelineState.getPipelineLayout();
+    auto& bindingContext = getBindingContext();
+    auto& pipelineLayout = bindingContext.pipelineState.getPipelineLayout();
 
     std::unordered_set<uint32_t> update_descriptor_sets;
 
     for (auto& set_it : pipelineLayout.getShaderSets()) {
         uint32_t descriptor_set_id = set_it.first;
 
-        auto descriptor_set_layout_it = descriptor_set_layout_binding_state.find(descriptor_set_id);
+        auto descriptor_set_layout_it = bindingContext.descriptor_set_layout_binding_state.find(descriptor_set_id);
 
-        if (descriptor_set_layout_it != descriptor_set_layout_binding_state.end()) {
+        if (descriptor_set_layout_it != bindingContext.descriptor_set_layout_binding_state.end()) {
             if (descriptor_set_layout_it->second->getHandle() != pipelineLayout.getDescriptorLayout(descriptor_set_id).getHandle()) {
                 update_descriptor_sets.emplace(descriptor_set_id);
             }
         }
     }
 
-    for (auto set_it = descriptor_set_layout_binding_state.begin(); set_it != descriptor_set_layout_binding_state.end();) {
+    for (auto set_it = bindingContext.descriptor_set_layout_binding_state.begin(); set_it != bindingContext.descriptor_set_layout_binding_state.end();) {
         if (!pipelineLayout.hasLayout(set_it->first)) {
-            set_it = descriptor_set_layout_binding_state.erase(set_it);
+            set_it = bindingContext.descriptor_set_layout_binding_state.erase(set_it);
         } else {
             ++set_it;
         }
     }
 
+    //Sets bound with another pipeline layout may have been disturbed
+    if (bindingContext.boundPipelineLayout != pipelineLayout.getHandle()) {
+        bindingContext.boundDescriptorSets.clear();
+        bindingContext.boundPipelineLayout = pipelineLayout.getHandle();
+    }
+
+    //The bindless heap never changes, it is bound once per command buffer and pipeline layout
+    if (auto* bindlessHeap = device.getResourceCache().getBindlessHeap(); bindlessHeap && pipelineLayout.hasLayout(BINDLESS_SET)) {
+        auto& boundDescriptorSet = bindingContext.boundDescriptorSets[BINDLESS_SET];
+        if (boundDescriptorSet != bindlessHeap->getHandle()) {
+            boundDescriptorSet = bindlessHeap->getHandle();
+            vkCmdBindDescriptorSets(commandBuffer.getHandle(), pipeline_bind_point, pipelineLayout.getHandle(), BINDLESS_SET, 1, &boundDescriptorSet, 0, nullptr);
+            frameDescriptorCounters.descriptorSetBinds++;
+        }
+    }
+
     //Two case wee need to update descriptor sets
     //1. descriptor set layout has been changed
     //2. resourceSets is dirty
-    if (resourceSetsDirty || !update_descriptor_sets.empty()) {
-
-        resourceSetsDirty = false;
+    if (bindingContext.resourceSetsDirty || !update_descriptor_sets.empty()) {
 
-        for (auto& resourceSetIt : resourceSets) {
-
-            //setId -> pair(binding,arrayElement)
-            BindingMap<VkDescriptorBufferInfo>                       bufferInfos;
-            BindingMap<VkDescriptorImageInfo>                        imageInfos;
-            BindingMap<VkWriteDescriptorSetAccelerationStructureKHR> accelerationInfos;
-
-            std::vector<uint32_t> dynamic_offsets;
+        bindingContext.resourceSetsDirty = false;
 
+        for (auto& resourceSetIt : bindingContext.resourceSets) {
             auto  descriptorSetID = resourceSetIt.first;
             auto& resourceSet     = resourceSetIt.second;
 
@@ -467,99 +820,134 @@ void RenderContext::flushDescriptorState(CommandBuffer& commandBuffer, VkPipelin
 
             resourceSet.clearDirty();
 
-            if (!pipelineState.getPipelineLayout().hasLayout(descriptorSetID))
+            if (!bindingContext.pipelineState.getPipelineLayout().hasLayout(descriptorSetID))
                 continue;
 
             auto& descriptorSetLayout                            = pipelineLayout.getDescriptorLayout(descriptorSetID);
-            descriptor_set_layout_binding_state[descriptorSetID] = &descriptorSetLayout;
+            bindingContext.descriptor_set_layout_binding_state[descriptorSetID] = &descriptorSetLayout;
+
+            auto descriptorSetKey = resourceSet.getKey(descriptorSetLayout.getHandle());
+
+            DescriptorSet* descriptorSet = nullptr;
+            {
+                //Sets are also written under the lock, descriptor pools are not thread safe
+                std::lock_guard<std::mutex> guard(descriptorSetCacheMutex);
+                if (auto it = descriptorSetCache.find(descriptorSetKey); it != descriptorSetCache.end()) {
+                    descriptorSet            = it->second.descriptorSet;
+                    it->second.lastUsedFrame = getFrameNumber();
+                    frameDescriptorCounters.cachedSets++;
+                } else {
+                    descriptorSet = &requestDescriptorSet(descriptorSetLayout, resourceSet);
+                    frameDescriptorCounters.createdSets++;
+                    descriptorSetCache.emplace(std::move(descriptorSetKey), CachedDescriptorSet{descriptorSet, getFrameNumber()});
+                }
+            }
 
-            for (auto& bindingIt : resourceSet.getResourceBindings()) {
-                auto  bindingIndex     = bindingIt.first;
-                auto& bindingResources = bindingIt.second;
+            auto& boundDescriptorSet = bindingContext.boundDescriptorSets[descriptorSetID];
+            if (boundDescriptorSet == descriptorSet->getHandle()) {
+                frameDescriptorCounters.skippedBinds++;
+                continue;
+            }
+            boundDescriptorSet = descriptorSet->getHandle();
+            commandBuffer.bindDescriptorSets(pipeline_bind_point, pipelineLayout.getHandle(), descriptorSetID, {descriptorSet}, {});
+            frameDescriptorCounters.descriptorSetBinds++;
+        }
+    }
+}
 
-                for (auto& elementIt : bindingResources) {
-                    auto  arrayElement = elementIt.first;
-                    auto& resourceInfo = elementIt.second;
+DescriptorSet& RenderContext::requestDescriptorSet(const DescriptorLayout& descriptorSetLayout, const ResourceSet& resourceSet) {
+    //setId -> pair(binding,arrayElement)
+    BindingMap<VkDescriptorBufferInfo>                       bufferInfos;
+    BindingMap<VkDescriptorImageInfo>                        imageInfos;
+    BindingMap<VkWriteDescriptorSetAccelerationStructureKHR> accelerationInfos;
 
-                    auto& buffer    = resourceInfo.buffer;
-                    auto& sampler   = resourceInfo.sampler;
-                    auto& imageView = resourceInfo.image_view;
-                    auto& accel     = resourceInfo.accel;
+    for (auto& bindingIt : resourceSet.getResourceBindings()) {
+        auto  bindingIndex     = bindingIt.first;
+        auto& bindingResources = bindingIt.second;
 
-                    if (!descriptorSetLayout.hasLayoutBinding(bindingIndex) || descriptorSetLayout.getLayoutBindingInfo(bindingIndex).descriptorCount <= arrayElement)
-                        continue;
-                    auto& bindingInfo = descriptorSetLayout.getLayoutBindingInfo(bindingIndex);
+        for (auto& elementIt : bindingResources) {
+            auto  arrayElement = elementIt.first;
+            auto& resourceInfo = elementIt.second;
 
-                    if (buffer != nullptr) {
-                        VkDescriptorBufferInfo bufferInfo{
-                            .buffer = buffer->getHandle(), .offset = resourceInfo.offset, .range = resourceInfo.range};
+            auto& buffer    = resourceInfo.buffer;
+            auto& sampler   = resourceInfo.sampler;
+            auto& imageView = resourceInfo.image_view;
+            auto& accel     = resourceInfo.accel;
 
-                        bufferInfos[bindingIndex][arrayElement] = bufferInfo;
-                    }
+            if (!descriptorSetLayout.hasLayoutBinding(bindingIndex) || descriptorSetLayout.getLayoutBindingInfo(bindingIndex).descriptorCount <= arrayElement)
+                continue;
+            auto& bindingInfo = descriptorSetLayout.getLayoutBindingInfo(bindingIndex);
 
-                    if (imageView != nullptr || sampler != nullptr) {
-                        VkDescriptorImageInfo imageInfo{
-                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        };
-
-                        if(imageView) {
-                            imageInfo.imageView = imageView->getHandle();
-                        }
-                        if (sampler)
-                            imageInfo.sampler = sampler->getHandle();
-
-                        if (imageView != nullptr) {
-                            // Add image layout info based on descriptor type
-                            switch (bindingInfo.descriptorType) {
-                                case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-                                    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                                    break;
-                                case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-                                    if (isDepthOrStencilFormat(imageView->getFormat())) {
-                                        imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-                                    } else {
-                                        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                                    }
-                                    break;
-                                case VK_DESCRIPTOR_TYPE_SAMPLER:
-                                   // imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                                    break;
-                                case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-                                    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-                                    break;
-                                case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-                                    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                                    break;
-                                default:
-                                    continue;
-                            }
-                        }
-                        imageInfos[bindingIndex][arrayElement] = imageInfo;
-                    }
+            if (buffer != nullptr) {
+                VkDescriptorBufferInfo bufferInfo{
+                    .buffer = buffer->getHandle(), .offset = resourceInfo.offset, .range = resourceInfo.range};
 
-                    if (accel != nullptr) {
-                        VkWriteDescriptorSetAccelerationStructureKHR accelInfo{
-                            .sType                      = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
-                            .accelerationStructureCount = 1,
-                            .pAccelerationStructures    = &accel->accel};
-                        accelerationInfos[bindingIndex][arrayElement] = accelInfo;
+                bufferInfos[bindingIndex][arrayElement] = bufferInfo;
+            }
+
+            if (imageView != nullptr || sampler != nullptr) {
+                VkDescriptorImageInfo imageInfo{
+                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                };
+
+                if(imageView) {
+                    imageInfo.imageView = imageView->getHandle();
+                }
+                if (sampler)
+                    imageInfo.sampler = sampler->getHandle();
+
+                if (imageView != nullptr) {
+                    // Add image layout info based on descriptor type
+                    switch (bindingInfo.descriptorType) {
+                        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+                            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                            break;
+                        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                            if (isDepthOrStencilFormat(imageView->getFormat())) {
+                                imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+                            } else {
+                                imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                            }
+                            break;
+                        case VK_DESCRIPTOR_TYPE_SAMPLER:
+                           // imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                            break;
+                        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+                            imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+                            break;
+                        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+                            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                            break;
+                        default:
+                            continue;
                     }
                 }
+                imageInfos[bindingIndex][arrayElement] = imageInfo;
+            }
+
+            if (accel != nullptr) {
+                VkWriteDescriptorSetAccelerationStructureKHR accelInfo{
+                    .sType                      = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+                    .accelerationStructureCount = 1,
+                    .pAccelerationStructures    = &accel->accel};
+                accelerationInfos[bindingIndex][arrayElement] = accelInfo;
             }
-            auto& descriptorPool = device.getResourceCache().requestDescriptorPool(descriptorSetLayout);
-            auto& descriptorSet  = device.getResourceCache().requestDescriptorSet(
-                descriptorSetLayout, descriptorPool, bufferInfos, imageInfos, accelerationInfos);
-            descriptorSet.update({});
-            commandBuffer.bindDescriptorSets(pipeline_bind_point, pipelineLayout.getHandle(), descriptorSetID, {&descriptorSet}, dynamic_offsets);
         }
     }
+    auto& descriptorPool = device.getResourceCache().requestDescriptorPool(descriptorSetLayout);
+    auto& descriptorSet  = device.getResourceCache().requestDescriptorSet(
+        descriptorSetLayout, descriptorPool, bufferInfos, imageInfos, accelerationInfos);
+    frameDescriptorCounters.descriptorWrites += descriptorSet.update({});
+    return descriptorSet;
 }
 
 void RenderContext::flushPipelineState(CommandBuffer& commandBuffer) {
-    if (pipelineState.isDirty()) {
-        commandBuffer.bindPipeline(device.getResourceCache().requestPipeline(this->getPipelineState()),
-                                   getPipelineBindPoint());
-        pipelineState.clearDirty();
+    auto& bindingContext = getBindingContext();
+    if (bindingContext.pipelineState.isDirty()) {
+        auto& pipeline = device.getResourceCache().requestPipeline(this->getPipelineState());
+        commandBuffer.bindPipeline(pipeline, getPipelineBindPoint());
+        bindingContext.boundPipeline = pipeline.getHandle();
+        bindingContext.pipelineState.clearDirty();
     }
 }
 
@@ -573,6 +961,16 @@ void RenderContext::flushAndDraw(CommandBuffer& commandBuffer, uint32_t vertexCo
     commandBuffer.draw(vertexCount, instanceCount, firstVertex, firstInstance);
 }
 
+void RenderContext::flushAndDrawIndexedIndirectCount(CommandBuffer& commandBuffer, const Buffer& buffer, VkDeviceSize offset, const Buffer& countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount) {
+    flush(commandBuffer);
+    commandBuffer.drawIndexedIndirectCount(buffer, offset, countBuffer, countBufferOffset, maxDrawCount);
+}
+
+void RenderContext::flushAndDrawIndirectCount(CommandBuffer& commandBuffer, const Buffer& buffer, VkDeviceSize offset, const Buffer& countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount) {
+    flush(commandBuffer);
+    commandBuffer.drawIndirectCount(buffer, offset, countBuffer, countBufferOffset, maxDrawCount);
+}
+
 void RenderContext::traceRay(CommandBuffer& commandBuffer, VkExtent3D dims) {
     CHECK_RESULT((getPipelineState().getPipelineType() == PIPELINE_TYPE::E_RAY_TRACING));
     if (dims.width == 0 || dims.height == 0 || dims.depth == 0) {
@@ -589,6 +987,10 @@ void RenderContext::flushAndDispatch(CommandBuffer& commandBuffer, uint32_t grou
     flush(commandBuffer);
     vkCmdDispatch(commandBuffer.getHandle(), groupCountX, groupCountY, groupCountZ);
 }
+void RenderContext::flushAndDispatchIndirect(CommandBuffer& commandBuffer, const Buffer& buffer, VkDeviceSize offset) {
+    flush(commandBuffer);
+    vkCmdDispatchIndirect(commandBuffer.getHandle(), buffer.getHandle(), offset);
+}
 void RenderContext::flushAndDispatchMesh(CommandBuffer& commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
     flush(commandBuffer);
     vkCmdDrawMeshTasksEXT(commandBuffer.getHandle(), groupCountX, groupCountY, groupCountZ);
@@ -598,50 +1000,55 @@ void RenderContext::flushAndDrawMeshTasks(CommandBuffer& commandBuffer, uint gro
     vkCmdDrawMeshTasksEXT(commandBuffer.getHandle(), groupCountX, groupCountY, groupCountZ);
 }
 
-void RenderContext::beginRenderPass(CommandBuffer& commandBuffer, RenderTarget& renderTarget, const std::vector<SubpassInfo>& subpassInfos) {
+void RenderContext::beginRenderPass(CommandBuffer& commandBuffer, RenderTarget& renderTarget, const std::vector<SubpassInfo>& subpassInfos, VkSubpassContents contents) {
+    auto& bindingContext = getBindingContext();
     auto& renderPass  = device.getResourceCache().requestRenderPass(renderTarget.getAttachments(), subpassInfos);
     auto& framebuffer = device.getResourceCache().requestFrameBuffer(
         renderTarget, renderPass, renderTarget.getExtent());
 
-    commandBuffer.beginRenderPass(renderPass, framebuffer, renderTarget.getDefaultClearValues(), {});
+    commandBuffer.beginRenderPass(renderPass, framebuffer, renderTarget.getDefaultClearValues(), contents);
+    if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+        getParallelCommandRecorder().beginSubpass(commandBuffer, renderPass, framebuffer, 0);
 
-    ColorBlendState colorBlendState = pipelineState.getColorBlendState();
+    ColorBlendState colorBlendState = bindingContext.pipelineState.getColorBlendState();
     colorBlendState.attachments.resize(renderPass.getColorOutputCount(0));
-    pipelineState.setColorBlendState(colorBlendState);
+    bindingContext.pipelineState.setColorBlendState(colorBlendState);
 
-    pipelineState.setRenderPass(renderPass);
-    pipelineState.setSubpassIndex(0);
+    bindingContext.pipelineState.setRenderPass(renderPass);
+    bindingContext.pipelineState.setSubpassIndex(0);
 }
 
 void RenderContext::nextSubpass(CommandBuffer& commandBuffer) {
+    auto& bindingContext = getBindingContext();
     // clearPassResources();
     //   resourceSets.clear();
-    storePushConstants.clear();
+    bindingContext.storePushConstants.clear();
 
-    uint32_t subpassIdx = pipelineState.getSubpassIndex();
-    pipelineState.setSubpassIndex(subpassIdx + 1);
+    uint32_t subpassIdx = bindingContext.pipelineState.getSubpassIndex();
+    bindingContext.pipelineState.setSubpassIndex(subpassIdx + 1);
 
-    ColorBlendState colorBlendState = pipelineState.getColorBlendState();
-    colorBlendState.attachments.resize(pipelineState.getRenderPass()->getColorOutputCount(subpassIdx + 1));
-    pipelineState.setColorBlendState(colorBlendState);
+    ColorBlendState colorBlendState = bindingContext.pipelineState.getColorBlendState();
+    colorBlendState.attachments.resize(bindingContext.pipelineState.getRenderPass()->getColorOutputCount(subpassIdx + 1));
+    bindingContext.pipelineState.setColorBlendState(colorBlendState);
 
     vkCmdNextSubpass(commandBuffer.getHandle(), {});
 }
 
 void RenderContext::flushPushConstantStage(CommandBuffer& commandBuffer) {
+    auto& bindingContext = getBindingContext();
     // commandBuffer
-    if (storePushConstants.empty())
+    if (bindingContext.storePushConstants.empty())
         return;
 
-    auto& pipelineLayout    = pipelineState.getPipelineLayout();
-    auto  pushConstantRange = pipelineLayout.getPushConstantRangeStage(storePushConstants.size());
+    auto& pipelineLayout    = bindingContext.pipelineState.getPipelineLayout();
+    auto  pushConstantRange = pipelineLayout.getPushConstantRangeStage(bindingContext.storePushConstants.size());
 
     if (pushConstantRange == 0) {
-        pushConstantRange = pipelineLayout.getPushConstantRangeStage(storePushConstants.size());
-        LOGE("Push Constant Size is too large,device support {},but current size is {}", maxPushConstantSize, storePushConstants.size());
+        pushConstantRange = pipelineLayout.getPushConstantRangeStage(bindingContext.storePushConstants.size());
+        LOGE("Push Constant Size is too large,device support {},but current size is {}", maxPushConstantSize, bindingContext.storePushConstants.size());
     }
-    vkCmdPushConstants(commandBuffer.getHandle(), pipelineLayout.getHandle(), pushConstantRange, 0, storePushConstants.size(), storePushConstants.data());
-    storePushConstants.clear();
+    vkCmdPushConstants(commandBuffer.getHandle(), pipelineLayout.getHandle(), pushConstantRange, 0, bindingContext.storePushConstants.size(), bindingContext.storePushConstants.data());
+    bindingContext.storePushConstants.clear();
 }
 
 void RenderContext::flush(CommandBuffer& commandBuffer) {
@@ -650,7 +1057,23 @@ void RenderContext::flush(CommandBuffer& commandBuffer) {
     flushPushConstantStage(commandBuffer);
 }
 
+void RenderContext::rebindFlushedState(CommandBuffer& commandBuffer) {
+    auto&      bindingContext = getBindingContext();
+    const auto bindPoint      = getPipelineBindPoint();
+    if (bindingContext.boundPipeline != VK_NULL_HANDLE)
+        vkCmdBindPipeline(commandBuffer.getHandle(), bindPoint, bindingContext.boundPipeline);
+    for (const auto& [set, descriptorSet] : bindingContext.boundDescriptorSets) {
+        if (descriptorSet != VK_NULL_HANDLE)
+            vkCmdBindDescriptorSets(commandBuffer.getHandle(), bindPoint, bindingContext.boundPipelineLayout, set, 1, &descriptorSet, 0, nullptr);
+    }
+    flushPushConstantStage(commandBuffer);
+}
+
 void RenderContext::endRenderPass(CommandBuffer& commandBuffer, RenderTarget& renderTarget) {
+    auto& bindingContext = getBindingContext();
+    auto& recorder       = getParallelCommandRecorder();
+    if (recorder.isRecording())
+        recorder.endSubpass();
     commandBuffer.endPass();
     // resourceSets.clear();
 
@@ -659,7 +1082,7 @@ void RenderContext::endRenderPass(CommandBuffer& commandBuffer, RenderTarget& re
     //     renderTarget.getImage(i).setLayout(finalLayouts[i]);
     // }
 
-    pipelineState.reset();
+    bindingContext.pipelineState.reset();
 }
 void RenderContext::resetViewport(CommandBuffer& commandBuffer) {
     commandBuffer.setViewport(0, {vkCommon::initializers::viewport(float(getViewPortExtent().width), float(getViewPortExtent().height), 0.0f, 1.0f, flipViewport)});
@@ -667,28 +1090,34 @@ void RenderContext::resetViewport(CommandBuffer& commandBuffer) {
 }
 
 void RenderContext::clearPassResources() {
-    resourceSets.clear();
-    storePushConstants.clear();
-    pipelineState.reset();
+    auto& bindingContext = getBindingContext();
+    bindingContext.resourceSets.clear();
+    bindingContext.storePushConstants.clear();
+    bindingContext.pipelineState.reset();
+    bindingContext.boundDescriptorSets.clear();
+    bindingContext.boundPipelineLayout = VK_NULL_HANDLE;
 }
 template<>
 RenderContext& RenderContext::bindPushConstants(const std::vector<uint8_t>& pushConstants) {
-    auto size = pushConstants.size() + storePushConstants.size();
+    auto& bindingContext = getBindingContext();
+    auto size = pushConstants.size() + bindingContext.storePushConstants.size();
     if (size > maxPushConstantSize) {
         LOGE("Push Constant Size is too large,device support {},but current size is {}", maxPushConstantSize, size);
     }
-    storePushConstants.insert(storePushConstants.end(), pushConstants.begin(), pushConstants.end());
+    bindingContext.storePushConstants.insert(bindingContext.storePushConstants.end(), pushConstants.begin(), pushConstants.end());
     return *this;
 }
 RenderContext& RenderContext::bindShaders(const ShaderPipelineKey& shaderKeys) {
+    auto& bindingContext = getBindingContext();
     auto& pipelineLayout = device.getResourceCache().requestPipelineLayout(shaderKeys);
-    pipelineState.setPipelineLayout(pipelineLayout);
+    bindingContext.pipelineState.setPipelineLayout(pipelineLayout);
     return *this;
 }
 
 BufferAllocation RenderContext::allocateBuffer(VkDeviceSize allocateSize, VkBufferUsageFlags usage) {
     auto& frameResource = frameResources[activeFrameIndex];
     // assert(frameResource.bufferPools.contains(usage), "Buffer usage not contained");
+    std::lock_guard<std::mutex> lock(frameResource->bufferPoolMutex);
     return frameResource->bufferPools.at(usage)->AllocateBufferBlock(allocateSize);
 }
 
@@ -696,7 +1125,52 @@ CommandBuffer& RenderContext::getGraphicCommandBuffer() {
     return *frameResources[activeFrameIndex]->graphicCommandBuffer;
 }
 
+BindingContext& RenderContext::getBindingContext() {
+    return threadBindingContext ? *threadBindingContext : mainBindingContext;
+}
+
+const BindingContext& RenderContext::getBindingContext() const {
+    return threadBindingContext ? *threadBindingContext : mainBindingContext;
+}
+
+void RenderContext::setThreadBindingContext(BindingContext* bindingContext) {
+    threadBindingContext = bindingContext;
+}
+
+BindingContext* RenderContext::getThreadBindingContext() {
+    return threadBindingContext;
+}
+
+ParallelCommandRecorder& RenderContext::getParallelCommandRecorder() {
+    return *frameResources[activeFrameIndex]->parallelCommandRecorder;
+}
+
+bool RenderContext::getParallelRecording() const {
+    return parallelRecording;
+}
+
+void RenderContext::setParallelRecording(bool parallel_recording) {
+    parallelRecording = parallel_recording;
+}
+
+const DescriptorStats& RenderContext::getDescriptorStats() const {
+    return descriptorStats;
+}
+
+GpuProfiler& RenderContext::getGpuProfiler() {
+    return *gpuProfiler;
+}
+
+void RenderContext::invalidateDescriptorSetCache() {
+    std::lock_guard<std::mutex> guard(descriptorSetCacheMutex);
+    for (const auto& [key, cachedSet] : descriptorSetCache)
+        retiredDescriptorSets.push_back(cachedSet);
+    descriptorSetCache.clear();
+}
+
 CommandBuffer& RenderContext::getComputeCommandBuffer() {
+    if (frameResources[activeFrameIndex]->computeCommandBuffer)
+        return *frameResources[activeFrameIndex]->computeCommandBuffer;
     return *frameResources[activeFrameIndex]->graphicCommandBuffer;
 }
 
@@ -720,6 +1194,7 @@ void RenderContext::handleSurfaceChanges() {
 void RenderContext::recrateSwapChain(VkExtent2D extent) {
     device.getResourceCache().clearFrameBuffers();
     device.getResourceCache().clearSgImages();
+    invalidateDescriptorSetCache();
 
     hwTextures.clear();
 
@@ -737,6 +1212,7 @@ void RenderContext::recrateSwapChain(VkExtent2D extent) {
             hwTextures.emplace_back(device, image_handle, extent3d, swapchain->getImageFormat(), swapchain->getUseage());
         }
     }
+    createRenderFinishedSemaphores();
 }
 
 void RenderContext::copyBuffer(const Buffer& src, Buffer& dst) {
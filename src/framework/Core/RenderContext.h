@@ -8,15 +8,20 @@
 #include "ResourceBindingState.h"
 #include "Scene/Scene.h"
 #include "Core/BufferPool.h"
+#include "Core/ParallelCommandRecorder.h"
+#include "Core/GpuProfiler.h"
 #include "Images/VirtualViewport.h"
 
+#include <atomic>
+#include <mutex>
+
 class Device;
 class SwapChain;
-class Window;
 class FrameBuffer;
 class Sampler;
 class Scene;
 class View;
+class DescriptorSet;
 
 struct FrameResource {
     static constexpr uint32_t BUFFER_POOL_BLOCK_SIZE = 256;
@@ -29,12 +34,65 @@ struct FrameResource {
     };
 
     FrameResource(Device&);
-    ~FrameResource() = default;
+    ~FrameResource();
 
+    //Wait until the gpu finished the previous frame recorded into this resource and recycle everything it used
     void reset();
+    //Graphics command buffer from the frame pool, valid until the next reset()
+    VkCommandBuffer requestSpareGraphicCommandBuffer();
+
+    Device& device;
+    //Signalled by the submission of the frame, created signalled so the first wait returns immediately
+    VkFence     fence{VK_NULL_HANDLE};
+    VkSemaphore imageAcquiredSem{VK_NULL_HANDLE};
+    //Reset as a whole once the fence is signalled, the command buffers are never reset individually
+    VkCommandPool graphicCommandPool{VK_NULL_HANDLE};
+    VkCommandPool computeCommandPool{VK_NULL_HANDLE};
 
     std::unique_ptr<CommandBuffer> graphicCommandBuffer{nullptr};
+    //Handle graphicCommandBuffer starts the frame with, a split submission continues it in a spare
+    VkCommandBuffer              frameGraphicCommandBuffer{VK_NULL_HANDLE};
+    std::vector<VkCommandBuffer> spareGraphicCommandBuffers{};
+    uint32_t                     usedSpareGraphicCommandBuffers{0};
+    //Only allocated when the device has an async compute queue
+    std::unique_ptr<CommandBuffer> computeCommandBuffer{nullptr};
+    std::unique_ptr<ParallelCommandRecorder> parallelCommandRecorder{nullptr};
     std::unordered_map<VkBufferUsageFlags, std::unique_ptr<BufferPool>> bufferPools{};
+    //Secondary command buffers of the frame allocate from the pools on the recording threads
+    std::mutex bufferPoolMutex;
+    //Destroyed by reset(), once no command buffer of the frame can reference them anymore
+    std::vector<std::shared_ptr<void>> deferredReleases{};
+    //Frame number of the last submission signalling the fence
+    uint64_t submittedFrame{0};
+    //Compute timeline value of the last async compute submission of the frame, the frame submission waits for it so the fence covers it
+    uint64_t computeTimelineValue{0};
+};
+
+/**
+ * Pipeline and resource binding state consumed by the flush functions of RenderContext.
+ * Threads recording secondary command buffers install their own copy with RenderContext::setThreadBindingContext.
+ */
+struct BindingContext {
+    PipelineState                                   pipelineState;
+    std::unordered_map<uint32_t, DescriptorLayout*> descriptor_set_layout_binding_state;
+    std::unordered_map<uint32_t, ResourceSet>       resourceSets;
+    bool                                            resourceSetsDirty{false};
+    std::vector<uint8_t>                            storePushConstants;
+    //Descriptor sets bound on the current command buffer, binding the same set again is skipped
+    std::unordered_map<uint32_t, VkDescriptorSet> boundDescriptorSets;
+    VkPipelineLayout                              boundPipelineLayout{VK_NULL_HANDLE};
+    VkPipeline                                    boundPipeline{VK_NULL_HANDLE};
+
+    //Make the next flush bind pipeline and descriptor sets again, used when recording moves to another command buffer
+    void markDirty();
+};
+
+struct DescriptorStats {
+    uint32_t descriptorWrites{0};
+    uint32_t descriptorSetBinds{0};
+    uint32_t skippedBinds{0};
+    uint32_t cachedSets{0};
+    uint32_t createdSets{0};
 };
 
 struct alignas(16) GlobalUniform {
@@ -69,7 +127,9 @@ enum class DescriptorSetPoints : uint32_t {
 
 class RenderContext {
 public:
-    RenderContext(Device& device, VkSurfaceKHR surface, Window& window);
+    //A null surface renders headless, frames are only submitted and the viewport image is the final output
+    RenderContext(Device& device, VkSurfaceKHR surface, VkExtent2D extent, uint32_t framesInFlight = 2);
+    ~RenderContext();
 
     RenderContext& bindBuffer(uint32_t binding, const Buffer& buffer, VkDeviceSize offset = 0, VkDeviceSize range = 0, uint32_t setId = -1, uint32_t array_element = 0);
     RenderContext& bindAcceleration(uint32_t binding, const Accel& acceleration, uint32_t setId = -1, uint32_t array_element = 0);
@@ -77,6 +137,7 @@ public:
     RenderContext& bindImage(uint32_t binding, const ImageView& view, uint32_t setId = -1, uint32_t array_element = 0);
     RenderContext& bindSampler(uint32_t binding, const Sampler& sampler, uint32_t setId = -1, uint32_t array_element = 0);
     RenderContext& bindView(const View& view);
+    //Only reads the primitive and writes the binding context of the calling thread, safe on the recording threads
     RenderContext& bindPrimitiveGeom(CommandBuffer& commandBuffer, const Primitive& primitive);
     RenderContext& bindScene(CommandBuffer& commandBuffer, const Scene& scene);
     RenderContext& bindPrimitiveShading(CommandBuffer& commandBuffer, const Primitive& primitive);
@@ -102,12 +163,39 @@ public:
     VkExtent3D getViewPortExtent3D() const;
     VkExtent2D getSwapChainExtent() const;
     uint32_t getSwapChainImageCount() const;
+    bool isHeadless() const;
     void prepare();
+    //Waits for the frame recorded framesInFlight frames ago, then acquires the next swap chain image
     void beginFrame();
     void waitFrame();
+    //Index of the frame resources in [0,getFramesInFlight()), per frame buffers of the passes are indexed with it
     uint32_t getActiveFrameIndex() const;
-    void submitAndPresent(CommandBuffer& commandBuffer, VkFence fence = VK_NULL_HANDLE);
+    uint32_t getFramesInFlight() const;
+    //Number of the frame being recorded, starting at 1 and increasing with every submitAndPresent
+    uint64_t getFrameNumber() const;
+    //Polls the fence of the frame without waiting, frames complete in submission order
+    bool isFrameComplete(uint64_t frameNumber);
+    //Blocks until the gpu finished the frame, false when it was never submitted
+    bool waitForFrame(uint64_t frameNumber);
+    //Submits without waiting for the gpu, the next beginFrame on the same frame resources waits for it
+    void submitAndPresent(CommandBuffer& commandBuffer);
+    //Keeps a resource replaced during the frame alive until the gpu finished the frames that may still reference it
+    template<typename T>
+    void deferRelease(std::unique_ptr<T>&& resource) {
+        deferRelease(std::shared_ptr<void>(std::move(resource)));
+    }
+    void deferRelease(std::shared_ptr<void>&& resource);
     void submit(CommandBuffer& commandBuffer, bool waiteFence = true, VkQueueFlagBits queueFlags = VK_QUEUE_GRAPHICS_BIT);
+    bool supportAsyncCompute() const;
+    //Submit to the async compute queue once the graphics queue reached graphicsTimelineValue, returns the timeline value signalled when the work completes
+    uint64_t submitAsyncCompute(CommandBuffer& commandBuffer, uint64_t graphicsTimelineValue = 0);
+    //The next graphics submission waits for the async compute timeline value at waitStages
+    void waitAsyncCompute(uint64_t timelineValue, VkPipelineStageFlags waitStages);
+    //Submits what commandBuffer recorded so far and continues recording into a new command buffer behind the same wrapper,
+    //returns the graphics timeline value signalled when the submitted part completes
+    uint64_t splitGraphicSubmission(CommandBuffer& commandBuffer);
+    //Recorded until the next graphics submission and submitted behind it, once all async compute work submitted before completed
+    CommandBuffer& getQueueAcquireCommandBuffer();
     void setActiveFrameIdx(int idx);
     bool isPrepared() const;
     PipelineState& getPipelineState();
@@ -116,15 +204,24 @@ public:
     void flushDescriptorState(CommandBuffer& commandBuffer, VkPipelineBindPoint pipeline_bind_point);
     void flushAndDrawIndexed(CommandBuffer& commandBuffer, uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, uint32_t vertexOffset = 0, uint32_t firstInstance = 0);
     void flushAndDraw(CommandBuffer& commandBuffer, uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0);
+    //Draw count is read from countBuffer on the gpu, commands are tightly packed VkDrawIndexedIndirectCommand
+    void flushAndDrawIndexedIndirectCount(CommandBuffer& commandBuffer, const Buffer& buffer, VkDeviceSize offset, const Buffer& countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount);
+    void flushAndDrawIndirectCount(CommandBuffer& commandBuffer, const Buffer& buffer, VkDeviceSize offset, const Buffer& countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount);
     void traceRay(CommandBuffer& commandBuffer, VkExtent3D dims);
     void flushAndDispatch(CommandBuffer& commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+    //Group counts are read on the gpu from a VkDispatchIndirectCommand at offset
+    void flushAndDispatchIndirect(CommandBuffer& commandBuffer, const Buffer& buffer, VkDeviceSize offset);
     void flushAndDispatchMesh(CommandBuffer& commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
     void flushAndDrawMeshTasks(CommandBuffer& commandBuffer, uint groupCountX, uint groupCountY, uint groupCountZ);
-    void beginRenderPass(CommandBuffer& commandBuffer, RenderTarget& renderTarget, const std::vector<SubpassInfo>& subpassInfos);
+    void beginRenderPass(CommandBuffer& commandBuffer, RenderTarget& renderTarget, const std::vector<SubpassInfo>& subpassInfos, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
     void nextSubpass(CommandBuffer& commandBuffer);
     void flush(CommandBuffer& commandBuffer);
+    //Binds the pipeline and descriptor sets the binding context flushed last and its pending push constants,
+    //for continuing the flushed state in another command buffer without flushing it again
+    void rebindFlushedState(CommandBuffer& commandBuffer);
     void endRenderPass(CommandBuffer& commandBuffer, RenderTarget& renderTarget);
     void resetViewport(CommandBuffer& commandBuffer);
+    //Thread safe, the recording threads of secondary command buffers share the pools of the frame
     BufferAllocation allocateBuffer(VkDeviceSize allocateSize, VkBufferUsageFlags usage);
     CommandBuffer& getGraphicCommandBuffer();
     CommandBuffer& getComputeCommandBuffer();
@@ -135,11 +232,36 @@ public:
     void setFlipViewport(bool flip);
     bool getFlipViewport() const;
 
+    BindingContext&          getBindingContext();
+    const BindingContext&    getBindingContext() const;
+    static void              setThreadBindingContext(BindingContext* bindingContext);
+    static BindingContext*   getThreadBindingContext();
+    ParallelCommandRecorder& getParallelCommandRecorder();
+    bool                     getParallelRecording() const;
+    void                     setParallelRecording(bool parallel_recording);
+    //Counters of the last completed frame
+    const DescriptorStats&   getDescriptorStats() const;
+    //Per pass timings of the render graph, framesInFlight frames old
+    GpuProfiler&             getGpuProfiler();
+    //Forget the written descriptor sets, for when the resources they were written with go away at once
+    void                     invalidateDescriptorSetCache();
+
 private:
+    //Build and write the descriptor set of a resource set, reused by its bindings in flushDescriptorState
+    DescriptorSet& requestDescriptorSet(const DescriptorLayout& descriptorSetLayout, const ResourceSet& resourceSet);
+
+    void createRenderFinishedSemaphores();
+    //Trailing batch of a submission waiting for all async compute work submitted so far, so its fence and idle wait cover it.
+    //On the graphics queue it also carries the pending queue ownership acquires
+    bool fillAsyncComputeBatch(VkSubmitInfo& submitInfo, VkTimelineSemaphoreSubmitInfo& timelineInfo, bool graphicsQueue);
+
     bool frameActive = false;
-    VkSemaphore acquiredSem;
     bool prepared{false};
     uint32_t activeFrameIndex{0};
+    uint32_t swapChainImageIndex{0};
+    uint32_t framesInFlight{2};
+    uint64_t submittedFrames{0};
+    uint64_t completedFrames{0};
     Device& device;
     std::unique_ptr<SwapChain> swapchain;
     std::unique_ptr<VirtualViewport> virtualViewport;
@@ -147,22 +269,51 @@ private:
     std::vector<std::unique_ptr<FrameBuffer>> frameBuffers;
     VkExtent2D surfaceExtent;
 
+    //One per swap chain image, the presentation of an image may still wait on it after the frame fence signalled
+    std::vector<VkSemaphore> renderFinishedSems;
+
+    VkSemaphore computeTimelineSem{VK_NULL_HANDLE};
+    uint64_t    computeTimelineValue{0};
+    //Signalled by split graphics submissions, async compute work acquiring content from the graphics queue waits for it
+    VkSemaphore graphicsTimelineSem{VK_NULL_HANDLE};
+    uint64_t    graphicsTimelineValue{0};
+    //Non owning, wraps a spare command buffer of the frame while queue ownership acquires are pending
+    std::unique_ptr<CommandBuffer> queueAcquireCommandBuffer{nullptr};
+
     struct {
-        VkSemaphore presentFinishedSem;
-        VkSemaphore renderFinishedSem;
-        VkSemaphore computeFinishedSem;
-        VkSemaphore graphicFinishedSem;
-    } semaphores;
+        uint64_t             timelineValue{0};
+        VkPipelineStageFlags waitStages{0};
+    } pendingComputeWait;
 
-    PipelineState pipelineState;
+    BindingContext mainBindingContext;
+
+    struct CachedDescriptorSet {
+        DescriptorSet* descriptorSet;
+        uint64_t       lastUsedFrame;
+    };
+    //Written descriptor sets by layout and bound handles, shared by all recording threads.
+    //The key only has resource handles, an entry unused for framesInFlight frames is evicted in beginFrame,
+    //before a resource it was written with can be released and its handle reused, and its set is freed.
+    //Sets dropped by invalidateDescriptorSetCache are retired and freed the same way once no frame in flight uses them
+    std::unordered_map<DescriptorSetKey, CachedDescriptorSet, DescriptorSetKey::Hash> descriptorSetCache;
+    std::vector<CachedDescriptorSet>                                                   retiredDescriptorSets;
+    std::mutex                                                                         descriptorSetCacheMutex;
+
+    struct {
+        std::atomic<uint32_t> descriptorWrites{0};
+        std::atomic<uint32_t> descriptorSetBinds{0};
+        std::atomic<uint32_t> skippedBinds{0};
+        std::atomic<uint32_t> cachedSets{0};
+        std::atomic<uint32_t> createdSets{0};
+    } frameDescriptorCounters;
+    DescriptorStats descriptorStats;
     std::vector<std::unique_ptr<FrameResource>> frameResources{};
+    std::unique_ptr<GpuProfiler> gpuProfiler;
     std::vector<SgImage> hwTextures;
-    std::unordered_map<uint32_t, DescriptorLayout*> descriptor_set_layout_binding_state;
-    std::unordered_map<uint32_t, ResourceSet> resourceSets;
-    bool resourceSetsDirty{false};
-    std::vector<uint8_t> storePushConstants;
     uint32_t maxPushConstantSize;
     bool flipViewport = true;
+    //record graphics passes into secondary command buffers so large draw lists can be split across threads
+    bool parallelRecording = false;
 };
 
 extern RenderContext* g_context;
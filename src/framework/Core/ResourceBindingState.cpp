@@ -8,34 +8,90 @@
 #include "Images/Image.h"
 #include "Images/ImageUtil.h"
 #include "Images/ImageView.h"
+#include "Images/Sampler.h"
+#include "ResourceCachingHelper.h"
+#include "RayTracing/Accel.h"
 
-void ResourceSet::bindBuffer(const Buffer& buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding, uint32_t array_element) {
-    resourceBindings[binding][array_element].dirty  = true;
-    resourceBindings[binding][array_element].buffer = &buffer;
-    resourceBindings[binding][array_element].offset = offset;
-    resourceBindings[binding][array_element].range  = range;
+static DescriptorSetKey::Element GetKeyElement(uint32_t binding, uint32_t array_element, const ResourceInfo& info) {
+    return {.binding      = binding,
+            .arrayElement = array_element,
+            .buffer       = info.buffer ? info.buffer->getHandle() : VK_NULL_HANDLE,
+            .offset       = info.offset,
+            .range        = info.range,
+            .imageView    = info.image_view ? info.image_view->getHandle() : VK_NULL_HANDLE,
+            .sampler      = info.sampler ? info.sampler->getHandle() : VK_NULL_HANDLE,
+            .accel        = info.accel ? info.accel->accel : VK_NULL_HANDLE,
+            .layout       = info.layout};
+}
 
-    dirty = true;
+size_t DescriptorSetKey::Hash::operator()(const DescriptorSetKey& key) const {
+    size_t hash = 0;
+    hash_combine(hash, key.descriptorSetLayout);
+    for (const auto& element : key.elements) {
+        hash_combine(hash, element.binding);
+        hash_combine(hash, element.arrayElement);
+        hash_combine(hash, element.buffer);
+        hash_combine(hash, element.offset);
+        hash_combine(hash, element.range);
+        hash_combine(hash, element.imageView);
+        hash_combine(hash, element.sampler);
+        hash_combine(hash, element.accel);
+        hash_combine(hash, element.layout);
+    }
+    return hash;
+}
+
+static ResourceInfo FindResource(const BindingMap<ResourceInfo>& resourceBindings, uint32_t binding, uint32_t array_element) {
+    if (auto bindingIt = resourceBindings.find(binding); bindingIt != resourceBindings.end()) {
+        if (auto elementIt = bindingIt->second.find(array_element); elementIt != bindingIt->second.end())
+            return elementIt->second;
+    }
+    return {};
+}
+
+void ResourceSet::setResource(uint32_t binding, uint32_t array_element, const ResourceInfo& info) {
+    auto& element = resourceBindings[binding];
+    if (auto it = element.find(array_element); it != element.end()) {
+        if (GetKeyElement(binding, array_element, it->second) == GetKeyElement(binding, array_element, info))
+            return;
+    }
+    element[array_element]       = info;
+    element[array_element].dirty = true;
+    dirty                        = true;
+}
+
+void ResourceSet::bindBuffer(const Buffer& buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding, uint32_t array_element) {
+    ResourceInfo info = FindResource(resourceBindings, binding, array_element);
+    info.buffer       = &buffer;
+    info.offset       = offset;
+    info.range        = range;
+    setResource(binding, array_element, info);
 }
 
 void ResourceSet::bindImage(const ImageView& view, const Sampler& sampler, uint32_t binding, uint32_t array_element) {
-    resourceBindings[binding][array_element].dirty      = true;
-    resourceBindings[binding][array_element].image_view = &view;
-    resourceBindings[binding][array_element].sampler    = &sampler;
-    resourceBindings[binding][array_element].layout     = ImageUtil::getVkImageLayout(view.getImage().getLayout(view.getSubResourceRange()));
-    dirty                                               = true;
+    ResourceInfo info = FindResource(resourceBindings, binding, array_element);
+    info.image_view   = &view;
+    info.sampler      = &sampler;
+    info.layout       = ImageUtil::getVkImageLayout(view.getImage().getLayout(view.getSubResourceRange()));
+    setResource(binding, array_element, info);
 }
 void ResourceSet::bindSampler(const Sampler& sampler, uint32_t binding, uint32_t array_element) {
-    resourceBindings[binding][array_element].dirty   = true;
-    resourceBindings[binding][array_element].sampler = &sampler;
-    dirty                                            = true;
+    ResourceInfo info = FindResource(resourceBindings, binding, array_element);
+    info.sampler      = &sampler;
+    setResource(binding, array_element, info);
 }
 
 void ResourceSet::bindInput(const ImageView& view, uint32_t binding, uint32_t array_element) {
-    resourceBindings[binding][array_element].dirty      = true;
-    resourceBindings[binding][array_element].image_view = &view;
-    resourceBindings[binding][array_element].layout     = ImageUtil::getVkImageLayout(view.getImage().getLayout(view.getSubResourceRange()));
-    dirty                                               = true;
+    ResourceInfo info = FindResource(resourceBindings, binding, array_element);
+    info.image_view   = &view;
+    info.layout       = ImageUtil::getVkImageLayout(view.getImage().getLayout(view.getSubResourceRange()));
+    setResource(binding, array_element, info);
+}
+
+void ResourceSet::bindAccel(const Accel& accel, uint32_t binding, uint32_t array_element) {
+    ResourceInfo info = FindResource(resourceBindings, binding, array_element);
+    info.accel        = &accel;
+    setResource(binding, array_element, info);
 }
 
 void ResourceSet::clearDirty() {
@@ -61,6 +117,22 @@ bool ResourceSet::isDirty() const {
     return dirty;
 }
 
+void ResourceSet::setDirty() {
+    dirty = true;
+}
+
+DescriptorSetKey ResourceSet::getKey(VkDescriptorSetLayout descriptorSetLayout) const {
+    DescriptorSetKey key{.descriptorSetLayout = descriptorSetLayout};
+    for (const auto& [binding, elements] : resourceBindings) {
+        for (const auto& [arrayElement, info] : elements)
+            key.elements.push_back(GetKeyElement(binding, arrayElement, info));
+    }
+    std::ranges::sort(key.elements, [](const auto& a, const auto& b) {
+        return std::tie(a.binding, a.arrayElement) < std::tie(b.binding, b.arrayElement);
+    });
+    return key;
+}
+
 const BindingMap<ResourceInfo>& ResourceSet::getResourceBindings() const {
     return resourceBindings;
 }
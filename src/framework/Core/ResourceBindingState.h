@@ -35,6 +35,32 @@ struct ResourceInfo {
     VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
 };
 
+//Handles a descriptor set is written with, written descriptor sets are cached by it
+struct DescriptorSetKey {
+    struct Element {
+        uint32_t                   binding{0};
+        uint32_t                   arrayElement{0};
+        VkBuffer                   buffer{VK_NULL_HANDLE};
+        VkDeviceSize               offset{0};
+        VkDeviceSize               range{0};
+        VkImageView                imageView{VK_NULL_HANDLE};
+        VkSampler                  sampler{VK_NULL_HANDLE};
+        VkAccelerationStructureKHR accel{VK_NULL_HANDLE};
+        VkImageLayout              layout{VK_IMAGE_LAYOUT_UNDEFINED};
+
+        bool operator==(const Element&) const = default;
+    };
+
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    std::vector<Element>  elements{};// sorted by binding and array element
+
+    bool operator==(const DescriptorSetKey&) const = default;
+
+    struct Hash {
+        size_t operator()(const DescriptorSetKey& key) const;
+    };
+};
+
 struct ResourceSet {
 public:
     void
@@ -45,20 +71,22 @@ public:
     void bindInput(const ImageView& view, uint32_t binding, uint32_t array_element);
 
     void clearDirty();
+    void setDirty();
 
     // void bindAccel(const Accel &accel, uint32_t binding, uint32_t array_element);
     //   void bindAccel(const Accel &accel, uint32_t binding, uint32_t array_element);
-    void bindAccel(const Accel& accel, uint32_t binding, uint32_t array_element) {
-        resourceBindings[binding][array_element].dirty = true;
-        resourceBindings[binding][array_element].accel = &accel;
-        dirty                                          = true;
-    }
+    void bindAccel(const Accel& accel, uint32_t binding, uint32_t array_element);
 
     const BindingMap<ResourceInfo>& getResourceBindings() const;
 
     bool isDirty() const;
 
+    DescriptorSetKey getKey(VkDescriptorSetLayout descriptorSetLayout) const;
+
 private:
+    //Rebinding the same resource leaves the set clean
+    void setResource(uint32_t binding, uint32_t array_element, const ResourceInfo& info);
+
     BindingMap<ResourceInfo> resourceBindings;
 
     bool dirty{false};
@@ -54,13 +54,25 @@ inline EShLanguage FindShaderLanguage(VkShaderStageFlagBits stage) {
     }
 }
 
+//glslang process state is shared by all threads, initialized on first compile and released at exit
+struct GlslangProcess {
+    GlslangProcess() {
+        glslang::InitializeProcess();
+    }
+    ~GlslangProcess() {
+        glslang::FinalizeProcess();
+    }
+};
+
+static void InitializeGlslang() {
+    static GlslangProcess process;
+}
+
 glslang::EShTargetLanguage        GlslCompiler::env_target_language         = glslang::EShTargetSpv;
 glslang::EShTargetLanguageVersion GlslCompiler::env_target_language_version = glslang::EShTargetLanguageVersion::EShTargetSpv_1_5;
 
 bool GlslCompiler::compileToSpirv(VkShaderStageFlagBits stage, const std::vector<uint8_t>& glsl_source, const std::string& entry_point, std::vector<std::uint32_t>& spirv, std::string& info_log, const std::filesystem::path& shader_path, const ShaderKey& shaderKey) {
-    //return false;
-    // Initialize glslang library.
-    glslang::InitializeProcess();
+    InitializeGlslang();
 
     auto messages = static_cast<EShMessages>(EShMsgDefault | EShMsgVulkanRules | EShMsgSpvRules);
 
@@ -124,9 +136,6 @@ bool GlslCompiler::compileToSpirv(VkShaderStageFlagBits stage, const std::vector
 
     info_log += logger.getAllMessages() + "\n";
 
-    // Shutdown glslang library.
-    glslang::FinalizeProcess();
-
     return true;
 }
 
@@ -137,4 +146,9 @@ void GlslCompiler::setEnvTarget(glslang::EShTargetLanguage        target_languag
 }
 void GlslCompiler::setForceRecompile(bool _forceRecompile) {
     forceRecompile = _forceRecompile;
-}
\ No newline at end of file
+}
+std::string GlslCompiler::getCompilerVersion() {
+    auto version = glslang::GetVersion();
+    return "glslang " + std::to_string(version.major) + "." + std::to_string(version.minor) + "." + std::to_string(version.patch) + version.flavor +
+           " spv " + std::to_string(env_target_language_version);
+}
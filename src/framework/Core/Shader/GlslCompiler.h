@@ -15,6 +15,8 @@ public:
     static void        setEnvTarget(glslang::EShTargetLanguage        target_language,
                                     glslang::EShTargetLanguageVersion target_language_version);
     static void setForceRecompile(bool _forceRecompile);
+    //Part of the spv cache key, a compiler update invalidates every cached spv
+    static std::string getCompilerVersion();
     inline static bool forceRecompile{};
 
 private:
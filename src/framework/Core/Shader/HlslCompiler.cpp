@@ -140,6 +140,28 @@ void HlslCompiler::setForceRecompile(bool _forceRecompile) {
     forceRecompile = _forceRecompile;
 }
 
+std::string HlslCompiler::getCompilerVersion() {
+    static const std::string version = [] {
+        std::string version = "dxc";
+        Microsoft::WRL::ComPtr<IDxcVersionInfo> versionInfo;
+        if (!InitializeDxcCompiler() || FAILED(dxc_compiler->QueryInterface(IID_PPV_ARGS(versionInfo.GetAddressOf()))))
+            return version;
+        UINT32 major = 0, minor = 0;
+        if (SUCCEEDED(versionInfo->GetVersion(&major, &minor)))
+            version += " " + std::to_string(major) + "." + std::to_string(minor);
+        //Builds between releases only differ by their commit
+        Microsoft::WRL::ComPtr<IDxcVersionInfo2> versionInfo2;
+        UINT32                                   commitCount = 0;
+        char*                                    commitHash  = nullptr;
+        if (SUCCEEDED(versionInfo.As(&versionInfo2)) && SUCCEEDED(versionInfo2->GetCommitInfo(&commitCount, &commitHash))) {
+            version += "." + std::to_string(commitCount) + " " + commitHash;
+            CoTaskMemFree(commitHash);
+        }
+        return version;
+    }();
+    return version + " " + target_profile;
+}
+
 std::string HlslCompiler::getTargetProfile(VkShaderStageFlagBits stage) {
     switch (stage) {
         case VK_SHADER_STAGE_VERTEX_BIT:
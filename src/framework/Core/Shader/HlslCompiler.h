@@ -28,6 +28,8 @@ public:
     static void setTargetProfile(const std::string& target_profile);
     
     static void setForceRecompile(bool _forceRecompile);
+    //Part of the spv cache key, a compiler update invalidates every cached spv
+    static std::string getCompilerVersion();
     inline static bool forceRecompile{};
     HlslCompiler();
     ~HlslCompiler();
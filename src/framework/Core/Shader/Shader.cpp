@@ -10,7 +10,12 @@
 #include "spdlog/fmt/bundled/os.h"
 #include "Core/Shader/SpirvShaderReflection.h"
 
+#include "Common/samplerCPP/ThreadPool.h"
+
+#include <mutex>
+#include <sstream>
 #include <stack>
+#include <unordered_set>
 
 Shader::SHADER_LOAD_MODE getShaderMode(const std::string& ext) {
     if (ext == "spv")
@@ -70,14 +75,106 @@ VkShaderStageFlagBits find_shader_stage(const std::string& ext) {
 
 static std::string SPV_CACHED_PATH = "spvcachedFiles/";
 
-static std::string GetSpvPathFromShaderPath(const std::string& path, const std::string& shaderDefinitions) {
+
+static void HashBytes(uint64_t& hash, const void* data, size_t size) {
+    //FNV-1a, stable across runs and compilers unlike std::hash
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+static void HashString(uint64_t& hash, const std::string& str) {
+    HashBytes(hash, str.data(), str.size());
+    HashBytes(hash, "", 1);
+}
+
+//Hash a source file and every file it includes, conditional includes are always followed
+static void HashIncludeClosure(uint64_t& hash, const std::filesystem::path& path, const std::filesystem::path& shaderDir, std::unordered_set<std::string>& visited) {
+    auto canonicalPath = std::filesystem::weakly_canonical(path).string();
+    if (!visited.insert(canonicalPath).second)
+        return;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        //Unresolved includes are reported by the compiler
+        HashString(hash, canonicalPath);
+        return;
+    }
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    HashString(hash, canonicalPath);
+    HashString(hash, source);
+
+    std::istringstream lines(source);
+    std::string        line;
+    while (std::getline(lines, line)) {
+        auto pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos || line[pos] != '#')
+            continue;
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos || line.compare(pos, 7, "include") != 0)
+            continue;
+        auto open = line.find_first_of("\"<", pos + 7);
+        if (open == std::string::npos)
+            continue;
+        auto close = line.find_first_of("\">", open + 1);
+        if (close == std::string::npos)
+            continue;
+
+        std::filesystem::path include = line.substr(open + 1, close - open - 1);
+        std::filesystem::path resolved = path.parent_path() / include;
+        if (!std::filesystem::exists(resolved))
+            resolved = shaderDir / include;
+        HashIncludeClosure(hash, resolved, shaderDir, visited);
+    }
+}
+
+//Which compiled shader a spv is, the variant, the entry point and the stage, independent of the source contents
+static uint64_t GetShaderVariantHash(const ShaderKey& key, VkShaderStageFlagBits stage) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    HashString(hash, key.variant.get_preamble());
+    for (const auto& process : key.variant.get_processes())
+        HashString(hash, process);
+    HashString(hash, key.entryPoint);
+    HashBytes(hash, &stage, sizeof(stage));
+    return hash;
+}
+
+//Key of the spv cache: the include closure, the variant and the compiler version
+static uint64_t GetShaderSourceHash(const std::string& shaderFilePath, const ShaderKey& key, VkShaderStageFlagBits stage, Shader::SHADER_LOAD_MODE mode) {
+    uint64_t                        hash = GetShaderVariantHash(key, stage);
+    std::unordered_set<std::string> visited;
+    HashIncludeClosure(hash, shaderFilePath, std::filesystem::path(shaderFilePath).parent_path(), visited);
+    HashString(hash, mode == Shader::HLSL ? HlslCompiler::getCompilerVersion() : GlslCompiler::getCompilerVersion());
+    return hash;
+}
+
+//Variants of a shader get separate spv files, so an edit replaces the spv of each variant instead of piling up next to it
+static std::string GetSpvPathFromShaderPath(const std::string& path, const ShaderKey& key, VkShaderStageFlagBits stage, uint64_t sourceHash) {
     static std::string shaderFolder = "shaders/";
     size_t             idx          = path.find(shaderFolder);
     if (idx == std::string::npos) {
         LOGE("Failed to find shaders folder in shader path: {}", path.c_str());
     }
     idx += shaderFolder.size();
-    return path.substr(0, idx) + SPV_CACHED_PATH + path.substr(idx) + shaderDefinitions + ".spv";
+    return path.substr(0, idx) + SPV_CACHED_PATH + path.substr(idx) + fmt::format(".{:016x}.{:016x}.spv", GetShaderVariantHash(key, stage), sourceHash);
+}
+
+//Remove the spv files of older sources of the same variant, named like spvPath with another source hash
+static void RemoveStaleSpv(const std::string& spvPath) {
+    std::filesystem::path path(spvPath);
+    std::string           fileName = path.filename().string();
+    //Drop "<source hash>.spv"
+    std::string     variantPrefix = fileName.substr(0, fileName.size() - 20);
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(path.parent_path(), error)) {
+        std::string entryName = entry.path().filename().string();
+        if (entryName != fileName && entryName.size() == fileName.size() && entryName.starts_with(variantPrefix) && entryName.ends_with(".spv")) {
+            std::filesystem::remove(entry.path(), error);
+            LOGI("Removed stale shader spv: {}", entry.path().string());
+        }
+    }
 }
 
 static std::ofstream OpenOrCreateFile(const std::string& path) {
@@ -174,70 +271,102 @@ void ShaderVariant::update_id() {
 
 
 
-Shader::Shader(Device& device, const ShaderKey& key, VkShaderStageFlagBits spv_stage) : device(device) {
-    std::string           shaderFilePath = FileUtils::getShaderPath(key.path);
-    auto                  shaderExt      = FileUtils::getFileExt(shaderFilePath);
-    auto                  mode           = getShaderMode(shaderExt);
-    std::vector<uint32_t> spirvCode;
-
-    auto defineString = key.variant.get_preamble();
+static VkShaderStageFlagBits GetShaderStage(const std::string& shaderFilePath, const ShaderKey& key, Shader::SHADER_LOAD_MODE mode) {
+    return mode == Shader::GLSL ? find_shader_stage(FileUtils::getFileExt(shaderFilePath)) : key.stage;
+}
 
-    if (shaderFilePath.ends_with(".spv")) {
-        mode  = SPV;
-        stage = spv_stage;
+static bool CompileShader(Shader::SHADER_LOAD_MODE mode, VkShaderStageFlagBits stage, const std::string& shaderFilePath, const ShaderKey& key, std::vector<uint32_t>& spirvCode) {
+    std::string shaderLog;
+    auto        shaderBuffer   = FileUtils::readShaderBinary(shaderFilePath);
+    bool        compileSuccess = false;
+
+    if (mode == Shader::HLSL) {
+        //dxc objects are shared, hlsl shaders are compiled one at a time
+        static std::mutex           hlslMutex;
+        std::lock_guard<std::mutex> guard(hlslMutex);
+        compileSuccess = HlslCompiler::compileToSpirv(stage, shaderBuffer, "main", spirvCode, shaderLog, shaderFilePath, key);
+        if (!compileSuccess) {
+            LOGE("Failed to compile HLSL shader {}, Error: {}", shaderFilePath, shaderLog.c_str());
+        } else {
+            LOGI("HLSL shader compiled successfully {}", shaderFilePath.c_str());
+        }
     } else {
-        if (mode == GLSL)
-            stage = find_shader_stage(FileUtils::getFileExt(shaderFilePath));
-        else
-            stage = key.stage;
-        std::string spvPath = GetSpvPathFromShaderPath(shaderFilePath, defineString);
-        if (std::filesystem::exists(spvPath)) {
-            auto spvUpdateTime    = std::filesystem::last_write_time(spvPath);
-            auto shaderUpdateTime = std::filesystem::last_write_time(shaderFilePath);
-            if (spvUpdateTime > shaderUpdateTime && !GlslCompiler::forceRecompile && !HlslCompiler::forceRecompile) {
-                mode           = SPV;
-                shaderFilePath = spvPath;
-                LOGI("Cached shader spv found: {},Spv last update time {}", shaderFilePath, FileUtils::getFileTimeStr(spvPath));
-            }
+        compileSuccess = GlslCompiler::compileToSpirv(stage, shaderBuffer, key.entryPoint, spirvCode, shaderLog, shaderFilePath, key);
+        if (!compileSuccess) {
+            LOGE("Failed to compile GLSL shader {}, Error: {}", shaderFilePath, shaderLog.c_str());
+        } else {
+            LOGI("GLSL shader compiled successfully {}", shaderFilePath.c_str());
         }
     }
+    return compileSuccess;
+}
 
-    if (mode == SHADER_LOAD_MODE::SPV) {
-        auto shaderSource = FileUtils::readShaderBinary(shaderFilePath);
-        if (shaderSource.empty()) {
-            mode = getShaderMode(shaderExt);
+//Load the cached spv of a shader source, compiling and caching it when the include closure changed
+static void LoadOrCompileSpirv(Shader::SHADER_LOAD_MODE mode, VkShaderStageFlagBits stage, const std::string& shaderFilePath, const ShaderKey& key, uint64_t sourceHash, std::vector<uint32_t>& spirvCode) {
+    std::string spvPath = GetSpvPathFromShaderPath(shaderFilePath, key, stage, sourceHash);
+    if (std::filesystem::exists(spvPath) && !GlslCompiler::forceRecompile && !HlslCompiler::forceRecompile) {
+        auto shaderSource = FileUtils::readShaderBinary(spvPath);
+        if (!shaderSource.empty()) {
+            LOGI("Cached shader spv found: {}", spvPath);
+            spirvCode.assign(reinterpret_cast<const uint32_t*>(shaderSource.data()),
+                             reinterpret_cast<const uint32_t*>(shaderSource.data() + shaderSource.size()));
+            return;
         }
-        spirvCode.assign(reinterpret_cast<const uint32_t*>(shaderSource.data()),
-                         reinterpret_cast<const uint32_t*>(shaderSource.data() + shaderSource.size()));
     }
 
-    if (mode != SHADER_LOAD_MODE::SPV) {
-        std::string shaderLog;
-        auto        shaderBuffer   = FileUtils::readShaderBinary(shaderFilePath);
-        bool        compileSuccess = false;
-
-        if (mode == SHADER_LOAD_MODE::HLSL) {
-            compileSuccess = HlslCompiler::compileToSpirv(stage, shaderBuffer, "main", spirvCode, shaderLog, shaderFilePath, key);
-            if (!compileSuccess) {
-                LOGE("Failed to compile HLSL shader {}, Error: {}", shaderFilePath, shaderLog.c_str());
-            } else {
-                LOGI("HLSL shader compiled successfully {}", shaderFilePath.c_str());
-            }
-        } else {
-            compileSuccess = GlslCompiler::compileToSpirv(stage, shaderBuffer, key.entryPoint, spirvCode, shaderLog, shaderFilePath, key);
-            if (!compileSuccess) {
-                LOGE("Failed to compile GLSL shader {}, Error: {}", shaderFilePath, shaderLog.c_str());
-            } else {
-                LOGI("GLSL shader compiled successfully {}", shaderFilePath.c_str());
-            }
-        }
+    if (CompileShader(mode, stage, shaderFilePath, key, spirvCode)) {
+        std::ofstream file = OpenOrCreateFile(spvPath);
+        file.write(reinterpret_cast<const char*>(spirvCode.data()), spirvCode.size() * sizeof(uint32_t));
+        file.close();
+        RemoveStaleSpv(spvPath);
+    }
+}
 
-        if (compileSuccess) {
-            std::string   spvPath = GetSpvPathFromShaderPath(shaderFilePath, defineString);
-            std::ofstream file    = OpenOrCreateFile(spvPath);
-            file.write(reinterpret_cast<const char*>(spirvCode.data()), spirvCode.size() * sizeof(uint32_t));
-            file.close();
-        }
+std::vector<uint64_t> Shader::compileShaders(const std::vector<ShaderKey>& keys) {
+    std::vector<std::tuple<SHADER_LOAD_MODE, VkShaderStageFlagBits, std::string, const ShaderKey*, uint64_t>> jobs;
+    std::vector<uint64_t>                                                                                   sourceHashes(keys.size(), 0);
+    std::unordered_set<uint64_t>                                                                            hashes;
+    for (size_t i = 0; i < keys.size(); i++) {
+        const auto& key            = keys[i];
+        std::string shaderFilePath = FileUtils::getShaderPath(key.path);
+        if (shaderFilePath.ends_with(".spv"))
+            continue;
+        auto mode       = getShaderMode(FileUtils::getFileExt(shaderFilePath));
+        auto stage      = GetShaderStage(shaderFilePath, key, mode);
+        auto hash       = GetShaderSourceHash(shaderFilePath, key, stage, mode);
+        sourceHashes[i] = hash;
+        if (!hashes.insert(hash).second)
+            continue;
+        if (std::filesystem::exists(GetSpvPathFromShaderPath(shaderFilePath, key, stage, hash)) && !GlslCompiler::forceRecompile && !HlslCompiler::forceRecompile)
+            continue;
+        jobs.emplace_back(mode, stage, std::move(shaderFilePath), &key, hash);
+    }
+
+    auto compile = [](const auto& job) {
+        std::vector<uint32_t> spirvCode;
+        auto& [mode, stage, shaderFilePath, key, hash] = job;
+        LoadOrCompileSpirv(mode, stage, shaderFilePath, *key, hash, spirvCode);
+    };
+    //Pipelines are also built from pool tasks, the calling thread compiles too instead of blocking on the pool
+    ThreadPool::ParallelFor(jobs.size(), [&](uint32_t job) { compile(jobs[job]); });
+    return sourceHashes;
+}
+
+Shader::Shader(Device& device, const ShaderKey& key, VkShaderStageFlagBits spv_stage, uint64_t sourceHash) : device(device) {
+    std::string           shaderFilePath = FileUtils::getShaderPath(key.path);
+    auto                  mode           = getShaderMode(FileUtils::getFileExt(shaderFilePath));
+    std::vector<uint32_t> spirvCode;
+
+    if (shaderFilePath.ends_with(".spv")) {
+        stage             = spv_stage;
+        auto shaderSource = FileUtils::readShaderBinary(shaderFilePath);
+        spirvCode.assign(reinterpret_cast<const uint32_t*>(shaderSource.data()),
+                         reinterpret_cast<const uint32_t*>(shaderSource.data() + shaderSource.size()));
+    } else {
+        stage = GetShaderStage(shaderFilePath, key, mode);
+        if (sourceHash == 0)
+            sourceHash = GetShaderSourceHash(shaderFilePath, key, stage, mode);
+        LoadOrCompileSpirv(mode, stage, shaderFilePath, key, sourceHash, spirvCode);
     }
 
     VkShaderModuleCreateInfo createInfo{};
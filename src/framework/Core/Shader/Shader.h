@@ -169,7 +169,11 @@ public:
         HLSL
     };
 
-    Shader(Device& device, const ShaderKey& key, VkShaderStageFlagBits stage = VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM);
+    //sourceHash is the spv cache key returned by compileShaders, 0 hashes the sources again
+    Shader(Device& device, const ShaderKey& key, VkShaderStageFlagBits stage = VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM, uint64_t sourceHash = 0);
+
+    //Compile the shaders missing from the spv cache in parallel on the thread pool, returns the spv cache key of each shader, 0 for spv files
+    static std::vector<uint64_t> compileShaders(const std::vector<ShaderKey>& keys);
 
     ~Shader();
 
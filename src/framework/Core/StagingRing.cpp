@@ -0,0 +1,173 @@
+#include "StagingRing.h"
+
+#include "Core/Buffer.h"
+#include "Core/CommandBuffer.h"
+#include "Core/CommandPool.h"
+#include "Core/Device/Device.h"
+
+//Copy offsets must be a multiple of the texel size and of 4
+static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+static std::vector<std::unique_ptr<CommandBuffer>> AllocateCommandBuffers(Device& device, CommandPool& commandPool, uint32_t count, VkQueueFlags queueFlags) {
+    std::vector<VkCommandBuffer> handles(count);
+    VkCommandBufferAllocateInfo  allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocateInfo.commandPool        = commandPool.getHandle();
+    allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = count;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device.getHandle(), &allocateInfo, handles.data()));
+    std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+    for (auto handle : handles)
+        commandBuffers.push_back(std::make_unique<CommandBuffer>(device.getHandle(), commandPool.getHandle(), handle, queueFlags));
+    return commandBuffers;
+}
+
+static VkSemaphore CreateTimelineSemaphore(Device& device) {
+    VkSemaphoreTypeCreateInfo timelineCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCreateInfo.initialValue  = 0;
+    VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    semaphoreInfo.pNext = &timelineCreateInfo;
+    VkSemaphore semaphore;
+    VK_CHECK_RESULT(vkCreateSemaphore(device.getHandle(), &semaphoreInfo, nullptr, &semaphore));
+    return semaphore;
+}
+
+StagingRing::StagingRing(Device& device, VkDeviceSize slotSize, uint32_t slotCount, Queue& queue, Queue& ownerQueue) : device(device), queue(queue), ownerQueue(ownerQueue), slotSize(slotSize), slots(slotCount) {
+    buffer = std::make_unique<Buffer>(device, slotSize * slotCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+    //Own pools, command pools are externally synchronized and the ring records on a loading thread
+    commandPool         = std::make_unique<CommandPool>(device, queue.getFamilyIndex(), CommandBuffer::ResetMode::ResetIndividually);
+    auto commandBuffers = AllocateCommandBuffers(device, *commandPool, slotCount, queue.getProp().queueFlags);
+    for (uint32_t i = 0; i < slotCount; i++)
+        slots[i].commandBuffer = std::move(commandBuffers[i]);
+    timelineSemaphore = CreateTimelineSemaphore(device);
+
+    if (transfersOwnership()) {
+        ownerCommandPool         = std::make_unique<CommandPool>(device, ownerQueue.getFamilyIndex(), CommandBuffer::ResetMode::ResetIndividually);
+        auto ownerCommandBuffers = AllocateCommandBuffers(device, *ownerCommandPool, slotCount, ownerQueue.getProp().queueFlags);
+        for (uint32_t i = 0; i < slotCount; i++)
+            slots[i].ownerCommandBuffer = std::move(ownerCommandBuffers[i]);
+        ownerTimelineSemaphore = CreateTimelineSemaphore(device);
+    }
+}
+
+StagingRing::~StagingRing() {
+    wait();
+    //The command buffers free themselves from their pools
+    slots.clear();
+    vkDestroyCommandPool(device.getHandle(), commandPool->getHandle(), nullptr);
+    vkDestroySemaphore(device.getHandle(), timelineSemaphore, nullptr);
+    if (transfersOwnership()) {
+        vkDestroyCommandPool(device.getHandle(), ownerCommandPool->getHandle(), nullptr);
+        vkDestroySemaphore(device.getHandle(), ownerTimelineSemaphore, nullptr);
+    }
+}
+
+StagingRing::Allocation StagingRing::allocate(VkDeviceSize size) {
+    size = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+    Slot* slot = &slots[currentSlot];
+    if (slot->recording && slot->used > 0 && slot->used + size > slotSize) {
+        submitSlot(*slot);
+        currentSlot = (currentSlot + 1) % slots.size();
+        slot        = &slots[currentSlot];
+    }
+    if (!slot->recording)
+        beginSlot(*slot);
+
+    auto&    ownerCommandBuffer = transfersOwnership() ? *slot->ownerCommandBuffer : *slot->commandBuffer;
+    uint32_t srcQueueFamily     = queue.getFamilyIndex();
+    uint32_t dstQueueFamily     = ownerQueue.getFamilyIndex();
+    if (size > slotSize) {
+        slot->dedicatedBuffers.push_back(std::make_unique<Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
+        return {*slot->commandBuffer, *slot->dedicatedBuffers.back(), 0, ownerCommandBuffer, srcQueueFamily, dstQueueFamily};
+    }
+
+    VkDeviceSize offset = currentSlot * slotSize + slot->used;
+    slot->used += size;
+    return {*slot->commandBuffer, *buffer, offset, ownerCommandBuffer, srcQueueFamily, dstQueueFamily};
+}
+
+void StagingRing::flush() {
+    auto& slot = slots[currentSlot];
+    if (!slot.recording)
+        return;
+    submitSlot(slot);
+    currentSlot = (currentSlot + 1) % slots.size();
+}
+
+void StagingRing::wait() {
+    flush();
+    waitTimeline(timelineValue);
+    for (auto& slot : slots)
+        slot.dedicatedBuffers.clear();
+}
+
+bool StagingRing::transfersOwnership() const {
+    return queue.getFamilyIndex() != ownerQueue.getFamilyIndex();
+}
+
+void StagingRing::beginSlot(Slot& slot) {
+    //The slot memory and command buffers are in use until the gpu reached the value of its last submit
+    waitTimeline(slot.timelineValue);
+    slot.dedicatedBuffers.clear();
+    slot.used = 0;
+    slot.commandBuffer->beginRecord(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    if (slot.ownerCommandBuffer)
+        slot.ownerCommandBuffer->beginRecord(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    slot.recording = true;
+}
+
+void StagingRing::submitSlot(Slot& slot) {
+    slot.commandBuffer->endRecord();
+    slot.timelineValue = ++timelineValue;
+    slot.recording     = false;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &slot.timelineValue;
+
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = slot.commandBuffer->getHandlePointer();
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &timelineSemaphore;
+
+    queue.submit({submitInfo}, VK_NULL_HANDLE);
+
+    if (!slot.ownerCommandBuffer)
+        return;
+
+    //The acquire barriers only take effect after the matching releases executed on the copy queue
+    slot.ownerCommandBuffer->endRecord();
+    VkPipelineStageFlags          waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkTimelineSemaphoreSubmitInfo ownerTimelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    ownerTimelineInfo.waitSemaphoreValueCount   = 1;
+    ownerTimelineInfo.pWaitSemaphoreValues      = &slot.timelineValue;
+    ownerTimelineInfo.signalSemaphoreValueCount = 1;
+    ownerTimelineInfo.pSignalSemaphoreValues    = &slot.timelineValue;
+
+    VkSubmitInfo ownerSubmitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    ownerSubmitInfo.pNext                = &ownerTimelineInfo;
+    ownerSubmitInfo.waitSemaphoreCount   = 1;
+    ownerSubmitInfo.pWaitSemaphores      = &timelineSemaphore;
+    ownerSubmitInfo.pWaitDstStageMask    = &waitStage;
+    ownerSubmitInfo.commandBufferCount   = 1;
+    ownerSubmitInfo.pCommandBuffers      = slot.ownerCommandBuffer->getHandlePointer();
+    ownerSubmitInfo.signalSemaphoreCount = 1;
+    ownerSubmitInfo.pSignalSemaphores    = &ownerTimelineSemaphore;
+
+    ownerQueue.submit({ownerSubmitInfo}, VK_NULL_HANDLE);
+}
+
+void StagingRing::waitTimeline(uint64_t value) {
+    if (value == 0)
+        return;
+    //The owner command buffers wait on the copies of their slot, they complete last
+    VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = transfersOwnership() ? &ownerTimelineSemaphore : &timelineSemaphore;
+    waitInfo.pValues        = &value;
+    VK_CHECK_RESULT(vkWaitSemaphores(device.getHandle(), &waitInfo, UINT64_MAX));
+}
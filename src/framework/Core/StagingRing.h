@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Core/Vulkan.h"
+
+#include <memory>
+#include <vector>
+
+class Buffer;
+class CommandBuffer;
+class CommandPool;
+class Device;
+class Queue;
+
+/**
+ * Persistent staging buffer of a fixed budget split in slots, for uploads streamed over a whole loading pass.
+ * Each slot records the copies of the data written into it and is submitted with a timeline semaphore signal once full,
+ * it is only written again after the gpu reached its value, so cpu copies into a slot overlap the gpu copies of the others.
+ * The copies may run on a queue of another family than the one owning the uploads, a dedicated transfer queue beside the
+ * graphics queue. Each slot then also records an owner command buffer, submitted on the owner queue after the copies of
+ * the slot, which acquires the released resources and records the work the copy queue can not do, such as mip blits.
+ */
+class StagingRing {
+public:
+    struct Allocation {
+        CommandBuffer& commandBuffer;
+        Buffer&        buffer;
+        VkDeviceSize   offset;
+        //The copy command buffer itself when both queues are of one family
+        CommandBuffer& ownerCommandBuffer;
+        //Families to release the copied resources from and acquire them on, equal when no ownership transfer is needed
+        uint32_t srcQueueFamily;
+        uint32_t dstQueueFamily;
+    };
+
+    StagingRing(Device& device, VkDeviceSize slotSize, uint32_t slotCount, Queue& queue, Queue& ownerQueue);
+    ~StagingRing();
+
+    //Staging space of size bytes and the command buffer copying from it.
+    //Data larger than a slot gets a dedicated buffer released with the slot
+    Allocation allocate(VkDeviceSize size);
+    //Submits the slot being recorded
+    void flush();
+    //Submits the slot being recorded and blocks until every copy and owner command buffer completed
+    void wait();
+
+private:
+    struct Slot {
+        std::unique_ptr<CommandBuffer>       commandBuffer;
+        //Null without an ownership transfer
+        std::unique_ptr<CommandBuffer>       ownerCommandBuffer;
+        std::vector<std::unique_ptr<Buffer>> dedicatedBuffers;
+        VkDeviceSize                         used{0};
+        uint64_t                             timelineValue{0};
+        bool                                 recording{false};
+    };
+
+    bool transfersOwnership() const;
+    void beginSlot(Slot& slot);
+    void submitSlot(Slot& slot);
+    //Blocks until the last command buffer of the slots submitted up to value completed
+    void waitTimeline(uint64_t value);
+
+    Device&                      device;
+    Queue&                       queue;
+    Queue&                       ownerQueue;
+    std::unique_ptr<CommandPool> commandPool;
+    std::unique_ptr<CommandPool> ownerCommandPool;
+    std::unique_ptr<Buffer>      buffer;
+    VkDeviceSize                 slotSize;
+    std::vector<Slot>            slots;
+    uint32_t                     currentSlot{0};
+    //Signaled by the copies, and by the owner command buffers waiting on them with an ownership transfer
+    VkSemaphore                  timelineSemaphore{VK_NULL_HANDLE};
+    VkSemaphore                  ownerTimelineSemaphore{VK_NULL_HANDLE};
+    uint64_t                     timelineValue{0};
+};
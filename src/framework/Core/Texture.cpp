@@ -11,6 +11,9 @@
 
 #include "RenderContext.h"
 #include "Common/ResourceCache.h"
+#include "IO/TextureCooker.h"
+#include "IO/VirtualTextureFile.h"
+#include "StagingRing.h"
 
 const SgImage& Texture::getImage() const {
     return *image;
@@ -62,11 +65,43 @@ const Sampler& Texture::getSampler() const {
 //     g_context->submit(commandBuffer,true,VK_QUEUE_TRANSFER_BIT);
 //     texture->sampler = std::make_unique<Sampler>(device, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_FILTER_LINEAR, mipmaps.size());
 // }
+//Hands the uploaded levels from the copy queue family over to the family of the owner command buffer,
+//the release is recorded after the copies and the acquire before the mip blits
+static void transferImageOwnership(Image& image, CommandBuffer& commandBuffer, CommandBuffer& ownerCommandBuffer, uint32_t srcQueueFamily, uint32_t dstQueueFamily, const VkImageSubresourceRange& subresourceRange) {
+    VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = srcQueueFamily;
+    barrier.dstQueueFamilyIndex = dstQueueFamily;
+    barrier.image               = image.getHandle();
+    barrier.subresourceRange    = subresourceRange;
+    VkDependencyInfo dependencyInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependencyInfo.imageMemoryBarrierCount = 1;
+    dependencyInfo.pImageMemoryBarriers    = &barrier;
+
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier2(commandBuffer.getHandle(), &dependencyInfo);
+
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+    barrier.srcAccessMask = VK_ACCESS_2_NONE;
+    barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier2(ownerCommandBuffer.getHandle(), &dependencyInfo);
+}
+
+//Copies are recorded in commandBuffer, the mip blits and the final transition in ownerCommandBuffer.
+//Both may be the same command buffer, when they are of different queue families the uploaded levels change owner in between
 static void initVKTexture(Device&                   device,
                           std::unique_ptr<Texture>& texture,
                           CommandBuffer&            commandBuffer,
+                          CommandBuffer&            ownerCommandBuffer,
+                          uint32_t                  srcQueueFamily,
+                          uint32_t                  dstQueueFamily,
                           Buffer&                   imageBuffer,
                           uint32_t                  offset) {
+    if (texture->image->needGenerateMipMapOnGpu() && !texture->image->isMipMapBlitSupported())
+        texture->image->generateMipMapOnCpu();
     texture->image->createVkImage(device);
     imageBuffer.uploadData(static_cast<void*>(texture->image->getData().data()), texture->image->getBufferSize(), offset);
 
@@ -100,59 +135,26 @@ static void initVKTexture(Device&                   device,
 
     commandBuffer.copyBufferToImage(imageBuffer, texture->image->getVkImage(), imageCopyRegions);
 
+    //Levels left to the blits are undefined until then, they need no ownership transfer
+    if (srcQueueFamily != dstQueueFamily)
+        transferImageOwnership(texture->image->getVkImage(), commandBuffer, ownerCommandBuffer, srcQueueFamily, dstQueueFamily, subresourceRange);
 
-    if (texture->image->getMipMaps().size() == 1 && texture->image->needGenerateMipMapOnGpu()) {
-        std::vector<VkImageBlit2> blits;
-        int                       mipWidth  = texture->image->getExtent().width;
-        int                       mipHeight = texture->image->getExtent().height;
-
-        int i = 0;
-        while (true) {
-            VkImageBlit2 blit{};
-            blit.sType                         = VK_STRUCTURE_TYPE_IMAGE_BLIT_2;
-            blit.srcOffsets[0]                 = {0, 0, 0};
-            blit.srcOffsets[1]                 = {mipWidth, mipHeight, 1};
-            blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel       = i;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount     = 1;
-            blit.dstOffsets[0]                 = {0, 0, 0};
-            blit.dstOffsets[1]                 = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
-            blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel       = i + 1;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount     = 1;
-            blits                              = {blit};
-
-            mipWidth  = std::max(1, mipWidth / 2);
-            mipHeight = std::max(1, mipHeight / 2);
-            if (mipWidth <= 1 && mipHeight <= 1)
-                break;
-
-            VkBlitImageInfo2 blitInfo{};
-            blitInfo.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2;
-            texture->image->getVkImage().transitionLayout(commandBuffer, VulkanLayout::TRANSFER_SRC, {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = static_cast<uint32_t>(i), .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1});
-            texture->image->getVkImage().transitionLayout(commandBuffer, VulkanLayout::TRANSFER_DST, {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = static_cast<uint32_t>(i + 1), .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1});
-            blitInfo.srcImage       = texture->image->getVkImage().getHandle();
-            blitInfo.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            blitInfo.dstImage       = texture->image->getVkImage().getHandle();
-            blitInfo.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            blitInfo.regionCount    = blits.size();
-            blitInfo.pRegions       = blits.data();
-            vkCmdBlitImage2(commandBuffer.getHandle(), &blitInfo);//
-
-            i++;
-        }
-    }
+    //Only level 0 is uploaded, the rest of the chain is blitted in the owner command buffer
+    if (texture->image->needGenerateMipMapOnGpu())
+        texture->image->generateMipMapOnGpu(ownerCommandBuffer);
 
     subresourceRange.levelCount = texture->image->getMipLevelCount();
-    texture->getImage().getVkImage().transitionLayout(commandBuffer, VulkanLayout::READ_ONLY, subresourceRange);
+    texture->getImage().getVkImage().transitionLayout(ownerCommandBuffer, VulkanLayout::READ_ONLY, subresourceRange);
 
     VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     VkSamplerAddressMode addressModeV = texture->image->getFormat() == VK_FORMAT_R32G32B32A32_SFLOAT ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
     texture->sampler                  = &device.getResourceCache().requestSampler(VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_FILTER_LINEAR, texture->image->getMipLevelCount(), addressModeU, addressModeV);
 }
 
+static void initVKTexture(Device& device, std::unique_ptr<Texture>& texture, CommandBuffer& commandBuffer, Buffer& imageBuffer, uint32_t offset) {
+    initVKTexture(device, texture, commandBuffer, commandBuffer, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, imageBuffer, offset);
+}
+
 std::unique_ptr<Texture> Texture::loadTextureFromFile(Device& device, const std::string& path) {
     std::unique_ptr<Texture> texture = std::make_unique<Texture>();
     texture->image                   = std::make_unique<SgImage>(device, path);
@@ -164,11 +166,32 @@ std::unique_ptr<Texture> Texture::loadTextureFromFile(Device& device, const std:
 }
 std::unique_ptr<Texture> Texture::loadTextureFromFileWitoutInit(Device& device, const std::string& path) {
     std::unique_ptr<Texture> texture = std::make_unique<Texture>();
-    texture->image                   = std::make_unique<SgImage>(device, path);
+    //Block compressed mip complete copy of the source when it can be cooked
+    std::string cookedPath = device.isTextureCompressionBCSupported() ? TextureCooker::getCookedPath(path) : std::string{};
+    texture->image         = std::make_unique<SgImage>(device, cookedPath.empty() ? path : cookedPath);
     if (texture->image->getData().empty())
         return nullptr;
     return texture;
 }
+std::unique_ptr<Texture> Texture::loadVirtualTextureWithoutInit(Device& device, const std::string& path) {
+    auto               tiledPath = VirtualTextureFile::getTiledPath(path, getVirtualTexturePageFormat(device));
+    VirtualTextureFile file;
+    if (tiledPath.empty() || !file.open(tiledPath))
+        return loadTextureFromFileWitoutInit(device, path);
+    auto tail = file.readTail();
+    if (tail.empty())
+        return loadTextureFromFileWitoutInit(device, path);
+
+    std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+    texture->image                   = std::make_unique<SgImage>(device, std::move(tail), file.getTailExtent(), VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R8G8B8A8_SRGB);
+    //Sources fitting in a page have no paged level and stay plain textures
+    if (!file.getLevels().empty())
+        texture->virtualTexturePath = tiledPath;
+    return texture;
+}
+VkFormat Texture::getVirtualTexturePageFormat(const Device& device) {
+    return device.isTextureCompressionBCSupported() ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_R8G8B8A8_SRGB;
+}
 std::unique_ptr<Texture> Texture::loadTextureFromMemory(Device& device, std::vector<uint8_t>& data, VkExtent3D extent, VkImageViewType viewType, VkFormat format) {
     std::unique_ptr<Texture> texture = std::make_unique<Texture>();
     texture->image                   = std::make_unique<SgImage>(device, std::move(data), extent, viewType, format);
@@ -246,7 +269,7 @@ std::unique_ptr<Texture> Texture::loadTextureArrayFromFile(Device& device, const
 
     commandBuffer.endRecord();
 
-    auto queue = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0);
+    auto& queue = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0);
 
     VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
     submitInfo.commandBufferCount = 1;
@@ -260,27 +283,24 @@ std::unique_ptr<Texture> Texture::loadTextureArrayFromFile(Device& device, const
     return texture;
 }
 
-void initTexturesInBatch(std::vector<std::unique_ptr<Texture>>& textures, int start, int end) {
-    if (end <= start) {
-        return;
-    }
-    // start = 31;end =32;
-    CommandBuffer commandBuffer = g_context->getDevice().createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true, VK_QUEUE_TRANSFER_BIT);
-    uint32_t      size{0}, offset{0};
-    for (int i = start; i < end; i++) {
-        size += textures[i]->image->getBufferSize();
-    }
-    auto buffer = Buffer(g_context->getDevice(), size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    for (int i = start; i < end; i++) {
-        initVKTexture(g_context->getDevice(), textures[i], commandBuffer, buffer, offset);
-        offset += textures[i]->image->getBufferSize();
-    }
-    g_context->submit(commandBuffer, true, VK_QUEUE_TRANSFER_BIT);
-    for (int i = start; i < end; i++) {
-        //For hdr image,cpu date may be used in ray tracing scene,for accel construction
-        if (textures[i]->getImage().getFormat() != VK_FORMAT_R32G32B32A32_SFLOAT) {
-            textures[i]->image->freeImageCpuData();
-        }
+//Budget of the staging memory of a loading pass, textures larger than a slot get a dedicated staging buffer
+static constexpr VkDeviceSize STAGING_SLOT_SIZE  = 64'000'000;
+static constexpr uint32_t     STAGING_SLOT_COUNT = 3;
+
+std::unique_ptr<StagingRing> Texture::createUploadRing(Device& device) {
+    //Copies run on the dedicated transfer queue beside rendering, the mip blits need graphics and run on the graphics
+    //queue once the images were handed over. Without a transfer only family everything is recorded for graphics
+    auto& graphicsQueue = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0);
+    auto* transferQueue = device.getDedicatedTransferQueue();
+    return std::make_unique<StagingRing>(device, STAGING_SLOT_SIZE, STAGING_SLOT_COUNT, transferQueue ? *transferQueue : graphicsQueue, graphicsQueue);
+}
+
+void Texture::initTextureStreamed(StagingRing& stagingRing, std::unique_ptr<Texture>& texture) {
+    auto allocation = stagingRing.allocate(texture->image->getBufferSize());
+    initVKTexture(g_context->getDevice(), texture, allocation.commandBuffer, allocation.ownerCommandBuffer, allocation.srcQueueFamily, allocation.dstQueueFamily, allocation.buffer, toUint32(allocation.offset));
+    //For hdr image,cpu date may be used in ray tracing scene,for accel construction
+    if (texture->getImage().getFormat() != VK_FORMAT_R32G32B32A32_SFLOAT) {
+        texture->image->freeImageCpuData();
     }
 }
 
@@ -289,48 +309,17 @@ void Texture::initTexturesInOneSubmit(std::vector<std::unique_ptr<Texture>>& tex
         return;
     }
 
-    size_t oneBatchLimit = 256'000'000;
-
-    std::vector<int> batchStart{0};
-    size_t currentSize = 0;
-    for (int i = 0; i < textures.size(); i++) {
-        currentSize += textures[i]->image->getBufferSize();
-        if (currentSize > oneBatchLimit) {
-            batchStart.push_back(i);
-            currentSize = 0;
-        }
-    }
-
-    batchStart.push_back(textures.size());
-    
-    for (int i = 0; i < batchStart.size() - 1; i++) {
-        initTexturesInBatch(textures, batchStart[i],batchStart[i+1]);
-    }
-
-    return;
-
-    CommandBuffer commandBuffer = g_context->getDevice().createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-    uint32_t      size{0}, offset{0};
-    for (auto& texture : textures) {
-        size += texture->image->getBufferSize();
-    }
-    auto buffer = Buffer(g_context->getDevice(), size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
-    for (auto& texture : textures) {
-        initVKTexture(g_context->getDevice(), texture, commandBuffer, buffer, offset);
-        offset += texture->image->getBufferSize();
-    }
-    g_context->submit(commandBuffer, true, VK_QUEUE_TRANSFER_BIT);
+    auto stagingRing = createUploadRing(g_context->getDevice());
     for (auto& texture : textures) {
-        //For hdr image,cpu date may be used in ray tracing scene,for accel construction
-        if (texture->getImage().getFormat() != VK_FORMAT_R32G32B32A32_SFLOAT) {
-            texture->image->freeImageCpuData();
-        }
+        initTextureStreamed(*stagingRing, texture);
     }
+    stagingRing->wait();
 }
 
 Texture& Texture::operator=(Texture&& rhs) {
-    this->image   = std::move(rhs.image);
-    this->name    = rhs.name;
-    this->sampler = std::move(rhs.sampler);
+    this->image              = std::move(rhs.image);
+    this->name               = rhs.name;
+    this->virtualTexturePath = std::move(rhs.virtualTexturePath);
+    this->sampler            = std::move(rhs.sampler);
     return *this;
 }
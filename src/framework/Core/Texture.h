@@ -8,10 +8,14 @@
 #include "Scene/SgImage.h"
 #include "Images/Sampler.h"
 
+class StagingRing;
+
 struct Texture {
     std::unique_ptr<SgImage> image{nullptr};
     const Sampler*           sampler{nullptr};
     std::string              name;
+    //Tiled file streamed by the VirtualTexturePass, image then only holds the mip tail
+    std::string              virtualTexturePath;
 
     const Sampler& getSampler() const;
 
@@ -19,11 +23,17 @@ struct Texture {
 
     static std::unique_ptr<Texture> loadTextureFromFile(Device& device, const std::string& path);
     static std::unique_ptr<Texture> loadTextureFromFileWitoutInit(Device& device, const std::string& path);
+    //Tiles the source on first use and loads its mip tail, sources that can not be tiled are loaded whole
+    static std::unique_ptr<Texture> loadVirtualTextureWithoutInit(Device& device, const std::string& path);
+    static VkFormat                 getVirtualTexturePageFormat(const Device& device);
     static std::unique_ptr<Texture> loadTextureFromMemoryWithoutInit(Device& device, std::vector<uint8_t>& data, VkExtent3D extent, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
 
     static std::unique_ptr<Texture> loadTextureFromMemory(Device& device, std::vector<uint8_t>& data, VkExtent3D extent, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
     static std::unique_ptr<Texture> loadTextureArrayFromFile(Device& device, const std::string& path);
     static void                     initTexturesInOneSubmit(std::vector<std::unique_ptr<Texture>>& textures);
+    //Records the upload of a texture into the staging ring of a loading pass, its cpu data is released once copied
+    static void                     initTextureStreamed(StagingRing& stagingRing, std::unique_ptr<Texture>& texture);
+    static std::unique_ptr<StagingRing> createUploadRing(Device& device);
     Texture&                        operator=(Texture&&);
     Texture(Texture& texture) = delete;
     Texture()                 = default;
@@ -2,6 +2,7 @@
 
 #include "imgui.h"
 #include "RenderContext.h"
+#include "Common/ResourceCache.h"
 #include "Gui/Gui.h"
 #include "Scene/Scene.h"
 #include "Scene/Compoments/SgLight.h"
@@ -10,18 +11,30 @@ constexpr size_t CONFIG_MAX_LIGHT_COUNT = 64;
 
 
 View::View(Device& device) {
-    mLightBuffer.resize(g_context->getSwapChainImageCount());
+    mLightBuffer.resize(g_context->getFramesInFlight());
     for (auto& lightBuffer : mLightBuffer) {
         lightBuffer = std::make_unique<Buffer>(device, sizeof(LightUib) * CONFIG_MAX_LIGHT_COUNT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
     }
-    mPerViewBuffer = std::make_unique<Buffer>(device, sizeof(PerViewUnifom), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    //The gpu may still read the uniforms of the previous frames, every frame in flight writes its own buffer
+    mPerViewBuffers.resize(g_context->getFramesInFlight());
+    for (auto& perViewBuffer : mPerViewBuffers) {
+        perViewBuffer = std::make_unique<Buffer>(device, sizeof(PerViewUnifom), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
+    mUploadedPerViewUniforms.resize(mPerViewBuffers.size());
+}
+//Shared by all views, a new view never repeats the version of a previous one
+static uint64_t NextPrimitivesVersion() {
+    static uint64_t version = 0;
+    return ++version;
 }
+
 void View::setScene(const Scene* scene) {
     mScene = scene;
     
     for (const auto& primitive : mScene->getPrimitives()) {
         mVisiblePrimitives.emplace_back(primitive.get());
     }
+    mPrimitivesVersion = NextPrimitivesVersion();
     for (const auto& texture : mScene->getTextures()) {
         mImageViews.emplace_back(&texture->getImage().getVkImageView());
         mSamplers.emplace_back(&texture->getSampler());
@@ -29,8 +42,61 @@ void View::setScene(const Scene* scene) {
     mMaterials = scene->getGltfMaterials();
 
     mLights = scene->getLights();
-    lightDirty = true;
+    setLightDirty(true);
     updateLight(true);
+
+    if (auto* bindlessHeap = g_context->getDevice().getResourceCache().getBindlessHeap())
+        setBindlessScene(*bindlessHeap);
+}
+
+//Zero when the buffer was not created with device address usage
+static uint64_t GetBufferAddress(const Buffer& buffer) {
+    return buffer.getUsageFlags() & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT ? buffer.getDeviceAddress() : 0;
+}
+
+void View::setBindlessScene(BindlessDescriptorHeap& heap) {
+    std::vector<uint32_t> heapIndices;
+    heapIndices.reserve(mImageViews.size());
+    for (uint32_t i = 0; i < mImageViews.size(); i++)
+        heapIndices.push_back(heap.registerTexture(*mImageViews[i], *mSamplers[i]));
+    mBindlessTextureIndices = heapIndices;
+
+    //Gltf materials index the scene textures, the copy uploaded to the gpu indexes the heap instead
+    auto materials    = mMaterials;
+    auto remapTexture = [&heapIndices](int& textureIndex) {
+        if (textureIndex >= 0 && static_cast<size_t>(textureIndex) < heapIndices.size())
+            textureIndex = heapIndices[textureIndex];
+    };
+    for (auto& material : materials) {
+        remapTexture(material.pbrBaseColorTexture);
+        remapTexture(material.pbrMetallicRoughnessTexture);
+        remapTexture(material.emissiveTexture);
+        remapTexture(material.normalTexture);
+        remapTexture(material.occlusionTexture);
+    }
+    //Frames in flight still read the materials through the address of the previous buffer
+    if (mBindlessMaterialBuffer)
+        g_context->deferRelease(std::move(mBindlessMaterialBuffer));
+    mBindlessMaterialBuffer = std::make_unique<Buffer>(g_context->getDevice(), sizeof(GltfMaterial) * std::max<size_t>(materials.size(), 1), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, materials.empty() ? nullptr : materials.data());
+
+    BindlessSceneAddresses addresses{};
+    addresses.materials      = mBindlessMaterialBuffer->getDeviceAddress();
+    addresses.material_count = materials.size();
+    addresses.texture_count  = heap.getTextureCount();
+    if (mScene->getBufferRate() == BufferRate::PER_SCENE) {
+        addresses.primitive_infos   = GetBufferAddress(mScene->getUniformBuffer());
+        addresses.indices           = GetBufferAddress(mScene->getIndexBuffer());
+        addresses.index_type_uint32 = mScene->getIndexType() == VK_INDEX_TYPE_UINT32;
+        if (mScene->hasVertexBuffer(POSITION_ATTRIBUTE_NAME))
+            addresses.positions = GetBufferAddress(mScene->getVertexBuffer(POSITION_ATTRIBUTE_NAME));
+        if (mScene->hasVertexBuffer(NORMAL_ATTRIBUTE_NAME))
+            addresses.normals = GetBufferAddress(mScene->getVertexBuffer(NORMAL_ATTRIBUTE_NAME));
+        if (mScene->hasVertexBuffer(TEXCOORD_ATTRIBUTE_NAME))
+            addresses.texcoords = GetBufferAddress(mScene->getVertexBuffer(TEXCOORD_ATTRIBUTE_NAME));
+    }
+    if (addresses.primitive_infos == 0)
+        LOGW("Bindless mode expects per scene buffers created with device address usage");
+    heap.setSceneAddresses(addresses);
 }
 void View::setCamera(const Camera* camera) {
     mCamera = camera;
@@ -54,22 +120,28 @@ View& View::bindViewBuffer() {
     perViewUnifom.roughnessOverride = mPerViewUniform.roughnessOverride;
     perViewUnifom.overrideRoughness = mPerViewUniform.overrideRoughness;
 
-    if (perViewUnifom != mPerViewUniform) {
-        mPerViewBuffer->uploadData(&perViewUnifom, sizeof(PerViewUnifom), 0);
-        mPerViewUniform = perViewUnifom;
+    uint32_t frameIndex    = g_context->getActiveFrameIndex();
+    auto&    perViewBuffer = *mPerViewBuffers[frameIndex];
+    if (perViewUnifom != mUploadedPerViewUniforms[frameIndex]) {
+        perViewBuffer.uploadData(&perViewUnifom, sizeof(PerViewUnifom), 0);
+        mUploadedPerViewUniforms[frameIndex] = perViewUnifom;
     }
-    //perViewUnif
+    mPerViewUniform = perViewUnifom;
 
-    g_context->bindBuffer(static_cast<uint32_t>(UniformBindingPoints::PER_VIEW), *mPerViewBuffer, 0, mPerViewBuffer->getSize(), 0);
+    g_context->bindBuffer(static_cast<uint32_t>(UniformBindingPoints::PER_VIEW), perViewBuffer, 0, perViewBuffer.getSize(), 0);
 
     return *this;
 }
 
 View& View::bindViewShading() {
 
-    if(lightDirty) updateLight();
+    if(lightDirtyFrames > 0) updateLight();
     g_context->bindBuffer(static_cast<uint32_t>(UniformBindingPoints::LIGHTS), *mLightBuffer[g_context->getActiveFrameIndex()], 0, mLightBuffer[g_context->getActiveFrameIndex()]->getSize(), 0);
-    
+
+    //Materials and textures are already resident in the bindless heap
+    if (mBindlessMaterialBuffer)
+        return *this;
+
     auto             materials  = GetMMaterials();
     BufferAllocation allocation = g_context->allocateBuffer(sizeof(GltfMaterial) * materials.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
     allocation.buffer->uploadData(materials.data(), allocation.size, allocation.offset);
@@ -83,6 +155,8 @@ View& View::bindViewShading() {
     return *this;
 }
 int View::bindTexture(const ImageView& imageView, const Sampler& sampler) {
+    if (auto* bindlessHeap = g_context->getDevice().getResourceCache().getBindlessHeap())
+        return bindlessHeap->registerTexture(imageView, sampler);
     mImageViews.emplace_back(&imageView);
     mSamplers.emplace_back(&sampler);
     return mImageViews.size() - 1;
@@ -93,6 +167,15 @@ View& View::bindViewGeom(CommandBuffer& commandBuffer) {
         g_context->bindScene(commandBuffer, *mScene);
     return *this;
 }
+//Splits the draw list across threads when the pass records into secondary command buffers
+static void recordDrawList(CommandBuffer& commandBuffer, uint32_t drawCount, const ParallelCommandRecorder::RecordFunc& recordFunc) {
+    auto& recorder = g_context->getParallelCommandRecorder();
+    if (recorder.isRecording() && &recorder.getCommandBuffer() == &commandBuffer)
+        recorder.record(drawCount, recordFunc);
+    else
+        recordFunc(commandBuffer, 0, drawCount);
+}
+
 void View::drawPrimitives(CommandBuffer& commandBuffer) {
     if (mScene->getBufferRate() == BufferRate::PER_PRIMITIVE) {
         drawPrimitivesUseSeparateBuffers(commandBuffer);
@@ -109,9 +192,12 @@ void View::drawPrimitives(CommandBuffer& commandBuffer) {
 
     }
     else {
-        for (const auto& primitive : mVisiblePrimitives) {
-            g_context->flushAndDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, primitive->firstVertex, instance_count++);
-        }
+        recordDrawList(commandBuffer, mVisiblePrimitives.size(), [&](CommandBuffer& drawCommandBuffer, uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                const auto& primitive = mVisiblePrimitives[i];
+                g_context->flushAndDrawIndexed(drawCommandBuffer, primitive->indexCount, 1, primitive->firstIndex, primitive->firstVertex, i);
+            }
+        });
     }
     
 }
@@ -122,25 +208,39 @@ void View::drawPrimitives(CommandBuffer& commandBuffer, const PrimitiveSelectFun
         return drawPrimitives(commandBuffer);
     }
     
-    int instance_count = 0;
-    for (const auto& primitive : mVisiblePrimitives) {
-        if (selectFunc(*primitive)) {
-            g_context->flushAndDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, primitive->firstVertex, instance_count);
+    recordDrawList(commandBuffer, mVisiblePrimitives.size(), [&](CommandBuffer& drawCommandBuffer, uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const auto& primitive = mVisiblePrimitives[i];
+            if (selectFunc(*primitive)) {
+                g_context->flushAndDrawIndexed(drawCommandBuffer, primitive->indexCount, 1, primitive->firstIndex, primitive->firstVertex, i);
+            }
         }
-        instance_count++;
-    }
+    });
+}
+void View::drawPrimitivesIndirect(CommandBuffer& commandBuffer, const Buffer& drawCommands, const Buffer& drawCounts, AlphaMode alphaMode) {
+    const uint32_t maxDrawCount = mVisiblePrimitives.size();
+    if (maxDrawCount == 0)
+        return;
+    recordDrawList(commandBuffer, 1, [&](CommandBuffer& drawCommandBuffer, uint32_t begin, uint32_t end) {
+        g_context->flushAndDrawIndexedIndirectCount(drawCommandBuffer, drawCommands, sizeof(VkDrawIndexedIndirectCommand) * maxDrawCount * alphaMode, drawCounts, sizeof(uint32_t) * alphaMode, maxDrawCount);
+    });
+}
+
+bool View::supportIndirectDraw() const {
+    return mScene != nullptr && mScene->getBufferRate() == BufferRate::PER_SCENE && !mScene->getMergeDrawCall();
 }
+
 void View::drawPrimitivesUseSeparateBuffers(CommandBuffer& commandBuffer) {
-    uint32_t instance_count = 0;
     //Here first binding hard code
     //Fix me
     commandBuffer.bindVertexBuffer(3, mScene->getPrimitiveIdBuffer(), {0});
     g_context->bindBuffer(static_cast<uint32_t>(UniformBindingPoints::PRIM_INFO), mScene->getUniformBuffer(), 0, mScene->getUniformBuffer().getSize());
-    for (const auto& primitive : mVisiblePrimitives) {
-        g_context->bindPrimitiveGeom(commandBuffer, *primitive);
-        g_context->flushAndDrawIndexed(commandBuffer, primitive->indexCount, 1, 0, 0, instance_count++);
-        //  return;
-    }
+    recordDrawList(commandBuffer, mVisiblePrimitives.size(), [&](CommandBuffer& drawCommandBuffer, uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            g_context->bindPrimitiveGeom(drawCommandBuffer, *mVisiblePrimitives[i]);
+            g_context->flushAndDrawIndexed(drawCommandBuffer, mVisiblePrimitives[i]->indexCount, 1, 0, 0, i);
+        }
+    });
 }
 
 void View::updateGui() {
@@ -165,11 +265,30 @@ void View::updateGui() {
 void View::perFrameUpdate() {
     mSamplers.resize(mScene->getTextures().size());
     mImageViews.resize(mScene->getTextures().size());
+    updateMaterials();
+}
+
+void View::updateMaterials() {
+    const auto& sceneMaterials = mScene->getGltfMaterials();
+    if (sceneMaterials.size() == mMaterials.size() && (mMaterials.empty() || memcmp(sceneMaterials.data(), mMaterials.data(), sizeof(GltfMaterial) * mMaterials.size()) == 0))
+        return;
+    //The materials are uploaded every frame without the bindless heap, only its buffer is written once
+    mMaterials = sceneMaterials;
+    if (auto* bindlessHeap = g_context->getDevice().getResourceCache().getBindlessHeap())
+        setBindlessScene(*bindlessHeap);
 }
 
 const Camera* View::getCamera() const {
     return mCamera;
 }
+const Scene* View::getScene() const {
+    return mScene;
+}
+int View::getTextureShaderIndex(uint32_t sceneTextureIndex) const {
+    if (sceneTextureIndex < mBindlessTextureIndices.size())
+        return mBindlessTextureIndices[sceneTextureIndex];
+    return sceneTextureIndex;
+}
 void View::IteratorPrimitives(const PrimitiveCallBack& callback) const {
     for ( auto& primitive : mVisiblePrimitives) {
         callback(*primitive);
@@ -181,6 +300,7 @@ std::vector<Primitive*> View::getMVisiblePrimitives() const {
 }
 void View::setMVisiblePrimitives(const std::vector<Primitive*>& mVisiblePrimitives) {
     this->mVisiblePrimitives = mVisiblePrimitives;
+    mPrimitivesVersion       = NextPrimitivesVersion();
 }
 
 std::vector<SgLight>& View::getLights() {
@@ -234,9 +354,12 @@ void View::updateLight(bool updateAllLightBuffer) {
         currentLightBuffer->uploadData(lights.data(), lights.size() * sizeof(LightUib), 0);
     }
     else {
-        for (uint32_t i = 0; i < g_context->getSwapChainImageCount(); i++) {
+        for (uint32_t i = 0; i < mLightBuffer.size(); i++) {
             mLightBuffer[i]->uploadData(lights.data(), lights.size() * sizeof(LightUib), 0);
         }
     }
-    lightDirty = false;
+    if (updateAllLightBuffer)
+        lightDirtyFrames = 0;
+    else if (lightDirtyFrames > 0)
+        lightDirtyFrames--;
 }
\ No newline at end of file
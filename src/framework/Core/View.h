@@ -11,6 +11,7 @@ class Scene;
 class Texture;
 class ImageView;
 class Sampler;
+class BindlessDescriptorHeap;
 
 enum AlphaMode {
     OPAQUE = 0,
@@ -34,18 +35,28 @@ public:
     using PrimitiveSelectFunc = std::function<bool(const Primitive& primitive)>;
     void drawPrimitives(CommandBuffer& commandBuffer, const PrimitiveSelectFunc& selectFunc,bool forceSelect = false);
 
+    //Draws the commands written on the gpu for one alpha mode, see GpuCullingPass for the buffer layout
+    void drawPrimitivesIndirect(CommandBuffer& commandBuffer, const Buffer& drawCommands, const Buffer& drawCounts, AlphaMode alphaMode);
+    //Per scene buffers and separate draws, the layout the gpu driven path is able to draw
+    bool supportIndirectDraw() const;
+
     void drawPrimitivesUseSeparateBuffers(CommandBuffer& commandBuffer);
-    void setLightDirty(bool dirty) { lightDirty = dirty; }
+    void setLightDirty(bool dirty) { lightDirtyFrames = dirty ? static_cast<uint32_t>(mLightBuffer.size()) : 0; }
 
     void updateGui();
     void perFrameUpdate();
     
     const Camera*                 getCamera() const;
+    const Scene*                  getScene() const;
+    //Index shaders use for a scene texture, the heap slot in the bindless mode
+    int                           getTextureShaderIndex(uint32_t sceneTextureIndex) const;
 
     using PrimitiveCallBack = std::function<void(Primitive& primitive)>;
     void IteratorPrimitives(const PrimitiveCallBack& callback) const;
     std::vector< Primitive*> getMVisiblePrimitives() const;
     void                          setMVisiblePrimitives(const std::vector< Primitive*>& mVisiblePrimitives);
+    //Changes whenever the primitive list is replaced, caches built from the primitives compare it
+    uint64_t                      getPrimitivesVersion() const { return mPrimitivesVersion; }
     std::vector<SgLight> & getLights();
 
     AlphaMode getAlphaMode(const Primitive & primitive) const;
@@ -80,17 +91,27 @@ protected:
 protected:
 
     void updateLight(bool updateAllLightBuffer = false);
+    //Takes the scene materials again when they changed since the last frame
+    void updateMaterials();
+    //Registers the scene textures in the heap and publishes the scene buffer addresses
+    void setBindlessScene(BindlessDescriptorHeap& heap);
     
     const Camera*                 mCamera{nullptr};
     std::vector< Primitive*> mVisiblePrimitives;
+    uint64_t                 mPrimitivesVersion{0};
     std::vector<const ImageView *> mImageViews;
     std::vector<const Sampler *>  mSamplers;
     std::vector<SgLight> mLights;
     std::vector<GltfMaterial>     mMaterials;
     const Scene*                  mScene{nullptr};
-    std::unique_ptr<Buffer>       mPerViewBuffer;
-    PerViewUnifom                 mPerViewUniform;
+    std::vector<std::unique_ptr<Buffer>> mPerViewBuffers;
+    std::vector<PerViewUnifom>           mUploadedPerViewUniforms;
+    PerViewUnifom                        mPerViewUniform;
     std::vector<std::unique_ptr<Buffer>>      mLightBuffer;
+    //Materials with texture indices remapped to the bindless heap, written again when the scene materials change
+    std::unique_ptr<Buffer>                   mBindlessMaterialBuffer;
+    std::vector<uint32_t>                     mBindlessTextureIndices;
 
-    bool lightDirty{false};
+    //Light buffers of the frames in flight still holding the previous lights
+    uint32_t lightDirtyFrames{0};
 };
\ No newline at end of file
@@ -205,13 +205,9 @@ bool Gui::update() {
         return false;
     }
 
-    // if (mvertexBuffer.size != vertexBufferSize ||
-    //     mIndexBuffer.size != indexBufferSize) {
-    if (mvertexBuffer.size != vertexBufferSize) {
-        mvertexBuffer = g_context->allocateBuffer(vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-    }
-    if (mIndexBuffer.size != indexBufferSize)
-        mIndexBuffer = g_context->allocateBuffer(indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    //Allocated from the buffer pools of the current frame, the previous frames may still be drawn from theirs
+    mvertexBuffer = g_context->allocateBuffer(vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    mIndexBuffer  = g_context->allocateBuffer(indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
     uint64_t vtxOffset = mvertexBuffer.offset, idxOffset = mIndexBuffer.offset;
     for (int n = 0; n < imDrawData->CmdListsCount; n++) {
         const ImDrawList* cmd_list = imDrawData->CmdLists[n];
@@ -1,11 +1,15 @@
 #include "ImageIO.h"
 #include <stb_image.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "ctpl_stl.h"
 #include "Common/FIleUtils.h"
 #include "Common/Log.h"
+#include "Scene/Images/MipMapGenerator.h"
 
 #include <stb_image_write.h>
+#include <gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 // #include <dds.hpp>
@@ -196,6 +200,7 @@ ImageIO::ImageDesc ImageIO::loadImage(const std::string& path) {
                 desc.mipmaps[arrayIdx * dds.GetMipCount() + mipIdx].extent.width  = imageData->m_width;
                 desc.mipmaps[arrayIdx * dds.GetMipCount() + mipIdx].extent.height = imageData->m_height;
                 desc.mipmaps[arrayIdx * dds.GetMipCount() + mipIdx].extent.depth  = imageData->m_depth;
+                desc.mipmaps[arrayIdx * dds.GetMipCount() + mipIdx].offset        = datasize;
                 datasize += imageData->m_memSlicePitch;
             }
         }
@@ -230,29 +235,79 @@ ImageIO::ImageDesc ImageIO::loadImage(const std::string& path) {
         return desc;
     }
 }
-void ImageIO::saveImage(const std::string& path, std::shared_ptr<std::vector<uint8_t>> data, int width, int height, int channels, bool ldr, bool hdr) {
-
-    ctpl::thread_pool pool(1);
+//Linear float rgba of every texel, unorm formats are assumed to hold linear values like the float ones
+static std::vector<float> ToLinearFloat(const uint8_t* data, VkFormat format, size_t texelCount) {
+    std::vector<float> rgba(texelCount * 4);
+    switch (format) {
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            memcpy(rgba.data(), data, rgba.size() * sizeof(float));
+            break;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            for (size_t i = 0; i < texelCount; i++) {
+                uint64_t packed;
+                memcpy(&packed, data + i * sizeof(packed), sizeof(packed));
+                glm::vec4 value = glm::unpackHalf4x16(packed);
+                memcpy(rgba.data() + i * 4, &value.x, sizeof(value));
+            }
+            break;
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            for (size_t i = 0; i < texelCount * 4; i++) {
+                float c = data[i] / 255.0f;
+                rgba[i] = (i & 3) == 3 ? c : std::pow(c, 2.2f);
+            }
+            break;
+        default:
+            for (size_t i = 0; i < texelCount * 4; i++)
+                rgba[i] = data[i] / 255.0f;
+            break;
+    }
+    return rgba;
+}
 
-    std::future<void> future = pool.push([path, ldr, hdr, width, height, data](int id) {
-        if (ldr)
-            ImageIO::saveLdr(path, data->data(), width, height, 4);
-        if (hdr)
-            ImageIO::saveHdr(path, data->data(), width, height, 4);
-    });
+bool ImageIO::saveImage(const std::string& path, const uint8_t* data, VkFormat format, int width, int height, bool ldr, bool hdr) {
+    if (MipMapGenerator::getTexelSize(format) == 0) {
+        LOGE("Saving images of format {} is not supported", static_cast<int>(format));
+        return false;
+    }
+    const size_t texelCount = size_t(width) * height;
+    bool         saved      = true;
+    if (ldr) {
+        std::vector<uint8_t> rgba(texelCount * 4);
+        if (format == VK_FORMAT_R8G8B8A8_SRGB) {
+            memcpy(rgba.data(), data, rgba.size());
+        } else {
+            //Linear values are gamma encoded, alpha is kept linear
+            std::vector<float> linear = ToLinearFloat(data, format, texelCount);
+            for (size_t i = 0; i < rgba.size(); i++) {
+                float c = std::clamp(linear[i], 0.0f, 1.0f);
+                rgba[i] = static_cast<uint8_t>(((i & 3) == 3 ? c : std::pow(c, 1.0f / 2.2f)) * 255.0f + 0.5f);
+            }
+        }
+        saved &= saveLdr(path, rgba.data(), width, height);
+    }
+    if (hdr)
+        saved &= saveHdr(path, ToLinearFloat(data, format, texelCount).data(), width, height);
+    return saved;
 }
-void ImageIO::saveLdr(const std::string& path, void* data, int width, int height, int channels) {
-    auto                 path_not_overwrite = FileUtils::getFilePath(path, "png", false);
-    std::vector<uint8_t> image_data;
-    image_data.resize(width * height * channels);
-    memcpy(image_data.data(), data, image_data.size());
-    std::ranges::transform(image_data.begin(), image_data.end(), image_data.begin(), [](uint8_t value) -> uint8_t {
-        return static_cast<uint8_t>(std::pow(value / 255.0, 1.0 / 2.2) * 255);
-    });
+
+bool ImageIO::saveLdr(const std::string& path, const uint8_t* data, int width, int height) {
+    auto path_not_overwrite = FileUtils::getFilePath(path, "png", false);
     LOGI("Saving image to {}", path_not_overwrite.c_str());
-    stbi_write_png(path_not_overwrite.c_str(), width, height, channels, image_data.data(), width * channels);
+    if (!stbi_write_png(path_not_overwrite.c_str(), width, height, 4, data, width * 4)) {
+        LOGE("Failed to write {}", path_not_overwrite);
+        return false;
+    }
+    return true;
 }
 
-void ImageIO::saveHdr(const std::string& path, void* data, int width, int height, int channels) {
-   
+bool ImageIO::saveHdr(const std::string& path, const float* data, int width, int height) {
+    auto        path_not_overwrite = FileUtils::getFilePath(path, "exr", false);
+    const char* err                = nullptr;
+    LOGI("Saving image to {}", path_not_overwrite.c_str());
+    if (SaveEXR(data, width, height, 4, 1, path_not_overwrite.c_str(), &err) != TINYEXR_SUCCESS) {
+        LOGE("Failed to write {}: {}", path_not_overwrite, err ? err : "unknown error");
+        FreeEXRErrorMessage(err);
+        return false;
+    }
+    return true;
 }
@@ -32,7 +32,10 @@ public:
         bool                 needGenerateMipmaps{true};
     };
     static ImageDesc loadImage(const std::string& path);
-    static void      saveImage(const std::string& path, std::shared_ptr<std::vector<uint8_t>>, int width, int height, int channels, bool ldr, bool hdr);
-    static void      saveHdr(const std::string& path, void* data, int width, int height, int channels);
-    static void      saveLdr(const std::string& path, void* data, int width, int height, int channels);
+    //Encodes texels of an rgba format to path.png and path.exr on the calling thread, runs on the readback encoder threads
+    static bool      saveImage(const std::string& path, const uint8_t* data, VkFormat format, int width, int height, bool ldr, bool hdr);
+    //Linear float rgba, written as half float exr
+    static bool      saveHdr(const std::string& path, const float* data, int width, int height);
+    //Gamma encoded rgba8
+    static bool      saveLdr(const std::string& path, const uint8_t* data, int width, int height);
 };
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Read only memory mapping of a whole file.
+ * Pages are faulted in by the os on first access, a cooked file laid out as the consumer reads it is then loaded without
+ * any read or parse, and pages nobody touches are never read.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return mData; }
+    size_t         size() const { return mSize; }
+    bool           isOpen() const { return mData != nullptr; }
+
+protected:
+    const uint8_t* mData{nullptr};
+    size_t         mSize{0};
+#ifdef _WIN32
+    void* mFile{nullptr};
+    void* mMapping{nullptr};
+#else
+    int mFile{-1};
+#endif
+};
@@ -0,0 +1,394 @@
+#include "TextureCooker.h"
+
+#include "tinyddsloader.h"
+#include "Common/FIleUtils.h"
+#include "Common/Log.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+//Bump when the encoder or the container changes, every cooked file is then cooked again
+static constexpr uint32_t COOKER_VERSION      = 1;
+static const std::string  COOKED_TEXTURE_PATH = "cookedTextures/";
+static constexpr int      BC7_WEIGHTS[16]     = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+static constexpr uint32_t BC7_BLOCK_SIZE      = 16;
+
+static void HashBytes(uint64_t& hash, const void* data, size_t size) {
+    //FNV-1a, stable across runs and compilers unlike std::hash
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+static std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return {};
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static float SrgbToLinear(uint8_t value) {
+    static const auto table = [] {
+        std::array<float, 256> table{};
+        for (uint32_t i = 0; i < 256; i++) {
+            float c  = i / 255.0f;
+            table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+    return table[value];
+}
+
+static uint8_t LinearToSrgb(float value) {
+    value   = std::clamp(value, 0.0f, 1.0f);
+    float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(c * 255.0f + 0.5f);
+}
+
+//2x2 box filter of an rgba8 srgb level, color is averaged in linear space, odd sizes clamp to the last row and column
+static void DownsampleSrgb(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight) {
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        uint32_t rows[2] = {std::min(2 * y, height - 1), std::min(2 * y + 1, height - 1)};
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            uint32_t columns[2] = {std::min(2 * x, width - 1), std::min(2 * x + 1, width - 1)};
+            float    sum[4]{};
+            for (uint32_t row : rows)
+                for (uint32_t column : columns) {
+                    const uint8_t* texel = src + (row * width + column) * 4;
+                    for (uint32_t c = 0; c < 3; c++)
+                        sum[c] += SrgbToLinear(texel[c]);
+                    sum[3] += texel[3];
+                }
+            uint8_t* out = dst + (y * dstWidth + x) * 4;
+            for (uint32_t c = 0; c < 3; c++)
+                out[c] = LinearToSrgb(sum[c] * 0.25f);
+            out[3] = static_cast<uint8_t>(sum[3] * 0.25f + 0.5f);
+        }
+    }
+}
+
+/**
+ * BC7 mode 6 encoder: one subset, rgba endpoints of 7 bits plus a p-bit each and 4 bit indices.
+ * Endpoints are the extent of the block along its principal axis, refined once by least squares on the chosen indices.
+ */
+struct Bc7Endpoints {
+    uint8_t  color[2][4];
+    uint32_t pbit[2];
+};
+
+static void QuantizeEndpoint(const float endpoint[4], uint8_t color[4], uint32_t& pbit) {
+    float bestError = std::numeric_limits<float>::max();
+    for (uint32_t p = 0; p < 2; p++) {
+        uint8_t quantized[4];
+        float   error = 0;
+        for (uint32_t c = 0; c < 4; c++) {
+            quantized[c] = static_cast<uint8_t>(std::clamp(std::round((endpoint[c] - p) * 0.5f), 0.0f, 127.0f));
+            float delta  = static_cast<float>((quantized[c] << 1) | p) - endpoint[c];
+            error += delta * delta;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pbit      = p;
+            std::copy_n(quantized, 4, color);
+        }
+    }
+}
+
+static uint32_t SelectIndices(const uint8_t pixels[16][4], const Bc7Endpoints& endpoints, uint8_t indices[16]) {
+    int palette[16][4];
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t c = 0; c < 4; c++) {
+            int e0        = (endpoints.color[0][c] << 1) | endpoints.pbit[0];
+            int e1        = (endpoints.color[1][c] << 1) | endpoints.pbit[1];
+            palette[i][c] = ((64 - BC7_WEIGHTS[i]) * e0 + BC7_WEIGHTS[i] * e1 + 32) >> 6;
+        }
+
+    uint32_t totalError = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        for (uint32_t j = 0; j < 16; j++) {
+            uint32_t error = 0;
+            for (uint32_t c = 0; c < 4; c++) {
+                int delta = palette[j][c] - pixels[i][c];
+                error += delta * delta;
+            }
+            if (error < bestError) {
+                bestError  = error;
+                indices[i] = j;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+static void FitEndpoints(const uint8_t pixels[16][4], float e0[4], float e1[4]) {
+    float mean[4]{}, minColor[4], maxColor[4];
+    std::fill_n(minColor, 4, 255.0f);
+    std::fill_n(maxColor, 4, 0.0f);
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t c = 0; c < 4; c++) {
+            mean[c] += pixels[i][c] / 16.0f;
+            minColor[c] = std::min<float>(minColor[c], pixels[i][c]);
+            maxColor[c] = std::max<float>(maxColor[c], pixels[i][c]);
+        }
+
+    float covariance[4][4]{};
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t r = 0; r < 4; r++)
+            for (uint32_t c = 0; c < 4; c++)
+                covariance[r][c] += (pixels[i][r] - mean[r]) * (pixels[i][c] - mean[c]);
+
+    //Power iteration from the diagonal of the bounding box
+    float axis[4];
+    for (uint32_t c = 0; c < 4; c++)
+        axis[c] = maxColor[c] - minColor[c];
+    for (uint32_t iteration = 0; iteration < 8; iteration++) {
+        float next[4]{}, length = 0;
+        for (uint32_t r = 0; r < 4; r++) {
+            for (uint32_t c = 0; c < 4; c++)
+                next[r] += covariance[r][c] * axis[c];
+            length += next[r] * next[r];
+        }
+        if (length < 1e-12f)
+            break;
+        length = std::sqrt(length);
+        for (uint32_t c = 0; c < 4; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+    if (length < 1e-6f) {
+        //Constant block
+        std::copy_n(mean, 4, e0);
+        std::copy_n(mean, 4, e1);
+        return;
+    }
+    for (uint32_t c = 0; c < 4; c++)
+        axis[c] /= length;
+
+    float tMin = std::numeric_limits<float>::max(), tMax = std::numeric_limits<float>::lowest();
+    for (uint32_t i = 0; i < 16; i++) {
+        float t = 0;
+        for (uint32_t c = 0; c < 4; c++)
+            t += (pixels[i][c] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    for (uint32_t c = 0; c < 4; c++) {
+        e0[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+        e1[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+    }
+}
+
+//Least squares endpoints for fixed indices, false if the indices do not constrain both endpoints
+static bool RefineEndpoints(const uint8_t pixels[16][4], const uint8_t indices[16], float e0[4], float e1[4]) {
+    float aa = 0, ab = 0, bb = 0, ap[4]{}, bp[4]{};
+    for (uint32_t i = 0; i < 16; i++) {
+        float b = BC7_WEIGHTS[indices[i]] / 64.0f;
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (uint32_t c = 0; c < 4; c++) {
+            ap[c] += a * pixels[i][c];
+            bp[c] += b * pixels[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f)
+        return false;
+    for (uint32_t c = 0; c < 4; c++) {
+        e0[c] = std::clamp((bb * ap[c] - ab * bp[c]) / det, 0.0f, 255.0f);
+        e1[c] = std::clamp((aa * bp[c] - ab * ap[c]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+static void WriteBits(uint8_t* block, uint32_t& bitOffset, uint32_t value, uint32_t bitCount) {
+    for (uint32_t i = 0; i < bitCount; i++, bitOffset++)
+        if ((value >> i) & 1)
+            block[bitOffset >> 3] |= 1 << (bitOffset & 7);
+}
+
+static void EncodeBlockBc7(const uint8_t pixels[16][4], uint8_t* block) {
+    float e[2][4];
+    FitEndpoints(pixels, e[0], e[1]);
+
+    Bc7Endpoints bestEndpoints{};
+    uint8_t      bestIndices[16]{};
+    uint32_t     bestError = std::numeric_limits<uint32_t>::max();
+    for (uint32_t iteration = 0; iteration < 2; iteration++) {
+        Bc7Endpoints endpoints{};
+        QuantizeEndpoint(e[0], endpoints.color[0], endpoints.pbit[0]);
+        QuantizeEndpoint(e[1], endpoints.color[1], endpoints.pbit[1]);
+        uint8_t  indices[16];
+        uint32_t error = SelectIndices(pixels, endpoints, indices);
+        if (error < bestError) {
+            bestError     = error;
+            bestEndpoints = endpoints;
+            std::copy_n(indices, 16, bestIndices);
+        }
+        if (error == 0 || !RefineEndpoints(pixels, indices, e[0], e[1]))
+            break;
+    }
+
+    //The msb of the anchor index is implicit zero
+    if (bestIndices[0] & 8) {
+        std::swap(bestEndpoints.color[0], bestEndpoints.color[1]);
+        std::swap(bestEndpoints.pbit[0], bestEndpoints.pbit[1]);
+        for (auto& index : bestIndices)
+            index = 15 - index;
+    }
+
+    std::fill_n(block, BC7_BLOCK_SIZE, 0);
+    uint32_t bitOffset = 0;
+    WriteBits(block, bitOffset, 1 << 6, 7);
+    for (uint32_t c = 0; c < 4; c++) {
+        WriteBits(block, bitOffset, bestEndpoints.color[0][c], 7);
+        WriteBits(block, bitOffset, bestEndpoints.color[1][c], 7);
+    }
+    WriteBits(block, bitOffset, bestEndpoints.pbit[0], 1);
+    WriteBits(block, bitOffset, bestEndpoints.pbit[1], 1);
+    for (uint32_t i = 0; i < 16; i++)
+        WriteBits(block, bitOffset, bestIndices[i], i == 0 ? 3 : 4);
+}
+
+void TextureCooker::compressBc7(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<uint8_t>& out) {
+    uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t   offset  = out.size();
+    out.resize(offset + size_t(blocksX) * blocksY * BC7_BLOCK_SIZE);
+    for (uint32_t by = 0; by < blocksY; by++)
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            //Blocks crossing the border repeat the last row and column
+            uint8_t block[16][4];
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+                uint32_t y = std::min(by * 4 + i / 4, height - 1);
+                std::copy_n(pixels + (y * width + x) * 4, 4, block[i]);
+            }
+            EncodeBlockBc7(block, out.data() + offset);
+            offset += BC7_BLOCK_SIZE;
+        }
+}
+
+static bool WriteDds(const std::string& path, uint32_t width, uint32_t height, uint32_t mipCount, const std::vector<uint8_t>& data) {
+    using namespace tinyddsloader;
+
+    DDSFile::Header header{};
+    header.m_size                      = sizeof(DDSFile::Header);
+    header.m_flags                     = uint32_t(DDSFile::HeaderFlagBits::Texture) | uint32_t(DDSFile::HeaderFlagBits::Mipmap) | uint32_t(DDSFile::HeaderFlagBits::LinearSize);
+    header.m_height                    = height;
+    header.m_width                     = width;
+    header.m_pitchOrLinerSize          = ((width + 3) / 4) * ((height + 3) / 4) * BC7_BLOCK_SIZE;
+    header.m_depth                     = 1;
+    header.m_mipMapCount               = mipCount;
+    header.m_pixelFormat.m_size        = sizeof(DDSFile::PixelFormat);
+    header.m_pixelFormat.m_flags       = uint32_t(DDSFile::PixelFormatFlagBits::FourCC);
+    header.m_pixelFormat.m_fourCC      = DDSFile::MakeFourCC('D', 'X', '1', '0');
+    header.m_caps                      = 0x1000 | 0x400000 | 0x8;//texture, mipmap, complex
+
+    DDSFile::HeaderDXT10 headerDxt10{};
+    headerDxt10.m_format            = DDSFile::DXGIFormat::BC7_UNorm_SRGB;
+    headerDxt10.m_resourceDimension = DDSFile::TextureDimension::Texture2D;
+    headerDxt10.m_arraySize         = 1;
+
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+
+    //Written aside and renamed so an interrupted cook never leaves a truncated file in the cache
+    auto tempPath = fmt::format("{}.{}.tmp", path, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file)
+            return false;
+        file.write(DDSFile::Magic, sizeof(DDSFile::Magic));
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&headerDxt10), sizeof(headerDxt10));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file)
+            return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool TextureCooker::canCook(const std::string& sourcePath) {
+    //Same sources as the stb path of SgImage, other formats already carry their own mips and format
+    auto ext = FileUtils::getFileExt(sourcePath);
+    return ext == "jpg" || ext == "png";
+}
+
+std::string TextureCooker::getCachePath(const std::string& sourcePath, uint32_t version, const std::string& extension) {
+    auto bytes = ReadFile(sourcePath);
+    if (bytes.empty())
+        return {};
+    uint64_t hash = 0xcbf29ce484222325ull;
+    HashBytes(hash, bytes.data(), bytes.size());
+    HashBytes(hash, &version, sizeof(version));
+    return FileUtils::getResourcePath(COOKED_TEXTURE_PATH + fmt::format("{:016x}.{}", hash, extension));
+}
+
+std::string TextureCooker::getCookedPath(const std::string& sourcePath) {
+    if (!enable || !canCook(sourcePath))
+        return {};
+
+    auto cookedPath = getCachePath(sourcePath, COOKER_VERSION, "dds");
+    if (cookedPath.empty())
+        return {};
+    if (FileUtils::fileExists(cookedPath))
+        return cookedPath;
+    return cook(sourcePath, cookedPath) ? cookedPath : std::string{};
+}
+
+bool TextureCooker::cook(const std::string& sourcePath, const std::string& cookedPath) {
+    int  width, height, comp;
+    auto rawData = stbi_load(sourcePath.c_str(), &width, &height, &comp, 4);
+    if (rawData == nullptr) {
+        LOGE("Failed to decode texture to cook: {}", sourcePath);
+        return false;
+    }
+    std::vector<uint8_t> level(rawData, rawData + width * height * 4);
+    stbi_image_free(rawData);
+
+    std::vector<uint8_t> data;
+    uint32_t             mipWidth = width, mipHeight = height, mipCount = 0;
+    while (true) {
+        compressBc7(level.data(), mipWidth, mipHeight, data);
+        mipCount++;
+        if (mipWidth == 1 && mipHeight == 1)
+            break;
+
+        uint32_t             nextWidth = std::max(1u, mipWidth / 2), nextHeight = std::max(1u, mipHeight / 2);
+        std::vector<uint8_t> next(size_t(nextWidth) * nextHeight * 4);
+        DownsampleSrgb(level.data(), mipWidth, mipHeight, next.data(), nextWidth, nextHeight);
+        level     = std::move(next);
+        mipWidth  = nextWidth;
+        mipHeight = nextHeight;
+    }
+
+    if (!WriteDds(cookedPath, width, height, mipCount, data)) {
+        LOGE("Failed to write cooked texture: {}", cookedPath);
+        return false;
+    }
+    LOGI("Cooked texture {} to {}", sourcePath, cookedPath);
+    return true;
+}
+
+void TextureCooker::setEnable(bool _enable) {
+    enable = _enable;
+}
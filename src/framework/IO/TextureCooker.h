@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Offline transcoding of ldr source images into mip complete BC7 dds files.
+ * Cooked files live in a content addressed cache keyed by the bytes of the source, an edited source is cooked again
+ * and a source referenced by several scenes is cooked once.
+ */
+class TextureCooker {
+public:
+    //Path of the cooked file of a source image, cooking it when it is not cached yet.
+    //Empty if the source can not be cooked, the caller then loads the source itself
+    static std::string getCookedPath(const std::string& sourcePath);
+    static bool        canCook(const std::string& sourcePath);
+    //Cache entry of a source for a given output version and extension, empty if the source can not be read
+    static std::string getCachePath(const std::string& sourcePath, uint32_t version, const std::string& extension);
+    //Decodes the source, builds its mip chain in linear space and writes it block compressed to cookedPath
+    static bool        cook(const std::string& sourcePath, const std::string& cookedPath);
+    //Appends the BC7 blocks of an rgba8 image to out, block rows past the image repeat its last row and column
+    static void        compressBc7(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<uint8_t>& out);
+
+    static void        setEnable(bool enable);
+    inline static bool enable{true};
+};
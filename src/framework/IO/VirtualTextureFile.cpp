@@ -0,0 +1,166 @@
+#include "VirtualTextureFile.h"
+
+#include "TextureCooker.h"
+#include "Common/FIleUtils.h"
+#include "Common/Log.h"
+#include "Scene/Images/MipMapGenerator.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+
+//Bump when the layout or the page content changes, every tiled file is then tiled again
+static constexpr uint32_t VT_FILE_VERSION  = 1;
+static constexpr char     VT_FILE_MAGIC[4] = {'Y', 'V', 'T', 'X'};
+
+static uint32_t WrapTexel(int64_t texel, uint32_t size) {
+    int64_t wrapped = texel % size;
+    return static_cast<uint32_t>(wrapped < 0 ? wrapped + size : wrapped);
+}
+
+static uint32_t PageCount(uint32_t texels) {
+    return (texels + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE;
+}
+
+bool VirtualTextureFile::isPageFormatSupported(VkFormat pageFormat) {
+    return pageFormat == VK_FORMAT_R8G8B8A8_SRGB || pageFormat == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+uint32_t VirtualTextureFile::getPageByteSize(VkFormat pageFormat) {
+    if (pageFormat == VK_FORMAT_BC7_SRGB_BLOCK)
+        return (VT_PHYSICAL_PAGE_SIZE / 4) * (VT_PHYSICAL_PAGE_SIZE / 4) * 16;
+    return VT_PHYSICAL_PAGE_SIZE * VT_PHYSICAL_PAGE_SIZE * 4;
+}
+
+std::string VirtualTextureFile::getTiledPath(const std::string& sourcePath, VkFormat pageFormat) {
+    if (!TextureCooker::canCook(sourcePath) || !isPageFormatSupported(pageFormat))
+        return {};
+
+    //Devices without block compression get their own rgba8 copy of the pages
+    auto tiledPath = TextureCooker::getCachePath(sourcePath, VT_FILE_VERSION, pageFormat == VK_FORMAT_BC7_SRGB_BLOCK ? "bc7.vtex" : "vtex");
+    if (tiledPath.empty())
+        return {};
+    if (FileUtils::fileExists(tiledPath))
+        return tiledPath;
+    return tile(sourcePath, tiledPath, pageFormat) ? tiledPath : std::string{};
+}
+
+bool VirtualTextureFile::tile(const std::string& sourcePath, const std::string& tiledPath, VkFormat pageFormat) {
+    int  width, height, comp;
+    auto rawData = stbi_load(sourcePath.c_str(), &width, &height, &comp, 4);
+    if (rawData == nullptr) {
+        LOGE("Failed to decode texture to tile: {}", sourcePath);
+        return false;
+    }
+    std::vector<uint8_t> level(rawData, rawData + size_t(width) * height * 4);
+    stbi_image_free(rawData);
+
+    Header header{};
+    std::copy_n(VT_FILE_MAGIC, 4, header.magic);
+    header.version    = VT_FILE_VERSION;
+    header.pageFormat = pageFormat;
+    header.width      = width;
+    header.height     = height;
+
+    //Layout of the levels first so pages are written as they are cut
+    std::vector<VirtualTextureLevel> levels;
+    VkExtent2D                       extent{header.width, header.height};
+    while (extent.width > VT_PAGE_SIZE || extent.height > VT_PAGE_SIZE) {
+        levels.push_back({extent.width, extent.height, PageCount(extent.width), PageCount(extent.height), header.pageCount});
+        header.pageCount += levels.back().pagesX * levels.back().pagesY;
+        extent = {std::max(1u, extent.width / 2), std::max(1u, extent.height / 2)};
+    }
+    header.levelCount = levels.size();
+    header.tailWidth  = extent.width;
+    header.tailHeight = extent.height;
+
+    std::filesystem::create_directories(std::filesystem::path(tiledPath).parent_path());
+
+    //Written aside and renamed so an interrupted tiling never leaves a truncated file in the cache
+    auto tempPath = fmt::format("{}.{}.tmp", tiledPath, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(VirtualTextureLevel));
+
+        std::vector<uint8_t> page(VT_PHYSICAL_PAGE_SIZE * VT_PHYSICAL_PAGE_SIZE * 4);
+        std::vector<uint8_t> compressed;
+        for (const auto& levelInfo : levels) {
+            for (uint32_t pageY = 0; pageY < levelInfo.pagesY; pageY++)
+                for (uint32_t pageX = 0; pageX < levelInfo.pagesX; pageX++) {
+                    for (uint32_t y = 0; y < VT_PHYSICAL_PAGE_SIZE; y++) {
+                        uint32_t       sourceY = WrapTexel(int64_t(pageY * VT_PAGE_SIZE + y) - VT_PAGE_BORDER, levelInfo.height);
+                        const uint8_t* row     = level.data() + size_t(sourceY) * levelInfo.width * 4;
+                        for (uint32_t x = 0; x < VT_PHYSICAL_PAGE_SIZE; x++) {
+                            uint32_t sourceX = WrapTexel(int64_t(pageX * VT_PAGE_SIZE + x) - VT_PAGE_BORDER, levelInfo.width);
+                            std::copy_n(row + sourceX * 4, 4, page.data() + (y * VT_PHYSICAL_PAGE_SIZE + x) * 4);
+                        }
+                    }
+                    if (pageFormat == VK_FORMAT_BC7_SRGB_BLOCK) {
+                        compressed.clear();
+                        TextureCooker::compressBc7(page.data(), VT_PHYSICAL_PAGE_SIZE, VT_PHYSICAL_PAGE_SIZE, compressed);
+                        file.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+                    } else
+                        file.write(reinterpret_cast<const char*>(page.data()), page.size());
+                }
+
+            VkExtent2D           nextExtent{std::max(1u, levelInfo.width / 2), std::max(1u, levelInfo.height / 2)};
+            std::vector<uint8_t> next(size_t(nextExtent.width) * nextExtent.height * 4);
+            MipMapGenerator::downsample(VK_FORMAT_R8G8B8A8_SRGB, level.data(), {levelInfo.width, levelInfo.height}, next.data(), nextExtent, 0, nextExtent.height);
+            level = std::move(next);
+        }
+
+        file.write(reinterpret_cast<const char*>(level.data()), level.size());
+        if (!file)
+            return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, tiledPath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        LOGE("Failed to write tiled texture: {}", tiledPath);
+        return false;
+    }
+    LOGI("Tiled texture {} to {}, {} pages", sourcePath, tiledPath, header.pageCount);
+    return true;
+}
+
+bool VirtualTextureFile::open(const std::string& path) {
+    file.open(path, std::ios::binary);
+    if (!file)
+        return false;
+    FileUtils::streamRead(file, header);
+    if (!file || !std::equal(header.magic, header.magic + 4, VT_FILE_MAGIC) || header.version != VT_FILE_VERSION || !isPageFormatSupported(getPageFormat())) {
+        LOGE("Invalid tiled texture: {}", path);
+        return false;
+    }
+    levels.resize(header.levelCount);
+    file.read(reinterpret_cast<char*>(levels.data()), levels.size() * sizeof(VirtualTextureLevel));
+    pageOffset = sizeof(Header) + levels.size() * sizeof(VirtualTextureLevel);
+    tailOffset = pageOffset + uint64_t(header.pageCount) * getPageByteSize(getPageFormat());
+    return static_cast<bool>(file);
+}
+
+bool VirtualTextureFile::readPage(uint32_t page, uint8_t* dst) {
+    uint32_t                    pageByteSize = getPageByteSize(getPageFormat());
+    std::lock_guard<std::mutex> lock(fileMutex);
+    file.clear();
+    file.seekg(pageOffset + uint64_t(page) * pageByteSize);
+    file.read(reinterpret_cast<char*>(dst), pageByteSize);
+    return static_cast<bool>(file);
+}
+
+std::vector<uint8_t> VirtualTextureFile::readTail() {
+    std::vector<uint8_t>        tail(size_t(header.tailWidth) * header.tailHeight * 4);
+    std::lock_guard<std::mutex> lock(fileMutex);
+    file.clear();
+    file.seekg(tailOffset);
+    file.read(reinterpret_cast<char*>(tail.data()), tail.size());
+    if (!file)
+        return {};
+    return tail;
+}
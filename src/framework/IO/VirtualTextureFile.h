@@ -0,0 +1,73 @@
+#pragma once
+
+#include <volk.h>
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Texels of a page, and of the border repeated around it so bilinear taps never cross into a neighbour page of the atlas
+static constexpr uint32_t VT_PAGE_SIZE          = 128;
+static constexpr uint32_t VT_PAGE_BORDER        = 4;
+static constexpr uint32_t VT_PHYSICAL_PAGE_SIZE = VT_PAGE_SIZE + 2 * VT_PAGE_BORDER;
+
+struct VirtualTextureLevel {
+    uint32_t width;
+    uint32_t height;
+    uint32_t pagesX;
+    uint32_t pagesY;
+    uint32_t firstPage;
+};
+
+/**
+ * Pre tiled texture streamed page by page by the virtual texturing.
+ * Every level larger than a page is cut in VT_PAGE_SIZE pages with a VT_PAGE_BORDER border taken with repeat addressing,
+ * pages are stored level major then row major at a fixed size so any page is a single read. The first level fitting in
+ * a page is the mip tail, stored as plain rgba8 and kept resident as a regular texture.
+ * Tiled files live in the same content addressed cache as the cooked textures.
+ */
+class VirtualTextureFile {
+public:
+    //Path of the tiled file of a source image in the page format, tiling it when it is not cached yet.
+    //Empty if the source can not be tiled
+    static std::string getTiledPath(const std::string& sourcePath, VkFormat pageFormat);
+    static bool        tile(const std::string& sourcePath, const std::string& tiledPath, VkFormat pageFormat);
+    //R8G8B8A8_SRGB, or BC7_SRGB when block compression is supported
+    static bool        isPageFormatSupported(VkFormat pageFormat);
+    static uint32_t    getPageByteSize(VkFormat pageFormat);
+
+    bool open(const std::string& path);
+    //Thread safe, dst holds getPageByteSize bytes
+    bool readPage(uint32_t page, uint8_t* dst);
+    //Level 0 of the mip tail, rgba8 srgb
+    std::vector<uint8_t> readTail();
+
+    VkFormat                                getPageFormat() const { return static_cast<VkFormat>(header.pageFormat); }
+    uint32_t                                getWidth() const { return header.width; }
+    uint32_t                                getHeight() const { return header.height; }
+    VkExtent3D                              getTailExtent() const { return {header.tailWidth, header.tailHeight, 1}; }
+    uint32_t                                getPageCount() const { return header.pageCount; }
+    const std::vector<VirtualTextureLevel>& getLevels() const { return levels; }
+
+protected:
+    struct Header {
+        char     magic[4];
+        uint32_t version;
+        uint32_t pageFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t pageCount;
+        uint32_t tailWidth;
+        uint32_t tailHeight;
+    };
+
+    Header                           header{};
+    std::vector<VirtualTextureLevel> levels;
+    std::ifstream                    file;
+    std::mutex                       fileMutex;
+    uint64_t                         tailOffset{0};
+    uint64_t                         pageOffset{0};
+};
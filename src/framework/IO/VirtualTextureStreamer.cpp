@@ -0,0 +1,78 @@
+#include "VirtualTextureStreamer.h"
+
+#include "Common/Log.h"
+
+#include <algorithm>
+
+//Pages read ahead of the uploads, bounds the memory of the queue when the render thread falls behind
+static constexpr uint32_t MAX_LOADED_PAGES = 128;
+
+VirtualTextureStreamer::VirtualTextureStreamer() {
+    thread = std::thread(&VirtualTextureStreamer::run, this);
+}
+
+VirtualTextureStreamer::~VirtualTextureStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+uint32_t VirtualTextureStreamer::addFile(std::unique_ptr<VirtualTextureFile> file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    files.emplace_back(std::move(file));
+    return files.size() - 1;
+}
+
+void VirtualTextureStreamer::request(std::vector<Request>&& requests) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingRequests = std::move(requests);
+        //Popped from the back
+        std::reverse(pendingRequests.begin(), pendingRequests.end());
+    }
+    condition.notify_one();
+}
+
+void VirtualTextureStreamer::collect(std::vector<LoadedPage>& pages, uint32_t maxCount) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!loadedPages.empty() && maxCount-- > 0) {
+            queuedPages.erase(loadedPages.front().page);
+            pages.emplace_back(std::move(loadedPages.front()));
+            loadedPages.pop_front();
+        }
+    }
+    condition.notify_one();
+}
+
+void VirtualTextureStreamer::run() {
+    while (true) {
+        Request             request;
+        VirtualTextureFile* file;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stop || (!pendingRequests.empty() && loadedPages.size() < MAX_LOADED_PAGES); });
+            if (stop)
+                return;
+            request = pendingRequests.back();
+            pendingRequests.pop_back();
+            if (!queuedPages.insert(request.page).second)
+                continue;
+            file = files[request.file].get();
+        }
+
+        LoadedPage loadedPage{request.page, std::vector<uint8_t>(VirtualTextureFile::getPageByteSize(file->getPageFormat()))};
+        if (!file->readPage(request.filePage, loadedPage.data.data())) {
+            LOGE("Failed to read virtual texture page {}", request.filePage);
+            std::lock_guard<std::mutex> lock(mutex);
+            queuedPages.erase(request.page);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        loadedPages.emplace_back(std::move(loadedPage));
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "VirtualTextureFile.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+
+/**
+ * Reads the pages requested by the virtual texture feedback on its own thread.
+ * Requests are replaced as a whole every frame so pages that went out of view are never read, loaded pages wait in a
+ * bounded queue until the render thread uploads them.
+ */
+class VirtualTextureStreamer {
+public:
+    struct Request {
+        //Page index in the page table, returned with the data
+        uint32_t page;
+        uint32_t file;
+        uint32_t filePage;
+    };
+
+    struct LoadedPage {
+        uint32_t             page;
+        std::vector<uint8_t> data;
+    };
+
+    VirtualTextureStreamer();
+    ~VirtualTextureStreamer();
+
+    uint32_t addFile(std::unique_ptr<VirtualTextureFile> file);
+    //Most important request first
+    void     request(std::vector<Request>&& requests);
+    //Moves at most maxCount loaded pages to pages
+    void     collect(std::vector<LoadedPage>& pages, uint32_t maxCount);
+
+private:
+    void run();
+
+    std::vector<std::unique_ptr<VirtualTextureFile>> files;
+    std::vector<Request>                             pendingRequests;
+    std::deque<LoadedPage>                           loadedPages;
+    //Pages loaded but not collected yet, requested again by the feedback until they are uploaded
+    std::unordered_set<uint32_t> queuedPages;
+
+    std::mutex              mutex;
+    std::condition_variable condition;
+    bool                    stop{false};
+    std::thread             thread;
+};
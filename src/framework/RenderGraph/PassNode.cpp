@@ -110,17 +110,21 @@ void GraphicsPassNode::execute(RenderGraph& renderGraph, CommandBuffer& commandB
 
     auto hwTextures = renderTarget.getHwTextures();
     g_context->getPipelineState().setPipelineType(PIPELINE_TYPE::E_GRAPHICS);
-    g_context->beginRenderPass(commandBuffer, renderTarget, subpassInfos);
 
-    RenderPassContext context = {
-        .commandBuffer = commandBuffer, .renderGraph = renderGraph};
+    //Single subpass passes are recorded into secondary command buffers so large draw lists can be split across threads
+    bool parallel = g_context->getParallelRecording() && subpassInfos.size() == 1;
 
     auto passName = getPassName("Render Pass", getName());
-    DebugUtils::CmdBeginLabel(context.commandBuffer.getHandle(), passName, {1, 0, 0, 1});
+    DebugUtils::CmdBeginLabel(commandBuffer.getHandle(), passName, {1, 0, 0, 1});
+    g_context->beginRenderPass(commandBuffer, renderTarget, subpassInfos, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+    RenderPassContext context = {
+        .commandBuffer = parallel ? g_context->getParallelCommandRecorder().getCommandBuffer() : commandBuffer, .renderGraph = renderGraph};
+
     mRenderPass->execute(context);
-    DebugUtils::CmdEndLabel(context.commandBuffer.getHandle());
 
     g_context->endRenderPass(commandBuffer, renderTarget);
+    DebugUtils::CmdEndLabel(commandBuffer.getHandle());
     g_context->clearPassResources();
 }
 
@@ -143,39 +147,6 @@ PassNode::PassNode(const std::string& passName) {
     setName(passName);
 }
 
-void PassNode::resolveResourceUsages(RenderGraph& renderGraph, CommandBuffer& commandBuffer) {
-    ResourceBarrierInfo barrierInfo;
-    for (auto& resourceIt : mResourceUsage) {
-        auto  resource     = renderGraph.getResource(resourceIt.first);
-        auto& stateTracker = renderGraph.getResourceStateTracker();
-
-        auto state = stateTracker.getResourceState(resourceIt.first);
-
-        unsigned short srcUsage;
-        RenderPassType srcState{UNDEFINED};
-
-        if (std::get<0>(state) == nullptr) {
-            //srcState = getType();
-            srcUsage = resource->getDefaultUsage(resourceIt.second);
-        } else {
-            srcState = std::get<0>(state)->getType();
-            srcUsage = std::get<1>(state);
-        }
-        stateTracker.setResourceState(resourceIt.first, this, resourceIt.second);
-        resource->resloveUsage(barrierInfo, srcUsage, resourceIt.second, srcState, getType());
-    }
-    VkDependencyInfo dependencyInfo{};
-    dependencyInfo.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-    dependencyInfo.bufferMemoryBarrierCount = barrierInfo.bufferBarriers.size();
-    dependencyInfo.imageMemoryBarrierCount  = barrierInfo.imageBarriers.size();
-    dependencyInfo.memoryBarrierCount       = barrierInfo.memoryBarriers.size();
-    dependencyInfo.pBufferMemoryBarriers    = barrierInfo.bufferBarriers.data();
-    dependencyInfo.pImageMemoryBarriers     = barrierInfo.imageBarriers.data();
-    dependencyInfo.pMemoryBarriers          = barrierInfo.memoryBarriers.data();
-    
-        vkCmdPipelineBarrier2(commandBuffer.getHandle(), &dependencyInfo);
-}
-
 void PassNode::addResourceUsage(RenderGraphHandle handle, uint16_t usage) {
     if (mResourceUsage.contains(handle))
         mResourceUsage[handle] |= usage;
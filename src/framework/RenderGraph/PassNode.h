@@ -52,11 +52,12 @@ class PassNode : public RenderGraphNode {
 public:
     PassNode(const std::string& passName);
     ~PassNode() override = default;
-    void resolveResourceUsages(RenderGraph& renderGraph, CommandBuffer& commandBuffer);
     void addResourceUsage(RenderGraphHandle handle, uint16_t usage);
     bool active() { return mActive & getRefCount() > 0; }
     void setActive(bool active) { mActive = active; }
+    bool getActive() const { return mActive; }
     uint16_t getResourceUsage(RenderGraphHandle handle) const;
+    const std::unordered_map<RenderGraphHandle, uint16_t, RenderGraphHandle::Hash>& getResourceUsages() const { return mResourceUsage; }
     virtual void                   execute(RenderGraph& renderGraph, CommandBuffer& commandBuffer) = 0;
     virtual RenderPassType getType() const { return RenderPassType::UNDEFINED; }
 
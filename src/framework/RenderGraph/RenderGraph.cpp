@@ -2,9 +2,16 @@
 #include "Core/CommandBuffer.h"
 #include "Core/Pipeline.h"
 #include "Core/Texture.h"
+#include "Core/ResourceCachingHelper.h"
+#include "Core/RenderContext.h"
+#include "Core/Images/ImageUtil.h"
+#include "Common/ResourceCache.h"
+#include "Common/Timer.h"
 #include "Scene/SceneLoader/gltfloader.h"
 
+#include <format>
 #include <stack>
+#include <unordered_set>
 
 // void RenderGraph::Builder::read(VirtualResource* resource, PassNode* node)
 // {
@@ -192,6 +199,24 @@ bool RenderGraph::getCutUnUsedResources() const {
 void RenderGraph::setCutUnUsedResources(const bool cut_un_used_resources) {
     cutUnUsedResources = cut_un_used_resources;
 }
+bool RenderGraph::getSplitBarriers() const {
+    return splitBarriers;
+}
+void RenderGraph::setSplitBarriers(const bool split_barriers) {
+    splitBarriers = split_barriers;
+}
+bool RenderGraph::getAsyncCompute() const {
+    return asyncCompute;
+}
+void RenderGraph::setAsyncCompute(const bool async_compute) {
+    asyncCompute = async_compute;
+}
+bool RenderGraph::getAliasTransientResources() const {
+    return aliasTransientResources;
+}
+void RenderGraph::setAliasTransientResources(const bool alias_transient_resources) {
+    aliasTransientResources = alias_transient_resources;
+}
 RenderGraphHandle RenderGraph::addTexture(RenderGraphTexture* texture) {
     if (mBlackBoard->contains(texture->getName())) {
         LOGE("Texture with name %s already exists in render graph", texture->getName());
@@ -271,8 +296,71 @@ void RenderGraph::setOutput(RenderGraphHandle resource) {
     getResource(resource)->addRef();
 }
 
-void RenderGraph::compile() {
-    //first cull Graph
+//Compiled graphs are keyed by graph structure. RenderGraph is rebuilt every frame, so the cache lives outside of it.
+static constexpr uint32_t MAX_CACHED_GRAPH_COUNT = 32;
+static std::unordered_map<RenderGraphStructureKey, CompiledRenderGraph, RenderGraphStructureKey::Hash> sCompiledGraphs;
+
+static RenderGraphCompileStats sCompileStats;
+static RenderGraphBarrierStats sBarrierStats;
+static bool                    sDumpBarrierPlan = false;
+
+size_t RenderGraphStructureKey::Hash::operator()(const RenderGraphStructureKey& key) const {
+    size_t hash = 0;
+    hash_combine(hash, key.cutUnUsedResources);
+    hash_combine(hash, key.aliasTransientResources);
+    hash_combine(hash, key.splitBarriers);
+    hash_combine(hash, key.asyncCompute);
+    hash_combine(hash, key.passes.size());
+    for (const auto& pass : key.passes) {
+        hash_combine(hash, pass.name);
+        hash_combine(hash, static_cast<uint8_t>(pass.type));
+        hash_combine(hash, pass.active);
+        hash_combine(hash, pass.refCount);
+    }
+    hash_combine(hash, key.resources.size());
+    for (const auto& resource : key.resources) {
+        hash_combine(hash, resource.name);
+        hash_combine(hash, static_cast<uint8_t>(resource.type));
+        hash_combine(hash, resource.refCount);
+        hash_combine(hash, resource.descriptor.size);
+        hash_combine(hash, resource.descriptor.format);
+        hash_combine(hash, resource.descriptor.usage);
+        hash_combine(hash, resource.descriptor.memoryUsage);
+        hash_combine(hash, resource.descriptor.transient);
+    }
+    hash_combine(hash, key.edges.size());
+    for (const auto& edge : key.edges) {
+        hash_combine(hash, edge.pass);
+        hash_combine(hash, edge.resource);
+        hash_combine(hash, edge.usage);
+        hash_combine(hash, edge.read);
+    }
+    return hash;
+}
+
+RenderGraphStructureKey RenderGraph::getStructureKey() const {
+    std::unordered_map<const PassNode*, uint32_t> passIndices;
+    for (uint32_t i = 0; i < mPassNodes.size(); i++)
+        passIndices[mPassNodes[i]] = i;
+
+    RenderGraphStructureKey key{.cutUnUsedResources      = cutUnUsedResources,
+                                .aliasTransientResources = aliasTransientResources,
+                                .splitBarriers           = splitBarriers,
+                                .asyncCompute            = asyncCompute && g_context && g_context->supportAsyncCompute()};
+    key.passes.reserve(mPassNodes.size());
+    for (const auto& passNode : mPassNodes)
+        key.passes.push_back({passNode->getName(), passNode->getType(), passNode->getActive(), passNode->getRefCount()});
+    key.resources.reserve(mResources.size());
+    for (const auto& resource : mResources)
+        key.resources.push_back({resource->getName(), resource->getType(), resource->getRefCount(), resource->getDescriptorKey()});
+    key.edges.reserve(edges.size());
+    for (const auto& edge : edges)
+        key.edges.push_back({passIndices.at(edge.pass), edge.resource->handle.index, edge.usage, edge.read});
+    return key;
+}
+
+void RenderGraph::cullAndSortPasses(CompiledRenderGraph& compiled) {
+    const std::vector<PassNode*> passNodes = mPassNodes;
 
     for (auto edge : edges) {
         if (edge.read)
@@ -307,45 +395,301 @@ void RenderGraph::compile() {
         LOGI("Pass {0} is not active", (*pass)->getName())
     }
 
-    auto       first = mPassNodes.begin();
-    const auto last  = mActivePassNodesEnd;
-    while (first != last) {
-        PassNode* const passNode = *first;
-        first++;
-        auto inResources  = getInComingNodes(passNode);
-        auto outResources = getOutComingNodes(passNode);
-
-        for (const auto inResource : inResources) {
-            const auto resource = dynamic_cast<ResourceNode*>(inResource);
-            assert(resource);
-            resource->first = resource->first ? resource->first : passNode;
-            resource->last  = passNode;
-            //   passNode->addTextureUsage(static_cast<const RenderGraphTexture*>(inResource), );
+    std::unordered_map<const PassNode*, std::vector<const Edge*>> passEdges;
+    for (const auto& edge : edges)
+        passEdges[edge.pass].push_back(&edge);
+
+    for (auto pass = mPassNodes.begin(); pass != mActivePassNodesEnd; pass++) {
+        PassNode* const passNode = *pass;
+        for (const auto edge : passEdges[passNode]) {
+            const auto resource = edge->resource;
+            resource->first     = resource->first ? resource->first : passNode;
+            resource->last      = passNode;
         }
-        for (const auto outResource : outResources) {
-            const auto resource = dynamic_cast<ResourceNode*>(outResource);
-            assert(resource);
-            resource->first = resource->first ? resource->first : passNode;
-            resource->last  = passNode;
-            //passNode->addTextureUsage(static_cast<const RenderGraphTexture*>(inResource), texture->usage);
+    }
+
+    std::unordered_map<const PassNode*, int32_t> passIndices;
+    for (uint32_t i = 0; i < passNodes.size(); i++)
+        passIndices[passNodes[i]] = i;
+
+    compiled.activePassCount = mActivePassNodesEnd - mPassNodes.begin();
+    for (const auto& passNode : mPassNodes)
+        compiled.passOrder.push_back(passIndices[passNode]);
+    for (const auto& passNode : passNodes)
+        compiled.passRefCounts.push_back(passNode->getRefCount());
+    for (const auto& resource : mResources) {
+        compiled.resourceRefCounts.push_back(resource->getRefCount());
+        compiled.resourceFirstPass.push_back(resource->first ? passIndices[resource->first] : -1);
+        compiled.resourceLastPass.push_back(resource->last ? passIndices[resource->last] : -1);
+    }
+}
+
+void RenderGraph::storeCompiledGraph(CompiledRenderGraph& compiled) const {
+    std::unordered_map<const ResourceNode*, uint32_t> resourceIndices;
+    for (uint32_t i = 0; i < mResources.size(); i++) {
+        resourceIndices[mResources[i]] = i;
+        compiled.resourcePoolSlots.push_back(mResources[i]->poolSlot);
+    }
+
+    compiled.asyncComputePasses  = mAsyncComputePasses;
+    compiled.barrierPlan         = mBarrierPlan;
+    compiled.queueAcquires       = mQueueAcquires;
+    compiled.queueReturns        = mQueueReturns;
+    compiled.skippedBarrierCount = skippedBarrierCount;
+    for (auto pass = mPassNodes.begin(); pass != mActivePassNodesEnd; pass++) {
+        auto& devirtualize = compiled.passDevirtualize.emplace_back();
+        for (const auto& resource : (*pass)->devirtualize)
+            devirtualize.push_back(resourceIndices[resource]);
+        auto& destroy = compiled.passDestroy.emplace_back();
+        for (const auto& resource : (*pass)->destroy)
+            destroy.push_back(resourceIndices[resource]);
+    }
+}
+
+void RenderGraph::applyCompiledGraph(const CompiledRenderGraph& compiled) {
+    const std::vector<PassNode*> passNodes = mPassNodes;
+
+    for (uint32_t i = 0; i < passNodes.size(); i++)
+        passNodes[i]->refCount = compiled.passRefCounts[i];
+    for (uint32_t i = 0; i < mResources.size(); i++) {
+        const auto resource = mResources[i];
+        resource->refCount  = compiled.resourceRefCounts[i];
+        resource->first     = compiled.resourceFirstPass[i] >= 0 ? passNodes[compiled.resourceFirstPass[i]] : nullptr;
+        resource->last      = compiled.resourceLastPass[i] >= 0 ? passNodes[compiled.resourceLastPass[i]] : nullptr;
+    }
+    for (uint32_t i = 0; i < compiled.passOrder.size(); i++)
+        mPassNodes[i] = passNodes[compiled.passOrder[i]];
+    mActivePassNodesEnd = mPassNodes.begin() + compiled.activePassCount;
+
+    for (uint32_t i = 0; i < mResources.size(); i++)
+        mResources[i]->poolSlot = compiled.resourcePoolSlots[i];
+
+    mAsyncComputePasses = compiled.asyncComputePasses;
+    mBarrierPlan        = compiled.barrierPlan;
+    mQueueAcquires      = compiled.queueAcquires;
+    mQueueReturns       = compiled.queueReturns;
+    skippedBarrierCount = compiled.skippedBarrierCount;
+    for (uint32_t i = 0; i < compiled.activePassCount; i++) {
+        for (const auto resource : compiled.passDevirtualize[i])
+            mPassNodes[i]->devirtualize.push_back(mResources[resource]);
+        for (const auto resource : compiled.passDestroy[i])
+            mPassNodes[i]->destroy.push_back(mResources[resource]);
+    }
+}
+
+void RenderGraph::assignTransientSlots() {
+    std::unordered_map<const PassNode*, uint32_t> passOrder;
+    for (auto pass = mPassNodes.begin(); pass != mActivePassNodesEnd; pass++)
+        passOrder[*pass] = pass - mPassNodes.begin();
+
+    std::vector<ResourceNode*> transientResources;
+    for (const auto& resource : mResources) {
+        if (resource->first && !needToCutResource(resource) && resource->isTransient())
+            transientResources.push_back(resource);
+    }
+    std::ranges::sort(transientResources, [&](const ResourceNode* a, const ResourceNode* b) {
+        return passOrder[a->first] < passOrder[b->first];
+    });
+
+    //For each resource description, the last pass index using each pooled slot
+    std::unordered_map<size_t, std::vector<uint32_t>> slotLastPass;
+    for (const auto& resource : transientResources) {
+        auto&      slots     = slotLastPass[resource->getPoolKey()];
+        const auto firstPass = passOrder[resource->first];
+        const auto lastPass  = passOrder[resource->last];
+
+        //pass order does not describe execution order across queues,resources of async compute passes get their own slot
+        if (mAsyncComputePasses[firstPass]) {
+            resource->poolSlot = slots.size();
+            slots.push_back(UINT32_MAX);
+            continue;
         }
 
-        for (const auto edge : getEdges(passNode)) {
-            passNode->addResourceUsage(edge->resource->handle, edge->usage);
+        auto slot = std::ranges::find_if(slots, [firstPass](uint32_t slotLast) { return slotLast < firstPass; });
+        if (slot == slots.end())
+            slot = slots.insert(slots.end(), lastPass);
+        else
+            *slot = lastPass;
+        resource->poolSlot = slot - slots.begin();
+    }
+}
+
+void RenderGraph::assignAsyncComputePasses() {
+    const uint32_t activePassCount = mActivePassNodesEnd - mPassNodes.begin();
+    mAsyncComputePasses.assign(activePassCount, false);
+    if (!asyncCompute || !g_context || !g_context->supportAsyncCompute())
+        return;
+
+    //A compute pass leaves the graphics queue when no resource it uses was touched by a graphics queue pass before it.
+    //Transient content is discarded on first use, imported and persistent content is released by the graphics queue
+    //before the graph and handed back after it, results flowing back to the graphics queue within the graph are transferred too.
+    std::unordered_set<RenderGraphHandle, RenderGraphHandle::Hash> graphicsQueueResources;
+    for (uint32_t passIndex = 0; passIndex < activePassCount; passIndex++) {
+        const auto  pass   = mPassNodes[passIndex];
+        const auto& usages = pass->getResourceUsages();
+        const bool  async  = pass->getType() == RenderPassType::COMPUTE && !usages.empty() &&
+                            std::ranges::none_of(usages, [&](const auto& usage) { return graphicsQueueResources.contains(usage.first); });
+        mAsyncComputePasses[passIndex] = async;
+        if (!async) {
+            for (const auto& [handle, usage] : usages)
+                graphicsQueueResources.insert(handle);
         }
     }
+}
 
-    for (const auto& resource : mResources) {
-        if (!needToCutResource(resource)) {
-            if (resource->first)
-                resource->first->devirtualize.push_back(resource);
-            if (resource->last)
-                resource->last->destroy.push_back(resource);
-        } else {
-            auto incoming  = getInComingNodes(resource);
-            auto outComing = getOutComingNodes(resource);
-            LOGI("Resource {0} is not used", resource->getName());
+void RenderGraph::buildBarrierPlan() {
+    const uint32_t activePassCount = mActivePassNodesEnd - mPassNodes.begin();
+    mBarrierPlan.assign(activePassCount, {});
+    mQueueAcquires.clear();
+    mQueueReturns.clear();
+    skippedBarrierCount = 0;
+
+    struct LastUse {
+        uint32_t       pass;
+        uint16_t       usage;
+        RenderPassType barrierPassType;// pass type the last issued barrier made the resource visible to
+    };
+    std::unordered_map<RenderGraphHandle, LastUse, RenderGraphHandle::Hash> lastUses;
+
+    for (uint32_t passIndex = 0; passIndex < activePassCount; passIndex++) {
+        const auto pass = mPassNodes[passIndex];
+        for (const auto& [handle, usage] : pass->getResourceUsages()) {
+            BarrierPlanEntry entry{.handle = handle, .dstUsage = usage, .dstPassType = pass->getType(), .consumer = passIndex};
+
+            auto lastUse = lastUses.find(handle);
+            if (lastUse == lastUses.end()) {
+                entry.external = true;
+                if (mAsyncComputePasses[passIndex] && !getResource(handle)->isTransient()) {
+                    mQueueAcquires.push_back(entry);
+                } else {
+                    mBarrierPlan[passIndex].barriers.push_back(entry);
+                }
+                lastUses[handle] = {passIndex, usage, pass->getType()};
+                continue;
+            }
+
+            auto& last        = lastUse->second;
+            entry.srcUsage    = last.usage;
+            entry.srcPassType = mPassNodes[last.pass]->getType();
+
+            if (mAsyncComputePasses[last.pass] != mAsyncComputePasses[passIndex]) {
+                //async compute result consumed on the graphics queue,released after the last async use and acquired by this pass
+                entry.queueTransfer = true;
+                mBarrierPlan[last.pass].queueReleases.push_back(entry);
+                mBarrierPlan[passIndex].barriers.push_back(entry);
+                last = {passIndex, usage, pass->getType()};
+                continue;
+            }
+
+            const auto resource = getResource(handle);
+            if (last.usage == usage && resource->isReadOnlyUsage(usage) && last.barrierPassType == pass->getType()) {
+                //read after read in the same layout,the previous barrier already made the data visible to this stage
+                last.pass = passIndex;
+                skippedBarrierCount++;
+                continue;
+            }
+
+            if (splitBarriers && passIndex - last.pass > 1) {
+                auto& producerPlan = mBarrierPlan[last.pass];
+                if (!producerPlan.splitBarriers.contains(passIndex))
+                    mBarrierPlan[passIndex].waitProducers.push_back(last.pass);
+                producerPlan.splitBarriers[passIndex].push_back(entry);
+            } else {
+                mBarrierPlan[passIndex].barriers.push_back(entry);
+            }
+            last = {passIndex, usage, pass->getType()};
+        }
+    }
+
+    for (const auto& [handle, last] : lastUses) {
+        if (mAsyncComputePasses[last.pass] && !getResource(handle)->isTransient())
+            mQueueReturns.push_back({.handle = handle, .consumer = last.pass});
+    }
+}
+
+std::string RenderGraph::getBarrierPlanDump() const {
+    std::string dump  = "RenderGraph barrier plan:\n";
+    uint32_t    count = 0;
+    for (const auto& entry : mQueueAcquires) {
+        dump += std::format("queue acquire {} {:#x} for [{}] {}\n", getResource(entry.handle)->getName(), entry.dstUsage, entry.consumer, mPassNodes[entry.consumer]->getName());
+        count++;
+    }
+    for (uint32_t passIndex = 0; passIndex < mBarrierPlan.size(); passIndex++) {
+        const auto& plan = mBarrierPlan[passIndex];
+        dump += std::format("[{}] {}{}\n", passIndex, mPassNodes[passIndex]->getName(), mAsyncComputePasses[passIndex] ? " (async compute)" : "");
+        for (const auto producer : plan.waitProducers)
+            dump += std::format("    wait event from [{}] {}\n", producer, mPassNodes[producer]->getName());
+        for (const auto& entry : plan.barriers) {
+            dump += std::format("    barrier {} {:#x} -> {:#x}{}{}\n", getResource(entry.handle)->getName(), entry.srcUsage, entry.dstUsage, entry.external ? " (external)" : "", entry.queueTransfer ? " (queue acquire)" : "");
+            count++;
+        }
+        for (const auto& entry : plan.queueReleases) {
+            dump += std::format("    queue release {} {:#x} -> {:#x} for [{}] {}\n", getResource(entry.handle)->getName(), entry.srcUsage, entry.dstUsage, entry.consumer, mPassNodes[entry.consumer]->getName());
+            count++;
         }
+        for (const auto& [consumer, entries] : plan.splitBarriers) {
+            for (const auto& entry : entries) {
+                dump += std::format("    split barrier {} {:#x} -> {:#x} for [{}] {}\n", getResource(entry.handle)->getName(), entry.srcUsage, entry.dstUsage, consumer, mPassNodes[consumer]->getName());
+                count++;
+            }
+        }
+    }
+    for (const auto& entry : mQueueReturns) {
+        dump += std::format("queue return {} after [{}] {}\n", getResource(entry.handle)->getName(), entry.consumer, mPassNodes[entry.consumer]->getName());
+        count++;
+    }
+    dump += std::format("{} barriers in {} passes", count, mBarrierPlan.size());
+    return dump;
+}
+
+void RenderGraph::compile() {
+    Timer compileTimer;
+    compileTimer.start();
+
+    auto         key      = getStructureKey();
+    const size_t hash     = RenderGraphStructureKey::Hash{}(key);
+    const auto   cached   = sCompiledGraphs.find(key);
+    const bool   cacheHit = cached != sCompiledGraphs.end();
+
+    CompiledRenderGraph compiledGraph;
+    if (cacheHit)
+        applyCompiledGraph(cached->second);
+    else
+        cullAndSortPasses(compiledGraph);
+
+    for (const auto& edge : edges) {
+        if (edge.pass->active())
+            edge.pass->addResourceUsage(edge.resource->handle, edge.usage);
+    }
+
+    if (!cacheHit) {
+        assignAsyncComputePasses();
+
+        if (aliasTransientResources)
+            assignTransientSlots();
+
+        buildBarrierPlan();
+
+        for (const auto& resource : mResources) {
+            if (!needToCutResource(resource)) {
+                if (resource->first)
+                    resource->first->devirtualize.push_back(resource);
+                if (resource->last)
+                    resource->last->destroy.push_back(resource);
+            } else {
+                LOGI("Resource {0} is not used", resource->getName());
+            }
+        }
+
+        if (sCompiledGraphs.size() >= MAX_CACHED_GRAPH_COUNT)
+            sCompiledGraphs.clear();
+        storeCompiledGraph(compiledGraph);
+        sCompiledGraphs.emplace(std::move(key), std::move(compiledGraph));
+    }
+
+    if (sDumpBarrierPlan) {
+        LOGI("{}", getBarrierPlanDump());
+        sDumpBarrierPlan = false;
     }
 
     for (const auto& edge : edges) {
@@ -356,7 +700,31 @@ void RenderGraph::compile() {
         if (needToCutResource(node))
             node->destroy();
     }
+
+    compiled = true;
+
+    sCompileStats.cacheHit         = cacheHit;
+    sCompileStats.hash             = hash;
+    sCompileStats.cachedGraphCount = sCompiledGraphs.size();
+    sCompileStats.compileTime      = compileTimer.stop<Timer::Milliseconds>();
+}
+
+const RenderGraphCompileStats& RenderGraph::getCompileStats() {
+    return sCompileStats;
+}
+
+void RenderGraph::clearCompileCache() {
+    sCompiledGraphs.clear();
+}
+
+const RenderGraphBarrierStats& RenderGraph::getBarrierStats() {
+    return sBarrierStats;
+}
+
+void RenderGraph::requestBarrierPlanDump() {
+    sDumpBarrierPlan = true;
 }
+
 void RenderGraph::clearPass() {
     for (const auto& passNode : mPassNodes)
         passNode->setActive(false);
@@ -387,47 +755,316 @@ bool RenderGraph::needToCutResource(ResourceNode* resourceNode) const {
     return resourceNode->getRefCount() == 0 && cutUnUsedResources;
 }
 
+void RenderGraph::resolveBarrier(const BarrierPlanEntry& entry, ResourceBarrierInfo& barrierInfo, bool queueRelease) {
+    const auto resource = getResource(entry.handle);
+
+    auto srcUsage    = entry.srcUsage;
+    auto srcPassType = entry.srcPassType;
+    if (entry.external) {
+        srcUsage    = resource->getDefaultUsage(entry.dstUsage);
+        srcPassType = RenderPassType::UNDEFINED;
+    }
+    resourceStateTracker.setResourceState(entry.handle, mPassNodes[entry.consumer], entry.dstUsage);
+
+    const auto imageBegin  = barrierInfo.imageBarriers.size();
+    const auto bufferBegin = barrierInfo.bufferBarriers.size();
+    resource->resloveUsage(barrierInfo, srcUsage, entry.dstUsage, srcPassType, entry.dstPassType);
+
+    auto patchBarriers = [&](auto&& patch) {
+        for (auto i = imageBegin; i < barrierInfo.imageBarriers.size(); i++)
+            patch(barrierInfo.imageBarriers[i]);
+        for (auto i = bufferBegin; i < barrierInfo.bufferBarriers.size(); i++)
+            patch(barrierInfo.bufferBarriers[i]);
+    };
+
+    if (entry.external && mAsyncComputePasses[entry.consumer] && resource->isTransient()) {
+        //first use on the async compute queue discards the content,so no ownership transfer from the graphics queue is needed
+        patchBarriers([](auto& barrier) {
+            barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+            barrier.srcAccessMask = VK_ACCESS_2_NONE;
+        });
+        for (auto i = imageBegin; i < barrierInfo.imageBarriers.size(); i++)
+            barrierInfo.imageBarriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    if (entry.queueTransfer) {
+        //release and acquire carry the same layout transition,the release only keeps the source scope and the acquire the destination scope
+        const auto computeFamily  = device.getAsyncComputeQueue()->getFamilyIndex();
+        const auto graphicsFamily = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0).getFamilyIndex();
+        patchBarriers([&](auto& barrier) {
+            barrier.srcQueueFamilyIndex = computeFamily;
+            barrier.dstQueueFamilyIndex = graphicsFamily;
+            if (queueRelease) {
+                barrier.dstStageMask  = VK_PIPELINE_STAGE_2_NONE;
+                barrier.dstAccessMask = VK_ACCESS_2_NONE;
+            } else {
+                barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+                barrier.srcAccessMask = VK_ACCESS_2_NONE;
+            }
+        });
+    }
+}
+
+//Hands a pooled hardware resource over from the transient released before to the transient using it first, for the
+//barriers from begin on. A release still pending in the same batch is folded into the first use barrier, two transitions
+//of one subresource in a batch have no order. An issued release is chained through its destination scope instead
+template<typename Barrier, typename Handle>
+static void ChainAliasHandoffs(std::vector<Barrier>& barriers, size_t& pendingReleaseCount, size_t begin, Handle Barrier::*handle, std::unordered_map<Handle, Barrier>& releases) {
+    for (size_t i = begin; i < barriers.size(); i++) {
+        auto release = releases.find(barriers[i].*handle);
+        if (release == releases.end())
+            continue;
+        auto pendingEnd = barriers.begin() + pendingReleaseCount;
+        auto pending    = std::find_if(barriers.begin(), pendingEnd, [&](const Barrier& barrier) { return barrier.*handle == barriers[i].*handle; });
+        if (pending != pendingEnd) {
+            barriers[i].srcStageMask  = pending->srcStageMask;
+            barriers[i].srcAccessMask = pending->srcAccessMask;
+            if constexpr (std::is_same_v<Barrier, VkImageMemoryBarrier2>)
+                barriers[i].oldLayout = pending->oldLayout;
+            barriers.erase(pending);
+            pendingReleaseCount--;
+            i--;
+        } else {
+            barriers[i].srcStageMask  = release->second.dstStageMask;
+            barriers[i].srcAccessMask = release->second.dstAccessMask;
+        }
+        releases.erase(release);
+    }
+}
+
+//Turns the transitions in releaseInfo into queue ownership releases keeping the source scope and returns the matching
+//acquires keeping the destination scope, the acquires are ordered by the semaphore wait of their submission
+static ResourceBarrierInfo SplitQueueTransfer(ResourceBarrierInfo& releaseInfo, uint32_t srcQueueFamily, uint32_t dstQueueFamily) {
+    auto setQueueFamilies = [&](auto& barrier) {
+        barrier.srcQueueFamilyIndex = srcQueueFamily;
+        barrier.dstQueueFamilyIndex = dstQueueFamily;
+    };
+    std::ranges::for_each(releaseInfo.imageBarriers, setQueueFamilies);
+    std::ranges::for_each(releaseInfo.bufferBarriers, setQueueFamilies);
+
+    auto keepSrcScope = [](auto& barrier) {
+        barrier.dstStageMask  = VK_PIPELINE_STAGE_2_NONE;
+        barrier.dstAccessMask = VK_ACCESS_2_NONE;
+    };
+    auto keepDstScope = [](auto& barrier) {
+        barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+        barrier.srcAccessMask = VK_ACCESS_2_NONE;
+    };
+    ResourceBarrierInfo acquireInfo = releaseInfo;
+    std::ranges::for_each(releaseInfo.imageBarriers, keepSrcScope);
+    std::ranges::for_each(releaseInfo.bufferBarriers, keepSrcScope);
+    std::ranges::for_each(acquireInfo.imageBarriers, keepDstScope);
+    std::ranges::for_each(acquireInfo.bufferBarriers, keepDstScope);
+    return acquireInfo;
+}
+
+void RenderGraph::issueBarriers(CommandBuffer& commandBuffer, ResourceBarrierInfo& barrierInfo) {
+    if (barrierInfo.empty())
+        return;
+    sBarrierStats.barrierBatches++;
+    sBarrierStats.imageBarriers += barrierInfo.imageBarriers.size();
+    sBarrierStats.bufferBarriers += barrierInfo.bufferBarriers.size();
+
+    auto dependencyInfo = barrierInfo.GetVkDependencyInfo();
+    vkCmdPipelineBarrier2(commandBuffer.getHandle(), &dependencyInfo);
+    barrierInfo = {};
+}
+
 void RenderGraph::execute(CommandBuffer& commandBuffer) {
 
     // DebugUtils::CmdInsertLabel(commandBuffer, "RenderGraph")
 
-    //todo handle compile
-    compile();
+    if (!compiled)
+        compile();
+
+    sBarrierStats = {.skippedBarriers = skippedBarrierCount};
 
-    auto first = mPassNodes.begin();
-    while (first != mActivePassNodesEnd) {
+    auto& transientResourcePool = ResourceCache::getResourceCache().getTransientResourcePool();
+    auto& profiler              = g_context->getGpuProfiler();
 
-        const auto pass = *first;
+    //Async compute passes are recorded into their own command buffer,submitted after the graph
+    CommandBuffer*                          computeCommandBuffer  = nullptr;
+    uint64_t                                graphicsTimelineValue = 0;
+    std::unordered_set<const ResourceNode*> devirtualized;
+    ResourceBarrierInfo                     queueAcquireInfo;
+    ResourceBarrierInfo                     queueReturnInfo;
+    uint32_t                                graphicsFamily        = VK_QUEUE_FAMILY_IGNORED;
+    uint32_t                                computeFamily         = VK_QUEUE_FAMILY_IGNORED;
+    if (std::ranges::find(mAsyncComputePasses, true) != mAsyncComputePasses.end()) {
+        graphicsFamily = device.getQueueByFlag(VK_QUEUE_GRAPHICS_BIT, 0).getFamilyIndex();
+        computeFamily  = device.getAsyncComputeQueue()->getFamilyIndex();
 
-        first++;
+        //Imported and persistent content is released after everything recorded on the graphics queue so far,
+        //that part is submitted ahead so the async compute submission can wait for it instead of the whole frame
+        ResourceBarrierInfo queueReleaseInfo;
+        for (const auto& entry : mQueueAcquires) {
+            const auto resource = getResource(entry.handle);
+            if (devirtualized.insert(resource).second)
+                resource->devirtualize();
+            resolveBarrier(entry, queueReleaseInfo);
+            sBarrierStats.queueTransfers++;
+        }
+        //the release also covers uses on the graphics queue outside of the graph
+        auto coverEarlierUses = [](auto& barrier) {
+            barrier.srcStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        };
+        std::ranges::for_each(queueReleaseInfo.imageBarriers, coverEarlierUses);
+        std::ranges::for_each(queueReleaseInfo.bufferBarriers, coverEarlierUses);
+        queueAcquireInfo = SplitQueueTransfer(queueReleaseInfo, graphicsFamily, computeFamily);
+        if (!queueReleaseInfo.empty()) {
+            issueBarriers(commandBuffer, queueReleaseInfo);
+            graphicsTimelineValue = g_context->splitGraphicSubmission(commandBuffer);
+        }
+        computeCommandBuffer = &g_context->getComputeCommandBuffer();
+        computeCommandBuffer->beginRecord(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        issueBarriers(*computeCommandBuffer, queueAcquireInfo);
+    }
+    VkPipelineStageFlags asyncComputeWaitStages = 0;
+    //Graphics passes before the first consumer of async compute results are submitted ahead without waiting for them
+    bool graphicsPassRecorded = false;
+
+    struct SplitBarrier {
+        VkEvent             event{VK_NULL_HANDLE};
+        ResourceBarrierInfo barrierInfo;
+    };
+    //keyed by (producer,consumer)
+    std::map<std::pair<uint32_t, uint32_t>, SplitBarrier> splitBarriers;
+    uint32_t                                              eventIndex = 0;
+
+    //transitions back to first usage for resources whose last pass has executed,batched with the next pass barriers on the same queue
+    ResourceBarrierInfo releaseBarriers;
+    ResourceBarrierInfo asyncComputeReleaseBarriers;
+    //Releases of pooled transients by hardware resource, a later transient in the same pool slot chains from them
+    std::unordered_map<VkImage, VkImageMemoryBarrier2>   aliasImageReleases;
+    std::unordered_map<VkBuffer, VkBufferMemoryBarrier2> aliasBufferReleases;
+
+    for (uint32_t passIndex = 0; passIndex < mBarrierPlan.size(); passIndex++) {
+        const auto  pass                = mPassNodes[passIndex];
+        const auto& plan                = mBarrierPlan[passIndex];
+        const bool  async               = mAsyncComputePasses[passIndex];
+        auto&       passCommandBuffer   = async ? *computeCommandBuffer : commandBuffer;
+        auto&       passReleaseBarriers = async ? asyncComputeReleaseBarriers : releaseBarriers;
 
-        //
         for (const auto& resource : pass->devirtualize) {
-            resource->devirtualize();
+            if (!devirtualized.contains(resource))
+                resource->devirtualize();
             //getBlackBoard().put(resource->getName(), resource->handle);
         }
-        pass->resolveResourceUsages(*this, commandBuffer);
-        pass->execute(*this, commandBuffer);
 
-        ResourceBarrierInfo barrierInfo;
+        const bool consumesAsyncCompute = std::ranges::any_of(plan.barriers, [](const auto& entry) { return entry.queueTransfer; });
+        if (consumesAsyncCompute && asyncComputeWaitStages == 0 && graphicsPassRecorded)
+            g_context->splitGraphicSubmission(commandBuffer);
+        graphicsPassRecorded |= !async;
 
-        for (const auto& resourceNode : pass->destroy) {
-            auto firstPass = resourceNode->first;
-            auto state = firstPass->getResourceUsage(resourceNode->handle);
-            auto curState = resourceStateTracker.getResourceState(resourceNode->handle);
-            unsigned short srcUsage;
-            RenderPassType srcState;
-            resourceNode->resloveUsage(barrierInfo,std::get<1>(curState),state,pass->getType(),firstPass->getType());
+        if (!plan.waitProducers.empty()) {
+            std::vector<VkEvent>          events;
+            std::vector<VkDependencyInfo> dependencyInfos;
+            for (const auto producer : plan.waitProducers) {
+                auto& split = splitBarriers.at({producer, passIndex});
+                events.push_back(split.event);
+                dependencyInfos.push_back(split.barrierInfo.GetVkDependencyInfo());
+            }
+            vkCmdWaitEvents2(passCommandBuffer.getHandle(), events.size(), events.data(), dependencyInfos.data());
+            for (const auto event : events)
+                vkCmdResetEvent2(passCommandBuffer.getHandle(), event, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+        }
+
+        ResourceBarrierInfo barrierInfo           = std::move(passReleaseBarriers);
+        passReleaseBarriers                       = {};
+        size_t              pendingImageReleases  = barrierInfo.imageBarriers.size();
+        size_t              pendingBufferReleases = barrierInfo.bufferBarriers.size();
+        for (const auto& entry : plan.barriers) {
+            const auto imageBegin  = barrierInfo.imageBarriers.size();
+            const auto bufferBegin = barrierInfo.bufferBarriers.size();
+            resolveBarrier(entry, barrierInfo);
+            if (entry.external && getResource(entry.handle)->poolSlot >= 0) {
+                ChainAliasHandoffs(barrierInfo.imageBarriers, pendingImageReleases, imageBegin, &VkImageMemoryBarrier2::image, aliasImageReleases);
+                ChainAliasHandoffs(barrierInfo.bufferBarriers, pendingBufferReleases, bufferBegin, &VkBufferMemoryBarrier2::buffer, aliasBufferReleases);
+            }
+            if (entry.queueTransfer) {
+                asyncComputeWaitStages |= static_cast<VkPipelineStageFlags>(ImageUtil::getStageFlags(entry.dstPassType));
+                sBarrierStats.queueTransfers++;
+            }
         }
+        issueBarriers(passCommandBuffer, barrierInfo);
 
+        //Queries can not be inherited by secondary command buffers, parallel recorded graphics passes only get timestamps
+        const bool secondaryRecorded = pass->getType() == RenderPassType::GRAPHICS && g_context->getParallelRecording();
+        profiler.beginPass(passCommandBuffer, pass->getName(), !async, !secondaryRecorded);
+        pass->execute(*this, passCommandBuffer);
+        profiler.endPass(passCommandBuffer);
+
+        if (!plan.queueReleases.empty()) {
+            ResourceBarrierInfo queueReleaseInfo;
+            for (const auto& entry : plan.queueReleases)
+                resolveBarrier(entry, queueReleaseInfo, true);
+            issueBarriers(passCommandBuffer, queueReleaseInfo);
+        }
+
+        for (const auto& [consumer, entries] : plan.splitBarriers) {
+            auto& split = splitBarriers[{passIndex, consumer}];
+            split.event = transientResourcePool.requestEvent(eventIndex++);
+            for (const auto& entry : entries)
+                resolveBarrier(entry, split.barrierInfo);
+            sBarrierStats.splitBarriers += entries.size();
+
+            auto dependencyInfo = split.barrierInfo.GetVkDependencyInfo();
+            vkCmdSetEvent2(passCommandBuffer.getHandle(), split.event, &dependencyInfo);
+        }
 
-        auto depdencyInfo = barrierInfo.GetVkDependencyInfo();
-        vkCmdPipelineBarrier2(commandBuffer.getHandle(),&depdencyInfo);
+        for (const auto& resourceNode : pass->destroy) {
+            auto firstPass = resourceNode->first;
+            auto state     = firstPass->getResourceUsage(resourceNode->handle);
+            auto curState  = resourceStateTracker.getResourceState(resourceNode->handle);
+            if (async && std::ranges::any_of(mQueueReturns, [&](const auto& entry) { return entry.handle == resourceNode->handle; })) {
+                //the transition back to the first usage hands the content back to the graphics queue
+                resourceNode->resloveUsage(queueReturnInfo, std::get<1>(curState), state, pass->getType(), firstPass->getType());
+                sBarrierStats.queueTransfers++;
+                continue;
+            }
+            const auto imageCount  = passReleaseBarriers.imageBarriers.size();
+            const auto bufferCount = passReleaseBarriers.bufferBarriers.size();
+            resourceNode->resloveUsage(passReleaseBarriers, std::get<1>(curState), state, pass->getType(), firstPass->getType());
+            if (resourceNode->poolSlot < 0)
+                continue;
+            for (auto i = imageCount; i < passReleaseBarriers.imageBarriers.size(); i++)
+                aliasImageReleases[passReleaseBarriers.imageBarriers[i].image] = passReleaseBarriers.imageBarriers[i];
+            for (auto i = bufferCount; i < passReleaseBarriers.bufferBarriers.size(); i++)
+                aliasBufferReleases[passReleaseBarriers.bufferBarriers[i].buffer] = passReleaseBarriers.bufferBarriers[i];
+        }
 
         for (const auto& resource : pass->destroy) {
             resource->destroy();
         }
+
+        if (async)
+            sBarrierStats.asyncComputePasses++;
     }
+    issueBarriers(commandBuffer, releaseBarriers);
+
+    if (computeCommandBuffer) {
+        issueBarriers(*computeCommandBuffer, asyncComputeReleaseBarriers);
+
+        //The acquire is submitted behind the next graphics submission and makes the content visible to everything after it
+        queueAcquireInfo = SplitQueueTransfer(queueReturnInfo, computeFamily, graphicsFamily);
+        auto makeVisible = [](auto& barrier) {
+            barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+        };
+        std::ranges::for_each(queueAcquireInfo.imageBarriers, makeVisible);
+        std::ranges::for_each(queueAcquireInfo.bufferBarriers, makeVisible);
+        issueBarriers(*computeCommandBuffer, queueReturnInfo);
+
+        const auto timelineValue = g_context->submitAsyncCompute(*computeCommandBuffer, graphicsTimelineValue);
+        //Graphics only waits at the stages consuming async compute results, the submission of the frame waits for the rest
+        if (asyncComputeWaitStages)
+            g_context->waitAsyncCompute(timelineValue, asyncComputeWaitStages);
+        if (!queueAcquireInfo.empty())
+            issueBarriers(g_context->getQueueAcquireCommandBuffer(), queueAcquireInfo);
+    }
+
+    transientResourcePool.endFrame();
 }
 
 Blackboard& RenderGraph::getBlackBoard() const {
@@ -45,6 +45,120 @@ protected:
 
 class CommandBuffer;
 
+/**
+ * A transition a pass needs for one resource, computed by RenderGraph::compile.
+ * On the first use in the graph(external) the source state is ResourceNode::getDefaultUsage at execute time,
+ * the tracked layout of the image for textures and the consumer usage itself for buffers.
+ * Aliased transients chain that first use from the release of the transient sharing the hardware resource before.
+ */
+struct BarrierPlanEntry {
+    RenderGraphHandle handle{};
+    uint16_t          srcUsage{0};
+    uint16_t          dstUsage{0};
+    RenderPassType    srcPassType{RenderPassType::UNDEFINED};
+    RenderPassType    dstPassType{RenderPassType::UNDEFINED};
+    uint32_t          consumer{0};// active pass index the transition is for
+    bool              external{false};
+    bool              queueTransfer{false};// ownership moves from the async compute queue to the graphics queue
+};
+
+struct PassBarrierPlan {
+    //Issued in a single vkCmdPipelineBarrier2 before the pass
+    std::vector<BarrierPlanEntry> barriers{};
+    //Split barriers signalled with an event after the pass and waited by a later consumer, keyed by consumer index
+    std::map<uint32_t, std::vector<BarrierPlanEntry>> splitBarriers{};
+    //Producer pass indices of split barriers waited before this pass
+    std::vector<uint32_t> waitProducers{};
+    //Queue ownership releases recorded on the async compute queue after the pass, acquired by the consumer
+    std::vector<BarrierPlanEntry> queueReleases{};
+};
+
+struct RenderGraphBarrierStats {
+    uint32_t barrierBatches{0};
+    uint32_t imageBarriers{0};
+    uint32_t bufferBarriers{0};
+    uint32_t splitBarriers{0};
+    uint32_t skippedBarriers{0};
+    uint32_t asyncComputePasses{0};
+    uint32_t queueTransfers{0};
+};
+
+/**
+ * Everything compile() depends on, by pass/resource index. Compiled graphs are keyed on it,
+ * so a hash collision is resolved by comparing the structure instead of applying the result of another graph.
+ */
+struct RenderGraphStructureKey {
+    struct Pass {
+        std::string    name{};
+        RenderPassType type{RenderPassType::UNDEFINED};
+        bool           active{false};
+        uint32_t       refCount{0};
+
+        bool operator==(const Pass&) const = default;
+    };
+    struct Resource {
+        std::string           name{};
+        RenderResourceType    type{};
+        uint32_t              refCount{0};
+        ResourceDescriptorKey descriptor{};
+
+        bool operator==(const Resource&) const = default;
+    };
+    struct Edge {
+        uint32_t pass{0};
+        uint32_t resource{0};
+        uint16_t usage{0};
+        bool     read{true};
+
+        bool operator==(const Edge&) const = default;
+    };
+
+    bool                  cutUnUsedResources{false};
+    bool                  aliasTransientResources{false};
+    bool                  splitBarriers{false};
+    bool                  asyncCompute{false};
+    std::vector<Pass>     passes{};
+    std::vector<Resource> resources{};
+    std::vector<Edge>     edges{};
+
+    bool operator==(const RenderGraphStructureKey&) const = default;
+
+    struct Hash {
+        size_t operator()(const RenderGraphStructureKey& key) const;
+    };
+};
+
+/**
+ * Result of compile() stored by pass/resource index, so it can be reapplied to the graph
+ * that is rebuilt every frame as long as the pass setup does not change.
+ */
+struct CompiledRenderGraph {
+    std::vector<uint32_t> passOrder{};// pass indices after culling, active passes first
+    uint32_t              activePassCount{0};
+    std::vector<uint32_t> passRefCounts{};
+    std::vector<uint32_t> resourceRefCounts{};
+    std::vector<int32_t>  resourceFirstPass{};// -1 if the resource is never used by an active pass
+    std::vector<int32_t>  resourceLastPass{};
+    std::vector<int32_t>  resourcePoolSlots{};
+
+    //by active pass index
+    std::vector<bool>                  asyncComputePasses{};
+    std::vector<PassBarrierPlan>       barrierPlan{};
+    std::vector<std::vector<uint32_t>> passDevirtualize{};// resource indices
+    std::vector<std::vector<uint32_t>> passDestroy{};
+
+    std::vector<BarrierPlanEntry> queueAcquires{};
+    std::vector<BarrierPlanEntry> queueReturns{};
+    uint32_t                      skippedBarrierCount{0};
+};
+
+struct RenderGraphCompileStats {
+    bool     cacheHit{false};
+    double   compileTime{0};// ms
+    size_t   hash{0};
+    uint32_t cachedGraphCount{0};
+};
+
 class RenderGraph {
 public:
     RenderGraph(Device& device);
@@ -179,6 +293,24 @@ public:
 
     bool getCutUnUsedResources() const;
     void setCutUnUsedResources(const bool cut_un_used_resources);
+
+    bool getAliasTransientResources() const;
+    void setAliasTransientResources(const bool alias_transient_resources);
+
+    //Stats of the last compiled graph, shown in gui
+    static const RenderGraphCompileStats& getCompileStats();
+    static void                           clearCompileCache();
+
+    bool getSplitBarriers() const;
+    void setSplitBarriers(const bool split_barriers);
+
+    bool getAsyncCompute() const;
+    void setAsyncCompute(const bool async_compute);
+
+    static const RenderGraphBarrierStats& getBarrierStats();
+    //Log the barrier plan of the next compiled graph
+    static void        requestBarrierPlanDump();
+    std::string        getBarrierPlanDump() const;
     ResourceStateTracker& getResourceStateTracker(){
         return resourceStateTracker;
     }
@@ -186,6 +318,16 @@ private:
     RenderGraphHandle addTexture(RenderGraphTexture* texture);
     RenderGraphHandle addBuffer(RenderGraphBuffer* buffer);
 
+    RenderGraphStructureKey getStructureKey() const;
+    void                    cullAndSortPasses(CompiledRenderGraph& compiled);
+    void                    storeCompiledGraph(CompiledRenderGraph& compiled) const;
+    void                    applyCompiledGraph(const CompiledRenderGraph& compiled);
+    void                    assignTransientSlots();
+    void                    assignAsyncComputePasses();
+    void                    buildBarrierPlan();
+    void                    resolveBarrier(const BarrierPlanEntry& entry, ResourceBarrierInfo& barrierInfo, bool queueRelease = false);
+    void                    issueBarriers(CommandBuffer& commandBuffer, ResourceBarrierInfo& barrierInfo);
+
     std::vector<RenderGraphNode*> getInComingNodes(RenderGraphNode* node) const;
     std::vector<RenderGraphNode*> getOutComingNodes(RenderGraphNode* node) const;
 
@@ -247,6 +389,26 @@ private:
     //when an algothrim is not completed,some resource may be cutted,which is not desired for debug process
     bool cutUnUsedResources{true};
 
+    //transient resources with non-overlapping lifetimes share pooled memory
+    bool aliasTransientResources{true};
+
+    //use events for transitions whose producer and consumer are not adjacent passes
+    bool splitBarriers{true};
+
+    //run compute passes independent of the graphics chain on the async compute queue if the device has one
+    bool asyncCompute{true};
+
+    std::vector<PassBarrierPlan> mBarrierPlan{};
+    std::vector<bool>            mAsyncComputePasses{};// by active pass index
+    //Imported and persistent content first used on the async compute queue, released by the graphics queue before the graph
+    std::vector<BarrierPlanEntry> mQueueAcquires{};
+    //Imported and persistent content last used on the async compute queue, handed back to the graphics queue with the
+    //transition to its first usage after the last pass
+    std::vector<BarrierPlanEntry> mQueueReturns{};
+    uint32_t                     skippedBarrierCount{0};
+
+    bool compiled{false};
+
     // std::vector<std::unique_ptr<Vi>>
 };
 
@@ -2,18 +2,67 @@
 #include "Common/ResourceCache.h"
 #include "Core/Images/ImageUtil.h"
 
-RenderGraphBuffer::RenderGraphBuffer(const std::string& name, const Descriptor& descriptor) {
-    //todo
-    //mBuffer = ResourceCache::getResourceCache().requestNamedBuffer(name, descriptor.size, descriptor.usage, descriptor.memoryUsage);
+RenderGraphBuffer::RenderGraphBuffer(const std::string& name, const Descriptor& descriptor) : mDesc(descriptor) {
+    RenderGraphNode::setName(name);
 }
 
-RenderGraphBuffer::RenderGraphBuffer(const std::string& name, Buffer* hwBuffer) {
+RenderGraphBuffer::RenderGraphBuffer(const std::string& name, Buffer* hwBuffer) : imported(true) {
     RenderGraphNode::setName(name);
 
     mBuffer = hwBuffer;
 }
 
+VkBufferUsageFlags RenderGraphBuffer::getVkUsageFlags() const {
+    VkBufferUsageFlags flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if (any(mDesc.usage & BufferUsage::INDEX))
+        flags |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    if (any(mDesc.usage & BufferUsage::VERTEX))
+        flags |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    if (any(mDesc.usage & BufferUsage::READ))
+        flags |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    if (any(mDesc.usage & BufferUsage::INDIRECT))
+        flags |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    if (any(mDesc.usage & BufferUsage::STORAGE))
+        flags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (any(mDesc.usage & BufferUsage::UNIFORM_TEXEL))
+        flags |= VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT;
+    if (any(mDesc.usage & BufferUsage::STORAGE_TEXEL))
+        flags |= VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+    if (any(mDesc.usage & BufferUsage::RAY_TRACING))
+        flags |= VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    return flags;
+}
+
 void RenderGraphBuffer::devirtualize() {
+    if (imported)
+        return;
+    if (poolSlot >= 0) {
+        mBuffer = &ResourceCache::getResourceCache().getTransientResourcePool().requestBuffer(mDesc.size, getVkUsageFlags(), mDesc.memoryUsage, poolSlot);
+        return;
+    }
+    mBuffer = &ResourceCache::getResourceCache().requestNamedBuffer(mName, mDesc.size, getVkUsageFlags(), mDesc.memoryUsage);
+}
+
+bool RenderGraphBuffer::isTransient() const {
+    return !imported;
+}
+
+bool RenderGraphBuffer::isReadOnlyUsage(uint16_t usage) const {
+    const auto writeUsages = BufferUsage::UPLOADABLE | BufferUsage::STORAGE | BufferUsage::TRANSFER_DST | BufferUsage::STORAGE_TEXEL;
+    return usage != 0 && !any(static_cast<BufferUsage>(usage) & writeUsages);
+}
+
+size_t RenderGraphBuffer::getPoolKey() const {
+    return TransientResourcePool::getBufferKey(mDesc.size, getVkUsageFlags(), mDesc.memoryUsage);
+}
+
+ResourceDescriptorKey RenderGraphBuffer::getDescriptorKey() const {
+    if (imported)
+        return {};
+    return {.size        = mDesc.size,
+            .usage       = getVkUsageFlags(),
+            .memoryUsage = static_cast<uint32_t>(mDesc.memoryUsage),
+            .transient   = isTransient()};
 }
 
 void RenderGraphBuffer::destroy() {
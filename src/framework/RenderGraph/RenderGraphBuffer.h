@@ -22,8 +22,16 @@ public:
     void               resloveUsage(ResourceBarrierInfo& barrierInfo, uint16_t lastUsage, uint16_t nextUsage, RenderPassType lastPassType, RenderPassType nextPassType) override;
     Buffer*            getHwBuffer();
     uint16_t           getDefaultUsage(uint16_t nextUsage) override;
+    bool               isTransient() const override;
+    size_t             getPoolKey() const override;
+    bool               isReadOnlyUsage(uint16_t usage) const override;
+
+    ResourceDescriptorKey getDescriptorKey() const override;
 
 private:
-    Descriptor mDesc;
+    VkBufferUsageFlags getVkUsageFlags() const;
+
+    Descriptor mDesc{};
     Buffer*    mBuffer{nullptr};
+    bool       imported{false};
 };
\ No newline at end of file
@@ -14,6 +14,15 @@ SgImage* RenderGraphTexture::getHwTexture() const {
     return mHwTexture;
 }
 
+VkFormat RenderGraphTexture::getVkFormat() const {
+    return mDescriptor.format == VK_FORMAT_UNDEFINED ? ImageUtil::getFormat(mDescriptor.useage) : mDescriptor.format;
+}
+
+VkImageUsageFlags RenderGraphTexture::getVkUsageFlags() const {
+    //2024 1 20 all renderGraph texture created with transfer_src usage for debug
+    return ImageUtil::getUsageFlags(mDescriptor.useage | TextureUsage::TRANSFER_SRC);
+}
+
 void RenderGraphTexture::devirtualize() {
     if (imported)
         return;
@@ -21,11 +30,36 @@ void RenderGraphTexture::devirtualize() {
         LOGE("Texture already devirtualized")
     }
 
-    VkFormat format = mDescriptor.format == VK_FORMAT_UNDEFINED ? ImageUtil::getFormat(mDescriptor.useage) : mDescriptor.format;
-
-    //2024 1 20 all renderGraph texture created with transfer_src usage for debug
+    const VkExtent3D extent = {mDescriptor.extent.width, mDescriptor.extent.height, 1};
+    if (poolSlot >= 0) {
+        mHwTexture = &ResourceCache::getResourceCache().getTransientResourcePool().requestSgImage(extent, getVkFormat(), getVkUsageFlags(), poolSlot);
+        return;
+    }
     mHwTexture = &ResourceCache::getResourceCache().requestSgImage(
-        mName, {mDescriptor.extent.width, mDescriptor.extent.height, 1}, format, ImageUtil::getUsageFlags(mDescriptor.useage | TextureUsage::TRANSFER_SRC), VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_VIEW_TYPE_2D);
+        mName, extent, getVkFormat(), getVkUsageFlags(), VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_VIEW_TYPE_2D);
+}
+
+bool RenderGraphTexture::isTransient() const {
+    return !imported && !mDescriptor.persistent;
+}
+
+bool RenderGraphTexture::isReadOnlyUsage(uint16_t usage) const {
+    const auto writeUsages = TextureUsage::COLOR_ATTACHMENT | TextureUsage::DEPTH_ATTACHMENT | TextureUsage::STENCIL_ATTACHMENT |
+                             TextureUsage::UPLOADABLE | TextureUsage::TRANSFER_DST | TextureUsage::STORAGE | TextureUsage::PRESENT;
+    return usage != 0 && !any(static_cast<TextureUsage>(usage) & writeUsages);
+}
+
+size_t RenderGraphTexture::getPoolKey() const {
+    return TransientResourcePool::getTextureKey({mDescriptor.extent.width, mDescriptor.extent.height, 1}, getVkFormat(), getVkUsageFlags());
+}
+
+ResourceDescriptorKey RenderGraphTexture::getDescriptorKey() const {
+    if (imported)
+        return {};
+    return {.size      = (uint64_t(mDescriptor.extent.width) << 32) | mDescriptor.extent.height,
+            .format    = static_cast<uint32_t>(getVkFormat()),
+            .usage     = getVkUsageFlags(),
+            .transient = isTransient()};
 }
 
 void RenderGraphTexture::destroy() {
@@ -31,6 +31,8 @@ public:
         VkExtent2D extent{};
         Usage      useage;
         VkFormat  format = VK_FORMAT_UNDEFINED;
+        //content is kept across frames(e.g. accumulation targets),never aliased with other textures
+        bool persistent = false;
     };
 
     static constexpr Usage DEFAULT_R_USAGE       = Usage::READ_ONLY;
@@ -59,11 +61,21 @@ public:
 
     RenderResourceType getType() const override;
 
+    bool   isTransient() const override;
+    size_t getPoolKey() const override;
+    bool   isReadOnlyUsage(uint16_t usage) const override;
+
+    ResourceDescriptorKey getDescriptorKey() const override;
+
     void             resloveUsage(ResourceBarrierInfo& barrierInfo, uint16_t lastUsage, uint16_t nextUsage, RenderPassType lastPassType, RenderPassType nextPassType) override;
     uint16_t         getDefaultUsage(uint16_t nextUsage) override;
     
     bool             imported{false};
     const Descriptor mDescriptor;
 
+private:
+    VkFormat          getVkFormat() const;
+    VkImageUsageFlags getVkUsageFlags() const;
+
     // Usage usage{};
 };
\ No newline at end of file
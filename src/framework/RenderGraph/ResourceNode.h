@@ -12,6 +12,10 @@
 #include <vector>
 
 struct ResourceBarrierInfo {
+    bool empty() const {
+        return imageBarriers.empty() && bufferBarriers.empty() && memoryBarriers.empty();
+    }
+
     std::vector<VkImageMemoryBarrier2KHR> imageBarriers;
     std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
     std::vector<VkMemoryBarrier2KHR> memoryBarriers;
@@ -28,6 +32,17 @@ struct ResourceBarrierInfo {
     }
 };
 
+//Descriptor of a resource as far as RenderGraph::compile depends on it, compared on compile cache hits
+struct ResourceDescriptorKey {
+    uint64_t size{0};// bytes for buffers, width and height for textures
+    uint32_t format{0};
+    uint32_t usage{0};
+    uint32_t memoryUsage{0};
+    bool     transient{false};
+
+    bool operator==(const ResourceDescriptorKey&) const = default;
+};
+
 class ResourceNode : public RenderGraphNode {
 public:
     virtual void                       devirtualize()                                             = 0;
@@ -35,11 +50,20 @@ public:
     virtual void                       resloveUsage(ResourceBarrierInfo & barrierInfo, uint16_t lastUsage, uint16_t nextUsage,RenderPassType lastPassType, RenderPassType nextPassType) = 0;
     virtual uint16_t getDefaultUsage(uint16_t nextUsage) = 0;
     virtual RenderResourceType getType() const                                            = 0;
+
+    //Transient resources are backed by TransientResourcePool and may share memory with other resources
+    virtual bool   isTransient() const { return false; }
+    virtual size_t getPoolKey() const { return 0; }
+    virtual ResourceDescriptorKey getDescriptorKey() const = 0;
+
+    //Usage that never writes the resource,a transition between two equal read only usages can be dropped
+    virtual bool isReadOnlyUsage(uint16_t usage) const = 0;
 public:
     PassNode *first{nullptr},
         *last{nullptr};
     uint8_t           resourceUsage{0};
     RenderGraphHandle handle;
+    int32_t           poolSlot{-1};// slot in TransientResourcePool assigned by RenderGraph::compile, -1 if not pooled
 
 protected:
 };
\ No newline at end of file
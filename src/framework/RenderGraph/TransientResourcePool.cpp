@@ -0,0 +1,121 @@
+#include "TransientResourcePool.h"
+
+#include "Core/ResourceCachingHelper.h"
+#include "Core/Device/Device.h"
+
+TransientResourcePool::TransientResourcePool(Device& device) : device(device) {
+}
+
+TransientResourcePool::~TransientResourcePool() {
+    for (auto& slot : frameSlots)
+        for (auto event : slot.events)
+            vkDestroyEvent(device.getHandle(), event, nullptr);
+}
+
+size_t TransientResourcePool::getTextureKey(const VkExtent3D& extent, VkFormat format, VkImageUsageFlags usage) {
+    size_t hash{0};
+    hash_combine(hash, extent.width);
+    hash_combine(hash, extent.height);
+    hash_combine(hash, extent.depth);
+    hash_combine(hash, format);
+    hash_combine(hash, usage);
+    return hash;
+}
+
+size_t TransientResourcePool::getBufferKey(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
+    size_t hash{0};
+    hash_combine(hash, size);
+    hash_combine(hash, usage);
+    hash_combine(hash, memoryUsage);
+    return hash;
+}
+
+SgImage& TransientResourcePool::requestSgImage(const VkExtent3D& extent, VkFormat format, VkImageUsageFlags usage, uint32_t slot) {
+    std::lock_guard<std::mutex> guard(poolMutex);
+
+    size_t hash = getTextureKey(extent, format, usage);
+    hash_combine(hash, slot);
+    hash_combine(hash, frameSlot);
+
+    frameStats.requestedTextures++;
+    auto& entry = images[hash];
+    if (entry.resource == nullptr) {
+        auto name      = "transient image " + std::to_string(images.size());
+        entry.resource = std::make_unique<SgImage>(device, name, extent, format, usage, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_VIEW_TYPE_2D);
+    }
+    entry.lastUsedFrame = frameIndex;
+    return *entry.resource;
+}
+
+Buffer& TransientResourcePool::requestBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, uint32_t slot) {
+    std::lock_guard<std::mutex> guard(poolMutex);
+
+    size_t hash = getBufferKey(size, usage, memoryUsage);
+    hash_combine(hash, slot);
+    hash_combine(hash, frameSlot);
+
+    frameStats.requestedBuffers++;
+    auto& entry = buffers[hash];
+    if (entry.resource == nullptr)
+        entry.resource = std::make_unique<Buffer>(device, size, usage, memoryUsage);
+    entry.lastUsedFrame = frameIndex;
+    return *entry.resource;
+}
+
+VkEvent TransientResourcePool::requestEvent(uint32_t index) {
+    std::lock_guard<std::mutex> guard(poolMutex);
+
+    auto& events = frameSlots[frameSlot].events;
+    while (events.size() <= index) {
+        VkEventCreateInfo eventInfo{VK_STRUCTURE_TYPE_EVENT_CREATE_INFO};
+        eventInfo.flags = VK_EVENT_CREATE_DEVICE_ONLY_BIT;
+        VkEvent event{VK_NULL_HANDLE};
+        VK_CHECK_RESULT(vkCreateEvent(device.getHandle(), &eventInfo, nullptr, &event));
+        events.push_back(event);
+    }
+    return events[index];
+}
+
+void TransientResourcePool::beginFrame(uint32_t frameSlot) {
+    std::lock_guard<std::mutex> guard(poolMutex);
+
+    if (frameSlots.size() <= frameSlot)
+        frameSlots.resize(frameSlot + 1);
+    this->frameSlot = frameSlot;
+    frameSlots[frameSlot].retiredImages.clear();
+    frameSlots[frameSlot].retiredBuffers.clear();
+}
+
+//Moves the entries unused for MAX_UNUSED_FRAMES out of the pool, the frames in flight may still reference them
+template<typename T>
+static void RetireUnused(std::unordered_map<size_t, T>& entries, uint32_t frameIndex, uint32_t maxUnusedFrames, auto& retired) {
+    std::erase_if(entries, [&](auto& it) {
+        if (it.second.lastUsedFrame + maxUnusedFrames >= frameIndex)
+            return false;
+        retired.push_back(std::move(it.second.resource));
+        return true;
+    });
+}
+
+void TransientResourcePool::endFrame() {
+    std::lock_guard<std::mutex> guard(poolMutex);
+
+    RetireUnused(images, frameIndex, MAX_UNUSED_FRAMES, frameSlots[frameSlot].retiredImages);
+    RetireUnused(buffers, frameIndex, MAX_UNUSED_FRAMES, frameSlots[frameSlot].retiredBuffers);
+
+    frameStats.pooledTextures = images.size();
+    frameStats.pooledBuffers  = buffers.size();
+    lastFrameStats            = frameStats;
+    frameStats                = {};
+    frameIndex++;
+}
+
+void TransientResourcePool::clear() {
+    std::lock_guard<std::mutex> guard(poolMutex);
+    images.clear();
+    buffers.clear();
+    for (auto& slot : frameSlots) {
+        slot.retiredImages.clear();
+        slot.retiredBuffers.clear();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Core/Buffer.h"
+#include "Scene/SgImage.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/*
+ * Frame-persistent pool of hardware resources backing transient render graph textures and buffers.
+ * RenderGraph::compile assigns a slot to every transient resource from its first/last pass,
+ * resources with the same description and non-overlapping lifetimes get the same slot and so share one allocation.
+ * Frames in flight each get their own resources and events, the frame recorded on the cpu never aliases one the gpu
+ * may still execute. Pooled resources that are not requested for a few frames are retired and destroyed when their
+ * frame slot comes around again, after the gpu is done with it.
+ * Also owns the VkEvents used by split barriers, reused every frame.
+ */
+class TransientResourcePool {
+public:
+    struct Stats {
+        uint32_t requestedTextures{0};
+        uint32_t pooledTextures{0};
+        uint32_t requestedBuffers{0};
+        uint32_t pooledBuffers{0};
+    };
+
+    explicit TransientResourcePool(Device& device);
+    ~TransientResourcePool();
+
+    static size_t getTextureKey(const VkExtent3D& extent, VkFormat format, VkImageUsageFlags usage);
+    static size_t getBufferKey(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+
+    SgImage& requestSgImage(const VkExtent3D& extent, VkFormat format, VkImageUsageFlags usage, uint32_t slot);
+    Buffer&  requestBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, uint32_t slot);
+    VkEvent  requestEvent(uint32_t index);
+
+    //Called once the gpu finished the previous frame of frameSlot, before the render graph of the frame is built
+    void beginFrame(uint32_t frameSlot);
+    //Called once per frame after the render graph is executed,retire resources unused for MAX_UNUSED_FRAMES
+    void endFrame();
+    void clear();
+
+    const Stats& getStats() const { return lastFrameStats; }
+
+    static constexpr uint32_t MAX_UNUSED_FRAMES = 8;
+
+private:
+    template<typename T>
+    struct Entry {
+        std::unique_ptr<T> resource;
+        uint32_t           lastUsedFrame{0};
+    };
+
+    Device& device;
+
+    struct FrameSlot {
+        std::vector<VkEvent>                  events;
+        std::vector<std::unique_ptr<SgImage>> retiredImages;
+        std::vector<std::unique_ptr<Buffer>>  retiredBuffers;
+    };
+
+    std::unordered_map<size_t, Entry<SgImage>> images;
+    std::unordered_map<size_t, Entry<Buffer>>  buffers;
+    std::vector<FrameSlot>                     frameSlots{1};
+
+    uint32_t frameIndex{0};
+    uint32_t frameSlot{0};
+    Stats    frameStats{};
+    Stats    lastFrameStats{};
+
+    std::mutex poolMutex;
+};
@@ -4,6 +4,8 @@
 #include "Common/ResourceCache.h"
 #include "Core/RenderContext.h"
 #include "Core/View.h"
+#include "GpuCullingPass.h"
+#include "VirtualTexturePass.h"
 
 struct IBLLightingPassPushConstant {
     float exposure        = 4.5f;
@@ -66,7 +68,8 @@ void ForwardPass::render(RenderGraph& rg) {
             
             RenderGraphPassDescriptor desc{};
             desc.setTextures({output, depth}).addSubpass({.outputAttachments = {output,depth}});
-            builder.declare(desc); }, [&](RenderPassContext& context) {
+            builder.declare(desc);
+            GpuCullingPass::ReadDrawCommands(rg, builder); }, [&](RenderPassContext& context) {
             auto view = g_manager->fetchPtr<View>("view");
 
             g_context->getPipelineState().setPipelineLayout(*mPipelineLayout);
@@ -88,7 +91,8 @@ void ForwardPass::render(RenderGraph& rg) {
             g_context->bindImageSampler(0, irradianceCube, irradianceCubeSampler).bindImageSampler(1, prefilterCube, prefilterCubeSampler).bindImageSampler(2, brdfLUT, brdfLUTSampler);
 
             g_context->getPipelineState().setDepthStencilState({.depthCompareOp = VK_COMPARE_OP_LESS});
-            view->drawPrimitives(context.commandBuffer, [&view](const Primitive& primitive) { return view->getAlphaMode(primitive) == AlphaMode::OPAQUE; });
+            if (!GpuCullingPass::DrawPrimitivesIndirect(rg, context.commandBuffer, *view, AlphaMode::OPAQUE))
+                view->drawPrimitives(context.commandBuffer, [&view](const Primitive& primitive) { return view->getAlphaMode(primitive) == AlphaMode::OPAQUE; });
 
             ColorBlendAttachmentState colorBlendAttachmentState{};
             colorBlendAttachmentState.blendEnable = VK_TRUE;
@@ -105,7 +109,8 @@ void ForwardPass::render(RenderGraph& rg) {
             g_context->getPipelineState().setColorBlendState(blendState);
 
             g_context->getPipelineState().setDepthStencilState({.depthTestEnable = false});
-            view->drawPrimitives(context.commandBuffer, [&view](const Primitive& primitive) { return view->getAlphaMode(primitive) == AlphaMode::BLEND; }); });
+            if (!GpuCullingPass::DrawPrimitivesIndirect(rg, context.commandBuffer, *view, AlphaMode::BLEND))
+                view->drawPrimitives(context.commandBuffer, [&view](const Primitive& primitive) { return view->getAlphaMode(primitive) == AlphaMode::BLEND; }); });
 }
 void ForwardPass::init() {
     PassBase::init();
@@ -186,6 +191,8 @@ void IBLLightingPass::updateGui() {
     ImGui::Combo("Debug Mode", &debugMode, "None\0Diffuse\0Specular\0Normal\0Depth\0Albedo\0Metallic\0Roughness\0Ambient Occlusion\0Irradiance\0Prefilter\0BRDF LUT\0");
 }
 
+static ShaderPipelineKey VirtualTextureGBuffer = {"defered_one_scene_buffer.vert", {"defered_pbr.frag", {"VIRTUAL_TEXTURE"}}};
+
 void GBufferPass::render(RenderGraph& rg) {
     auto& blackBoard    = rg.getBlackBoard();
     auto& renderContext = g_context;
@@ -216,9 +223,21 @@ void GBufferPass::render(RenderGraph& rg) {
          RenderGraphPassDescriptor desc({diffuse,  normal, emission, depth}, {.outputAttachments = {diffuse,  normal, emission, depth}});
             builder.declare(desc);
 
-            builder.writeTextures({diffuse,  emission, depth}, TextureUsage::COLOR_ATTACHMENT).writeTexture(depth, TextureUsage::DEPTH_ATTACHMENT); }, [&](RenderPassContext& context) {
-            renderContext->getPipelineState().setPipelineLayout(*mPipelineLayout).setDepthStencilState({.depthCompareOp = VK_COMPARE_OP_LESS}).setRasterizationState({.cullMode =  VK_CULL_MODE_NONE});
-            g_manager->fetchPtr<View>("view")->bindViewBuffer().bindViewShading().bindViewGeom(context.commandBuffer).drawPrimitives(context.commandBuffer); });
+            builder.writeTextures({diffuse,  emission, depth}, TextureUsage::COLOR_ATTACHMENT).writeTexture(depth, TextureUsage::DEPTH_ATTACHMENT);
+            GpuCullingPass::ReadDrawCommands(rg, builder);
+            VirtualTexturePass::DeclareResources(rg, builder); }, [&](RenderPassContext& context) {
+            //Scene textures are fetched through the page table when their pages are streamed
+            auto& pipelineLayout = VirtualTexturePass::IsActive(rg) ? rg.getDevice().getResourceCache().requestPipelineLayout(VirtualTextureGBuffer) : *mPipelineLayout;
+            renderContext->getPipelineState().setPipelineLayout(pipelineLayout).setDepthStencilState({.depthCompareOp = VK_COMPARE_OP_LESS}).setRasterizationState({.cullMode =  VK_CULL_MODE_NONE});
+            auto view = g_manager->fetchPtr<View>("view");
+            view->bindViewBuffer().bindViewShading().bindViewGeom(context.commandBuffer);
+            VirtualTexturePass::BindResources(rg);
+            if (!GpuCullingPass::DrawPrimitivesIndirect(rg, context.commandBuffer, *view, AlphaMode::OPAQUE)) {
+                view->drawPrimitives(context.commandBuffer);
+                return;
+            }
+            GpuCullingPass::DrawPrimitivesIndirect(rg, context.commandBuffer, *view, AlphaMode::MASK);
+            GpuCullingPass::DrawPrimitivesIndirect(rg, context.commandBuffer, *view, AlphaMode::BLEND); });
 }
 
 std::vector<std::string> outputToBufferDefines                  = {"OUTPUT_TO_BUFFER"};
@@ -0,0 +1,147 @@
+#include "GpuCullingPass.h"
+
+#include "imgui.h"
+#include "Common/ResourceCache.h"
+#include "Core/RenderContext.h"
+
+void GpuCullingPass::init() {
+    PassBase::init();
+    if (!g_context->getDevice().isDrawIndirectCountSupported())
+        LOGW("Draw indirect count is not supported, gpu driven draws are disabled");
+}
+
+void GpuCullingPass::updateDrawInfos(const View& view) {
+    std::vector<DrawInfo> drawInfos;
+    view.IteratorPrimitives([&](const Primitive& primitive) {
+        const auto& bbox = primitive.getDimensions();
+        drawInfos.push_back({.bboxMin      = glm::vec4(bbox.min(), 1.0f),
+                             .bboxMax      = glm::vec4(bbox.max(), 1.0f),
+                             .indexCount   = primitive.indexCount,
+                             .firstIndex   = primitive.firstIndex,
+                             .vertexOffset = static_cast<int32_t>(primitive.firstVertex),
+                             .alphaMode    = static_cast<uint32_t>(view.getAlphaMode(primitive))});
+    });
+    mDrawCount       = drawInfos.size();
+    mDrawInfoVersion = view.getPrimitivesVersion();
+
+    //Frames in flight may still cull with the previous buffers or draw the commands written to them
+    if (mDrawInfoBuffer)
+        g_context->deferRelease(std::move(mDrawInfoBuffer));
+    for (auto& drawCommandBuffer : mDrawCommandBuffers)
+        g_context->deferRelease(std::move(drawCommandBuffer));
+    for (auto& drawCountBuffer : mDrawCountBuffers)
+        g_context->deferRelease(std::move(drawCountBuffer));
+    mDrawCommandBuffers.clear();
+    mDrawCountBuffers.clear();
+    if (mDrawCount == 0)
+        return;
+
+    auto& device    = g_context->getDevice();
+    mDrawInfoBuffer = std::make_unique<Buffer>(device, sizeof(DrawInfo) * mDrawCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, drawInfos.data());
+    mDrawCommandBuffers.resize(g_context->getFramesInFlight());
+    mDrawCountBuffers.resize(g_context->getFramesInFlight());
+    for (uint32_t i = 0; i < g_context->getFramesInFlight(); i++) {
+        mDrawCommandBuffers[i] = std::make_unique<Buffer>(device, sizeof(VkDrawIndexedIndirectCommand) * mDrawCount * (AlphaMode::BLEND + 1), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        mDrawCountBuffers[i]   = std::make_unique<Buffer>(device, sizeof(uint32_t) * (AlphaMode::BLEND + 1), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+}
+
+void GpuCullingPass::render(RenderGraph& rg) {
+    auto view = g_manager->fetchPtr<View>("view");
+    if (!mEnable || !g_context->getDevice().isDrawIndirectCountSupported() || !view->supportIndirectDraw())
+        return;
+
+    if (view->getPrimitivesVersion() != mDrawInfoVersion)
+        updateDrawInfos(*view);
+    if (mDrawCount == 0)
+        return;
+
+    Buffer* drawCommandBuffer = mDrawCommandBuffers[g_context->getActiveFrameIndex()].get();
+    Buffer* drawCountBuffer   = mDrawCountBuffers[g_context->getActiveFrameIndex()].get();
+
+    auto drawCommands = rg.importBuffer(GPU_DRAW_COMMANDS_NAME, drawCommandBuffer);
+    auto drawCounts   = rg.importBuffer(GPU_DRAW_COUNTS_NAME, drawCountBuffer);
+    auto hiz          = mHiz.import(rg);
+
+    //The pyramid only matches the current depth convention if it was built with it
+    const bool useOcclusion = mOcclusion && mHiz.isValid(view->getCamera()->useInverseDepth);
+
+    rg.addComputePass(
+        "Gpu Culling Pass",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            builder.writeBuffer(drawCommands, BufferUsage::STORAGE);
+            builder.writeBuffer(drawCounts, BufferUsage::STORAGE);
+            //Bound even without occlusion, the shader skips the fetches
+            builder.readTexture(hiz, TextureUsage::SAMPLEABLE);
+            settings.pipelineLayout = &rg.getDevice().getResourceCache().requestPipelineLayout(ShaderPipelineKey{"common/gpu_cull.comp"});
+        },
+        [this, view, useOcclusion, drawCommandBuffer, drawCountBuffer](RenderPassContext& context) {
+            auto& commandBuffer = context.commandBuffer;
+
+            //Counts restart from zero every frame
+            vkCmdFillBuffer(commandBuffer.getHandle(), drawCountBuffer->getHandle(), 0, VK_WHOLE_SIZE, 0);
+            VkBufferMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+            barrier.srcStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+            barrier.srcAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            barrier.dstStageMask        = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            barrier.dstAccessMask       = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer              = drawCountBuffer->getHandle();
+            barrier.size                = VK_WHOLE_SIZE;
+            VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+            dependencyInfo.bufferMemoryBarrierCount = 1;
+            dependencyInfo.pBufferMemoryBarriers    = &barrier;
+            vkCmdPipelineBarrier2(commandBuffer.getHandle(), &dependencyInfo);
+
+            const Camera* camera = view->getCamera();
+            const auto    planes = Frustum::GetPlanes(camera->viewProj());
+
+            CullUniform uniform{};
+            std::copy(planes.begin(), planes.end(), uniform.frustumPlanes);
+            uniform.hizViewProj  = mHiz.getViewProj();
+            uniform.hizSize      = mHiz.getSize();
+            uniform.hizMipCount  = mHiz.getMipCount();
+            uniform.drawCount    = mDrawCount;
+            uniform.useOcclusion = useOcclusion;
+            uniform.inverseDepth = camera->useInverseDepth;
+            uniform.flipY        = g_context->getFlipViewport();
+
+            BufferAllocation allocation = g_context->allocateBuffer(sizeof(CullUniform), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+            allocation.buffer->uploadData(&uniform, sizeof(CullUniform), allocation.offset);
+
+            auto& hizSampler = g_context->getDevice().getResourceCache().requestSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, mHiz.getMipCount());
+            g_context->bindBuffer(0, *mDrawInfoBuffer)
+                .bindBuffer(1, *drawCommandBuffer)
+                .bindBuffer(2, *drawCountBuffer)
+                .bindBuffer(3, *allocation.buffer, allocation.offset, sizeof(CullUniform))
+                .bindImageSampler(0, mHiz.getImage().getVkImageView(), hizSampler)
+                .flushAndDispatch(commandBuffer, (mDrawCount + 63) / 64, 1, 1);
+        });
+}
+
+void GpuCullingPass::renderHiz(RenderGraph& rg) {
+    mHiz.build(rg);
+}
+
+void GpuCullingPass::ReadDrawCommands(RenderGraph& rg, RenderGraph::Builder& builder) {
+    auto& blackBoard = rg.getBlackBoard();
+    if (!blackBoard.contains(GPU_DRAW_COMMANDS_NAME))
+        return;
+    builder.readBuffer(blackBoard.getHandle(GPU_DRAW_COMMANDS_NAME), BufferUsage::INDIRECT);
+    builder.readBuffer(blackBoard.getHandle(GPU_DRAW_COUNTS_NAME), BufferUsage::INDIRECT);
+}
+
+bool GpuCullingPass::DrawPrimitivesIndirect(RenderGraph& rg, CommandBuffer& commandBuffer, View& view, AlphaMode alphaMode) {
+    auto& blackBoard = rg.getBlackBoard();
+    if (!blackBoard.contains(GPU_DRAW_COMMANDS_NAME))
+        return false;
+    view.drawPrimitivesIndirect(commandBuffer, blackBoard.getBuffer(GPU_DRAW_COMMANDS_NAME), blackBoard.getBuffer(GPU_DRAW_COUNTS_NAME), alphaMode);
+    return true;
+}
+
+void GpuCullingPass::updateGui() {
+    ImGui::Checkbox("Gpu driven draws", &mEnable);
+    ImGui::Checkbox("Occlusion culling", &mOcclusion);
+    ImGui::Text("Gpu culled primitives: %d", mDrawCount);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "RenderPassBase.h"
+#include "HizPyramid.h"
+#include "Core/View.h"
+#include "RenderGraph/RenderGraph.h"
+
+#include <memory>
+
+static const std::string GPU_DRAW_COMMANDS_NAME = "gpu_draw_commands";
+static const std::string GPU_DRAW_COUNTS_NAME   = "gpu_draw_counts";
+
+/**
+ * Gpu driven draws of the view. Every primitive is culled against the camera frustum and a Hi-Z built from the
+ * previous frame's depth, the visible ones are written as VkDrawIndexedIndirectCommands, one list per alpha mode,
+ * so passes submit a single vkCmdDrawIndexedIndirectCount per alpha mode whatever the primitive count.
+ * render is called before the passes drawing the view and renderHiz once the depth of the frame is written.
+ */
+class GpuCullingPass : public PassBase {
+public:
+    void render(RenderGraph& rg) override;
+    //Farthest depth pyramid tested by the culling of the next frame
+    void renderHiz(RenderGraph& rg);
+    void init() override;
+    void updateGui() override;
+
+    //Declares the indirect reads of a pass drawing the view, nothing is declared if culling did not run this frame
+    static void ReadDrawCommands(RenderGraph& rg, RenderGraph::Builder& builder);
+    //Returns false if culling did not run this frame, the caller then draws the view on the cpu path
+    static bool DrawPrimitivesIndirect(RenderGraph& rg, CommandBuffer& commandBuffer, View& view, AlphaMode alphaMode);
+
+protected:
+    struct DrawInfo {
+        glm::vec4 bboxMin;
+        glm::vec4 bboxMax;
+        uint32_t  indexCount;
+        uint32_t  firstIndex;
+        int32_t   vertexOffset;
+        uint32_t  alphaMode;
+    };
+
+    struct CullUniform {
+        glm::mat4  hizViewProj;
+        glm::vec4  frustumPlanes[6];
+        glm::ivec2 hizSize;
+        uint32_t   hizMipCount;
+        uint32_t   drawCount;
+        uint32_t   useOcclusion;
+        uint32_t   inverseDepth;
+        uint32_t   flipY;
+        uint32_t   padding;
+    };
+
+    //Rebuilt when the primitives of the view change, bounding boxes are static world space boxes
+    void updateDrawInfos(const View& view);
+
+    std::unique_ptr<Buffer>  mDrawInfoBuffer;
+    //Written by the culling every frame, one per frame in flight so a frame never overwrites the commands a previous frame still draws
+    std::vector<std::unique_ptr<Buffer>> mDrawCommandBuffers;
+    std::vector<std::unique_ptr<Buffer>> mDrawCountBuffers;
+    uint32_t                 mDrawCount{0};
+    //View primitives version the draw infos were built from
+    uint64_t                 mDrawInfoVersion{0};
+    HizPyramid               mHiz{"culling_hiz"};
+
+    bool mEnable{true};
+    bool mOcclusion{true};
+};
@@ -0,0 +1,113 @@
+#include "HizPyramid.h"
+
+#include "Common/ResourceCache.h"
+#include "Core/RenderContext.h"
+#include "RenderPassBase.h"
+#include "Core/View.h"
+
+struct HizPushConstant {
+    glm::ivec2 srcSize;
+    glm::ivec2 dstSize;
+};
+
+static ShaderPipelineKey GetHizShaders(bool inverseDepth) {
+    if (inverseDepth)
+        return {ShaderKey{"common/cull_hiz.comp", {"INVERSE_DEPTH"}}};
+    return {ShaderKey{"common/cull_hiz.comp"}};
+}
+
+static VkImageMemoryBarrier2 BuildHizBarrier(const Image& hiz, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags2 srcAccess, VkAccessFlags2 dstAccess, uint32_t baseLevel, uint32_t levelCount) {
+    VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.image               = hiz.getHandle();
+    barrier.oldLayout           = oldLayout;
+    barrier.newLayout           = newLayout;
+    barrier.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1};
+    barrier.srcAccessMask       = srcAccess;
+    barrier.dstAccessMask       = dstAccess;
+    barrier.srcStageMask        = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstStageMask        = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    return barrier;
+}
+
+static void CmdImageBarrier(CommandBuffer& commandBuffer, const VkImageMemoryBarrier2& barrier) {
+    VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependencyInfo.imageMemoryBarrierCount = 1;
+    dependencyInfo.pImageMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(commandBuffer.getHandle(), &dependencyInfo);
+}
+
+HizPyramid::HizPyramid(std::string name) : mName(std::move(name)) {
+}
+
+glm::ivec2 HizPyramid::getSize() const {
+    return glm::ivec2(mHiz->getExtent2D().width, mHiz->getExtent2D().height);
+}
+
+uint32_t HizPyramid::getMipCount() const {
+    return mHiz->getMipLevelCount();
+}
+
+RenderGraphHandle HizPyramid::import(RenderGraph& rg) {
+    VkExtent2D viewportExtent = g_context->getViewPortExtent();
+    VkExtent3D hizExtent      = {std::max(1u, viewportExtent.width / 2), std::max(1u, viewportExtent.height / 2), 1};
+    if (mHiz == nullptr || mHiz->getExtent2D().width != hizExtent.width || mHiz->getExtent2D().height != hizExtent.height) {
+        uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(hizExtent.width, hizExtent.height)))) + 1;
+        //The culling of the frames in flight may still sample the previous pyramid
+        g_context->deferRelease(std::move(mHiz));
+        mHiz               = std::make_unique<SgImage>(rg.getDevice(), mName, hizExtent, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_VIEW_TYPE_2D, VK_SAMPLE_COUNT_1_BIT, mipLevels, 1);
+        mValid             = false;
+    }
+    return rg.importTexture(mName, mHiz.get());
+}
+
+void HizPyramid::build(RenderGraph& rg) {
+    auto& blackBoard = rg.getBlackBoard();
+    if (!blackBoard.contains(mName) || !blackBoard.contains(DEPTH_IMAGE_NAME))
+        return;
+
+    auto            view         = g_manager->fetchPtr<View>("view");
+    const bool      inverseDepth = view->getCamera()->useInverseDepth;
+    const glm::mat4 viewProj     = view->getCamera()->viewProj();
+
+    rg.addComputePass(
+        mName + " Pass",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            //Layout of the pyramid levels is handled explicitly
+            builder.readTexture(blackBoard.getHandle(DEPTH_IMAGE_NAME), TextureUsage::SAMPLEABLE).writeTexture(blackBoard.getHandle(mName), TextureUsage::NONE);
+            settings.pipelineLayout = &rg.getDevice().getResourceCache().requestPipelineLayout(GetHizShaders(inverseDepth));
+        },
+        [this, &rg, inverseDepth, viewProj](RenderPassContext& context) {
+            auto&          commandBuffer = context.commandBuffer;
+            auto&          hiz           = mHiz->getVkImage();
+            const uint32_t mipCount      = mHiz->getMipLevelCount();
+            auto&          sampler       = rg.getDevice().getResourceCache().requestSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, 1);
+
+            //Every level is rewritten, the previous pyramid is discarded
+            CmdImageBarrier(commandBuffer, BuildHizBarrier(hiz, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, 0, mipCount));
+
+            VkExtent2D srcExtent = g_context->getViewPortExtent();
+            VkExtent2D dstExtent = mHiz->getExtent2D();
+            for (uint32_t level = 0; level < mipCount; level++) {
+                if (level == 0)
+                    g_context->bindImageSampler(0, rg.getBlackBoard().getImageView(DEPTH_IMAGE_NAME), sampler);
+                else
+                    g_context->bindImageSampler(0, mHiz->getVkImageView(VK_IMAGE_VIEW_TYPE_MAX_ENUM, VK_FORMAT_UNDEFINED, level - 1, 0, 1), sampler);
+                g_context->bindImage(0, mHiz->getVkImageView(VK_IMAGE_VIEW_TYPE_MAX_ENUM, VK_FORMAT_UNDEFINED, level, 0, 1));
+
+                HizPushConstant pushConstant{.srcSize = glm::ivec2(srcExtent.width, srcExtent.height), .dstSize = glm::ivec2(dstExtent.width, dstExtent.height)};
+                g_context->bindPushConstants(pushConstant).flushAndDispatch(commandBuffer, (dstExtent.width + 7) / 8, (dstExtent.height + 7) / 8, 1);
+
+                //Read by the next level and by the culling of the next frame
+                CmdImageBarrier(commandBuffer, BuildHizBarrier(hiz, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_2_SHADER_WRITE_BIT, VK_ACCESS_2_SHADER_READ_BIT, level, 1));
+
+                srcExtent = dstExtent;
+                dstExtent = {std::max(1u, dstExtent.width / 2), std::max(1u, dstExtent.height / 2)};
+            }
+
+            mViewProj     = viewProj;
+            mInverseDepth = inverseDepth;
+            mValid        = true;
+        });
+}
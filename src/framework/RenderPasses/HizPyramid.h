@@ -0,0 +1,36 @@
+#pragma once
+
+#include "RenderGraph/RenderGraph.h"
+
+#include <memory>
+
+/**
+ * Farthest depth pyramid for occlusion culling, built from the depth of a frame and tested by the culling of the next one.
+ * Level 0 is half the viewport resolution, the pyramid is recreated when the viewport is resized.
+ * Culling reprojects its bounds with getViewProj, the camera the pyramid was built with.
+ */
+class HizPyramid {
+public:
+    explicit HizPyramid(std::string name);
+
+    //Resizes with the viewport and imports the pyramid in the graph, call before the passes testing it
+    RenderGraphHandle import(RenderGraph& rg);
+    //Builds the pyramid from the depth of the frame, nothing is done if it was not imported this frame
+    void build(RenderGraph& rg);
+
+    //False until built with the current depth convention, occlusion must then be skipped
+    bool               isValid(bool inverseDepth) const { return mValid && mInverseDepth == inverseDepth; }
+    const glm::mat4&   getViewProj() const { return mViewProj; }
+    SgImage&           getImage() const { return *mHiz; }
+    const std::string& getName() const { return mName; }
+    glm::ivec2         getSize() const;
+    uint32_t           getMipCount() const;
+
+protected:
+    std::string              mName;
+    std::unique_ptr<SgImage> mHiz;
+
+    glm::mat4 mViewProj{1.0f};
+    bool      mValid{false};
+    bool      mInverseDepth{false};
+};
@@ -0,0 +1,356 @@
+#include "VirtualTexturePass.h"
+
+#include "imgui.h"
+#include "Common/ResourceCache.h"
+#include "Core/RenderContext.h"
+#include "Scene/Scene.h"
+
+#include <algorithm>
+
+//30 pages of 136 texels fit the 4096 guaranteed image size, 900 slots
+static constexpr uint32_t VT_ATLAS_PAGES_PER_ROW = 30;
+//Feedback is written by one pixel of every tile and one of the fetches of the pixel, both rotated every frame
+static constexpr uint32_t VT_FEEDBACK_TILE    = 8;
+static constexpr uint32_t VT_FEEDBACK_SAMPLES = 4;
+static constexpr uint32_t MAX_UPLOADS_PER_FRAME  = 32;
+static constexpr uint32_t MAX_REQUESTS_PER_FRAME = 512;
+//Pages seen by the feedback of the last frames are never evicted, the atlas then degrades to coarser levels
+static constexpr uint64_t VT_KEEP_FRAMES = 8;
+
+static void CmdBufferBarrier(CommandBuffer& commandBuffer, const Buffer& buffer, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+    VkBufferMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+    barrier.srcStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    barrier.srcAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask        = dstStage;
+    barrier.dstAccessMask       = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = buffer.getHandle();
+    barrier.size                = VK_WHOLE_SIZE;
+    VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependencyInfo.bufferMemoryBarrierCount = 1;
+    dependencyInfo.pBufferMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(commandBuffer.getHandle(), &dependencyInfo);
+}
+
+void VirtualTexturePass::init() {
+    PassBase::init();
+    mPageFormat       = Texture::getVirtualTexturePageFormat(g_context->getDevice());
+    mAtlasPagesPerRow = VT_ATLAS_PAGES_PER_ROW;
+}
+
+void VirtualTexturePass::registerTextures(const View& view) {
+    auto& device = g_context->getDevice();
+
+    //Joins the thread reading the files of the previous scene
+    mStreamer = std::make_unique<VirtualTextureStreamer>();
+    mTextures.clear();
+    mTextureInfos.clear();
+    mPageCount = 0;
+
+    const auto& textures = view.getScene()->getTextures();
+    for (uint32_t i = 0; i < textures.size(); i++) {
+        if (textures[i]->virtualTexturePath.empty())
+            continue;
+        auto file = std::make_unique<VirtualTextureFile>();
+        if (!file->open(textures[i]->virtualTexturePath) || file->getPageFormat() != mPageFormat) {
+            LOGE("Failed to open virtual texture {}", textures[i]->virtualTexturePath);
+            continue;
+        }
+
+        //Shaders index the infos with the texture index of the materials
+        uint32_t shaderIndex = view.getTextureShaderIndex(i);
+        if (shaderIndex >= mTextureInfos.size())
+            mTextureInfos.resize(shaderIndex + 1, TextureInfo{0, 0, 0, 0});
+        mTextureInfos[shaderIndex] = {mPageCount, toUint32(file->getLevels().size()), file->getWidth(), file->getHeight()};
+
+        uint32_t pageCount = file->getPageCount();
+        auto     levels    = file->getLevels();
+        mTextures.push_back({mPageCount, mStreamer->addFile(std::move(file)), std::move(levels)});
+        mPageCount += pageCount;
+    }
+
+    //Feedback in flight indexes the pages of the previous scene
+    mFeedbackReadbackValid.assign(mFeedbackReadbackValid.size(), false);
+    mPageTable.assign(mPageCount, 0);
+    mDirtyPages.clear();
+    mPageTableCleared = false;
+    mSlots.assign(mAtlasPagesPerRow * mAtlasPagesPerRow, AtlasSlot{});
+    mFreeSlots.clear();
+    for (uint32_t slot = mSlots.size(); slot > 0; slot--)
+        mFreeSlots.push_back(slot - 1);
+    mResidentPages = 0;
+    //Frames in flight may still read the page table and texture infos of the previous scene
+    g_context->deferRelease(std::move(mPageTableBuffer));
+    g_context->deferRelease(std::move(mTexturesBuffer));
+
+    if (mPageCount == 0) {
+        mStreamer.reset();
+        return;
+    }
+    LOGI("Streaming {} virtual textures, {} pages", mTextures.size(), mPageCount);
+
+    mPageTableBuffer = std::make_unique<Buffer>(device, sizeof(uint32_t) * mPageCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    mTexturesBuffer  = std::make_unique<Buffer>(device, sizeof(TexturesHeader) + sizeof(TextureInfo) * mTextureInfos.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    mTexturesBuffer->uploadData(mTextureInfos.data(), sizeof(TextureInfo) * mTextureInfos.size(), sizeof(TexturesHeader));
+
+    if (mAtlas == nullptr) {
+        uint32_t atlasSize = mAtlasPagesPerRow * VT_PHYSICAL_PAGE_SIZE;
+        mAtlas             = std::make_unique<SgImage>(device, VT_ATLAS_NAME, VkExtent3D{atlasSize, atlasSize, 1}, mPageFormat, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_VIEW_TYPE_2D);
+        mUploadBuffers.resize(g_context->getFramesInFlight());
+        for (auto& uploadBuffer : mUploadBuffers)
+            uploadBuffer = std::make_unique<Buffer>(device, VirtualTextureFile::getPageByteSize(mPageFormat) * MAX_UPLOADS_PER_FRAME, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
+}
+
+void VirtualTexturePass::updateFeedbackBuffers() {
+    VkExtent2D viewportExtent = g_context->getViewPortExtent();
+    VkExtent2D feedbackExtent = {(viewportExtent.width + VT_FEEDBACK_TILE - 1) / VT_FEEDBACK_TILE, (viewportExtent.height + VT_FEEDBACK_TILE - 1) / VT_FEEDBACK_TILE};
+    if (mFeedbackBuffer != nullptr && feedbackExtent.width == mFeedbackExtent.width && feedbackExtent.height == mFeedbackExtent.height)
+        return;
+
+    auto&        device = g_context->getDevice();
+    VkDeviceSize size   = sizeof(uint32_t) * feedbackExtent.width * feedbackExtent.height;
+    mFeedbackExtent     = feedbackExtent;
+    //Frames in flight may still write and copy the previous buffers
+    g_context->deferRelease(std::move(mFeedbackBuffer));
+    for (auto& readbackBuffer : mFeedbackReadbackBuffers)
+        g_context->deferRelease(std::move(readbackBuffer));
+    mFeedbackBuffer     = std::make_unique<Buffer>(device, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    mFeedbackReadbackBuffers.resize(g_context->getFramesInFlight());
+    for (auto& readbackBuffer : mFeedbackReadbackBuffers)
+        readbackBuffer = std::make_unique<Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+    mFeedbackReadbackValid.assign(mFeedbackReadbackBuffers.size(), false);
+}
+
+const VirtualTexturePass::VirtualTexture& VirtualTexturePass::findTexture(uint32_t page) const {
+    auto texture = std::upper_bound(mTextures.begin(), mTextures.end(), page, [](uint32_t page, const VirtualTexture& texture) { return page < texture.firstPage; });
+    return *(texture - 1);
+}
+
+void VirtualTexturePass::requestPage(uint32_t page, std::vector<PageRequest>& requests) {
+    const auto& texture  = findTexture(page);
+    uint32_t    filePage = page - texture.firstPage;
+    uint32_t    level    = 0;
+    while (level + 1 < texture.levels.size() && texture.levels[level + 1].firstPage <= filePage)
+        level++;
+    uint32_t pageX = (filePage - texture.levels[level].firstPage) % texture.levels[level].pagesX;
+    uint32_t pageY = (filePage - texture.levels[level].firstPage) / texture.levels[level].pagesX;
+
+    //The coarser pages covering it are requested along, so the fetch falls back to the closest level while it streams
+    for (; level < texture.levels.size(); level++) {
+        const auto& levelInfo = texture.levels[level];
+        pageX                 = std::min(pageX, levelInfo.pagesX - 1);
+        pageY                 = std::min(pageY, levelInfo.pagesY - 1);
+        uint32_t levelPage    = levelInfo.firstPage + pageY * levelInfo.pagesX + pageX;
+        uint32_t entry        = mPageTable[texture.firstPage + levelPage];
+        if (entry != 0) {
+            mSlots[entry - 1].lastUsedFrame = mFrame;
+            break;
+        }
+        requests.push_back({{texture.firstPage + levelPage, texture.file, levelPage}, toUint32(texture.levels.size()) - level});
+        pageX /= 2;
+        pageY /= 2;
+    }
+}
+
+void VirtualTexturePass::readFeedback() {
+    uint32_t frameIndex = g_context->getActiveFrameIndex();
+    if (!mFeedbackReadbackValid[frameIndex])
+        return;
+    mFeedbackReadbackValid[frameIndex] = false;
+
+    auto&                 readbackBuffer = *mFeedbackReadbackBuffers[frameIndex];
+    const auto*           feedback       = static_cast<const uint32_t*>(readbackBuffer.map());
+    std::vector<uint32_t> pages;
+    for (uint32_t i = 0; i < mFeedbackExtent.width * mFeedbackExtent.height; i++)
+        if (feedback[i] < mPageCount)
+            pages.push_back(feedback[i]);
+    readbackBuffer.unmap();
+
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+    std::vector<PageRequest> pageRequests;
+    for (uint32_t page : pages) {
+        if (uint32_t entry = mPageTable[page]; entry != 0)
+            mSlots[entry - 1].lastUsedFrame = mFrame;
+        else
+            requestPage(page, pageRequests);
+    }
+
+    //Coarse pages first, they cover the most screen and every finer request falls back to them
+    std::sort(pageRequests.begin(), pageRequests.end(), [](const PageRequest& a, const PageRequest& b) { return a.levelsToTail != b.levelsToTail ? a.levelsToTail < b.levelsToTail : a.request.page < b.request.page; });
+    pageRequests.erase(std::unique(pageRequests.begin(), pageRequests.end(), [](const PageRequest& a, const PageRequest& b) { return a.request.page == b.request.page; }), pageRequests.end());
+
+    std::vector<VirtualTextureStreamer::Request> requests;
+    for (uint32_t i = 0; i < pageRequests.size() && i < MAX_REQUESTS_PER_FRAME; i++)
+        requests.push_back(pageRequests[i].request);
+    mRequestedPages = requests.size();
+    mStreamer->request(std::move(requests));
+}
+
+uint32_t VirtualTexturePass::allocateSlot() {
+    if (!mFreeSlots.empty()) {
+        uint32_t slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        return slot;
+    }
+    uint32_t leastRecentlyUsed = UINT32_MAX;
+    for (uint32_t slot = 0; slot < mSlots.size(); slot++)
+        if (mSlots[slot].lastUsedFrame + VT_KEEP_FRAMES < mFrame && (leastRecentlyUsed == UINT32_MAX || mSlots[slot].lastUsedFrame < mSlots[leastRecentlyUsed].lastUsedFrame))
+            leastRecentlyUsed = slot;
+    return leastRecentlyUsed;
+}
+
+void VirtualTexturePass::render(RenderGraph& rg) {
+    auto view = g_manager->fetchPtr<View>("view");
+    if (view->getScene() != mScene) {
+        mScene = view->getScene();
+        registerTextures(*view);
+    }
+    if (mPageCount == 0)
+        return;
+
+    mFrame++;
+    updateFeedbackBuffers();
+    readFeedback();
+
+    //Pages loaded since the last frame are copied to their slot before the passes of the frame sample them
+    uint32_t                                        frameIndex   = g_context->getActiveFrameIndex();
+    uint32_t                                        pageByteSize = VirtualTextureFile::getPageByteSize(mPageFormat);
+    auto&                                           uploadBuffer = *mUploadBuffers[frameIndex];
+    std::vector<VirtualTextureStreamer::LoadedPage> uploadedPages;
+    std::vector<VkBufferImageCopy>                  copies;
+    mStreamer->collect(uploadedPages, MAX_UPLOADS_PER_FRAME);
+    for (const auto& uploadedPage : uploadedPages) {
+        if (mPageTable[uploadedPage.page] != 0)
+            continue;
+        uint32_t slot = allocateSlot();
+        if (slot == UINT32_MAX)
+            break;
+        if (uint32_t evictedPage = mSlots[slot].page; evictedPage != UINT32_MAX) {
+            mPageTable[evictedPage] = 0;
+            mDirtyPages.push_back(evictedPage);
+            mResidentPages--;
+        }
+        mSlots[slot]                  = {uploadedPage.page, mFrame};
+        mPageTable[uploadedPage.page] = slot + 1;
+        mDirtyPages.push_back(uploadedPage.page);
+        mResidentPages++;
+
+        VkBufferImageCopy copy{};
+        copy.bufferOffset     = copies.size() * pageByteSize;
+        copy.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        copy.imageOffset      = {static_cast<int32_t>(slot % mAtlasPagesPerRow * VT_PHYSICAL_PAGE_SIZE), static_cast<int32_t>(slot / mAtlasPagesPerRow * VT_PHYSICAL_PAGE_SIZE), 0};
+        copy.imageExtent      = {VT_PHYSICAL_PAGE_SIZE, VT_PHYSICAL_PAGE_SIZE, 1};
+        uploadBuffer.uploadData(uploadedPage.data.data(), pageByteSize, copy.bufferOffset);
+        copies.push_back(copy);
+    }
+    mUploadedPages = copies.size();
+
+    //Runs of consecutive entries are copied with one update
+    std::sort(mDirtyPages.begin(), mDirtyPages.end());
+    mDirtyPages.erase(std::unique(mDirtyPages.begin(), mDirtyPages.end()), mDirtyPages.end());
+    std::vector<std::pair<uint32_t, uint32_t>> pageTableRuns;
+    for (uint32_t page : mDirtyPages) {
+        if (!pageTableRuns.empty() && pageTableRuns.back().first + pageTableRuns.back().second == page && pageTableRuns.back().second < 65536 / sizeof(uint32_t))
+            pageTableRuns.back().second++;
+        else
+            pageTableRuns.push_back({page, 1});
+    }
+    mDirtyPages.clear();
+
+    TexturesHeader header{};
+    header.atlasPagesPerRow = mAtlasPagesPerRow;
+    header.textureCount     = mTextureInfos.size();
+    header.feedbackSize     = {mFeedbackExtent.width, mFeedbackExtent.height};
+    header.feedbackSample   = mFrame % VT_FEEDBACK_SAMPLES;
+    //Every pixel of a tile once in VT_FEEDBACK_TILE² rotations, 37 is coprime with 64
+    uint32_t jitter       = (mFrame / VT_FEEDBACK_SAMPLES * 37) % (VT_FEEDBACK_TILE * VT_FEEDBACK_TILE);
+    header.feedbackJitter = {jitter % VT_FEEDBACK_TILE, jitter / VT_FEEDBACK_TILE};
+
+    auto pageTable = rg.importBuffer(VT_PAGE_TABLE_NAME, mPageTableBuffer.get());
+    auto textures  = rg.importBuffer(VT_TEXTURES_NAME, mTexturesBuffer.get());
+    auto feedback  = rg.importBuffer(VT_FEEDBACK_NAME, mFeedbackBuffer.get());
+    auto atlas     = rg.importTexture(VT_ATLAS_NAME, mAtlas.get());
+
+    rg.addComputePass(
+        "Virtual Texture Update",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            builder.writeBuffer(pageTable, BufferUsage::TRANSFER_DST);
+            builder.writeBuffer(textures, BufferUsage::TRANSFER_DST);
+            builder.writeBuffer(feedback, BufferUsage::TRANSFER_DST);
+            builder.writeTexture(atlas, TextureUsage::TRANSFER_DST);
+        },
+        [this, header, frameIndex, copies = std::move(copies), pageTableRuns = std::move(pageTableRuns)](RenderPassContext& context) {
+            auto& commandBuffer = context.commandBuffer;
+            if (!mPageTableCleared) {
+                vkCmdFillBuffer(commandBuffer.getHandle(), mPageTableBuffer->getHandle(), 0, VK_WHOLE_SIZE, 0);
+                CmdBufferBarrier(commandBuffer, *mPageTableBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+                mPageTableCleared = true;
+            }
+            for (const auto& [firstPage, count] : pageTableRuns)
+                vkCmdUpdateBuffer(commandBuffer.getHandle(), mPageTableBuffer->getHandle(), firstPage * sizeof(uint32_t), count * sizeof(uint32_t), mPageTable.data() + firstPage);
+
+            vkCmdUpdateBuffer(commandBuffer.getHandle(), mTexturesBuffer->getHandle(), 0, sizeof(TexturesHeader), &header);
+            //Pixels not sampling a virtual texture leave their tile empty
+            vkCmdFillBuffer(commandBuffer.getHandle(), mFeedbackBuffer->getHandle(), 0, VK_WHOLE_SIZE, UINT32_MAX);
+            if (!copies.empty())
+                commandBuffer.copyBufferToImage(*mUploadBuffers[frameIndex], mAtlas->getVkImage(), copies);
+        });
+}
+
+void VirtualTexturePass::renderFeedbackReadback(RenderGraph& rg) {
+    if (!IsActive(rg))
+        return;
+    auto     feedback   = rg.getBlackBoard().getHandle(VT_FEEDBACK_NAME);
+    uint32_t frameIndex = g_context->getActiveFrameIndex();
+    rg.addComputePass(
+        "Virtual Texture Feedback Readback",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            builder.readBuffer(feedback, BufferUsage::TRANSFER_SRC);
+        },
+        [this, frameIndex](RenderPassContext& context) {
+            auto&        commandBuffer  = context.commandBuffer;
+            auto&        readbackBuffer = *mFeedbackReadbackBuffers[frameIndex];
+            VkBufferCopy region{0, 0, mFeedbackBuffer->getSize()};
+            vkCmdCopyBuffer(commandBuffer.getHandle(), mFeedbackBuffer->getHandle(), readbackBuffer.getHandle(), 1, &region);
+            CmdBufferBarrier(commandBuffer, readbackBuffer, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+            mFeedbackReadbackValid[frameIndex] = true;
+        });
+}
+
+bool VirtualTexturePass::IsActive(RenderGraph& rg) {
+    return rg.getBlackBoard().contains(VT_PAGE_TABLE_NAME);
+}
+
+void VirtualTexturePass::DeclareResources(RenderGraph& rg, RenderGraph::Builder& builder) {
+    if (!IsActive(rg))
+        return;
+    auto& blackBoard = rg.getBlackBoard();
+    builder.readBuffer(blackBoard.getHandle(VT_PAGE_TABLE_NAME), BufferUsage::STORAGE);
+    builder.readBuffer(blackBoard.getHandle(VT_TEXTURES_NAME), BufferUsage::STORAGE);
+    builder.writeBuffer(blackBoard.getHandle(VT_FEEDBACK_NAME), BufferUsage::STORAGE);
+    builder.readTexture(blackBoard.getHandle(VT_ATLAS_NAME), TextureUsage::SAMPLEABLE);
+}
+
+void VirtualTexturePass::BindResources(RenderGraph& rg) {
+    if (!IsActive(rg))
+        return;
+    auto& blackBoard = rg.getBlackBoard();
+    auto& atlas      = blackBoard.getImageView(VT_ATLAS_NAME);
+    //Pages carry their own border, bilinear taps never leave the page
+    auto& sampler = g_context->getDevice().getResourceCache().requestSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, 1);
+    g_context->bindBuffer(16, blackBoard.getBuffer(VT_PAGE_TABLE_NAME))
+        .bindBuffer(17, blackBoard.getBuffer(VT_TEXTURES_NAME))
+        .bindBuffer(18, blackBoard.getBuffer(VT_FEEDBACK_NAME))
+        .bindImageSampler(16, atlas, sampler);
+}
+
+void VirtualTexturePass::updateGui() {
+    if (mPageCount == 0)
+        return;
+    ImGui::Text("Virtual texture pages: %d resident / %d slots, %d total", mResidentPages, toUint32(mSlots.size()), mPageCount);
+    ImGui::Text("Virtual texture streaming: %d requested, %d uploaded", mRequestedPages, mUploadedPages);
+}
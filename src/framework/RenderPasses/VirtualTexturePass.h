@@ -0,0 +1,110 @@
+#pragma once
+
+#include "RenderPassBase.h"
+#include "Core/View.h"
+#include "IO/VirtualTextureStreamer.h"
+#include "RenderGraph/RenderGraph.h"
+
+#include <memory>
+
+static const std::string VT_PAGE_TABLE_NAME = "vt_page_table";
+static const std::string VT_TEXTURES_NAME   = "vt_textures";
+static const std::string VT_FEEDBACK_NAME   = "vt_feedback";
+static const std::string VT_ATLAS_NAME      = "vt_atlas";
+
+/**
+ * Streams the pages of the scene textures loaded with SceneLoadingConfig::virtualTexture.
+ * Passes sampling through virtualTexture.glsl write the page they want for one pixel of every tile to a feedback buffer,
+ * which is read back a few frames later. Missing pages are read by a VirtualTextureStreamer thread and copied to a
+ * fixed atlas of physical pages recycled least recently used first, the page table maps every page of every level to
+ * its atlas slot. Texture memory is then bounded by the atlas whatever the size of the scene textures.
+ * render is called before the passes sampling the view and renderFeedbackReadback after them.
+ */
+class VirtualTexturePass : public PassBase {
+public:
+    void render(RenderGraph& rg) override;
+    //Copies the feedback written this frame to the readback buffer of the frame
+    void renderFeedbackReadback(RenderGraph& rg);
+    void init() override;
+    void updateGui() override;
+
+    //Nothing is declared or bound if no virtual texture is streamed this frame, shaders then use their plain path
+    static bool IsActive(RenderGraph& rg);
+    static void DeclareResources(RenderGraph& rg, RenderGraph::Builder& builder);
+    static void BindResources(RenderGraph& rg);
+
+protected:
+    struct TextureInfo {
+        uint32_t firstPage;
+        uint32_t levelCount;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct TexturesHeader {
+        uint32_t   atlasPagesPerRow;
+        uint32_t   textureCount;
+        glm::uvec2 feedbackSize;
+        glm::uvec2 feedbackJitter;
+        uint32_t   feedbackSample;
+        uint32_t   padding;
+    };
+
+    //Page table range of a streamed texture
+    struct VirtualTexture {
+        uint32_t                         firstPage;
+        uint32_t                         file;
+        std::vector<VirtualTextureLevel> levels;
+    };
+
+    struct PageRequest {
+        VirtualTextureStreamer::Request request;
+        uint32_t                        levelsToTail;
+    };
+
+    struct AtlasSlot {
+        uint32_t page{UINT32_MAX};
+        uint64_t lastUsedFrame{0};
+    };
+
+    //Rebuilt when the view shows another scene
+    void registerTextures(const View& view);
+    void updateFeedbackBuffers();
+    void readFeedback();
+    //Requests the page and its coarser pages down to the first resident one
+    void requestPage(uint32_t page, std::vector<PageRequest>& requests);
+    //Slot of the least recently used page not seen in the last frames, UINT32_MAX if all are in use
+    uint32_t                                 allocateSlot();
+    const VirtualTexture&                    findTexture(uint32_t page) const;
+
+    const Scene*                             mScene{nullptr};
+    std::unique_ptr<VirtualTextureStreamer>  mStreamer;
+    std::vector<VirtualTexture>              mTextures;
+    std::vector<TextureInfo>                 mTextureInfos;
+    uint32_t                                 mPageCount{0};
+
+    //Cpu copy of the page table, entries changed this frame are copied to the gpu one in the upload pass
+    std::vector<uint32_t>                    mPageTable;
+    std::vector<uint32_t>                    mDirtyPages;
+    bool                                     mPageTableCleared{false};
+    std::vector<AtlasSlot>                   mSlots;
+    std::vector<uint32_t>                    mFreeSlots;
+    uint32_t                                 mAtlasPagesPerRow{0};
+    VkFormat                                 mPageFormat{VK_FORMAT_UNDEFINED};
+
+    std::unique_ptr<Buffer>                  mPageTableBuffer;
+    std::unique_ptr<Buffer>                  mTexturesBuffer;
+    std::unique_ptr<SgImage>                 mAtlas;
+    std::unique_ptr<Buffer>                  mFeedbackBuffer;
+    //One per frame in flight, read once the frame that wrote it completed
+    std::vector<std::unique_ptr<Buffer>>     mFeedbackReadbackBuffers;
+    std::vector<bool>                        mFeedbackReadbackValid;
+    std::vector<std::unique_ptr<Buffer>>     mUploadBuffers;
+    VkExtent2D                               mFeedbackExtent{0, 0};
+
+    uint64_t                                 mFrame{0};
+
+    uint32_t mResidentPages{0};
+    uint32_t mRequestedPages{0};
+    uint32_t mUploadedPages{0};
+};
@@ -133,6 +133,25 @@ BBox Frustum::getBBox() const {
 
     return bbox;
 }
+std::array<glm::vec4, 6> Frustum::GetPlanes(const glm::mat4& viewProj) {
+    const glm::mat4 m = glm::transpose(viewProj);
+
+    std::array<glm::vec4, 6> planes = {
+        m[3] + m[0],//left
+        m[3] - m[0],//right
+        m[3] + m[1],//bottom
+        m[3] - m[1],//top
+        m[2],       //near
+        m[3] - m[2] //far
+    };
+    for (auto& plane : planes) {
+        const float length = glm::length(glm::vec3(plane));
+        //An infinite far plane degenerates, keep it accepting everything
+        plane = length > 1e-6f ? plane / length : glm::vec4(0, 0, 0, 1);
+    }
+    return planes;
+}
+
 Camera::Camera() {
     m_transform = std::make_unique<Transform>();
 }
@@ -3,6 +3,7 @@
 #include "Core/Rect.h"
 #include "Core/Transform.h"
 
+#include <array>
 #include <memory>
 #include <mat4x4.hpp>
 #include <ext/matrix_transform.hpp>
@@ -88,6 +89,9 @@ struct Frustum {
 
     void transform(const glm::mat4& matrix);
     BBox getBBox() const;
+
+    //Planes of the clip volume of a zero to one depth projection, xyz is the normal pointing inside and w the distance
+    static std::array<glm::vec4, 6> GetPlanes(const glm::mat4& viewProj);
 };
 
 struct Ray {
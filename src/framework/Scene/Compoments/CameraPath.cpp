@@ -0,0 +1,54 @@
+#include "CameraPath.h"
+
+#include "Camera.h"
+#include "Common/FIleUtils.h"
+#include "Common/JsonUtil.h"
+#include "Common/Log.h"
+
+bool CameraPath::load(const std::string& path) {
+    if (!FileUtils::fileExists(path)) {
+        LOGE("Camera path {} does not exist", path);
+        return false;
+    }
+    keys.clear();
+    Json json = JsonUtil::fromFile(path);
+    for (const auto& keyJson : json["keys"]) {
+        auto& position = keyJson["position"];
+        auto& rotation = keyJson["rotation"];
+        //Rotation is stored w first like the camera of the scene config
+        keys.push_back({.position = {position[0], position[1], position[2]}, .rotation = glm::quat(rotation[0], rotation[1], rotation[2], rotation[3])});
+    }
+    LOGI("Loaded camera path {} with {} keys", path, keys.size());
+    return !keys.empty();
+}
+
+bool CameraPath::save(const std::string& path) const {
+    Json json;
+    json["keys"] = Json::array();
+    for (const auto& key : keys) {
+        json["keys"].push_back({{"position", {key.position.x, key.position.y, key.position.z}},
+                                {"rotation", {key.rotation.w, key.rotation.x, key.rotation.y, key.rotation.z}}});
+    }
+    JsonUtil::toFile(path, json);
+    LOGI("Saved camera path with {} keys to {}", keys.size(), path);
+    return true;
+}
+
+void CameraPath::record(const Camera& camera) {
+    const auto& transform = *camera.getTransform();
+    keys.push_back({.position = transform.getPosition(), .rotation = transform.getRotation()});
+}
+
+void CameraPath::apply(Camera& camera, uint32_t frame, uint32_t frameCount) const {
+    if (keys.empty())
+        return;
+    float t     = frameCount > 1 ? float(frame) / float(frameCount - 1) * float(keys.size() - 1) : 0.0f;
+    auto  index = std::min(static_cast<uint32_t>(t), static_cast<uint32_t>(keys.size() - 1));
+    auto  next  = std::min(index + 1, static_cast<uint32_t>(keys.size() - 1));
+    float alpha = t - float(index);
+
+    auto& transform = *camera.getTransform();
+    transform.setPosition(glm::mix(keys[index].position, keys[next].position, alpha));
+    transform.setRotation(glm::slerp(keys[index].rotation, keys[next].rotation, alpha));
+    camera.updateViewMatrix();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+
+#include <string>
+#include <vector>
+
+class Camera;
+
+/**
+ * Camera poses recorded frame by frame, replayed by the benchmark mode. Playback stretches the keys over the frame
+ * count, positions are interpolated linearly and rotations spherically. Saved as json next to the scene config.
+ */
+class CameraPath {
+public:
+    struct Key {
+        glm::vec3 position{0};
+        glm::quat rotation{1, 0, 0, 0};
+    };
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    void record(const Camera& camera);
+    void clear() { keys.clear(); }
+    //frame in [0,frameCount) is mapped onto the whole path
+    void apply(Camera& camera, uint32_t frame, uint32_t frameCount) const;
+
+    bool     empty() const { return keys.empty(); }
+    uint32_t getKeyCount() const { return keys.size(); }
+
+private:
+    std::vector<Key> keys;
+};
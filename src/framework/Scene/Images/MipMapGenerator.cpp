@@ -0,0 +1,247 @@
+#include "MipMapGenerator.h"
+
+#include "IO/ImageIO.h"
+#include "Common/samplerCPP/ThreadPool.h"
+
+#include <gtc/packing.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MIP_USE_SSE 1
+    #include <emmintrin.h>
+    #if defined(__F16C__)
+        #include <immintrin.h>
+    #endif
+#endif
+
+//Destination rows of one job
+static constexpr uint32_t ROWS_PER_JOB = 32;
+
+#ifdef MIP_USE_SSE
+using Float4 = __m128;
+static inline Float4 Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+static inline Float4 Quarter(Float4 a) { return _mm_mul_ps(a, _mm_set1_ps(0.25f)); }
+static inline Float4 LoadFloat4(const float* src) { return _mm_loadu_ps(src); }
+static inline void   StoreFloat4(float* dst, Float4 value) { _mm_storeu_ps(dst, value); }
+#else
+struct Float4 {
+    float v[4];
+};
+static inline Float4 Add(Float4 a, Float4 b) { return {a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}; }
+static inline Float4 Quarter(Float4 a) { return {a.v[0] * 0.25f, a.v[1] * 0.25f, a.v[2] * 0.25f, a.v[3] * 0.25f}; }
+static inline Float4 LoadFloat4(const float* src) { return {src[0], src[1], src[2], src[3]}; }
+static inline void   StoreFloat4(float* dst, Float4 value) { std::memcpy(dst, value.v, sizeof(value.v)); }
+#endif
+
+//Texel codecs, each converts a texel to linear float rgba and back
+struct Rgba32fCodec {
+    static constexpr uint32_t SIZE = 16;
+    static Float4             load(const uint8_t* src) { return LoadFloat4(reinterpret_cast<const float*>(src)); }
+    static void               store(uint8_t* dst, Float4 value) { StoreFloat4(reinterpret_cast<float*>(dst), value); }
+};
+
+struct Rgba16fCodec {
+    static constexpr uint32_t SIZE = 8;
+#if defined(MIP_USE_SSE) && defined(__F16C__)
+    static Float4 load(const uint8_t* src) { return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))); }
+    static void   store(uint8_t* dst, Float4 value) { _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT)); }
+#else
+    static Float4 load(const uint8_t* src) {
+        uint64_t packed;
+        std::memcpy(&packed, src, sizeof(packed));
+        glm::vec4 value = glm::unpackHalf4x16(packed);
+        return LoadFloat4(&value.x);
+    }
+    static void store(uint8_t* dst, Float4 value) {
+        glm::vec4 unpacked;
+        StoreFloat4(&unpacked.x, value);
+        uint64_t packed = glm::packHalf4x16(unpacked);
+        std::memcpy(dst, &packed, sizeof(packed));
+    }
+#endif
+};
+
+struct Srgb8Codec {
+    static constexpr uint32_t SIZE = 4;
+
+    static const std::array<float, 256>& toLinear() {
+        static const auto table = [] {
+            std::array<float, 256> table{};
+            for (uint32_t i = 0; i < 256; i++) {
+                float c  = i / 255.0f;
+                table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return table;
+        }();
+        return table;
+    }
+
+    //Indexed by linear * 65535, fine enough that the darkest step stays below an 8 bit unit
+    static const std::vector<uint8_t>& toSrgb() {
+        static const auto table = [] {
+            std::vector<uint8_t> table(65536);
+            for (uint32_t i = 0; i < table.size(); i++) {
+                float l  = i / 65535.0f;
+                float c  = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                table[i] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+            }
+            return table;
+        }();
+        return table;
+    }
+
+    static Float4 load(const uint8_t* src) {
+        const auto& table = toLinear();
+        float       value[4]{table[src[0]], table[src[1]], table[src[2]], src[3] / 255.0f};
+        return LoadFloat4(value);
+    }
+
+    static void store(uint8_t* dst, Float4 value) {
+        const auto& table = toSrgb();
+        float       linear[4];
+        StoreFloat4(linear, value);
+        for (uint32_t c = 0; c < 3; c++)
+            dst[c] = table[static_cast<uint32_t>(std::clamp(linear[c], 0.0f, 1.0f) * 65535.0f + 0.5f)];
+        dst[3] = static_cast<uint8_t>(std::clamp(linear[3], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+};
+
+struct Unorm8Codec {
+    static constexpr uint32_t SIZE = 4;
+    static Float4             load(const uint8_t* src) {
+        float value[4]{float(src[0]), float(src[1]), float(src[2]), float(src[3])};
+        return LoadFloat4(value);
+    }
+    static void store(uint8_t* dst, Float4 value) {
+        float sum[4];
+        StoreFloat4(sum, value);
+        for (uint32_t c = 0; c < 4; c++)
+            dst[c] = static_cast<uint8_t>(std::clamp(sum[c], 0.0f, 255.0f) + 0.5f);
+    }
+};
+
+template<typename Codec>
+static void DownsampleTexel(const uint8_t* row0, const uint8_t* row1, uint32_t column0, uint32_t column1, uint8_t* dst) {
+    Float4 top    = Add(Codec::load(row0 + column0 * Codec::SIZE), Codec::load(row0 + column1 * Codec::SIZE));
+    Float4 bottom = Add(Codec::load(row1 + column0 * Codec::SIZE), Codec::load(row1 + column1 * Codec::SIZE));
+    Codec::store(dst, Quarter(Add(top, bottom)));
+}
+
+template<typename Codec>
+static void DownsampleRows(const uint8_t* src, VkExtent2D srcExtent, uint8_t* dst, VkExtent2D dstExtent, uint32_t rowBegin, uint32_t rowEnd) {
+    for (uint32_t y = rowBegin; y < rowEnd; y++) {
+        const uint8_t* row0   = src + size_t(std::min(2 * y, srcExtent.height - 1)) * srcExtent.width * Codec::SIZE;
+        const uint8_t* row1   = src + size_t(std::min(2 * y + 1, srcExtent.height - 1)) * srcExtent.width * Codec::SIZE;
+        uint8_t*       dstRow = dst + size_t(y) * dstExtent.width * Codec::SIZE;
+        for (uint32_t x = 0; x < dstExtent.width; x++)
+            DownsampleTexel<Codec>(row0, row1, std::min(2 * x, srcExtent.width - 1), std::min(2 * x + 1, srcExtent.width - 1), dstRow + x * Codec::SIZE);
+    }
+}
+
+//Unorm rgba8 stays in integers, two destination texels per iteration
+static void DownsampleRowsUnorm8(const uint8_t* src, VkExtent2D srcExtent, uint8_t* dst, VkExtent2D dstExtent, uint32_t rowBegin, uint32_t rowEnd) {
+    for (uint32_t y = rowBegin; y < rowEnd; y++) {
+        const uint8_t* row0   = src + size_t(std::min(2 * y, srcExtent.height - 1)) * srcExtent.width * 4;
+        const uint8_t* row1   = src + size_t(std::min(2 * y + 1, srcExtent.height - 1)) * srcExtent.width * 4;
+        uint8_t*       dstRow = dst + size_t(y) * dstExtent.width * 4;
+        uint32_t       x      = 0;
+#ifdef MIP_USE_SSE
+        const __m128i zero  = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(2);
+        for (; x + 1 < dstExtent.width && 2 * x + 3 < srcExtent.width; x += 2) {
+            __m128i top    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+            __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+            __m128i lo     = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            __m128i hi     = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+            lo             = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+            hi             = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+            __m128i sum    = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dstRow + x * 4), _mm_packus_epi16(sum, sum));
+        }
+#endif
+        for (; x < dstExtent.width; x++)
+            DownsampleTexel<Unorm8Codec>(row0, row1, std::min(2 * x, srcExtent.width - 1), std::min(2 * x + 1, srcExtent.width - 1), dstRow + x * 4);
+    }
+}
+
+bool MipMapGenerator::isFormatSupported(VkFormat format) {
+    return getTexelSize(format) != 0;
+}
+
+uint32_t MipMapGenerator::getTexelSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+void MipMapGenerator::downsample(VkFormat format, const uint8_t* src, VkExtent2D srcExtent, uint8_t* dst, VkExtent2D dstExtent, uint32_t rowBegin, uint32_t rowEnd) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            DownsampleRows<Srgb8Codec>(src, srcExtent, dst, dstExtent, rowBegin, rowEnd);
+            break;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+            DownsampleRowsUnorm8(src, srcExtent, dst, dstExtent, rowBegin, rowEnd);
+            break;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            DownsampleRows<Rgba16fCodec>(src, srcExtent, dst, dstExtent, rowBegin, rowEnd);
+            break;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            DownsampleRows<Rgba32fCodec>(src, srcExtent, dst, dstExtent, rowBegin, rowEnd);
+            break;
+        default:
+            break;
+    }
+}
+
+void MipMapGenerator::generate(VkFormat format, VkExtent3D extent, uint32_t layers, std::vector<uint8_t>& data, std::vector<Mipmap>& mipmaps) {
+    uint32_t texelSize = getTexelSize(format);
+
+    //Size of the whole chain first, data is not reallocated while jobs read and write it
+    std::vector<VkExtent2D> extents{{extent.width, extent.height}};
+    while (extents.back().width > 1 || extents.back().height > 1)
+        extents.push_back({std::max(1u, extents.back().width / 2), std::max(1u, extents.back().height / 2)});
+
+    std::vector<uint32_t> levelOffsets;
+    uint32_t              size = 0;
+    for (const auto& levelExtent : extents) {
+        levelOffsets.push_back(size);
+        size += levelExtent.width * levelExtent.height * texelSize * layers;
+    }
+    data.resize(size);
+
+    auto levelSize = [&](uint32_t level) { return extents[level].width * extents[level].height * texelSize; };
+
+    mipmaps.clear();
+    for (uint32_t level = 0; level < extents.size(); level++) {
+        for (uint32_t layer = 0; layer < layers; layer++)
+            mipmaps.push_back({level, levelOffsets[level] + layer * levelSize(level), {extents[level].width, extents[level].height, 1}});
+        if (level == 0)
+            continue;
+
+        uint32_t jobsPerLayer = (extents[level].height + ROWS_PER_JOB - 1) / ROWS_PER_JOB;
+        ThreadPool::ParallelFor(jobsPerLayer * layers, [&](uint32_t job) {
+            uint32_t layer    = job / jobsPerLayer;
+            uint32_t rowBegin = (job % jobsPerLayer) * ROWS_PER_JOB;
+            uint32_t rowEnd   = std::min(rowBegin + ROWS_PER_JOB, extents[level].height);
+            downsample(format,
+                       data.data() + levelOffsets[level - 1] + layer * levelSize(level - 1),
+                       extents[level - 1],
+                       data.data() + levelOffsets[level] + layer * levelSize(level),
+                       extents[level],
+                       rowBegin,
+                       rowEnd);
+        });
+    }
+}
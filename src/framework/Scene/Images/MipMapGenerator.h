@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <volk.h>
+
+struct Mipmap;
+
+/**
+ * Cpu mip chain builder, 2x2 box filter with sse kernels.
+ * sRGB formats are filtered in linear space, every level is split in row ranges over the shared thread pool.
+ */
+class MipMapGenerator {
+public:
+    static bool     isFormatSupported(VkFormat format);
+    static uint32_t getTexelSize(VkFormat format);
+
+    //Appends the chain down to 1x1 of every layer to data.
+    //data holds the level 0 of the layers one after another, mipmaps is rebuilt level major as SgImage expects
+    static void generate(VkFormat format, VkExtent3D extent, uint32_t layers, std::vector<uint8_t>& data, std::vector<Mipmap>& mipmaps);
+
+    //Rows [rowBegin, rowEnd) of the level below src, odd sizes clamp to the last row and column
+    static void downsample(VkFormat format, const uint8_t* src, VkExtent2D srcExtent, uint8_t* dst, VkExtent2D dstExtent, uint32_t rowBegin, uint32_t rowEnd);
+};
@@ -20,5 +20,7 @@ struct SceneLoadingConfig {
     glm::quat                       sceneRotation{1.0f, 0.0f, 0.0f, 0.0f};
     glm::vec3                       sceneScale{1.0f};
     bool loadLight{true};
+    //Images are tiled and streamed by the VirtualTexturePass, the scene textures only hold their mip tails
+    bool                            virtualTexture{false};
     LoadCallback                    loadCallback{nullptr};
 };
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "Core/Descriptor/DescriptorSet.h"
 #include "Core/Buffer.h"
 #include "Core/RenderContext.h"
+#include "Core/StagingRing.h"
 #include "Core/math.h"
 
 #include <ctpl_stl.h>
@@ -653,11 +654,8 @@ void GLTFLoadingImpl::processNode(const tinygltf::Node& node, const tinygltf::Mo
 
             LOGI("Primitive {} has {} vertices and {} indices {} {} material_idx", j, primVertexCount, curPrimitiveIndexCount, mIndexCount, primitive.material)
             auto transform          = modelTransforms[&node];
-            auto min = transform.getLocalToWorldMatrix() * glm::vec4(posMin, 1.0f);
-            auto max = transform.getLocalToWorldMatrix() * glm::vec4(posMax, 1.0f);
-            auto tempMin = glm::vec3(std::min(min.x, max.x), std::min(min.y, max.y), std::min(min.z, max.z));
-            auto tempMax = glm::vec3(std::max(min.x, max.x), std::max(min.y, max.y), std::max(min.z, max.z));
-            newPrimitive->setDimensions(tempMin, tempMax);
+            //All corners are transformed, gpu culling relies on the box enclosing the rotated primitive
+            newPrimitive->setDimensions(BBox(posMin, posMax).toWorld(transform.getLocalToWorldMatrix()));
             newPrimitive->transform = transform;
             sceneBBox.unite(newPrimitive->getDimensions());
             //     primitiveUniforms.push_back(newPrimitive->GetPerPrimitiveUniform());
@@ -836,7 +834,7 @@ void GLTFLoadingImpl::loadFromFile(const std::string& path) {
         primitiveUniforms.push_back(primitives[i]->GetPerPrimitiveUniform());
     }
 
-    sceneUniformBuffer = std::make_unique<Buffer>(device, sizeof(PerPrimitiveUniform) * primitiveUniforms.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, primitiveUniforms.data());
+    sceneUniformBuffer = std::make_unique<Buffer>(device, sizeof(PerPrimitiveUniform) * primitiveUniforms.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | getBufferUsageFlags(config), VMA_MEMORY_USAGE_CPU_TO_GPU, primitiveUniforms.data());
 
     if (cameras.empty()) {
         auto camera = std::make_shared<Camera>();
@@ -943,6 +941,8 @@ void GLTFLoadingImpl::loadImages(const std::filesystem::path& modelPath, std::sh
                 if (image.image.size() > 0)
                     return Texture::loadTextureFromMemoryWithoutInit(device, image.image, VkExtent3D{static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), 1});
                 //return Texture::loadTextureFromMemory(device, image.image, VkExtent3D{static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), 1});
+                else if (!image.uri.empty() && config.virtualTexture)
+                    return Texture::loadVirtualTextureWithoutInit(device, parentDir.string() + "/" + image.uri);
                 else if (!image.uri.empty())
                     return Texture::loadTextureFromFileWitoutInit(device, parentDir.string() + "/" + image.uri);
                 else {
@@ -955,11 +955,15 @@ void GLTFLoadingImpl::loadImages(const std::filesystem::path& modelPath, std::sh
     }
 
     auto reOrganize = thread_pool.push([this, futures](size_t) {
-        for (auto& future : *futures)
-            future.wait();
-        for (int i = 0; i < futures->size(); i++) {
-            textures.emplace_back(futures->operator[](i).get());
+        //Each texture is uploaded as soon as it is decoded and its cpu data released once copied to staging
+        auto stagingRing = Texture::createUploadRing(device);
+        for (auto& future : *futures) {
+            auto texture = future.get();
+            if (texture != nullptr)
+                Texture::initTextureStreamed(*stagingRing, texture);
+            textures.emplace_back(std::move(texture));
         }
+        stagingRing->wait();
 
         std::unordered_map<int, int> texIndexRemap;
         int                          validTextureCount = 0;
@@ -991,7 +995,6 @@ void GLTFLoadingImpl::loadImages(const std::filesystem::path& modelPath, std::sh
         }
 
         textures = std::move(remappedTextures);
-        Texture::initTexturesInOneSubmit(textures);
 
         sceneToLoad->setTextures(std::move(textures));
 
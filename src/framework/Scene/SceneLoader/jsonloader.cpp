@@ -463,10 +463,7 @@ void JsonLoader::loadPrimitives() {
 
         primitive->lightIndex = lightIndex;
         auto bbox             = primitiveData->bbox;
-        auto tempMin          = transform.getLocalToWorldMatrix() * glm::vec4(bbox.min(), 1.0f);
-        auto tempMax          = transform.getLocalToWorldMatrix() * glm::vec4(bbox.max(), 1.0f);
-        primitive->setDimensions(vec3(std::min(tempMin.x, tempMax.x), std::min(tempMin.y, tempMax.y), std::min(tempMin.z, tempMax.z)),
-                                 vec3(std::max(tempMin.x, tempMax.x), std::max(tempMin.y, tempMax.y), std::max(tempMin.z, tempMax.z)));
+        primitive->setDimensions(bbox.toWorld(transform.getLocalToWorldMatrix()));
         primitive->transform = transform;
         
         sceneBBox.unite(primitive->getDimensions());
@@ -503,7 +500,7 @@ void JsonLoader::loadPrimitives() {
 
 
     {
-        sceneUniformBuffer = std::make_unique<Buffer>(device, sizeof(PerPrimitiveUniform) * primitives.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        sceneUniformBuffer = std::make_unique<Buffer>(device, sizeof(PerPrimitiveUniform) * primitives.size(), GetBufferUsageFlags(config, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT), VMA_MEMORY_USAGE_CPU_TO_GPU);
         std::vector<PerPrimitiveUniform> uniforms;
         for (uint32_t i = 0; i < primitives.size(); i++) {
             PerPrimitiveUniform uniform;
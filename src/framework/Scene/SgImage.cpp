@@ -21,9 +21,11 @@
 #include "imgui.h"
 #include "Core/ResourceCachingHelper.h"
 #include "Images/AstcImageHelper.h"
+#include "Images/MipMapGenerator.h"
 #include "Images/KtxFormat.h"
 #include "Core/Buffer.h"
 #include "IO/ImageIO.h"
+#include "Core/CommandBuffer.h"
 struct CallbackData final {
     ktxTexture*          texture;
     std::vector<Mipmap>* mipmaps;
@@ -119,7 +121,8 @@ VkImageType GetImageType(VkImageViewType viewType) {
 }
 
 void SgImage::freeImageCpuData() {
-    mData.clear();
+    //clear keeps the capacity
+    std::vector<uint8_t>().swap(mData);
 }
 void SgImage::createVkImage(Device& device, uint32_t mipLevels, VkImageViewType imageViewType, VkImageCreateFlags flags) {
     assert(vkImage == nullptr && "Image has been created");
@@ -306,52 +309,63 @@ void SgImage::setArrayLevelCount(uint32_t layers) {
 }
 
 void SgImage::generateMipMapOnCpu() {
-    if (mipMaps.size() > 1 && mipMaps[0].isInitialized())
+    if (mipMaps.size() > layers && mipMaps[0].isInitialized())
         return;
     if (!needGenerateMipMap) return;
-    assert(mipMaps.size() == 1 && "Mipmaps already generated");
-
-    for (int i = 0; i < layers; i++) {
-        auto extent      = getExtent();
-        auto next_width  = std::max<uint32_t>(1u, extent.width / 2);
-        auto next_height = std::max<uint32_t>(1u, extent.height / 2);
-        auto channels    = 4;
-        auto next_size   = next_width * next_height * channels;
-        auto level       = 0;
-        while (true) {
-            // Make space for next mipmap
-            auto old_size = toUint32(mData.size());
-            mData.resize(old_size + next_size);
-
-            auto& prev_mipmap = mipMaps.back();
-            // Update mipmaps
-            Mipmap next_mipmap{};
-            next_mipmap.level  = level++;
-            next_mipmap.offset = old_size;
-            next_mipmap.extent = {next_width, next_height, 1u};
-
-            //todo
-
-            stbir_resize_uint8(mData.data() + prev_mipmap.offset, prev_mipmap.extent.width, prev_mipmap.extent.height, 0, mData.data() + next_mipmap.offset, next_mipmap.extent.width, next_mipmap.extent.height, 0, channels);
-            // Fill next mipmap memory
-            //            stbir_resize_uint8(data.data() + prev_mipmap.offset, prev_mipmap.extent.width, prev_mipmap.extent.height, 0,
-            //                               data.data() + next_mipmap.offset, next_mipmap.extent.width, next_mipmap.extent.height, 0,
-            //                               channels);
-
-            mipMaps.emplace_back(std::move(next_mipmap));
-
-            // Next mipmap values
-            next_width  = std::max<uint32_t>(1u, next_width / 2);
-            next_height = std::max<uint32_t>(1u, next_height / 2);
-            next_size   = next_width * next_height * channels;
-
-            if (next_width <= 1 && next_height <= 1) {
-                break;
-            }
-        }
+    if (!MipMapGenerator::isFormatSupported(format)) {
+        LOGW("Cpu mipmaps not supported for format {} of {}, keeping a single level", static_cast<int>(format), name);
+        needGenerateMipMap = false;
+        return;
     }
+
+    MipMapGenerator::generate(format, mExtent3D, layers, mData, mipMaps);
+    needGenerateMipMap = false;
+}
+void SgImage::generateMipMapOnGpu(CommandBuffer& commandBuffer) {
+    uint32_t levelCount = vkImage->getMipLevelCount();
+    auto     levelRange = [this](uint32_t level) { return VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, layers}; };
+
+    int32_t width  = mExtent3D.width;
+    int32_t height = mExtent3D.height;
+    for (uint32_t level = 1; level < levelCount; level++) {
+        int32_t nextWidth  = std::max(1, width / 2);
+        int32_t nextHeight = std::max(1, height / 2);
+
+        vkImage->transitionLayout(commandBuffer, VulkanLayout::TRANSFER_SRC, levelRange(level - 1));
+        vkImage->transitionLayout(commandBuffer, VulkanLayout::TRANSFER_DST, levelRange(level));
+
+        VkImageBlit2 blit{VK_STRUCTURE_TYPE_IMAGE_BLIT_2};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, layers};
+        blit.srcOffsets[1]  = {width, height, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, layers};
+        blit.dstOffsets[1]  = {nextWidth, nextHeight, 1};
+
+        VkBlitImageInfo2 blitInfo{VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2};
+        blitInfo.srcImage       = vkImage->getHandle();
+        blitInfo.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        blitInfo.dstImage       = vkImage->getHandle();
+        blitInfo.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        blitInfo.regionCount    = 1;
+        blitInfo.pRegions       = &blit;
+        blitInfo.filter         = VK_FILTER_LINEAR;
+        vkCmdBlitImage2(commandBuffer.getHandle(), &blitInfo);
+
+        width  = nextWidth;
+        height = nextHeight;
+    }
+
+    //Levels end in different layouts, the whole range is tracked as READ_ONLY once each level is
+    for (uint32_t level = 0; level < levelCount; level++)
+        vkImage->transitionLayout(commandBuffer, VulkanLayout::READ_ONLY, levelRange(level));
+    vkImage->setLayout(VulkanLayout::READ_ONLY, {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, layers});
 }
-void SgImage::generateMipMapOnGpu() {
+
+bool SgImage::isMipMapBlitSupported() const {
+    constexpr VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), format, &properties);
+    return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
 }
 
 void SgImage::setExtent(const VkExtent3D& extent3D) {
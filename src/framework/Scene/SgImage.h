@@ -10,6 +10,8 @@
 #include "Core/Images/Image.h"
 #include "IO/ImageIO.h"
 
+class CommandBuffer;
+
 class SgImage {
 public:
     /**
@@ -88,7 +90,10 @@ public:
     void setArrayLevelCount(uint32_t layers);
 
     void generateMipMapOnCpu();
-    void generateMipMapOnGpu();
+    //Records the blit chain of every layer from level 0, which must be in TRANSFER_DST, and leaves the image READ_ONLY
+    void generateMipMapOnGpu(CommandBuffer& commandBuffer);
+    //Linear blits of the format, images that can not be blitted are mipmapped on the cpu before upload
+    bool isMipMapBlitSupported() const;
 
     void setExtent(const VkExtent3D& extent3D);
 
@@ -0,0 +1,197 @@
+#include "Scene/Images/MipMapGenerator.h"
+#include "IO/ImageIO.h"
+#include "Common/Log.h"
+#include "Common/Timer.h"
+#include "Common/samplerCPP/ThreadPool.h"
+
+#include <stb_image_resize.h>
+#include <gtc/packing.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+
+//Times the mip chain of MipMapGenerator against stb_image_resize for every supported format, on a random square
+//image whose size is the first argument, 4096 by default. stb runs its box filter with clamped edges and no alpha
+//weighting, the filter MipMapGenerator implements, so on power of two sizes both chains must agree to rounding
+
+struct FormatCase {
+    VkFormat    format;
+    const char* name;
+    //Largest difference allowed per channel, in 8 bit units or relative for the float formats.
+    //Every level is filtered from the rounded level above it, so rounding differences add up along the chain
+    double tolerance;
+};
+
+static std::vector<VkExtent2D> ChainExtents(uint32_t size) {
+    std::vector<VkExtent2D> extents{{size, size}};
+    while (extents.back().width > 1 || extents.back().height > 1)
+        extents.push_back({std::max(1u, extents.back().width / 2), std::max(1u, extents.back().height / 2)});
+    return extents;
+}
+
+//Every level after the first, one after another, as MipMapGenerator::generate lays out a single layer
+static std::vector<uint8_t> StbChain(VkFormat format, const std::vector<uint8_t>& level0, const std::vector<VkExtent2D>& extents) {
+    uint32_t             texelSize = MipMapGenerator::getTexelSize(format);
+    std::vector<uint8_t> chain     = level0;
+    std::vector<float>   src, dst;
+    size_t               srcOffset = 0;
+    for (uint32_t level = 1; level < extents.size(); level++) {
+        auto   srcExtent = extents[level - 1];
+        auto   dstExtent = extents[level];
+        size_t dstOffset = chain.size();
+        chain.resize(dstOffset + size_t(dstExtent.width) * dstExtent.height * texelSize);
+        const uint8_t* srcData = chain.data() + srcOffset;
+        uint8_t*       dstData = chain.data() + dstOffset;
+        switch (format) {
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                stbir_resize_uint8_generic(srcData, srcExtent.width, srcExtent.height, 0, dstData, dstExtent.width, dstExtent.height, 0, 4, STBIR_ALPHA_CHANNEL_NONE, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_BOX, STBIR_COLORSPACE_LINEAR, nullptr);
+                break;
+            case VK_FORMAT_R8G8B8A8_SRGB:
+                //Alpha stays linear, the premultiplied flag keeps stb from weighting the colors by it
+                stbir_resize_uint8_generic(srcData, srcExtent.width, srcExtent.height, 0, dstData, dstExtent.width, dstExtent.height, 0, 4, 3, STBIR_FLAG_ALPHA_PREMULTIPLIED, STBIR_EDGE_CLAMP, STBIR_FILTER_BOX, STBIR_COLORSPACE_SRGB, nullptr);
+                break;
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                stbir_resize_float_generic(reinterpret_cast<const float*>(srcData), srcExtent.width, srcExtent.height, 0, reinterpret_cast<float*>(dstData), dstExtent.width, dstExtent.height, 0, 4, STBIR_ALPHA_CHANNEL_NONE, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_BOX, STBIR_COLORSPACE_LINEAR, nullptr);
+                break;
+            case VK_FORMAT_R16G16B16A16_SFLOAT: {
+                //stb has no half floats, the conversions are part of its cost
+                src.resize(size_t(srcExtent.width) * srcExtent.height * 4);
+                dst.resize(size_t(dstExtent.width) * dstExtent.height * 4);
+                for (size_t i = 0; i < src.size(); i += 4) {
+                    uint64_t packed;
+                    std::memcpy(&packed, srcData + i * 2, sizeof(packed));
+                    auto value = glm::unpackHalf4x16(packed);
+                    std::memcpy(&src[i], &value.x, sizeof(value));
+                }
+                stbir_resize_float_generic(src.data(), srcExtent.width, srcExtent.height, 0, dst.data(), dstExtent.width, dstExtent.height, 0, 4, STBIR_ALPHA_CHANNEL_NONE, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_BOX, STBIR_COLORSPACE_LINEAR, nullptr);
+                for (size_t i = 0; i < dst.size(); i += 4) {
+                    uint64_t packed = glm::packHalf4x16(glm::vec4(dst[i], dst[i + 1], dst[i + 2], dst[i + 3]));
+                    std::memcpy(dstData + i * 2, &packed, sizeof(packed));
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        srcOffset = dstOffset;
+    }
+    return chain;
+}
+
+//MipMapGenerator kernels on the calling thread only
+static std::vector<uint8_t> SerialChain(VkFormat format, const std::vector<uint8_t>& level0, const std::vector<VkExtent2D>& extents) {
+    uint32_t             texelSize = MipMapGenerator::getTexelSize(format);
+    std::vector<uint8_t> chain     = level0;
+    size_t               srcOffset = 0;
+    for (uint32_t level = 1; level < extents.size(); level++) {
+        size_t dstOffset = chain.size();
+        chain.resize(dstOffset + size_t(extents[level].width) * extents[level].height * texelSize);
+        MipMapGenerator::downsample(format, chain.data() + srcOffset, extents[level - 1], chain.data() + dstOffset, extents[level], 0, extents[level].height);
+        srcOffset = dstOffset;
+    }
+    return chain;
+}
+
+static double ChannelDifference(VkFormat format, const uint8_t* a, const uint8_t* b, uint32_t channel) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return std::abs(int(a[channel]) - int(b[channel]));
+        case VK_FORMAT_R16G16B16A16_SFLOAT: {
+            uint16_t ha, hb;
+            std::memcpy(&ha, a + channel * 2, 2);
+            std::memcpy(&hb, b + channel * 2, 2);
+            float fa = glm::unpackHalf1x16(ha), fb = glm::unpackHalf1x16(hb);
+            return std::abs(fa - fb) / std::max(std::abs(fa), 1e-3f);
+        }
+        case VK_FORMAT_R32G32B32A32_SFLOAT: {
+            float fa, fb;
+            std::memcpy(&fa, a + channel * 4, 4);
+            std::memcpy(&fb, b + channel * 4, 4);
+            return std::abs(fa - fb) / std::max(std::abs(fa), 1e-6f);
+        }
+        default:
+            return 0;
+    }
+}
+
+static double MaxDifference(VkFormat format, const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    if (a.size() != b.size())
+        return INFINITY;
+    uint32_t texelSize = MipMapGenerator::getTexelSize(format);
+    double   maxDiff   = 0;
+    for (size_t texel = 0; texel < a.size(); texel += texelSize)
+        for (uint32_t channel = 0; channel < 4; channel++)
+            maxDiff = std::max(maxDiff, ChannelDifference(format, a.data() + texel, b.data() + texel, channel));
+    return maxDiff;
+}
+
+static std::vector<uint8_t> RandomLevel(VkFormat format, uint32_t size) {
+    std::mt19937         rng(size);
+    std::vector<uint8_t> data(size_t(size) * size * MipMapGenerator::getTexelSize(format));
+    if (format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB) {
+        std::uniform_int_distribution<uint32_t> dist(0, 255);
+        for (auto& value : data)
+            value = static_cast<uint8_t>(dist(rng));
+        return data;
+    }
+    //Hdr range, well inside the half float limits
+    std::uniform_real_distribution<float> dist(0.0f, 64.0f);
+    for (size_t i = 0; i < data.size() / MipMapGenerator::getTexelSize(format) * 4; i++) {
+        float value = dist(rng);
+        if (format == VK_FORMAT_R16G16B16A16_SFLOAT) {
+            uint16_t half = glm::packHalf1x16(value);
+            std::memcpy(data.data() + i * 2, &half, 2);
+        } else {
+            std::memcpy(data.data() + i * 4, &value, 4);
+        }
+    }
+    return data;
+}
+
+int main(int argc, char** argv) {
+    uint32_t size = argc > 1 ? std::stoul(argv[1]) : 4096;
+    if (size == 0 || (size & (size - 1)) != 0) {
+        LOGW("Size {} is not a power of two, stb and the box filter only agree on power of two sizes", size);
+        return 1;
+    }
+
+    const FormatCase formats[] = {
+        {VK_FORMAT_R8G8B8A8_UNORM, "rgba8 unorm", 1},
+        {VK_FORMAT_R8G8B8A8_SRGB, "rgba8 srgb", 1},
+        {VK_FORMAT_R16G16B16A16_SFLOAT, "rgba16f", 2.0 / 1024},
+        {VK_FORMAT_R32G32B32A32_SFLOAT, "rgba32f", 1e-5},
+    };
+
+    auto extents = ChainExtents(size);
+    bool match   = true;
+    LOGI("{}x{} chain, {} levels, {} pool threads", size, size, extents.size(), ThreadPool::GetThreadPool().size());
+    for (const auto& formatCase : formats) {
+        auto level0 = RandomLevel(formatCase.format, size);
+
+        Timer timer;
+        timer.start();
+        auto   stbChain = StbChain(formatCase.format, level0, extents);
+        double stbMs    = timer.stop<Timer::Milliseconds>();
+
+        timer.start();
+        auto   serialChain = SerialChain(formatCase.format, level0, extents);
+        double serialMs    = timer.stop<Timer::Milliseconds>();
+
+        std::vector<uint8_t> chain = level0;
+        std::vector<Mipmap>  mipmaps;
+        timer.start();
+        MipMapGenerator::generate(formatCase.format, {size, size, 1}, 1, chain, mipmaps);
+        double poolMs = timer.stop<Timer::Milliseconds>();
+
+        double stbDiff    = MaxDifference(formatCase.format, stbChain, chain);
+        double serialDiff = MaxDifference(formatCase.format, serialChain, chain);
+        bool   formatOk   = stbDiff <= formatCase.tolerance && serialDiff == 0;
+        match &= formatOk;
+        LOGI("{:<12} stb {:>9.1f} ms  sse 1 thread {:>8.1f} ms ({:.1f}x)  sse pool {:>8.1f} ms ({:.1f}x)  max difference to stb {:.3g} {}",
+             formatCase.name, stbMs, serialMs, stbMs / serialMs, poolMs, stbMs / poolMs, stbDiff, formatOk ? "ok" : "MISMATCH");
+    }
+    return match ? 0 : 1;
+}
@@ -53,10 +53,14 @@ void PBRLab::drawFrame(RenderGraph& rg) {
             renderContext->bindPrimitiveGeom(context.commandBuffer, *cube).bindImageSampler(0, environmentCube->getImage().getVkImageView(), environmentCube->getSampler()).bindPushConstants(SkyBoxPushConstant{.exposure = exposure, .gamma = gamma});
             renderContext->flushAndDrawIndexed(context.commandBuffer, cube->indexCount, 1, 0, 0, 0);
         });
-    
+
+        mGpuCullingPass->render(rg);
+        mVirtualTexturePass->render(rg);
         for (auto& pass : mRenderPasses) {
             pass->render(rg);
         }
+        mGpuCullingPass->renderHiz(rg);
+        mVirtualTexturePass->renderFeedbackReadback(rg);
 }
 
 void PBRLab::prepare() {
@@ -87,6 +91,10 @@ void PBRLab::prepare() {
     for (auto& pass : mforwardRenderPasses) {
         pass->init();
     }
+    mGpuCullingPass = std::make_unique<GpuCullingPass>();
+    mGpuCullingPass->init();
+    mVirtualTexturePass = std::make_unique<VirtualTexturePass>();
+    mVirtualTexturePass->init();
 
     cube             = SceneLoaderInterface::loadSpecifyTypePrimitive(*device, "cube");
     std::string path = FileUtils::getResourcePath("pisa_cube.ktx");
@@ -103,6 +111,8 @@ void PBRLab::onUpdateGUI() {
     for (auto& pass : mRenderPasses) {
         pass->updateGui();
     }
+    mGpuCullingPass->updateGui();
+    mVirtualTexturePass->updateGui();
 
     auto file = gui->showFileDialog("Select a cubemap", {".ktx"});
 
@@ -6,6 +6,8 @@
 #include "App/Application.h"
 #include "Rendering/IBL.h"
 #include "RenderPasses/RenderPassBase.h"
+#include "RenderPasses/GpuCullingPass.h"
+#include "RenderPasses/VirtualTexturePass.h"
 /**
  * @class PBRLab
  * @brief A sample application demonstrating PBR (Physically Based Rendering) techniques.
@@ -31,6 +33,8 @@ public:
 protected:
     std::vector<std::unique_ptr<PassBase>> mRenderPasses;
     std::vector<std::unique_ptr<PassBase>> mforwardRenderPasses;
+    std::unique_ptr<GpuCullingPass>        mGpuCullingPass;
+    std::unique_ptr<VirtualTexturePass>    mVirtualTexturePass;
     void                                   onUpdateGUI() override;
     void                                   drawFrame(RenderGraph& renderGraph) override;
     std::unique_ptr<IBL>                   ibl;
@@ -1 +1,99 @@
-#include "ClusterCuller.h"
\ No newline at end of file
+#include "ClusterCuller.h"
+
+#include "imgui.h"
+#include "Common/ResourceCache.h"
+#include "Core/RenderContext.h"
+
+//Bounds the visible cluster buffers when many instances are drawn, clusters past it are dropped
+static constexpr uint32_t NANITE_MAX_VISIBLE_CLUSTERS = 1 << 20;
+
+template<typename T>
+static std::unique_ptr<Buffer> CreateStorageBuffer(std::span<const T> data) {
+    return std::make_unique<Buffer>(g_context->getDevice(), sizeof(T) * data.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, data.data());
+}
+
+void ClusterCuller::setMesh(const NaniteMesh& mesh) {
+    mClusterCount = mesh.getClusters().size();
+    if (mClusterCount == 0 || mesh.getNodes().empty())
+        return;
+    g_context->deferRelease(std::move(mNodeBuffer));
+    g_context->deferRelease(std::move(mGroupBuffer));
+    g_context->deferRelease(std::move(mGroupClusterBuffer));
+    g_context->deferRelease(std::move(mClusterBuffer));
+    mNodeBuffer         = CreateStorageBuffer(mesh.getNodes());
+    mGroupBuffer        = CreateStorageBuffer(mesh.getGroups());
+    mGroupClusterBuffer = CreateStorageBuffer(mesh.getGroupClusters());
+    mClusterBuffer      = CreateStorageBuffer(mesh.getClusters());
+    mMaxVisibleClusters = 0;
+}
+
+void ClusterCuller::updateVisibleClusterBuffers() {
+    uint32_t maxVisibleClusters = std::min<uint64_t>(uint64_t(mClusterCount) * mInstanceCuller.getInstanceCount(), NANITE_MAX_VISIBLE_CLUSTERS);
+    if (maxVisibleClusters == mMaxVisibleClusters)
+        return;
+    mMaxVisibleClusters = maxVisibleClusters;
+    //Frames in flight may still rasterize the clusters of the previous buffers
+    g_context->deferRelease(std::move(mVisibleClusterBuffer));
+    g_context->deferRelease(std::move(mDrawCommandBuffer));
+    g_context->deferRelease(std::move(mSwClusterBuffer));
+    auto& device          = g_context->getDevice();
+    mVisibleClusterBuffer = std::make_unique<Buffer>(device, sizeof(glm::uvec2) * mMaxVisibleClusters, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    mDrawCommandBuffer    = std::make_unique<Buffer>(device, sizeof(VkDrawIndirectCommand) * mMaxVisibleClusters, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    mSwClusterBuffer      = std::make_unique<Buffer>(device, sizeof(uint32_t) * mMaxVisibleClusters, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+void ClusterCuller::render(RenderGraph& rg) {
+    auto& blackBoard = rg.getBlackBoard();
+    if (mClusterCount == 0 || !blackBoard.contains(NANITE_QUEUE_STATE_NAME))
+        return;
+
+    updateVisibleClusterBuffers();
+    auto visibleClusters = rg.importBuffer(NANITE_VISIBLE_CLUSTERS_NAME, mVisibleClusterBuffer.get());
+    auto drawCommands    = rg.importBuffer(NANITE_DRAW_COMMANDS_NAME, mDrawCommandBuffer.get());
+    auto swClusters      = rg.importBuffer(NANITE_SW_CLUSTERS_NAME, mSwClusterBuffer.get());
+
+    rg.addComputePass(
+        "Nanite Cluster Cull Pass",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            builder.writeBuffer(blackBoard.getHandle(NANITE_QUEUE_STATE_NAME), BufferUsage::STORAGE);
+            builder.writeBuffer(blackBoard.getHandle(NANITE_NODE_TASKS_NAME), BufferUsage::STORAGE);
+            builder.writeBuffer(visibleClusters, BufferUsage::STORAGE);
+            builder.writeBuffer(drawCommands, BufferUsage::STORAGE);
+            builder.writeBuffer(swClusters, BufferUsage::STORAGE);
+            builder.readTexture(blackBoard.getHandle(mInstanceCuller.getHiz().getName()), TextureUsage::SAMPLEABLE);
+            settings.pipelineLayout = &rg.getDevice().getResourceCache().requestPipelineLayout(ShaderPipelineKey{"tinyNanite/persistent_cull.comp"});
+        },
+        [this](RenderPassContext& context) {
+            NaniteCullUniform uniform  = mInstanceCuller.getUniform();
+            uniform.maxVisibleClusters = mMaxVisibleClusters;
+            uniform.swRasterThreshold  = g_context->getDevice().isBufferInt64AtomicsSupported() ? mSwRasterThreshold : 0.0f;
+
+            BufferAllocation allocation = g_context->allocateBuffer(sizeof(NaniteCullUniform), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+            allocation.buffer->uploadData(&uniform, sizeof(NaniteCullUniform), allocation.offset);
+
+            const auto& hiz        = mInstanceCuller.getHiz();
+            auto&       hizSampler = g_context->getDevice().getResourceCache().requestSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, hiz.getMipCount());
+            g_context->bindBuffer(0, *allocation.buffer, allocation.offset, sizeof(NaniteCullUniform))
+                .bindBuffer(1, mInstanceCuller.getInstanceBuffer())
+                .bindBuffer(2, mInstanceCuller.getQueueStateBuffer())
+                .bindBuffer(3, mInstanceCuller.getNodeTaskBuffer())
+                .bindBuffer(4, *mNodeBuffer)
+                .bindBuffer(5, *mGroupBuffer)
+                .bindBuffer(6, *mGroupClusterBuffer)
+                .bindBuffer(7, *mClusterBuffer)
+                .bindBuffer(8, *mVisibleClusterBuffer)
+                .bindBuffer(9, *mDrawCommandBuffer)
+                .bindBuffer(10, *mSwClusterBuffer)
+                .bindImageSampler(0, hiz.getImage().getVkImageView(), hizSampler)
+                .flushAndDispatch(context.commandBuffer, mPersistentGroupCount, 1, 1);
+        });
+}
+
+void ClusterCuller::updateGui() {
+    int groupCount = mPersistentGroupCount;
+    if (ImGui::SliderInt("Persistent cull groups", &groupCount, 1, 1024))
+        mPersistentGroupCount = groupCount;
+    if (g_context->getDevice().isBufferInt64AtomicsSupported())
+        ImGui::SliderFloat("Software raster threshold (pixels)", &mSwRasterThreshold, 0.0f, 64.0f);
+    ImGui::Text("Nanite clusters: %d max visible: %d", mClusterCount, mMaxVisibleClusters);
+}
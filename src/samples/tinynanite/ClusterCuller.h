@@ -1,6 +1,51 @@
 #pragma once
 
-class ClusterCuller {
+#include "InstanceCuller.h"
+
+static const std::string NANITE_VISIBLE_CLUSTERS_NAME = "nanite_visible_clusters";
+static const std::string NANITE_DRAW_COMMANDS_NAME    = "nanite_draw_commands";
+static const std::string NANITE_SW_CLUSTERS_NAME      = "nanite_sw_clusters";
+
+/**
+ * Persistent threads traversal of the cluster hierarchy of the instances queued by the InstanceCuller.
+ * A node child is visited while the projected error of its subtree is above the lod threshold and its box passes the
+ * frustum and Hi-Z tests, a cluster of a reached group is drawn once its own projected error is under the threshold.
+ * A visible cluster smaller on screen than the software raster threshold is appended to the software clusters, the
+ * others get one VkDrawIndirectCommand each. The draw count and the software dispatch are left in the queue state.
+ */
+class ClusterCuller : public PassBase {
 public:
-    
+    explicit ClusterCuller(const InstanceCuller& instanceCuller) : mInstanceCuller(instanceCuller) {}
+
+    void render(RenderGraph& rg) override;
+    void updateGui() override;
+
+    void setMesh(const NaniteMesh& mesh);
+
+    const Buffer& getClusterBuffer() const { return *mClusterBuffer; }
+    const Buffer& getVisibleClusterBuffer() const { return *mVisibleClusterBuffer; }
+    const Buffer& getDrawCommandBuffer() const { return *mDrawCommandBuffer; }
+    const Buffer& getSwClusterBuffer() const { return *mSwClusterBuffer; }
+    uint32_t      getMaxVisibleClusters() const { return mMaxVisibleClusters; }
+
+protected:
+    //Sized for the instance count of the InstanceCuller
+    void updateVisibleClusterBuffers();
+
+    const InstanceCuller& mInstanceCuller;
+
+    std::unique_ptr<Buffer> mNodeBuffer;
+    std::unique_ptr<Buffer> mGroupBuffer;
+    std::unique_ptr<Buffer> mGroupClusterBuffer;
+    std::unique_ptr<Buffer> mClusterBuffer;
+    std::unique_ptr<Buffer> mVisibleClusterBuffer;
+    std::unique_ptr<Buffer> mDrawCommandBuffer;
+    std::unique_ptr<Buffer> mSwClusterBuffer;
+    uint32_t                mClusterCount{0};
+    uint32_t                mMaxVisibleClusters{0};
+
+    //Threads loop until the node queue is drained, the dispatch does not grow with the hierarchy
+    uint32_t mPersistentGroupCount{128};
+    //In pixels, the software rasterizer needs 64 bit buffer atomics
+    float mSwRasterThreshold{16.0f};
 };
@@ -1 +1,116 @@
-#include "InstanceCuller.h"
\ No newline at end of file
+#include "InstanceCuller.h"
+
+#include "imgui.h"
+#include "Common/ResourceCache.h"
+#include "Core/RenderContext.h"
+#include "Core/View.h"
+
+void CmdFillStorageBuffer(CommandBuffer& commandBuffer, const Buffer& buffer, uint32_t value) {
+    vkCmdFillBuffer(commandBuffer.getHandle(), buffer.getHandle(), 0, VK_WHOLE_SIZE, value);
+    VkBufferMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+    barrier.srcStageMask        = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    barrier.srcAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask        = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = buffer.getHandle();
+    barrier.size                = VK_WHOLE_SIZE;
+    VkDependencyInfo dependencyInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependencyInfo.bufferMemoryBarrierCount = 1;
+    dependencyInfo.pBufferMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(commandBuffer.getHandle(), &dependencyInfo);
+}
+
+void InstanceCuller::setInstances(const NaniteMesh& mesh, const std::vector<glm::mat4>& transforms) {
+    mInstanceCount = 0;
+    mRootNode      = mesh.getRootNode();
+    if (transforms.empty() || mesh.getNodes().empty() || mRootNode == NANITE_INVALID_INDEX)
+        return;
+
+    const BBox                  meshBounds = mesh.getBounds();
+    std::vector<NaniteInstance> instances;
+    for (const auto& transform : transforms) {
+        BBox  bounds = meshBounds.toWorld(transform);
+        float scale  = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+        instances.push_back({.model = transform, .boundsMin = glm::vec4(bounds.min(), scale), .boundsMax = glm::vec4(bounds.max(), 1.0f)});
+    }
+    mInstanceCount = instances.size();
+    //Every node is visited at most once per instance
+    mMaxNodeTasks = mInstanceCount * mesh.getNodes().size();
+
+    //Frames in flight may still cull with the previous buffers
+    g_context->deferRelease(std::move(mInstanceBuffer));
+    g_context->deferRelease(std::move(mQueueStateBuffer));
+    g_context->deferRelease(std::move(mNodeTaskBuffer));
+    auto& device      = g_context->getDevice();
+    mInstanceBuffer   = std::make_unique<Buffer>(device, sizeof(NaniteInstance) * mInstanceCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, instances.data());
+    mQueueStateBuffer = std::make_unique<Buffer>(device, sizeof(NaniteQueueState), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    mNodeTaskBuffer   = std::make_unique<Buffer>(device, sizeof(uint32_t) * 2 * mMaxNodeTasks, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+void InstanceCuller::render(RenderGraph& rg) {
+    if (mInstanceCount == 0)
+        return;
+
+    auto view       = g_manager->fetchPtr<View>("view");
+    auto queueState = rg.importBuffer(NANITE_QUEUE_STATE_NAME, mQueueStateBuffer.get());
+    auto nodeTasks  = rg.importBuffer(NANITE_NODE_TASKS_NAME, mNodeTaskBuffer.get());
+    auto hiz        = mHiz.import(rg);
+
+    const Camera* camera = view->getCamera();
+    const auto    planes = Frustum::GetPlanes(camera->viewProj());
+    std::copy(planes.begin(), planes.end(), mUniform.frustumPlanes);
+    mUniform.hizViewProj   = mHiz.getViewProj();
+    mUniform.viewProj      = camera->viewProj();
+    mUniform.viewportSize  = glm::vec2(g_context->getViewPortExtent().width, g_context->getViewPortExtent().height);
+    mUniform.cameraPos     = camera->getPosition();
+    mUniform.lodScale      = 0.5f * g_context->getViewPortExtent().height * std::abs(camera->proj()[1][1]);
+    mUniform.hizSize       = mHiz.getSize();
+    mUniform.hizMipCount   = mHiz.getMipCount();
+    mUniform.inverseDepth  = camera->useInverseDepth;
+    mUniform.flipY         = g_context->getFlipViewport();
+    mUniform.useOcclusion  = mOcclusion && mHiz.isValid(camera->useInverseDepth);
+    mUniform.lodThreshold  = mLodThreshold;
+    mUniform.nearPlane     = camera->getNearClipPlane();
+    mUniform.instanceCount = mInstanceCount;
+    mUniform.maxNodeTasks  = mMaxNodeTasks;
+    mUniform.rootNode      = mRootNode;
+
+    rg.addComputePass(
+        "Nanite Instance Cull Pass",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            builder.writeBuffer(queueState, BufferUsage::STORAGE);
+            builder.writeBuffer(nodeTasks, BufferUsage::STORAGE);
+            builder.readTexture(hiz, TextureUsage::SAMPLEABLE);
+            settings.pipelineLayout = &rg.getDevice().getResourceCache().requestPipelineLayout(ShaderPipelineKey{"tinyNanite/instance_cull.comp"});
+        },
+        [this](RenderPassContext& context) {
+            auto& commandBuffer = context.commandBuffer;
+
+            //Queues restart empty every frame, a task slot is ready once its instance is no longer invalid
+            CmdFillStorageBuffer(commandBuffer, *mQueueStateBuffer, 0);
+            CmdFillStorageBuffer(commandBuffer, *mNodeTaskBuffer, NANITE_INVALID_INDEX);
+
+            BufferAllocation allocation = g_context->allocateBuffer(sizeof(NaniteCullUniform), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+            allocation.buffer->uploadData(&mUniform, sizeof(NaniteCullUniform), allocation.offset);
+
+            auto& hizSampler = g_context->getDevice().getResourceCache().requestSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, mHiz.getMipCount());
+            g_context->bindBuffer(0, *allocation.buffer, allocation.offset, sizeof(NaniteCullUniform))
+                .bindBuffer(1, *mInstanceBuffer)
+                .bindBuffer(2, *mQueueStateBuffer)
+                .bindBuffer(3, *mNodeTaskBuffer)
+                .bindImageSampler(0, mHiz.getImage().getVkImageView(), hizSampler)
+                .flushAndDispatch(commandBuffer, (mInstanceCount + 63) / 64, 1, 1);
+        });
+}
+
+void InstanceCuller::renderHiz(RenderGraph& rg) {
+    mHiz.build(rg);
+}
+
+void InstanceCuller::updateGui() {
+    ImGui::Checkbox("Occlusion culling", &mOcclusion);
+    ImGui::SliderFloat("Lod error threshold (pixels)", &mLodThreshold, 0.25f, 16.0f);
+    ImGui::Text("Nanite instances: %d", mInstanceCount);
+}
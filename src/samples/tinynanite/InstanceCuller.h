@@ -1,6 +1,91 @@
 #pragma once
 
-class InstanceCuller {
+#include "NaniteMesh.h"
+#include "RenderPasses/HizPyramid.h"
+#include "RenderPasses/RenderPassBase.h"
+
+static const std::string NANITE_QUEUE_STATE_NAME = "nanite_queue_state";
+static const std::string NANITE_NODE_TASKS_NAME  = "nanite_node_tasks";
+
+struct NaniteInstance {
+    glm::mat4 model;
+    //World space box of the whole mesh, w of boundsMin holds the largest scale of the model matrix
+    glm::vec4 boundsMin;
+    glm::vec4 boundsMax;
+};
+
+//Mirrors nanite_cull.glsl, reset every frame
+struct NaniteQueueState {
+    uint32_t nodeReadOffset;
+    uint32_t nodeWriteOffset;
+    int32_t  nodeCount;
+    //Slots used in the visible clusters by both raster paths
+    uint32_t visibleClusterCount;
+    //Draw count of the hardware raster pass
+    uint32_t hwClusterCount;
+    //VkDispatchIndirectCommand of the software raster pass
+    uint32_t swClusterCount;
+    uint32_t swDispatchY;
+    uint32_t swDispatchZ;
+};
+
+//Mirrors nanite_cull.glsl, shared by the instance and the cluster culling
+struct NaniteCullUniform {
+    glm::mat4  hizViewProj;
+    glm::mat4  viewProj;
+    glm::vec4  frustumPlanes[6];
+    glm::vec3  cameraPos;
+    float      lodScale;
+    glm::ivec2 hizSize;
+    uint32_t   hizMipCount;
+    uint32_t   inverseDepth;
+    glm::vec2  viewportSize;
+    uint32_t   flipY;
+    uint32_t   useOcclusion;
+    float      lodThreshold;
+    float      nearPlane;
+    float      swRasterThreshold;
+    uint32_t   instanceCount;
+    uint32_t   maxNodeTasks;
+    uint32_t   maxVisibleClusters;
+    uint32_t   rootNode;
+};
+
+//Fills the whole buffer before it is read and written by the following compute shaders
+void CmdFillStorageBuffer(CommandBuffer& commandBuffer, const Buffer& buffer, uint32_t value);
+
+/**
+ * First step of the nanite culling. The instances of the mesh are tested against the frustum and the Hi-Z of the
+ * previous frame, every visible instance queues the root of the cluster hierarchy for the ClusterCuller.
+ * Owns the node queue, the culling uniform of the frame and the Hi-Z, renderHiz is called once the depth of the frame
+ * is written.
+ */
+class InstanceCuller : public PassBase {
 public:
-    
+    void render(RenderGraph& rg) override;
+    void renderHiz(RenderGraph& rg);
+    void updateGui() override;
+
+    void setInstances(const NaniteMesh& mesh, const std::vector<glm::mat4>& transforms);
+
+    const NaniteCullUniform& getUniform() const { return mUniform; }
+    const HizPyramid&        getHiz() const { return mHiz; }
+    const Buffer&            getInstanceBuffer() const { return *mInstanceBuffer; }
+    const Buffer&            getQueueStateBuffer() const { return *mQueueStateBuffer; }
+    const Buffer&            getNodeTaskBuffer() const { return *mNodeTaskBuffer; }
+    uint32_t                 getInstanceCount() const { return mInstanceCount; }
+
+protected:
+    std::unique_ptr<Buffer> mInstanceBuffer;
+    std::unique_ptr<Buffer> mQueueStateBuffer;
+    std::unique_ptr<Buffer> mNodeTaskBuffer;
+    uint32_t                mInstanceCount{0};
+    uint32_t                mMaxNodeTasks{0};
+    uint32_t                mRootNode{NANITE_INVALID_INDEX};
+
+    NaniteCullUniform mUniform{};
+    HizPyramid        mHiz{"nanite_hiz"};
+
+    bool  mOcclusion{true};
+    float mLodThreshold{1.0f};
 };
@@ -0,0 +1,100 @@
+#include "MeshAdjacency.h"
+
+#include <algorithm>
+#include <bit>
+
+static constexpr uint32_t INVALID_EDGE = 0xffffffffu;
+
+namespace {
+//Distinct directed edges, the slots of the table hold edge ids and the keys are compared in edgeKeys
+struct EdgeTable {
+    std::vector<uint32_t> slots;
+    std::vector<uint64_t> edgeKeys;
+    uint32_t              mask;
+
+    explicit EdgeTable(uint32_t maxEdges) {
+        //At most half full, probes stay short
+        slots.resize(std::bit_ceil(std::max(maxEdges * 2, 16u)), INVALID_EDGE);
+        mask = slots.size() - 1;
+        edgeKeys.reserve(maxEdges);
+    }
+
+    uint32_t firstSlot(uint64_t key) const {
+        return Murmur32({uint32_t(key), uint32_t(key >> 32)}) & mask;
+    }
+
+    uint32_t find(uint64_t key) const {
+        for (uint32_t slot = firstSlot(key);; slot = (slot + 1) & mask) {
+            if (slots[slot] == INVALID_EDGE || edgeKeys[slots[slot]] == key)
+                return slots[slot];
+        }
+    }
+
+    uint32_t findOrAdd(uint64_t key) {
+        for (uint32_t slot = firstSlot(key);; slot = (slot + 1) & mask) {
+            if (slots[slot] == INVALID_EDGE) {
+                slots[slot] = edgeKeys.size();
+                edgeKeys.push_back(key);
+                return slots[slot];
+            }
+            if (edgeKeys[slots[slot]] == key)
+                return slots[slot];
+        }
+    }
+};
+}// namespace
+
+MeshAdjacency BuildMeshAdjacency(std::span<const uint32_t> vertexKeys) {
+    const uint32_t cornerCount = vertexKeys.size();
+    auto           edgeKey     = [&](uint32_t corner) {
+        return uint64_t(vertexKeys[corner]) | (uint64_t(vertexKeys[cycle3(corner)]) << 32);
+    };
+
+    //Corners holding the same directed edge, grouped by edge id in corner order
+    EdgeTable             table(cornerCount);
+    std::vector<uint32_t> cornerEdges(cornerCount);
+    std::vector<uint32_t> edgeOffsets;
+    for (uint32_t corner = 0; corner < cornerCount; corner++)
+        cornerEdges[corner] = table.findOrAdd(edgeKey(corner));
+    const uint32_t edgeCount = table.edgeKeys.size();
+    edgeOffsets.resize(edgeCount + 1, 0);
+    for (uint32_t corner = 0; corner < cornerCount; corner++)
+        edgeOffsets[cornerEdges[corner] + 1]++;
+    for (uint32_t edge = 0; edge < edgeCount; edge++)
+        edgeOffsets[edge + 1] += edgeOffsets[edge];
+    std::vector<uint32_t> edgeCorners(cornerCount);
+    {
+        std::vector<uint32_t> cursor(edgeOffsets.begin(), edgeOffsets.end() - 1);
+        for (uint32_t corner = 0; corner < cornerCount; corner++)
+            edgeCorners[cursor[cornerEdges[corner]]++] = corner;
+    }
+
+    //The neighbours of a corner are the corners of its reversed edge. A degenerate edge is its own reverse, the
+    //corner itself is skipped
+    std::vector<uint32_t> reverseEdges(edgeCount);
+    for (uint32_t edge = 0; edge < edgeCount; edge++) {
+        uint64_t key       = table.edgeKeys[edge];
+        reverseEdges[edge] = table.find((key >> 32) | (key << 32));
+    }
+
+    MeshAdjacency adjacency;
+    adjacency.offsets.resize(cornerCount + 1, 0);
+    for (uint32_t corner = 0; corner < cornerCount; corner++) {
+        uint32_t edge    = cornerEdges[corner];
+        uint32_t reverse = reverseEdges[edge];
+        uint32_t count   = reverse == INVALID_EDGE ? 0 : edgeOffsets[reverse + 1] - edgeOffsets[reverse] - (reverse == edge ? 1 : 0);
+        adjacency.offsets[corner + 1] = adjacency.offsets[corner] + count;
+    }
+    adjacency.adjacency.resize(adjacency.offsets[cornerCount]);
+    for (uint32_t corner = 0; corner < cornerCount; corner++) {
+        uint32_t reverse = reverseEdges[cornerEdges[corner]];
+        if (reverse == INVALID_EDGE)
+            continue;
+        uint32_t* out = adjacency.adjacency.data() + adjacency.offsets[corner];
+        for (uint32_t i = edgeOffsets[reverse]; i < edgeOffsets[reverse + 1]; i++) {
+            if (edgeCorners[i] != corner)
+                *out++ = edgeCorners[i];
+        }
+    }
+    return adjacency;
+}
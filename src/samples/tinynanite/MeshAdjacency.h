@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glm.hpp>
+
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <vector>
+
+inline uint32_t MurmurFinalize32(uint32_t Hash) {
+    Hash ^= Hash >> 16;
+    Hash *= 0x85ebca6b;
+    Hash ^= Hash >> 13;
+    Hash *= 0xc2b2ae35;
+    Hash ^= Hash >> 16;
+    return Hash;
+}
+
+inline uint32_t Murmur32(std::initializer_list<uint32_t> InitList) {
+    uint32_t Hash = 0;
+    for (auto Element : InitList) {
+        Element *= 0xcc9e2d51;
+        Element = (Element << 15) | (Element >> (32 - 15));
+        Element *= 0x1b873593;
+
+        Hash ^= Element;
+        Hash = (Hash << 13) | (Hash >> (32 - 13));
+        Hash = Hash * 5 + 0xe6546b64;
+    }
+
+    return MurmurFinalize32(Hash);
+}
+
+//Equal positions hash the same, -0 and 0 included
+inline uint32_t HashPosition(const glm::vec3& Position) {
+    union {
+        float    f;
+        uint32_t i;
+    } x;
+    union {
+        float    f;
+        uint32_t i;
+    } y;
+    union {
+        float    f;
+        uint32_t i;
+    } z;
+
+    x.f = Position.x;
+    y.f = Position.y;
+    z.f = Position.z;
+
+    return Murmur32({Position.x == 0.0f ? 0u : x.i,
+                     Position.y == 0.0f ? 0u : y.i,
+                     Position.z == 0.0f ? 0u : z.i});
+}
+
+//Next corner of the same triangle
+inline uint32_t cycle3(uint32_t Value) {
+    uint32_t ValueMod3  = Value % 3;
+    uint32_t Value1Mod3 = (1 << ValueMod3) & 3;
+    return Value - ValueMod3 + Value1Mod3;
+}
+
+/**
+ * Edge adjacency of a triangle list in compressed sparse row form. Corner c stands for the edge from its vertex to the
+ * vertex of cycle3(c), two corners are adjacent when they hold the same edge in opposite directions.
+ * The neighbours of corner c are adjacency[offsets[c], offsets[c + 1]), sorted by corner index.
+ */
+struct MeshAdjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> adjacency;
+
+    uint32_t getCornerCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    std::span<const uint32_t> getNeighbors(uint32_t corner) const {
+        return {adjacency.data() + offsets[corner], adjacency.data() + offsets[corner + 1]};
+    }
+
+    size_t getMemorySize() const { return (offsets.capacity() + adjacency.capacity()) * sizeof(uint32_t); }
+};
+
+//vertexKeys holds one key per corner, vertices are the same when their keys are. HashPosition welds split vertices,
+//the vertex index keeps them apart. Edges are matched in an open addressing table, no allocation per corner or edge
+MeshAdjacency BuildMeshAdjacency(std::span<const uint32_t> vertexKeys);
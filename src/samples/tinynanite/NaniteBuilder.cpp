@@ -1,6 +1,8 @@
 #include "NaniteBuilder.h"
 
+#include "MeshAdjacency.h"
 #include "meshoptimizer.h"
+#include "Common/samplerCPP/ThreadPool.h"
 #include "Core/RenderContext.h"
 #include "Scene/SceneLoader/ObjLoader.hpp"
 #include "Scene/SceneLoader/SceneLoaderInterface.h"
@@ -8,45 +10,20 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <metis.h>
+#include <cstring>
+#include <mutex>
 #include <numeric>
 
+//Largest triangle count of a cluster, NANITE_MAX_CLUSTER_TRIANGLES of the shaders which pack the triangle of a cluster
+//in the visibility id with NANITE_VISIBILITY_TRIANGLE_BITS
 static constexpr uint32_t ClusterSize = 128;
+//Validates the adjacency and writes the clusters, groups and simplified meshes of the build steps as obj files.
+//Slow, only meant to debug the builder
+static constexpr bool     DebugNaniteBuild = false;
 
 struct BuildCluster {
 };
 
-struct AdjVertex {
-    std::unordered_set<uint32_t> adjVertices;
-};
-
-static __forceinline uint32_t MurmurFinalize32(uint32_t Hash) {
-    Hash ^= Hash >> 16;
-    Hash *= 0x85ebca6b;
-    Hash ^= Hash >> 13;
-    Hash *= 0xc2b2ae35;
-    Hash ^= Hash >> 16;
-    return Hash;
-}
-
-static __forceinline uint32_t Murmur32(std::initializer_list<uint32_t> InitList) {
-    uint32_t Hash = 0;
-    for (auto Element : InitList) {
-        Element *= 0xcc9e2d51;
-        Element = (Element << 15) | (Element >> (32 - 15));
-        Element *= 0x1b873593;
-
-        Hash ^= Element;
-        Hash = (Hash << 13) | (Hash >> (32 - 13));
-        Hash = Hash * 5 + 0xe6546b64;
-    }
-
-    return MurmurFinalize32(Hash);
-}
-
-size_t HashCombine(uint32_t hash0, uint32_t hash1) {
-    return size_t(hash0) | (size_t(hash1) << 32);
-}
-
 void SaveMeshInputDataToObj(const MeshInputData& meshData, const std::string& filePath) {
     std::ofstream file(filePath);
     if (!file.is_open()) {
@@ -110,125 +87,6 @@ void saveSignleClusterToObj(Cluster& cluster, const std::string& filename) {
     SaveMeshInputDataToObj(inputData, filename);
 }
 
-uint32_t HashPosition(const glm::vec3& Position) {
-    union {
-        float    f;
-        uint32_t i;
-    } x;
-    union {
-        float    f;
-        uint32_t i;
-    } y;
-    union {
-        float    f;
-        uint32_t i;
-    } z;
-
-    x.f = Position.x;
-    y.f = Position.y;
-    z.f = Position.z;
-
-    return Murmur32({Position.x == 0.0f ? 0u : x.i,
-                     Position.y == 0.0f ? 0u : y.i,
-                     Position.z == 0.0f ? 0u : z.i});
-}
-
-inline uint32_t cycle3(uint32_t Value) {
-    uint32_t ValueMod3  = Value % 3;
-    uint32_t Value1Mod3 = (1 << ValueMod3) & 3;
-    return Value - ValueMod3 + Value1Mod3;
-}
-
-struct PointHash {
-    std::unordered_map<size_t, std::vector<uint32_t>>                                    hashTable1;
-    std::unordered_map<size_t, std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3>>> debugPositionTable;
-    template<typename GerPosition, typename Function>
-    void ForAllMatching(uint32_t index, bool bAdd, GerPosition&& getPosition, Function&& callback) {
-
-        vec3 position0 = getPosition(index);
-        vec3 position1 = getPosition(cycle3(index));
-
-        uint32 hash0 = HashPosition(position0);
-        uint32 hash1 = HashPosition(position1);
-        auto   hash  = HashCombine(hash0, hash1);
-
-        if (hashTable1.contains(hash)) {
-            for (auto& anotherEdge : hashTable1[hash]) {
-                callback(index, anotherEdge);
-            }
-        } else {
-        }
-
-        hash = HashCombine(hash1, hash0);
-
-        if (bAdd) {
-            if (!hashTable1.contains(hash)) {
-                hashTable1[hash] = std::vector<uint32_t>();
-            }
-            hashTable1[hash].push_back(index);
-
-            // if(debugPositionTable.contains(hash)) {
-            //     debugPositionTable[hash].push_back({position0, position1, position2});
-            // } else {
-            //     debugPositionTable[hash] = std::vector<std::tuple<glm::vec3,glm::vec3,glm::vec3>>();
-            //     debugPositionTable[hash].push_back({position0, position1, position2});
-            // }
-        }
-    }
-
-    template<typename GerPosition, typename Function>
-    void ForAllMatchingPoint(uint32_t index, bool bAdd, GerPosition&& getPosition, Function&& callback) {
-        vec3 position0 = getPosition(index);
-        auto hash0     = HashPosition(position0);
-        if (hashTable1.contains(hash0)) {
-            for (auto& anotherEdge : hashTable1[hash0]) {
-                callback(index, anotherEdge);
-            }
-        }
-        if (bAdd) {
-            if (!hashTable1.contains(hash0)) {
-                hashTable1[hash0] = std::vector<uint32_t>();
-            }
-            hashTable1[hash0].push_back(index);
-
-            auto position1 = getPosition(cycle3(index));
-            auto position2 = getPosition(cycle3(cycle3(index)));
-            if (debugPositionTable.contains(hash0)) {
-                debugPositionTable[hash0].push_back({position0, position1, position2});
-            } else {
-               
-                if(position0 == position1 && position1 == position2) {
-                    int k = 1;
-                }
-                debugPositionTable[hash0] = std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3>>();
-                debugPositionTable[hash0].push_back({position0, position1, position2});
-            }
-        }
-    }
-};
-
-uint32_t getTriangleIndexByVertexIndex(uint32_t vertexIndex) {
-    return vertexIndex / 3;
-}
-
-template<typename GerPosition>
-GraphAdjancy buildAdjancy(std::span<uint32_t> indexes, GerPosition&& getPosition) {
-    GraphAdjancy graphData(indexes.size());
-    PointHash    hash;
-    for (uint32_t i = 0; i < indexes.size(); i += 3) {
-        for (int k = 0; k < 3; k++) {
-            hash.ForAllMatching(i + k, true, [&](uint32_t index) { return getPosition(index); }, [&](uint32_t edgeIndex, uint32_t otherEdgeIndex) { graphData.addEdge(edgeIndex, otherEdgeIndex); });
-        }
-    }
-    std::vector<uint32_t> adjOffsets;
-    uint32_t              offset = 0;
-    for (uint32_t i = 0; i < graphData.adjVertices.size(); i++) {
-        adjOffsets.push_back(offset);
-        offset += graphData.adjVertices[i].adjVertices.size();
-    }
-    return graphData;
-}
-
 // GraphAdjancy buildClusterGroupAdjancy(std::span<Cluster> clusters) {
 //     std::vector<ClusterExternEdge> externEdges;
 //     uint32_t                       externalEdgeCount = 0;
@@ -339,88 +197,6 @@ void checkTriangleAdjancy(const GraphPartitioner::FGraphData& graph, const std::
     }
 }
 
-void clusterTriangles2(std::vector<Cluster>& clusters, MeshInputData& InputMeshData, uint32_t baseTriangle, uint32_t numTriangles) {
-    if (numTriangles == 0) {
-        LOGE("No triangles to cluster");
-        return;
-    }
-
-    uint32_t targetClusterCount = std::max(1u, (numTriangles + ClusterSize - 1) / ClusterSize);
-
-    GraphPartitioner partitioner(numTriangles, targetClusterCount);
-    auto             graph = partitioner.NewGraph(numTriangles * 6);
-
-    if (!graph) {
-        LOGE("Failed to create graph");
-        return;
-    }
-
-    graph->AdjacencyOffset[0] = 0;
-
-    std::vector<std::vector<uint32_t>> triangleAdjacency(numTriangles);
-
-    for (uint32_t i = 0; i < numTriangles; i++) {
-        uint32_t i0 = InputMeshData.TriangleIndices[baseTriangle + i * 3 + 0];
-        uint32_t i1 = InputMeshData.TriangleIndices[baseTriangle + i * 3 + 1];
-        uint32_t i2 = InputMeshData.TriangleIndices[baseTriangle + i * 3 + 2];
-
-        for (uint32_t j = 0; j < numTriangles; j++) {
-            if (i == j) continue;
-
-            uint32_t j0 = InputMeshData.TriangleIndices[baseTriangle + j * 3 + 0];
-            uint32_t j1 = InputMeshData.TriangleIndices[baseTriangle + j * 3 + 1];
-            uint32_t j2 = InputMeshData.TriangleIndices[baseTriangle + j * 3 + 2];
-
-            bool isAdjacent = false;
-            isAdjacent |= (i0 == j0 && i1 == j1) || (i0 == j1 && i1 == j0);
-            isAdjacent |= (i1 == j1 && i2 == j2) || (i1 == j2 && i2 == j1);
-            isAdjacent |= (i2 == j2 && i0 == j0) || (i2 == j0 && i0 == j2);
-
-            if (isAdjacent) {
-                triangleAdjacency[i].push_back(j);
-            }
-        }
-    }
-
-    for (uint32_t i = 0; i < numTriangles; i++) {
-        const auto& adjacentTris = triangleAdjacency[i];
-
-        graph->AdjacencyOffset[i + 1] = graph->AdjacencyOffset[i] + adjacentTris.size();
-
-        for (uint32_t adjTri : adjacentTris) {
-            float weight = 1.0f;
-
-            graph->Adjacency.push_back(adjTri);
-            graph->AdjacencyCost.push_back(weight);
-        }
-    }
-
-    bool isValid = true;
-    for (uint32_t i = 0; i < numTriangles; i++) {
-        if (graph->AdjacencyOffset[i] > graph->AdjacencyOffset[i + 1]) {
-            LOGE("Invalid adjacency offset at {}", i);
-            isValid = false;
-            break;
-        }
-    }
-
-    if (!isValid) {
-        delete graph;
-        return;
-    }
-
-    LOGI("Graph stats:");
-    LOGI("  Triangles: {}", numTriangles);
-    LOGI("  Target clusters: {}", targetClusterCount);
-    LOGI("  Total edges: {}", graph->Adjacency.size());
-    LOGI("  Average edges per triangle: %.2f",
-         static_cast<float>(graph->Adjacency.size()) / numTriangles);
-
-    partitioner.partition(*graph);
-
-    delete graph;
-}
-
 Cluster InitClusterFromMeshInputData(MeshInputData& InputMeshData, uint32_t baseTriangle, uint32_t numTriangles) {
     Cluster cluster;
 
@@ -429,7 +205,7 @@ Cluster InitClusterFromMeshInputData(MeshInputData& InputMeshData, uint32_t base
             uint32_t globalIndex = InputMeshData.TriangleIndices[baseTriangle + i * 3 + k];
 
             // if (std::find(cluster.m_indexes.begin(), cluster.m_indexes.end(), globalIndex) == cluster.m_indexes.end()) {
-            cluster.m_indexes.push_back(globalIndex);
+            cluster.m_indexes.push_back(cluster.m_positions.size());
             cluster.m_positions.push_back(InputMeshData.Vertices.Positions[globalIndex]);
             cluster.m_normals.push_back(InputMeshData.Vertices.Normals[globalIndex]);
             cluster.m_uvs.push_back(InputMeshData.Vertices.UVs[globalIndex]);
@@ -449,6 +225,28 @@ Cluster InitClusterFromMeshInputData(MeshInputData& InputMeshData, uint32_t base
     return cluster;
 }
 
+// cluster 之间按共享边连接: 相邻的两个角属于不同 cluster 时计一次, 代价为共享边数, 每个 cluster 的连接按索引排序
+// triangleClusters 为每个三角形所在 cluster 在 clusters 中的索引
+void BuildClusterLinks(std::vector<Cluster>& clusters, const MeshAdjacency& adjacency, std::span<const uint32_t> triangleClusters) {
+    std::vector<uint64_t> links;
+    for (uint32_t corner = 0; corner < adjacency.getCornerCount(); corner++) {
+        uint32_t cluster = triangleClusters[corner / 3];
+        for (uint32_t neighbor : adjacency.getNeighbors(corner)) {
+            uint32_t neighborCluster = triangleClusters[neighbor / 3];
+            if (neighborCluster != cluster)
+                links.push_back((uint64_t(cluster) << 32) | neighborCluster);
+        }
+    }
+    std::sort(links.begin(), links.end());
+    for (size_t i = 0; i < links.size();) {
+        size_t end = i + 1;
+        while (end < links.size() && links[end] == links[i])
+            end++;
+        clusters[links[i] >> 32].m_links.push_back({uint32_t(links[i]), uint32_t(end - i)});
+        i = end;
+    }
+}
+
 void clusterTrianglesByMeshOpt(std::vector<Cluster>& clusters, MeshInputData& InputMeshData, uint32_t baseTriangle, uint32_t numTriangles) {
     const size_t                 max_vertices  = 64;
     const size_t                 max_triangles = 124;
@@ -527,270 +325,80 @@ void clusterTrianglesByMeshOpt(std::vector<Cluster>& clusters, MeshInputData& In
     // Optionally, you can log the number of clusters created
     LOGI("Created {} clusters from mesh optimization.", clusters.size() - initialClusterCount);
 
-    std::span<Cluster> clusterSpan(clusters.data() + initialClusterCount, clusters.size() - initialClusterCount);
-    //Build cluster adjancy
-
-    auto sum_triangle = std::accumulate(clusterSpan.begin(), clusterSpan.end(), 0, [](int sum, const Cluster& cluster) { return sum + cluster.getTriangleCount(); });
-
-    std::unordered_map<uint32_t, uint32_t> faceToCluster;
-    size_t                                 globalFaceOffset = 0;
-    for (size_t i = 0; i < clusterSpan.size(); i++) {
-        for (size_t j = 0; j < clusterSpan[i].getTriangleCount(); j++) {
-            if(globalFaceOffset + j == 835 / 3 ) {
-                int k = 1;
-            }
-            faceToCluster[globalFaceOffset + j] = i + initialClusterCount;
-        }
-        // std::fill(faceToCluster
-        clusterSpan[i].triangle_offset = globalFaceOffset;
-        globalFaceOffset += clusterSpan[i].getTriangleCount();
-    }
-    if(false)
-    {
-        GraphAdjancy adjancy(sum_triangle * 3);
-        PointHash    hash;
-
-        
-
-        globalFaceOffset = 0;
-        for (auto& meshlet : clusterSpan) {
-            for (size_t j = 0; j < meshlet.getTriangleCount(); ++j) {
-                uint indexOffset = globalFaceOffset + j * 3;
-                hash.ForAllMatchingPoint(indexOffset + 0, true, [&](uint32_t index) { return meshlet.m_positions[meshlet.m_indexes[index - globalFaceOffset]]; }, [&](uint32_t edgeIndex, uint32_t otherEdgeIndex) {
-                    auto face0 = edgeIndex / 3;
-                    auto face1 = otherEdgeIndex / 3;
-                    if (faceToCluster[face0] != faceToCluster[face1]) {
-                        adjancy.addEdge(edgeIndex, otherEdgeIndex);
-                    } });
-                hash.ForAllMatchingPoint(indexOffset + 1, true, [&](uint32_t index) { return meshlet.m_positions[meshlet.m_indexes[index - globalFaceOffset]]; }, [&](uint32_t edgeIndex, uint32_t otherEdgeIndex) {
-                    auto face0 = edgeIndex / 3;
-                    auto face1 = otherEdgeIndex / 3;
-                    if (faceToCluster[face0] != faceToCluster[face1]) {
-                        adjancy.addEdge(edgeIndex, otherEdgeIndex);
-                    } });
-                hash.ForAllMatchingPoint(indexOffset + 2, true, [&](uint32_t index) { return meshlet.m_positions[meshlet.m_indexes[index - globalFaceOffset]]; }, [&](uint32_t edgeIndex, uint32_t otherEdgeIndex) {
-                    auto face0 = edgeIndex / 3;
-                    auto face1 = otherEdgeIndex / 3;
-                    if (faceToCluster[face0] != faceToCluster[face1]) {
-                        adjancy.addEdge(edgeIndex, otherEdgeIndex);
-                    } });
-            }
-            globalFaceOffset += meshlet.getTriangleCount() * 3;
-        }
-        int index = 0;
-        int count  = 0;
-        for (auto& adj : adjancy.adjVertices) {
-            auto face         = index / 3;
-            auto clusterIndex = faceToCluster[face];
-            Triangle tri;
-            tri.position[0] = clusterSpan[clusterIndex].m_positions[clusterSpan[clusterIndex].m_indexes[index/3 * 3 -  clusterSpan[clusterIndex].triangle_offset *3 ]];
-            tri.position[1] = clusterSpan[clusterIndex].m_positions[clusterSpan[clusterIndex].m_indexes[index /3 * 3-   clusterSpan[clusterIndex].triangle_offset *3 + 1]];
-            tri.position[2] = clusterSpan[clusterIndex].m_positions[clusterSpan[clusterIndex].m_indexes[index/3 * 3 -   clusterSpan[clusterIndex].triangle_offset *3+ 2]];
-
-            int index_ = 0;
-            for (auto& adjIndex : adj.adjVertices) {
-                index_++;
-                auto anotherFace         = adjIndex / 3;
-                auto anotherClusterIndex = faceToCluster[anotherFace];
-                Triangle anotherTri;
-                anotherTri.position[0] = clusterSpan[anotherClusterIndex].m_positions[clusterSpan[anotherClusterIndex].m_indexes[adjIndex/3 * 3 -  clusterSpan[anotherClusterIndex].triangle_offset*3]];
-                anotherTri.position[1] = clusterSpan[anotherClusterIndex].m_positions[clusterSpan[anotherClusterIndex].m_indexes[adjIndex/3 * 3 -  clusterSpan[anotherClusterIndex].triangle_offset*3 + 1]];
-                anotherTri.position[2] = clusterSpan[anotherClusterIndex].m_positions[clusterSpan[anotherClusterIndex].m_indexes[adjIndex /3 * 3 - clusterSpan[anotherClusterIndex].triangle_offset*3 + 2]];
-
-                auto hash_ = HashPosition(tri.position[index % 3]);
-                auto & adj1 = hash.debugPositionTable[hash_];
-            
-                bool c = isTriangleAdjancy(tri, anotherTri);
-                if (!c) {
-                    LOGE("Triangle {} and {} is not adjancy", face, anotherFace);
-                }
-            
-                if (clusterIndex != anotherClusterIndex) {
-                    clusters[clusterIndex].m_linked_cluster.insert(anotherClusterIndex);
-                    if(clusters[clusterIndex].m_linked_cluster_cost.contains(anotherClusterIndex)) {
-                        clusters[clusterIndex].m_linked_cluster_cost[anotherClusterIndex] += 1;
-                    }
-                    else {
-                        clusters[clusterIndex].m_linked_cluster_cost[anotherClusterIndex] = 1;
-                    }
-                    clusters[clusterIndex].m_linked_cluster_vec.push_back(anotherClusterIndex);
-                    count++;
-                }
-            }
-            index++;
-        }
-
-        for(auto & cluster : clusters) {
-            LOGI("Cluster {} has {} linked clusters", cluster.guid, cluster.m_linked_cluster.size());
-        }
-        LOGI("Total adjancy count: {}", count);
-    }
-
-    {
-        GraphAdjancy adjancy(sum_triangle * 3);
-        adjancy.init(InputMeshData.TriangleIndices.size());
-        for(auto& cluster : clusters) {
-            for(auto i = 0;i<cluster.getTriangleCount();i++) {
-                uint face_id = cluster.triangle_offset + i;
-                glm::uvec3 tri = {cluster.origin_indexes[i * 3], cluster.origin_indexes[i * 3 + 1], cluster.origin_indexes[i * 3 + 2]};
-                adjancy.add_edge(tri.x, tri.y,face_id);
-                adjancy.add_edge(tri.y, tri.z,face_id);
-                adjancy.add_edge(tri.z, tri.x,face_id);
-            }
-        }
-
-        for (auto& edge : adjancy.adj_list) {
-            auto from = &edge - adjancy.adj_list.data();
-            for (auto [to, face0] : edge) {
-                auto reverse_edge = adjancy.adj_list[to];
-                if (reverse_edge.find(from) != reverse_edge.end()) {
-                    uint face1 = reverse_edge[from];
-                    auto mid1 = faceToCluster.find(face0)->second;
-                    auto mid2 = faceToCluster.find(face1)->second;
-                    if (mid1 != mid2) {
-                        clusters[mid1].m_linked_cluster.insert(mid2);
-                        if(clusters[mid1].m_linked_cluster_cost.contains(mid2)) {
-                            clusters[mid1].m_linked_cluster_cost[mid2] += 1;
-                        }
-                        else {
-                            clusters[mid1].m_linked_cluster_cost[mid2] = 1;
-                        }
-                        clusters[mid1].m_linked_cluster_vec.push_back(mid2);
-
-                        clusters[mid2].m_linked_cluster.insert(mid1);
-                        if(clusters[mid2].m_linked_cluster_cost.contains(mid1)) {
-                            clusters[mid2].m_linked_cluster_cost[mid1] += 1;
-                        }
-                        else {
-                            clusters[mid2].m_linked_cluster_cost[mid1] = 1;
-                        }
-                    }
-                }
-		
-            }
-        }
+    // 按原始顶点索引连接 cluster, meshopt 的划分也不焊接位置相同的顶点
+    std::span<Cluster>    clusterSpan(clusters.data() + initialClusterCount, clusters.size() - initialClusterCount);
+    std::vector<uint32_t> vertexKeys;
+    std::vector<uint32_t> triangleClusters;
+    for (uint32_t i = 0; i < clusterSpan.size(); i++) {
+        clusterSpan[i].triangle_offset = triangleClusters.size();
+        vertexKeys.insert(vertexKeys.end(), clusterSpan[i].origin_indexes.begin(), clusterSpan[i].origin_indexes.end());
+        triangleClusters.insert(triangleClusters.end(), clusterSpan[i].getTriangleCount(), initialClusterCount + i);
     }
+    BuildClusterLinks(clusters, BuildMeshAdjacency(vertexKeys), triangleClusters);
 }
 
 void clusterTriangles1(std::vector<Cluster>& clusters, MeshInputData& InputMeshData, uint32_t baseTriangle, uint32_t numTriangles) {
+    uint32_t targetClusterCount = (numTriangles + ClusterSize - 1) / ClusterSize;
 
-    GraphAdjancy graphData          = buildAdjancy(std::span<uint32_t>(InputMeshData.TriangleIndices.data() + baseTriangle, numTriangles * 3), [&](uint32_t index) {
-        return InputMeshData.Vertices.Positions[InputMeshData.TriangleIndices[index]];
-    });
-    uint32_t     targetClusterCount = numTriangles / ClusterSize;
-
-    if (targetClusterCount == 1) {
+    if (targetClusterCount <= 1) {
         clusters.push_back(InitClusterFromMeshInputData(InputMeshData, baseTriangle, numTriangles));
         return;
     }
 
+    // 位置相同的顶点视为同一顶点, 简化后的网格在 UV 接缝处仍然连通
+    std::vector<uint32_t> vertexKeys(numTriangles * 3);
+    for (uint32_t i = 0; i < numTriangles * 3; i++) {
+        vertexKeys[i] = HashPosition(InputMeshData.Vertices.Positions[InputMeshData.TriangleIndices[baseTriangle + i]]);
+    }
+    MeshAdjacency adjacency = BuildMeshAdjacency(vertexKeys);
+
+    // 每条共享边是三角形图的一条边, 直接写入 METIS 的数组
     GraphPartitioner partitioner(numTriangles, targetClusterCount);
-    auto             graph = partitioner.NewGraph(numTriangles * 3);
+    auto             graph = partitioner.NewGraph(adjacency.adjacency.size());
     for (uint32_t i = 0; i < numTriangles; i++) {
         graph->AdjacencyOffset[i] = graph->Adjacency.size();
         for (int k = 0; k < 3; k++) {
-            graphData.forAll(3 * i + k, [&](uint32_t edgeIndex0, uint32_t edgeIndex1) {
-                partitioner.addAdjacency(graph, edgeIndex1 / 3, 4 * 65);
-            });
+            for (uint32_t neighbor : adjacency.getNeighbors(3 * i + k)) {
+                partitioner.addAdjacency(graph, neighbor / 3, 4 * 65);
+            }
         }
     }
     graph->AdjacencyOffset[numTriangles] = graph->Adjacency.size();
 
-    checkTriangleAdjancy(*graph, InputMeshData.TriangleIndices, [&](uint32_t index) { return InputMeshData.Vertices.Positions[InputMeshData.TriangleIndices[index]]; });
-
-    SaveMeshInputDataToObj(InputMeshData, FileUtils::getFilePath("mesh", "obj"));
-
-    partitioner.partition(*graph);
-
-    struct ClusterAdjacency {
-        std::unordered_map<uint32_t, std::unordered_set<uint32_t>> adj_clusters;
-        std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> adj_clusters_cost;
+    if (DebugNaniteBuild) {
+        checkTriangleAdjancy(*graph, InputMeshData.TriangleIndices, [&](uint32_t index) { return InputMeshData.Vertices.Positions[InputMeshData.TriangleIndices[index]]; });
+        SaveMeshInputDataToObj(InputMeshData, FileUtils::getFilePath("mesh", "obj"));
+    }
 
-        void addEdge(uint32_t cluster1, uint32_t cluster2) {
-            if (cluster1 != cluster2) {
-                adj_clusters[cluster1].insert(cluster2);
-                adj_clusters[cluster2].insert(cluster1);
-                if(adj_clusters_cost[cluster1].contains(cluster2)) {
-                    adj_clusters_cost[cluster1][cluster2] += 1;
-                }
-                else {
-                    adj_clusters_cost[cluster1][cluster2] = 1;
-                }
-                if(adj_clusters_cost[cluster2].contains(cluster1)) {
-                    adj_clusters_cost[cluster2][cluster1] += 1;
-                }
-                else {
-                    adj_clusters_cost[cluster2][cluster1] = 1;
-                }
-            }
-        }
-    } clusterAdj;
+    //The parts are only balanced to a small tolerance, one over ClusterSize is partitioned again with one more part
+    while (true) {
+        partitioner.partition(*graph);
+        std::vector<uint32_t> partSizes(targetClusterCount, 0);
+        for (uint32_t i = 0; i < numTriangles; i++)
+            partSizes[partitioner.partitionIDs[i]]++;
+        if (*std::max_element(partSizes.begin(), partSizes.end()) <= ClusterSize)
+            break;
+        partitioner.targetPart = ++targetClusterCount;
+    }
 
-    std::vector<std::unordered_map<uint32_t, uint32_t>> oldToNewIndexMaps(targetClusterCount);
-    const uint32_t                                      oldClusterCount = clusters.size();
+    const uint32_t oldClusterCount = clusters.size();
     clusters.resize(clusters.size() + targetClusterCount);
 
+    std::vector<uint32_t> triangleClusters(numTriangles);
     for (uint32_t i = 0; i < numTriangles; i++) {
-        int   partId           = partitioner.partitionIDs[i];
-        auto  clusterId        = oldClusterCount + partId;
-        auto& oldToNewIndexMap = oldToNewIndexMaps[partId];
+        auto clusterId      = oldClusterCount + partitioner.partitionIDs[i];
+        triangleClusters[i] = clusterId;
 
         for (int k = 0; k < 3; k++) {
             uint32_t globalIndex = InputMeshData.TriangleIndices[baseTriangle + i * 3 + k];
-
-            // if (oldToNewIndexMap.find(globalIndex) == oldToNewIndexMap.end()) {
-            //     oldToNewIndexMap[globalIndex] = clusters[clusterId].m_positions.size();
             clusters[clusterId].m_positions.push_back(InputMeshData.Vertices.Positions[globalIndex]);
             clusters[clusterId].m_normals.push_back(InputMeshData.Vertices.Normals[globalIndex]);
             clusters[clusterId].m_uvs.push_back(InputMeshData.Vertices.UVs[globalIndex]);
-            //}
             clusters[clusterId].m_indexes.push_back(clusters[clusterId].m_positions.size() - 1);
         }
     }
 
-    // for(int i =oldClusterCount; i < clusters.size(); i++) {
-    //     int clusterId = i;
-    //     if(!clusters[clusterId].isConnected()) {
-    //         saveSignleClusterToObj(clusters[clusterId], FileUtils::getFilePath("disconnected_cluster", "obj"));
-    //         LOGE("Cluster {} is not connected", clusterId);
-    //     }
-    // }
-
-    for (uint32_t i = 0; i < numTriangles * 3; i++) {
-        uint32_t currentCluster = partitioner.partitionIDs[i / 3] + oldClusterCount;
-
-        graphData.forAll(i, [&](uint32_t edgeIndex0, uint32_t edgeIndex1) {
-            uint32_t neighborCluster = partitioner.partitionIDs[edgeIndex1 / 3] + oldClusterCount;
-            if (currentCluster != neighborCluster) {
-                clusterAdj.addEdge(currentCluster, neighborCluster);
-            }
-        });
-    }
-
-    for (const auto& [clusterId, adjClusters] : clusterAdj.adj_clusters) {
-        auto& cluster            = clusters[clusterId];
-        cluster.m_linked_cluster = adjClusters;
-        cluster.m_linked_cluster_cost = clusterAdj.adj_clusters_cost[clusterId];
-
-        for (auto adjClusterId : adjClusters) {
-            const auto& adjCluster = clusters[adjClusterId];
-
-            for (uint32_t i = 0; i < cluster.m_positions.size(); i++) {
-                const auto& pos = cluster.m_positions[i];
-
-                for (uint32_t j = 0; j < adjCluster.m_positions.size(); j++) {
-                    if (pos == adjCluster.m_positions[j]) {
-                        ClusterExternEdge edge;
-                        edge.v0           = i;
-                        edge.v1           = j;
-                        edge.clusterIndex = adjClusterId;
-                        cluster.m_external_edges.push_back(edge);
-                        break;
-                    }
-                }
-            }
-        }
-    }
+    BuildClusterLinks(clusters, adjacency, triangleClusters);
 
     for (uint32_t i = oldClusterCount; i < clusters.size(); i++) {
         auto& cluster = clusters[i];
@@ -811,183 +419,6 @@ void clusterTriangles1(std::vector<Cluster>& clusters, MeshInputData& InputMeshD
     delete graph;
 }
 
-void clusterTriangles3(std::vector<Cluster>& clusters, MeshInputData& InputMeshData, uint32_t baseTriangle, uint32_t numTriangles) {
-    if (numTriangles == 0) return;
-
-    uint32_t         targetClusterCount = std::max(1u, (numTriangles + ClusterSize - 1) / ClusterSize);
-    GraphPartitioner partitioner(numTriangles, targetClusterCount);
-    auto             graph = partitioner.NewGraph(numTriangles * 6);
-
-    struct Edge {
-        uint32_t v0, v1;
-
-        Edge(uint32_t a, uint32_t b) {
-            v0 = std::min(a, b);
-            v1 = std::max(a, b);
-        }
-
-        bool operator==(const Edge& other) const {
-            return (v0 == other.v0 && v1 == other.v1);
-        }
-    };
-
-    struct EdgeHash {
-        size_t operator()(const Edge& edge) const {
-            return (static_cast<size_t>(edge.v0) << 32) | edge.v1;
-        }
-    };
-
-    std::unordered_map<Edge, std::vector<uint32_t>, EdgeHash> edgeToTriangles;
-    edgeToTriangles.reserve(numTriangles * 3);
-
-    for (uint32_t triIdx = 0; triIdx < numTriangles; triIdx++) {
-        uint32_t idx = baseTriangle + triIdx * 3;
-        uint32_t i0  = InputMeshData.TriangleIndices[idx + 0];
-        uint32_t i1  = InputMeshData.TriangleIndices[idx + 1];
-        uint32_t i2  = InputMeshData.TriangleIndices[idx + 2];
-
-        edgeToTriangles[Edge(i0, i1)].push_back(triIdx);
-        edgeToTriangles[Edge(i1, i2)].push_back(triIdx);
-        edgeToTriangles[Edge(i2, i0)].push_back(triIdx);
-    }
-
-    std::vector<std::vector<std::pair<uint32_t, float>>> triangleAdjacency(numTriangles);
-
-    for (const auto& pair : edgeToTriangles) {
-        const auto& triangles = pair.second;
-        for (size_t i = 0; i < triangles.size(); ++i) {
-            for (size_t j = i + 1; j < triangles.size(); ++j) {
-                triangleAdjacency[triangles[i]].push_back(std::make_pair(triangles[j], 1.0f));
-                triangleAdjacency[triangles[j]].push_back(std::make_pair(triangles[i], 1.0f));
-            }
-        }
-    }
-
-    uint32_t currentOffset    = 0;
-    graph->AdjacencyOffset[0] = 0;
-
-    for (uint32_t i = 0; i < numTriangles; i++) {
-        const auto& adjacentTris = triangleAdjacency[i];
-
-        for (const auto& [adjTri, weight] : adjacentTris) {
-            graph->Adjacency.push_back(adjTri);
-            graph->AdjacencyCost.push_back(weight);
-            currentOffset++;
-        }
-
-        graph->AdjacencyOffset[i + 1] = currentOffset;
-    }
-
-    partitioner.partition(*graph);
-
-    const uint32_t oldClusterCount = clusters.size();
-    clusters.resize(oldClusterCount + targetClusterCount);
-    std::vector<std::unordered_map<uint32_t, uint32_t>> oldToNewIndexMaps(targetClusterCount);
-
-    for (uint32_t i = 0; i < numTriangles; i++) {
-        int   partId   = partitioner.partitionIDs[i];
-        auto& cluster  = clusters[oldClusterCount + partId];
-        auto& indexMap = oldToNewIndexMaps[partId];
-
-        for (int k = 0; k < 3; k++) {
-            uint32_t globalIndex = InputMeshData.TriangleIndices[baseTriangle + i * 3 + k];
-            if (indexMap.find(globalIndex) == indexMap.end()) {
-                indexMap[globalIndex] = cluster.m_positions.size();
-                cluster.m_positions.push_back(InputMeshData.Vertices.Positions[globalIndex]);
-                cluster.m_normals.push_back(InputMeshData.Vertices.Normals[globalIndex]);
-                cluster.m_uvs.push_back(InputMeshData.Vertices.UVs[globalIndex]);
-                cluster.m_bounding_box.unite(cluster.m_positions.back());
-                cluster.m_min_pos = glm::min(cluster.m_min_pos, cluster.m_positions.back());
-                cluster.m_max_pos = glm::max(cluster.m_max_pos, cluster.m_positions.back());
-            }
-            cluster.m_indexes.push_back(indexMap[globalIndex]);
-        }
-    }
-
-    for (uint32_t i = 0; i < numTriangles; i++) {
-        int   partId   = partitioner.partitionIDs[i];
-        auto& cluster  = clusters[oldClusterCount + partId];
-        auto& indexMap = oldToNewIndexMaps[partId];
-
-        for (int k = 0; k < 3; k++) {
-            uint32_t globalIndex = InputMeshData.TriangleIndices[baseTriangle + i * 3 + k];
-            cluster.m_indexes.push_back(indexMap[globalIndex]);
-        }
-    }
-
-    struct ClusterEdge {
-        uint32_t v0, v1;
-        ClusterEdge(uint32_t a, uint32_t b) : v0(std::min(a, b)),
-                                              v1(std::max(a, b)) {}
-
-        bool operator==(const ClusterEdge& other) const {
-            return v0 == other.v0 && v1 == other.v1;
-        }
-    };
-
-    struct ClusterEdgeHash {
-        size_t operator()(const ClusterEdge& edge) const {
-            return (static_cast<size_t>(edge.v0) << 32) | edge.v1;
-        }
-    };
-
-    std::unordered_map<ClusterEdge, std::vector<uint32_t>, ClusterEdgeHash> clusterEdges;
-
-    for (uint32_t i = 0; i < numTriangles; i++) {
-        int      partId    = partitioner.partitionIDs[i];
-        uint32_t clusterId = oldClusterCount + partId;
-        auto&    cluster   = clusters[clusterId];
-        auto&    indexMap  = oldToNewIndexMaps[partId];
-
-        uint32_t i0 = InputMeshData.TriangleIndices[baseTriangle + i * 3 + 0];
-        uint32_t i1 = InputMeshData.TriangleIndices[baseTriangle + i * 3 + 1];
-        uint32_t i2 = InputMeshData.TriangleIndices[baseTriangle + i * 3 + 2];
-
-        clusterEdges[ClusterEdge(i0, i1)].push_back(clusterId);
-        clusterEdges[ClusterEdge(i1, i2)].push_back(clusterId);
-        clusterEdges[ClusterEdge(i2, i0)].push_back(clusterId);
-    }
-
-    for (const auto& [edge, clusterIds] : clusterEdges) {
-        if (clusterIds.size() > 1) {
-            for (size_t i = 0; i < clusterIds.size(); ++i) {
-                uint32_t clusterId = clusterIds[i];
-                auto&    cluster   = clusters[clusterId];
-                auto&    indexMap  = oldToNewIndexMaps[clusterId - oldClusterCount];
-
-                uint32_t localV0 = indexMap[edge.v0];
-                uint32_t localV1 = indexMap[edge.v1];
-
-                for (size_t j = 0; j < clusterIds.size(); ++j) {
-                    if (i != j) {
-                        cluster.m_external_edges.push_back({localV0,
-                                                            localV1,
-                                                            clusterIds[j]});
-                    }
-                }
-            }
-        }
-    }
-
-    for (uint32_t i = oldClusterCount; i < clusters.size(); ++i) {
-        auto& cluster = clusters[i];
-
-        for (const auto& pos : cluster.m_positions) {
-            cluster.m_min_pos = glm::min(cluster.m_min_pos, pos);
-            cluster.m_max_pos = glm::max(cluster.m_max_pos, pos);
-            cluster.m_bounding_box.unite(pos);
-        }
-
-        cluster.guid = i;
-
-        for (const auto& edge : cluster.m_external_edges) {
-            cluster.m_linked_cluster.insert(edge.clusterIndex);
-        }
-    }
-
-    delete graph;
-}
-
 inline float calculateEdgeWeight(const glm::vec3& pos1, const glm::vec3& pos2, const glm::vec3& normal1, const glm::vec3& normal2) {
     float distWeight   = glm::length2(pos1 - pos2);
     float normalWeight = 1.0f - glm::dot(normal1, normal2);
@@ -1088,55 +519,6 @@ Cluster::Cluster(std::vector<Cluster*>& clusters) {
         m_min_pos      = glm::min(m_min_pos, cluster->m_min_pos);
         m_max_pos      = glm::max(m_max_pos, cluster->m_max_pos);
     }
-
-    GraphAdjancy adjancy;
-
-    uint32_t minIndex = 0;
-    uint32_t maxIndex = clusters[0]->m_external_edges.size();
-    for (auto edgeIndex = 0; edgeIndex < m_external_edges.size(); edgeIndex++) {
-        if (edgeIndex >= maxIndex) {
-            minIndex = maxIndex;
-            maxIndex += clusters[edgeIndex]->m_external_edges.size();
-        }
-        auto adjCount = m_external_edges[edgeIndex].adjCount;
-        adjancy.forAll(edgeIndex, [&](uint32_t edgeIndex, uint32_t adjIndex) {
-            if (adjIndex < minIndex || adjIndex >= maxIndex) {
-                adjCount++;
-            }
-        });
-        adjCount                             = std::max(adjCount, 0u);
-        m_external_edges[edgeIndex].adjCount = adjCount;
-    }
-}
-Cluster::Cluster(Cluster* source, uint32_t start, uint32_t end, std::vector<uint32_t>& indexes, GraphAdjancy& adjancy) {
-    m_positions.resize((end - start) * 3);
-    m_normals.resize((end - start) * 3);
-    m_uvs.resize((end - start) * 3);
-    m_indexes.resize((end - start) * 3);
-    m_external_edges.clear();
-    m_bounding_box = BBox();
-    m_min_pos      = glm::vec3(1e30f, 1e30f, 1e30f);
-    m_max_pos      = glm::vec3(-1e30f, -1e30f, -1e30f);
-    for (uint32_t i = start; i < end; i++) {
-        uint32_t index         = indexes[i];
-        m_positions[i - start] = source->m_positions[index];
-        m_normals[i - start]   = source->m_normals[index];
-        m_uvs[i - start]       = source->m_uvs[index];
-        m_indexes[i - start]   = source->m_indexes[index];
-        m_bounding_box         = m_bounding_box + m_positions[i - start];
-        m_min_pos              = glm::min(m_min_pos, m_positions[i - start]);
-        m_max_pos              = glm::max(m_max_pos, m_positions[i - start]);
-    }
-    for (uint32_t i = 0; i < m_indexes.size(); i++) {
-        uint32_t index = m_indexes[i];
-        for (uint32_t adjIndex : adjancy.adjVertices[index].adjVertices) {
-            if (adjIndex < start || adjIndex >= end) {
-            }
-        }
-    }
-}
-GraphAdjancy Cluster::buildAdjacency() {
-    return GraphAdjancy();
 }
 
 // ClusterGroup 结构体定义
@@ -1146,6 +528,7 @@ struct ClusterGroup {
     std::vector<uint32_t> clusterIndexes{};
     BBox                  boundingBox;// 组的包围盒
     float                 errorMetric;// LOD误差度量
+    glm::vec4             lodBounds{0.0f};
     uint                  lodLevel = 0;
     ClusterGroup()
         : boundingBox(), errorMetric(0.0f) {}
@@ -1283,7 +666,9 @@ float simplifyMeshData1(MeshInputData& inputData, uint32_t targetNumTris) {
     // 更新三角形计数
     inputData.TriangleCounts[0] = simplified_index_count / 3;
 
-    SaveMeshInputDataToObj(inputData, "after.obj");
+    if (DebugNaniteBuild) {
+        SaveMeshInputDataToObj(inputData, "after.obj");
+    }
     return lod_error;
 }
 
@@ -1421,44 +806,71 @@ uint32_t BuildBVHTopDown(std::vector<BVHNode>& nodes, std::span<uint32_t> indice
     return nodeIndex;
 }
 
-SphereBox CalculateSphereBox(const std::vector<SphereBox>& boxes) {
-    return boxes[0];
-    // SphereBox result;
-    // for (const auto& box : boxes) {
-    //     result = result + box;
-    // }
-    // return result;
+// 包含所有球体的包围球, xyz 球心, w 半径
+glm::vec4 CalculateSphereBox(const std::vector<glm::vec4>& spheres) {
+    glm::vec4 result = spheres[0];
+    for (size_t i = 1; i < spheres.size(); i++) {
+        const auto& sphere   = spheres[i];
+        glm::vec3   toSphere = glm::vec3(sphere) - glm::vec3(result);
+        float       distance = glm::length(toSphere);
+        if (distance + sphere.w <= result.w) {
+            continue;
+        }
+        if (distance + result.w <= sphere.w) {
+            result = sphere;
+            continue;
+        }
+        float radius = (distance + result.w + sphere.w) * 0.5f;
+        result       = glm::vec4(glm::vec3(result) + toSphere * ((radius - result.w) / distance), radius);
+    }
+    return result;
 }
 
-uint32_t BuildBVHRecursive(std::vector<BVHNode>& nodes, std::vector<TNode>& tnodes, const std::vector<ClusterGroup> groups, uint32_t rootIndex, uint32_t depth) {
+glm::vec4 CalculateSphereBox(const BBox& box) {
+    return glm::vec4(box.center(), glm::length(box.extent()) * 0.5f);
+}
+
+uint32_t BuildBVHRecursive(std::vector<BVHNode>& nodes, std::vector<TNode>& tnodes, const std::vector<ClusterGroup>& groups, uint32_t rootIndex, uint32_t depth) {
     auto childNum = nodes[rootIndex].children.size();
 
     uint32 TNodeIndex = tnodes.size();
     auto&  tnode      = tnodes.emplace_back();
+    for (uint32_t i = 0; i < NANITE_MAX_BVH_NODE_FANOUT; i++) {
+        tnode.ChildrenStartIndex[i]    = NANITE_INVALID_INDEX;
+        tnode.ClusterGroupPartIndex[i] = NANITE_INVALID_INDEX;
+    }
+
+    // 子节点按槽位 i 存储, 递归会让 tnodes 扩容, 之后只能通过索引访问
     for (uint32_t i = 0; i < childNum; i++) {
         uint32_t childIndex = nodes[rootIndex].children[i];
         if (nodes[childIndex].isLeaf) {
-            tnode.ClusterGroupPartIndex[childIndex] = nodes[childIndex].groupIndex;
+            const auto& group                           = groups[nodes[childIndex].groupIndex];
+            tnodes[TNodeIndex].Bounds[i]                = group.boundingBox;
+            tnodes[TNodeIndex].LODBounds[i]             = group.lodBounds;
+            tnodes[TNodeIndex].MinLODError[i]           = group.errorMetric;
+            tnodes[TNodeIndex].MaxLODError[i]           = group.errorMetric;
+            tnodes[TNodeIndex].ClusterGroupPartIndex[i] = nodes[childIndex].groupIndex;
         } else {
             auto                   childTNodeIndex = BuildBVHRecursive(nodes, tnodes, groups, childIndex, depth + 1);
-            auto                   childTNode      = tnodes[childTNodeIndex];
-            std::vector<SphereBox> sphereBoxes;
+            const auto&            childTNode      = tnodes[childTNodeIndex];
+            std::vector<glm::vec4> sphereBoxes;
             BBox                   box;
             float                  minLodError = FLT_MAX;
             float                  maxLodError = 0.0f;
-            for (uint32 grandChildIndex : childTNode.ClusterGroupPartIndex) {
-                auto& group = groups[grandChildIndex];
-                box         = box + group.boundingBox;
-                sphereBoxes.push_back(childTNode.LODBounds[grandChildIndex]);
-                minLodError = std::min(minLodError, group.errorMetric);
-                maxLodError = std::max(maxLodError, group.errorMetric);
+            for (uint32 grandChild = 0; grandChild < nodes[childIndex].children.size(); grandChild++) {
+                box = box + childTNode.Bounds[grandChild];
+                sphereBoxes.push_back(childTNode.LODBounds[grandChild]);
+                minLodError = std::min(minLodError, childTNode.MinLODError[grandChild]);
+                maxLodError = std::max(maxLodError, childTNode.MaxLODError[grandChild]);
             }
 
-            tnode.Bounds[childIndex]             = box;
-            tnode.LODBounds[childIndex]          = CalculateSphereBox(sphereBoxes);
-            tnode.MinLODError[childIndex]        = minLodError;
-            tnode.MaxLODError[childIndex]        = maxLodError;
-            tnode.ChildrenStartIndex[childIndex] = childTNodeIndex;
+            auto& parent                 = tnodes[TNodeIndex];
+            parent.Bounds[i]             = box;
+            parent.LODBounds[i]          = sphereBoxes.empty() ? glm::vec4(0.0f) : CalculateSphereBox(sphereBoxes);
+            parent.MinLODError[i]        = sphereBoxes.empty() ? 0.0f : minLodError;
+            parent.MaxLODError[i]        = maxLodError;
+            parent.ChildrenStartIndex[i] = childTNodeIndex;
+            parent.NumChildren[i]        = nodes[childIndex].children.size();
         }
     }
     return TNodeIndex;
@@ -1505,15 +917,19 @@ NaniteBVH BuildBVH(const std::vector<Cluster>& clusters, const std::vector<Clust
     }
     LOGI("BVH node1 count: {}", nodes.size());
     auto root = BuildBVHTopDown(nodes, levelRoots, false);
+    if (nodes[root].isLeaf) {
+        // 只有一个 group 时根节点仍需是内部节点
+        nodes.emplace_back().children = {root};
+        root = nodes.size() - 1;
+    }
 
     LOGI("BVH node count: {}", nodes.size());
-    std::vector<TNode> tnodes;
-    BuildBVHRecursive(nodes, tnodes, groups, root, 0);
+    bvh.rootNode = BuildBVHRecursive(nodes, bvh.nodes, groups, root, 0);
 
     return bvh;
 }
 
-MeshInputData mergeClusterToMeshInputData(std::vector<Cluster>& clusters, std::span<uint32_t> children) {
+MeshInputData mergeClusterToMeshInputData(const std::vector<Cluster>& clusters, std::span<const uint32_t> children) {
     MeshInputData mergedInputData;
 
     // 创建顶点重映射表
@@ -1568,58 +984,131 @@ MeshInputData mergeClusterToMeshInputData(std::vector<Cluster>& clusters, std::s
     return mergedInputData;
 }
 
+// 一个 group 的简化结果
+struct ReducedGroup {
+    ClusterGroup         group;
+    std::vector<Cluster> clusters;
+};
+
 // DAGReduce 函数定义
-void DAGReduce(std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, std::atomic<uint32_t>& numClusters, std::span<uint32_t> children, uint32_t maxParents, uint32_t groupIndex, uint32_t MeshIndex) {
+// 只读取 clusters, 同一层的 group 互不依赖, 可以并行调用
+ReducedGroup DAGReduce(const std::vector<Cluster>& clusters, std::span<const uint32_t> children, uint32_t groupIndex) {
+    // 计算组内所有元素数量和最大父节点数量
+    uint32_t numGroupElements = 0;
+    for (uint32_t child : children) {
+        numGroupElements += clusters[child].getTriangleCount();
+    }
+    uint32_t maxParents = numGroupElements / (ClusterSize * 2);
+
     auto     mergedInputData = mergeClusterToMeshInputData(clusters, children);
-    uint32_t targetNumTris   = maxParents * ClusterSize;
+    uint32_t targetNumTris   = std::max(maxParents, 1u) * ClusterSize;
     float    error           = simplifyMeshData1(mergedInputData, targetNumTris);
 
-    // 使用clusterTriangles1重新划分
-    std::vector<Cluster> newClusters;
-    clusterTriangles1(newClusters, mergedInputData, 0, mergedInputData.TriangleCounts[0]);
-
-    // 更新groups和clusters
-    uint32_t newClusterStart = clusters.size();
-    clusters.insert(clusters.end(), newClusters.begin(), newClusters.end());
-
     // 更新group信息
-    ClusterGroup newGroup;
+    // group 的误差和包围球不小于其子 cluster, 保证 DAG 上的误差单调, 同一 group 的 cluster 总是一起切换
+    ReducedGroup           result;
+    auto&                  newGroup = result.group;
+    std::vector<glm::vec4> childLodBounds;
     newGroup.clusterIndexes = std::vector<uint32_t>(children.begin(), children.end());
     newGroup.lodLevel       = mergedInputData.mipLevel;
-    groups[groupIndex]      = std::move(newGroup);
+    newGroup.errorMetric    = error;
+    for (uint32_t child : children) {
+        newGroup.boundingBox = newGroup.boundingBox + clusters[child].m_bounding_box;
+        newGroup.errorMetric = std::max(newGroup.errorMetric, clusters[child].m_lod_error);
+        childLodBounds.push_back(clusters[child].m_lod_bounds);
+    }
+    newGroup.lodBounds = CalculateSphereBox(childLodBounds);
+
+    // 使用clusterTriangles1重新划分
+    clusterTriangles1(result.clusters, mergedInputData, 0, mergedInputData.TriangleCounts[0]);
+    for (auto& cluster : result.clusters) {
+        cluster.m_generating_group_index = groupIndex;
+        cluster.m_lod_error              = newGroup.errorMetric;
+        cluster.m_lod_bounds             = newGroup.lodBounds;
+    }
+    return result;
+}
+
+// 提交简化结果, 新 cluster 追加到 levelNewClusters, 邻接的 cluster 索引从 group 内转换到 clusters
+void CommitReducedGroup(std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, std::vector<Cluster>& levelNewClusters, ReducedGroup& reduced, uint32_t groupIndex) {
+    uint32_t newClusterStart = clusters.size() + levelNewClusters.size();
+    for (auto& cluster : reduced.clusters) {
+        for (auto& link : cluster.m_links) {
+            link.cluster += newClusterStart;
+        }
+    }
+    for (uint32_t child : reduced.group.clusterIndexes) {
+        clusters[child].m_group_index = groupIndex;
+    }
+    levelNewClusters.insert(levelNewClusters.end(), std::make_move_iterator(reduced.clusters.begin()), std::make_move_iterator(reduced.clusters.end()));
+    groups[groupIndex] = std::move(reduced.group);
 }
 
-void BuildDAG(std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, uint32_t ClusterStart, uint32_t clusterRangeNum, uint32_t MeshIndex, BBox MeshBounds) {
-    bool                  bFirstLevel = true;
-    std::atomic<uint32_t> numClusters = 0;
-    uint32_t              levelOffset = ClusterStart;
+// 一层的 group 在线程池上并行简化, 新 cluster 在整层完成后才加入 clusters, 简化时 clusters 不会被修改
+// 确定性模式按 group 顺序提交, 输出与线程数无关; 否则按完成顺序提交, 不必等待最慢的 group
+void ReduceLevel(std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, const std::vector<std::vector<uint32_t>>& levelGroups, const MeshNaniteSettings& Settings) {
+    uint32_t groupStartIndex = groups.size();
+    groups.resize(groups.size() + levelGroups.size());
+
+    std::vector<ReducedGroup> reducedGroups(Settings.Deterministic ? levelGroups.size() : 0);
+    std::vector<Cluster>      levelNewClusters;
+    std::mutex                commitMutex;
+
+    // 调试输出的 obj 文件名相同, 只能单线程
+    uint32_t maxThreads = DebugNaniteBuild ? 1 : Settings.MaxThreads;
+    ThreadPool::ParallelFor(levelGroups.size(), [&](uint32_t i) {
+        auto reduced = DAGReduce(clusters, levelGroups[i], groupStartIndex + i);
+        if (Settings.Deterministic) {
+            reducedGroups[i] = std::move(reduced);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(commitMutex);
+        CommitReducedGroup(groups, clusters, levelNewClusters, reduced, groupStartIndex + i); }, maxThreads);
 
-    bool buildRoot = true;
+    for (uint32_t i = 0; i < reducedGroups.size(); i++) {
+        CommitReducedGroup(groups, clusters, levelNewClusters, reducedGroups[i], groupStartIndex + i);
+    }
+    clusters.insert(clusters.end(), std::make_move_iterator(levelNewClusters.begin()), std::make_move_iterator(levelNewClusters.end()));
+}
+
+void BuildDAG(std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters, uint32_t ClusterStart, uint32_t clusterRangeNum, uint32_t MeshIndex, BBox MeshBounds, const MeshNaniteSettings& Settings) {
+    bool     bFirstLevel             = true;
+    uint32_t numClusters             = 0;
+    uint32_t levelOffset             = ClusterStart;
+    uint32_t previousLevelClusterNum = 0;
     while (true) {
         numClusters = clusters.size();
         std::span<Cluster> levelClusters(&clusters[levelOffset], bFirstLevel ? clusterRangeNum : clusters.size() - levelOffset);
-        bFirstLevel = false;
 
         if (levelClusters.size() < 2) {
             break;
         }
+        // 简化失败时层级不再减少, 剩下的 cluster 都作为根
+        if (!bFirstLevel && levelClusters.size() >= previousLevelClusterNum) {
+            LOGW("Nanite DAG stopped reducing at {} clusters", levelClusters.size());
+            break;
+        }
+        bFirstLevel             = false;
+        previousLevelClusterNum = levelClusters.size();
 
+        // 本层的 group, 每个 group 是 clusters 中的索引
+        std::vector<std::vector<uint32_t>> levelGroups;
         if (levelClusters.size() <= MaxClusterGroupSize) {
-            std::vector<uint32_t> children;
-            uint32_t              numGroupElements = 0;
+            auto& children = levelGroups.emplace_back();
             for (uint32_t i = 0; i < levelClusters.size(); i++) {
                 children.push_back(levelOffset + i);
-                numGroupElements += levelClusters[i].m_indexes.size() / 3;
             }
-            uint32_t maxParents = numGroupElements / (ClusterSize * 2);
-            DAGReduce(groups, clusters, numClusters, children, maxParents, groups.size() - 1, MeshIndex);
         } else {
             // GraphAdjancy adjancy = buildClusterGroupAdjancy1(levelClusters, levelOffset);
 
             uint32_t         targetGroupCount = (levelClusters.size() + MinClusterGroupSize - 1) / MinClusterGroupSize;
             GraphPartitioner partitioner(levelClusters.size(), targetGroupCount);
 
-            auto graph = partitioner.NewGraph(levelClusters.size() * 6);
+            size_t linkCount = 0;
+            for (const auto& cluster : levelClusters) {
+                linkCount += cluster.m_links.size();
+            }
+            auto graph = partitioner.NewGraph(linkCount);
             if (!graph) {
                 LOGE("Failed to create graph for cluster grouping");
                 return;
@@ -1627,11 +1116,9 @@ void BuildDAG(std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters,
 
             for (uint32_t i = 0; i < levelClusters.size(); i++) {
                 graph->AdjacencyOffset[i] = graph->Adjacency.size();
-                for (const auto& adjClusterId : levelClusters[i].m_linked_cluster) {
-                    if (adjClusterId >= levelOffset && adjClusterId < levelOffset + levelClusters.size()) {
-                       float weight = levelClusters[i].m_linked_cluster_cost[adjClusterId - levelOffset];
-                       // float weight = 1.0f;
-                        partitioner.addAdjacency(graph, adjClusterId - levelOffset, weight);
+                for (const auto& link : levelClusters[i].m_links) {
+                    if (link.cluster >= levelOffset && link.cluster < levelOffset + levelClusters.size()) {
+                        partitioner.addAdjacency(graph, link.cluster - levelOffset, link.cost);
                     }
                 }
             }
@@ -1640,65 +1127,42 @@ void BuildDAG(std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters,
             partitioner.partition(*graph);
             delete graph;
 
-            // 根据partition结果重组clusters
-            std::unordered_map<int, std::vector<uint32_t>> partitionGroups;
-
-            // 将clusters按照partition ID分组
+            // 将clusters按照partition ID分组, 按 ID 顺序排列, 与容器实现无关
+            levelGroups.resize(targetGroupCount);
             for (uint32_t i = 0; i < levelClusters.size(); i++) {
                 int partitionId = partitioner.partitionIDs[i];
-                partitionGroups[partitionId].push_back(levelOffset + i);
+                levelGroups[partitionId].push_back(levelOffset + i);
             }
+            std::erase_if(levelGroups, [](const std::vector<uint32_t>& children) { return children.empty(); });
+
+            if (DebugNaniteBuild) {
+                uint32_t debugGroupIndex = 0;
+                for (auto& children : levelGroups) {
+                    // 遍历每个集群
+                    for (size_t clusterIndex = 0; clusterIndex < children.size(); ++clusterIndex) {
+                        // 获取当前集群的索引
+                        const auto& clusterChildren = children[clusterIndex];
+
+                        // 合并当前集群的输入数据
+                        std::vector<uint32_t> clusterChildrenSpan = {clusterChildren};
+                        auto                  mergedInputData     = mergeClusterToMeshInputData(clusters, clusterChildrenSpan);
+
+                        // 保存合并后的输入数据到 OBJ 文件，文件名包含 clusterIndex 和 groupIndex
+                        SaveMeshInputDataToObj(
+                            mergedInputData,
+                            FileUtils::getFilePath("mergedInputData_group_" + std::to_string(debugGroupIndex) + "_cluster_" + std::to_string(clusterIndex), "obj", true));
+                    }
 
-            // 为每个partition创建新的group
-            groups.resize(groups.size() + partitionGroups.size());
-            uint32_t groupStartIndex = groups.size() - partitionGroups.size();
-
-            // 处理每个partition组
-            uint32_t groupIndex = 0;
-
-            for (auto& [partitionId, children] : partitionGroups) {
-                // 遍历每个集群
-                for (size_t clusterIndex = 0; clusterIndex < children.size(); ++clusterIndex) {
-                    // 获取当前集群的索引
-                    const auto& clusterChildren = children[clusterIndex];
-
-                    // 合并当前集群的输入数据
-                    std::vector<uint32_t> clusterChildrenSpan = {clusterChildren};
-                    auto                  mergedInputData     = mergeClusterToMeshInputData(clusters, clusterChildrenSpan);
-
-                    // 保存合并后的输入数据到 OBJ 文件，文件名包含 clusterIndex 和 groupIndex
-                    SaveMeshInputDataToObj(
-                        mergedInputData,
-                        FileUtils::getFilePath("mergedInputData_group_" + std::to_string(groupIndex) + "_cluster_" + std::to_string(clusterIndex), "obj", true));
-                }
-
-                auto groupmesh = mergeClusterToMeshInputData(clusters, children);
-                SaveMeshInputDataToObj(groupmesh, FileUtils::getFilePath("group_" + std::to_string(groupIndex), "obj", true));
-
-                groupIndex++;
-            }
-
-            exit(-1);
-
-            for (auto& [partitionId, children] : partitionGroups) {
-                // 计算组内所有元素数量
-                uint32_t numGroupElements = 0;
-                for (uint32_t clusterId : children) {
-                    numGroupElements += clusters[clusterId].m_indexes.size() / 3;
-                }
+                    auto groupmesh = mergeClusterToMeshInputData(clusters, children);
+                    SaveMeshInputDataToObj(groupmesh, FileUtils::getFilePath("group_" + std::to_string(debugGroupIndex), "obj", true));
 
-                if (buildRoot) {
+                    debugGroupIndex++;
                 }
-                // 计算最大父节点数量
-                uint32_t maxParents = numGroupElements / (ClusterSize * 2);
-
-                // 为这个partition创建新的group
-                DAGReduce(groups, clusters, numClusters, std::span<uint32_t>(children.data(), children.size()), maxParents, groupStartIndex + groupIndex, MeshIndex);
-
-                groupIndex++;
             }
         }
-        buildRoot   = false;
+
+        // 为每个partition创建新的group
+        ReduceLevel(groups, clusters, levelGroups, Settings);
         levelOffset = numClusters;
     }
 }
@@ -1728,7 +1192,7 @@ GraphPartitioner::FGraphData* GraphPartitioner::NewGraph(uint32_t maxEdges) cons
     return graph;
 }
 
-void GraphPartitioner::addAdjacency(FGraphData* graph, uint32_t toVertex, float weight) {
+void GraphPartitioner::addAdjacency(FGraphData* graph, uint32_t toVertex, idx_t weight) {
     if (!graph || toVertex >= numElements) {
         LOGE("Invalid parameters in addAdjacency");
         return;
@@ -1737,7 +1201,83 @@ void GraphPartitioner::addAdjacency(FGraphData* graph, uint32_t toVertex, float
     graph->Adjacency.push_back(toVertex);
     graph->AdjacencyCost.push_back(weight);
 }
-void NaniteBuilder::Build(MeshInputData& InputMeshData, MeshOutputData* OutFallbackMeshData, const MeshNaniteSettings& Settings) {
+// 转换为 NaniteMesh.h 中的 gpu 布局
+// 没有被简化的 cluster 组成根 group, 其误差为无穷大, 运行时 LOD 选择总会遍历到它们
+void AddRootGroup(std::vector<ClusterGroup>& groups, std::vector<Cluster>& clusters) {
+    ClusterGroup           rootGroup;
+    std::vector<glm::vec4> lodBounds;
+    rootGroup.errorMetric = MAX_FLT;
+    for (uint32_t i = 0; i < clusters.size(); i++) {
+        if (clusters[i].m_group_index != NANITE_INVALID_INDEX) {
+            continue;
+        }
+        clusters[i].m_group_index = groups.size();
+        rootGroup.clusterIndexes.push_back(i);
+        rootGroup.boundingBox = rootGroup.boundingBox + clusters[i].m_bounding_box;
+        rootGroup.lodLevel    = std::max(rootGroup.lodLevel, clusters[i].m_mip_level + 1);
+        lodBounds.push_back(clusters[i].m_lod_bounds);
+    }
+    if (lodBounds.empty()) {
+        return;
+    }
+    rootGroup.lodBounds = CalculateSphereBox(lodBounds);
+    groups.push_back(std::move(rootGroup));
+}
+
+void WriteNaniteMeshData(const std::vector<Cluster>& clusters, const std::vector<ClusterGroup>& groups, const NaniteBVH& bvh, NaniteMeshData& outData) {
+    outData.clusters.reserve(clusters.size());
+    for (const auto& cluster : clusters) {
+        auto& data                = outData.clusters.emplace_back();
+        data.boundsMin            = cluster.m_min_pos;
+        data.vertexOffset         = outData.vertices.size();
+        data.boundsMax            = cluster.m_max_pos;
+        data.triangleOffset       = outData.indices.size() / 3;
+        data.lodBounds            = cluster.m_lod_bounds;
+        data.vertexCount          = cluster.m_positions.size();
+        data.triangleCount        = cluster.getTriangleCount();
+        data.groupIndex           = cluster.m_group_index;
+        data.generatingGroupIndex = cluster.m_generating_group_index;
+        data.lodError             = cluster.m_lod_error;
+        data.parentLodError       = cluster.m_group_index == NANITE_INVALID_INDEX ? MAX_FLT : groups[cluster.m_group_index].errorMetric;
+        data.mipLevel             = cluster.m_mip_level;
+
+        for (uint32_t i = 0; i < cluster.m_positions.size(); i++) {
+            outData.vertices.push_back({cluster.m_positions[i], cluster.m_uvs[i].x, cluster.m_normals[i], cluster.m_uvs[i].y});
+        }
+        outData.indices.insert(outData.indices.end(), cluster.m_indexes.begin(), cluster.m_indexes.end());
+    }
+
+    outData.groups.reserve(groups.size());
+    for (const auto& group : groups) {
+        auto& data         = outData.groups.emplace_back();
+        data.boundsMin     = group.boundingBox.min();
+        data.lodError      = group.errorMetric;
+        data.boundsMax     = group.boundingBox.max();
+        data.lodBounds     = group.lodBounds;
+        data.clusterOffset = outData.groupClusters.size();
+        data.clusterCount  = group.clusterIndexes.size();
+        data.mipLevel      = group.lodLevel;
+        outData.groupClusters.insert(outData.groupClusters.end(), group.clusterIndexes.begin(), group.clusterIndexes.end());
+    }
+
+    outData.nodes.reserve(bvh.nodes.size());
+    for (const auto& tnode : bvh.nodes) {
+        auto& data = outData.nodes.emplace_back();
+        for (uint32_t i = 0; i < NANITE_MAX_BVH_NODE_FANOUT; i++) {
+            data.lodBounds[i] = tnode.LODBounds[i];
+            data.boundsMin[i] = glm::vec4(tnode.Bounds[i].min(), tnode.MinLODError[i]);
+            data.boundsMax[i] = glm::vec4(tnode.Bounds[i].max(), tnode.MaxLODError[i]);
+            if (tnode.ClusterGroupPartIndex[i] != NANITE_INVALID_INDEX) {
+                data.children[i] = tnode.ClusterGroupPartIndex[i] | NANITE_HIERARCHY_GROUP_FLAG;
+            } else {
+                data.children[i] = tnode.ChildrenStartIndex[i];
+            }
+        }
+    }
+    outData.rootNode = bvh.rootNode;
+}
+
+void NaniteBuilder::Build(MeshInputData& InputMeshData, MeshOutputData* OutFallbackMeshData, const MeshNaniteSettings& Settings, NaniteMeshData& OutNaniteData) {
     LOGI("NaniteBuilder::Build Vertex Count: {}", InputMeshData.Vertices.Positions.size());
 
     std::vector<Cluster>  clusters;
@@ -1752,28 +1292,91 @@ void NaniteBuilder::Build(MeshInputData& InputMeshData, MeshOutputData* OutFallb
         }
     }           
 
-    int index = 0;
-    for (auto& cluster : clusters) {
-        if(index == 315) {
-            int k = 1;
+    if (DebugNaniteBuild) {
+        int index = 0;
+        for (auto& cluster : clusters) {
+            saveSignleClusterToObj(cluster, FileUtils::getFilePath("cluster_" + std::to_string(index++), "obj", true));
+        }
+
+        std::vector<uint32_t> children;
+        for (uint32_t i = 0; i < clusters.size(); i++) {
+            children.push_back(i);
         }
-        saveSignleClusterToObj(cluster, FileUtils::getFilePath("cluster_" + std::to_string(index++), "obj", true));
+        auto mesh_input_data = mergeClusterToMeshInputData(clusters, children);
+        SaveMeshInputDataToObj(mesh_input_data, "mergedInputData.obj");
     }
-    
-    std::vector<uint32_t> children;
-    for (uint32_t i = 0; i < clusters.size(); i++) {
-        children.push_back(i);
+
+    // 源 cluster 的误差为 0, 包围球由包围盒得到
+    for (auto& cluster : clusters) {
+        cluster.m_lod_bounds = CalculateSphereBox(cluster.m_bounding_box);
     }
-    auto mesh_input_data = mergeClusterToMeshInputData(clusters, children);
-    SaveMeshInputDataToObj(mesh_input_data, "mergedInputData.obj");
-    // exit(-1);
 
     std::vector<ClusterGroup> groups;
-    BuildDAG(groups, clusters, 0, clusters.size(), 0, BBox());
+    BuildDAG(groups, clusters, 0, clusters.size(), 0, BBox(), Settings);
+    AddRootGroup(groups, clusters);
 
     NaniteBVH bvh = BuildBVH(clusters, groups);
     LOGI("NaniteBuilder::Build Cluster Count: {} Group Count: {}", clusters.size(), groups.size());
-    // ... 其余代码保持不变 ...
+
+    WriteNaniteMeshData(clusters, groups, bvh, OutNaniteData);
+}
+
+// 64 位为单位的 FNV-1a, 每次启动都要对整个输入求哈希, 按字节处理太慢
+static void HashBytes(uint64_t& hash, const void* data, size_t size) {
+    auto   bytes = static_cast<const uint8_t*>(data);
+    size_t words = size / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+        hash ^= word;
+        hash *= 0x100000001b3ull;
+    }
+    for (size_t i = words * sizeof(uint64_t); i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+template<typename T>
+static void HashVector(uint64_t& hash, const std::vector<T>& data) {
+    uint64_t size = data.size();
+    HashBytes(hash, &size, sizeof(size));
+    HashBytes(hash, data.data(), data.size() * sizeof(T));
+}
+
+// 构建结果变化时增加, 所有缓存会重新构建
+static constexpr uint32_t NANITE_BUILDER_VERSION = 3;
+static const std::string  COOKED_NANITE_PATH     = "cookedNanite/";
+
+static uint64_t GetCacheKey(const MeshInputData& InputMeshData, const MeshNaniteSettings& Settings) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    HashVector(hash, InputMeshData.Vertices.Positions);
+    HashVector(hash, InputMeshData.Vertices.Normals);
+    HashVector(hash, InputMeshData.Vertices.UVs);
+    HashVector(hash, InputMeshData.TriangleIndices);
+    HashVector(hash, InputMeshData.TriangleCounts);
+
+    // 线程数不影响结果, 不参与哈希
+    uint32_t settings[] = {NANITE_BUILDER_VERSION, ClusterSize, MaxClusterGroupSize, MinClusterGroupSize, Settings.Deterministic};
+    HashBytes(hash, settings, sizeof(settings));
+    return hash;
+}
+
+std::unique_ptr<NaniteMesh> NaniteBuilder::LoadOrBuild(MeshInputData& InputMeshData, const MeshNaniteSettings& Settings) {
+    uint64_t key  = GetCacheKey(InputMeshData, Settings);
+    auto     path = FileUtils::getResourcePath(COOKED_NANITE_PATH + fmt::format("{:016x}.nanite", key));
+    if (auto mesh = NaniteMesh::load(path, key)) {
+        LOGI("Loaded cooked nanite mesh {} Cluster Count: {} Group Count: {}", path, mesh->getClusters().size(), mesh->getGroups().size());
+        return mesh;
+    }
+
+    NaniteMeshData data;
+    Build(InputMeshData, nullptr, Settings, data);
+    if (!NaniteMesh::save(path, key, data)) {
+        LOGE("Failed to cook nanite mesh: {}", path);
+        return nullptr;
+    }
+    return NaniteMesh::load(path, key);
 }
 
 template<typename T1, typename T2>
@@ -1783,7 +1386,11 @@ void ConvertData(std::vector<T1>& data, std::vector<T2>& outData) {
 }
 
 std::unique_ptr<MeshInputData> NaniteBuilder::createNaniteExampleMeshInputData() {
-    auto primData      = PrimitiveLoader::loadPrimitive(FileUtils::getResourcePath("tiny_nanite/jinx-combined.obj"));
+    return createMeshInputData(FileUtils::getResourcePath("tiny_nanite/jinx-combined.obj"));
+}
+
+std::unique_ptr<MeshInputData> NaniteBuilder::createMeshInputData(const std::string& path) {
+    auto primData      = PrimitiveLoader::loadPrimitive(path);
     auto meshInputData = std::make_unique<MeshInputData>();
     ConvertData(primData->buffers[POSITION_ATTRIBUTE_NAME], meshInputData->Vertices.Positions);
     ConvertData(primData->buffers[NORMAL_ATTRIBUTE_NAME], meshInputData->Vertices.Normals);
@@ -1943,48 +1550,20 @@ GraphPartitioner::GraphPartitioner(uint32_t elementsNum, uint32_t targetPart) {
     partitionIDs.resize(numElements);
 }
 void GraphPartitioner::partition(FGraphData& graph) {
-    idx_t NumConstraints = 1;
-    int   NumParts       = targetPart;
     partitionIDs.resize(numElements);
     std::fill(partitionIDs.begin(), partitionIDs.end(), 0);
 
     // METIS要求的参数
     idx_t nvtxs  = numElements;// 顶点数量
     idx_t ncon   = 1;          // 约束数量（通常为1）
-    idx_t nparts = NumParts;   // 分区数量
+    idx_t nparts = targetPart; // 分区数量
 
     // METIS选项
     idx_t options[METIS_NOPTIONS];
     METIS_SetDefaultOptions(options);
     options[METIS_OPTION_NUMBERING] = 0;
-    options[METIS_OPTION_OBJTYPE] = METIS_OBJTYPE_CUT;
-    options[METIS_OPTION_SEED] = 14;
-    // 权重数组
-    std::vector<idx_t> vwgt(nvtxs, 1);// 顶点权重，默认为1
-    std::vector<idx_t> adjwgt;        // 边权重
-
-    // 转换边权重为idx_t类型
-    if (!graph.AdjacencyCost.empty()) {
-        adjwgt.resize(graph.AdjacencyCost.size());
-        for (size_t i = 0; i < graph.AdjacencyCost.size(); i++) {
-            adjwgt[i] = static_cast<idx_t>(graph.AdjacencyCost[i]);
-        }
-    }
-
-    // 转换偏移数组为idx_t类型
-    std::vector<idx_t> xadj(graph.AdjacencyOffset.size());
-    for (size_t i = 0; i < graph.AdjacencyOffset.size(); i++) {
-        xadj[i] = static_cast<idx_t>(graph.AdjacencyOffset[i]);
-    }
-
-    // 转换邻接数组为idx_t类型
-    std::vector<idx_t> adjncy(graph.Adjacency.size());
-    for (size_t i = 0; i < graph.Adjacency.size(); i++) {
-        adjncy[i] = static_cast<idx_t>(graph.Adjacency[i]);
-    }
-
-    // 分区结果
-    std::vector<idx_t> part(nvtxs);
+    options[METIS_OPTION_OBJTYPE]   = METIS_OBJTYPE_CUT;
+    options[METIS_OPTION_SEED]      = 14;
 
     // 调试输出
     LOGI("METIS Input - Vertices: {}, Parts: {}, Edges: {}",
@@ -1998,28 +1577,24 @@ void GraphPartitioner::partition(FGraphData& graph) {
         return;
     }
 
-    // nvtxs = 0;
-    int objval = 0;
-    std::vector<float> tpwgts;
-    tpwgts.resize(nparts, 1.0f / nparts);
-
-    
-    // 调用METIS
-    int result = METIS_PartGraphRecursive(
-        &nvtxs,                                  // 顶点数量
-        &ncon,                                   // 约束数量
-        xadj.data(),                             // 偏移数组
-        adjncy.data(),                           // 邻接数组
-        nullptr,                                 // 顶点权重 (nullptr表示所有权重为1)
-        nullptr,            // 顶点大小 (nullptr表示所有大小为1)
-        adjwgt.empty() ? nullptr : adjwgt.data(),  // 边权重
-        &nparts,            // 分区数量
-        nullptr,            // 目标分区大小
-        nullptr,            // 分区权重
-        options,            // 选项数组
-        &objval,          // 输出：边切割数量
-        part.data()         // 输出：分区结果
+    // 图的数组已是 idx_t, 直接交给 METIS, 分区结果直接写入 partitionIDs
+    idx_t objval = 0;
+    int   result = METIS_PartGraphRecursive(
+        &nvtxs,                                                          // 顶点数量
+        &ncon,                                                           // 约束数量
+        graph.AdjacencyOffset.data(),                                    // 偏移数组
+        graph.Adjacency.data(),                                          // 邻接数组
+        nullptr,                                                         // 顶点权重 (nullptr表示所有权重为1)
+        nullptr,                                                         // 顶点大小 (nullptr表示所有大小为1)
+        graph.AdjacencyCost.empty() ? nullptr : graph.AdjacencyCost.data(),// 边权重
+        &nparts,                                                         // 分区数量
+        nullptr,                                                         // 目标分区大小
+        nullptr,                                                         // 分区权重
+        options,                                                         // 选项数组
+        &objval,                                                         // 输出：边切割数量
+        partitionIDs.data()                                              // 输出：分区结果
     );
-
-    partitionIDs = part;
+    if (result != METIS_OK) {
+        LOGE("METIS partition failed with {}", result);
+    }
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "NaniteMesh.h"
 #include "Core/BoundingBox.h"
 #include "Scene/Compoments/RenderPrimitive.h"
 
@@ -43,10 +44,6 @@ struct MeshOutputData {
 struct NaniteDAG {
 };
 
-struct AdjancyVertex {
-    std::set<uint32_t> adjVertices;
-};
-
 struct Edge {
     uint32_t v0;
     uint32_t v1;
@@ -59,41 +56,13 @@ struct ClusterExternEdge {
     uint32_t clusterIndex;
 };
 
-struct GraphAdjancy {
-    //std::multimap<uint32_t, uint32_t> adjVertices;
-    GraphAdjancy() = default;
-    std::vector<AdjancyVertex> adjVertices;
-    std::vector<std::unordered_map<uint32_t, int>> adj_list; // 邻接列表
-
-    void init(uint32_t size) { 
-        adj_list.resize(size); 
-    }
-
-    void add_edge(uint32_t from, uint32_t to, int face_id) {
-        if(from == 0 || to == 0) {
-            int a = 0;
-        }
-        adj_list[from][to] = face_id; // 添加边
-    }
-    void                       addEdge(uint32_t v0, uint32_t v1) {
-        if(v0 == 277 && v1 == 5) {
-            int a = 0;
-        }
-        if(v1 == 277 && v0 == 5) {
-            int a = 0;
-        }
-        adjVertices[v0].adjVertices.insert(v1);
-        adjVertices[v1].adjVertices.insert(v0);
-    }
-    GraphAdjancy(uint32_t vertexCount) {
-        adjVertices.resize(vertexCount);
-    }
-    void forAll(uint32_t vertexIndex, std::function<void(uint32_t, uint32_t)> callback) {
-        for (auto adjIndex : adjVertices[vertexIndex].adjVertices) {
-            callback(vertexIndex, adjIndex);
-        }
-    }
+//Cluster sharing edges with another one
+struct ClusterLink {
+    uint32_t cluster;
+    //Shared edges, weight of the link when the clusters are grouped
+    uint32_t cost;
 };
+
 struct Cluster {
     uint32_t triangle_offset;
     std::vector<glm::vec3> m_positions;
@@ -111,15 +80,18 @@ struct Cluster {
     glm::vec3                      m_max_pos = glm::vec3(-1e30f, -1e30f, -1e30f);
 
     std::vector<int>             face_parent_cluster_group;//size == m_positions.size / 3
-    std::unordered_set<uint32_t> m_linked_cluster;
-    std::unordered_map<uint32_t, uint32_t> m_linked_cluster_cost;
-    std::vector<uint32_t> m_linked_cluster_vec;
+    //Sorted by cluster index
+    std::vector<ClusterLink>     m_links;
     uint64_t                     guid;
-    uint32_t                     m_mip_level;
+    uint32_t                     m_mip_level = 0;
+    //Group the cluster is a child of, and group it was simplified from
+    uint32_t                     m_group_index            = NANITE_INVALID_INDEX;
+    uint32_t                     m_generating_group_index = NANITE_INVALID_INDEX;
+    float                        m_lod_error              = 0.0f;
+    glm::vec4                    m_lod_bounds{0.0f};
     Cluster() = default;
     float simplify(uint32_t targetNumTris);
     Cluster(std::vector<Cluster*>& clusters);
-    Cluster(Cluster* source, uint32_t start, uint32_t end, std::vector<uint32_t>& indexes, GraphAdjancy& adjancy);
     glm::vec3 getPosition(uint32_t index) {
         return m_positions[index];
     }
@@ -129,7 +101,6 @@ struct Cluster {
     uint32_t getTriangleCount() const{
         return m_indexes.size()/3;
     }
-    GraphAdjancy buildAdjacency();
     bool isConnected() {
         if (m_indexes.empty()) return true; // 如果没有顶点，视为连通
 
@@ -173,13 +144,14 @@ struct GraphPartitioner {
         uint32_t Offset;
         uint32_t Num;
 
+        //Passed to METIS as adjncy, adjwgt and xadj
         std::vector<idx_t> Adjacency;
-        std::vector<float> AdjacencyCost;
+        std::vector<idx_t> AdjacencyCost;
         std::vector<idx_t> AdjacencyOffset;
     };
     FGraphData* NewGraph(uint32_t NumAdjacency) const;
     GraphPartitioner(uint32_t elementsNum, uint32_t targetPart);
-    void addAdjacency(FGraphData* graph, uint32_t index, float adjCount);
+    void addAdjacency(FGraphData* graph, uint32_t index, idx_t adjCount);
     struct Range {
         uint32_t start;
         uint32_t end;
@@ -193,6 +165,11 @@ struct GraphPartitioner {
 };
 
 struct MeshNaniteSettings {
+    //Groups of a level are committed in partition order so the output is bit identical whatever the thread count,
+    //otherwise in completion order which never waits on the slowest group
+    bool     Deterministic = true;
+    //Threads simplifying the groups of a level, 0 for the whole pool. Does not change a deterministic output
+    uint32_t MaxThreads    = 0;
 };
 
 class NaniteBuilder {
@@ -200,8 +177,12 @@ public:
     static void Build(
         MeshInputData&            InputMeshData,
         MeshOutputData*           OutFallbackMeshData,
-        const MeshNaniteSettings& Settings);
+        const MeshNaniteSettings& Settings,
+        NaniteMeshData&           OutNaniteData);
+    //Maps the cooked DAG of the mesh, building and cooking it only when the cache has no entry for the input and settings
+    static std::unique_ptr<NaniteMesh> LoadOrBuild(MeshInputData& InputMeshData, const MeshNaniteSettings& Settings);
     static std::unique_ptr<MeshInputData> createNaniteExampleMeshInputData();
+    static std::unique_ptr<MeshInputData> createMeshInputData(const std::string& path);
     static std::unique_ptr<Primitive>     createNaniteExamplePrimitive();
 };
 
@@ -219,7 +200,7 @@ struct BVHNode {
 };
 
 struct TNode {
-    SphereBox LODBounds[NANITE_MAX_BVH_NODE_FANOUT];
+    glm::vec4 LODBounds[NANITE_MAX_BVH_NODE_FANOUT];
     BBox      Bounds[NANITE_MAX_BVH_NODE_FANOUT];
     float     MinLODError[NANITE_MAX_BVH_NODE_FANOUT];
     float     MaxLODError[NANITE_MAX_BVH_NODE_FANOUT];
@@ -237,5 +218,7 @@ struct BVHTree {
 // 用于存储每个LOD级别的BVH树
 struct NaniteBVH {
     std::vector<BVHTree> lodTrees;  // 每个LOD级别一个BVH树
+    std::vector<TNode>   nodes;
+    uint32_t             rootNode = 0;
 };
 
@@ -0,0 +1,136 @@
+#include "NaniteMesh.h"
+
+#include "Common/Log.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+//Bump when a struct of NaniteMesh.h or the builder output changes, every cooked mesh is then built again
+static constexpr uint32_t NANITE_FILE_VERSION  = 1;
+static constexpr char     NANITE_FILE_MAGIC[4] = {'Y', 'N', 'A', 'N'};
+static constexpr uint64_t NANITE_SECTION_ALIGN = 16;
+
+enum NaniteSection : uint32_t {
+    CLUSTERS,
+    GROUPS,
+    GROUP_CLUSTERS,
+    NODES,
+    VERTICES,
+    INDICES,
+    SECTION_COUNT
+};
+
+struct NaniteFileSection {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct NaniteFileHeader {
+    char              magic[4];
+    uint32_t          version;
+    //Hash of the builder input, a cache entry is never used for another mesh
+    uint64_t          key;
+    uint32_t          rootNode;
+    uint32_t          padding;
+    NaniteFileSection sections[SECTION_COUNT];
+};
+
+template<typename T>
+static bool MapSection(const MappedFile& file, const NaniteFileSection& section, std::span<const T>& out) {
+    if (section.offset % NANITE_SECTION_ALIGN != 0 || section.offset > file.size() || section.count > (file.size() - section.offset) / sizeof(T))
+        return false;
+    out = std::span<const T>(reinterpret_cast<const T*>(file.data() + section.offset), section.count);
+    return true;
+}
+
+template<typename T>
+static void WriteSection(std::ofstream& out, NaniteFileSection& section, const std::vector<T>& data) {
+    uint64_t offset = out.tellp();
+    uint64_t padded = (offset + NANITE_SECTION_ALIGN - 1) / NANITE_SECTION_ALIGN * NANITE_SECTION_ALIGN;
+    static constexpr char zeros[NANITE_SECTION_ALIGN]{};
+    out.write(zeros, padded - offset);
+    section = {padded, data.size()};
+    out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+}
+
+std::unique_ptr<NaniteMesh> NaniteMesh::load(const std::string& path, uint64_t key) {
+    auto mesh = std::make_unique<NaniteMesh>();
+    if (!mesh->file.open(path))
+        return nullptr;
+
+    auto& file = mesh->file;
+    if (file.size() < sizeof(NaniteFileHeader)) {
+        LOGW("Cooked nanite mesh is truncated: {}", path);
+        return nullptr;
+    }
+    const auto& header = *reinterpret_cast<const NaniteFileHeader*>(file.data());
+    if (memcmp(header.magic, NANITE_FILE_MAGIC, sizeof(NANITE_FILE_MAGIC)) != 0 || header.version != NANITE_FILE_VERSION || header.key != key)
+        return nullptr;
+
+    if (!MapSection(file, header.sections[CLUSTERS], mesh->clusters) ||
+        !MapSection(file, header.sections[GROUPS], mesh->groups) ||
+        !MapSection(file, header.sections[GROUP_CLUSTERS], mesh->groupClusters) ||
+        !MapSection(file, header.sections[NODES], mesh->nodes) ||
+        !MapSection(file, header.sections[VERTICES], mesh->vertices) ||
+        !MapSection(file, header.sections[INDICES], mesh->indices)) {
+        LOGW("Cooked nanite mesh is truncated: {}", path);
+        return nullptr;
+    }
+    mesh->rootNode = header.rootNode;
+    return mesh;
+}
+
+BBox NaniteMesh::getBounds() const {
+    BBox bounds;
+    if (rootNode >= nodes.size())
+        return bounds;
+    const auto& root = nodes[rootNode];
+    for (uint32_t i = 0; i < NANITE_HIERARCHY_FANOUT; i++) {
+        if (root.children[i] != NANITE_INVALID_INDEX)
+            bounds = bounds + BBox(glm::vec3(root.boundsMin[i]), glm::vec3(root.boundsMax[i]));
+    }
+    return bounds;
+}
+
+bool NaniteMesh::save(const std::string& path, uint64_t key, const NaniteMeshData& data) {
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+
+    //Written aside and renamed so an interrupted build never leaves a truncated file in the cache
+    auto tempPath = fmt::format("{}.{}.tmp", path, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(tempPath, std::ios::binary);
+        if (!out)
+            return false;
+
+        NaniteFileHeader header{};
+        memcpy(header.magic, NANITE_FILE_MAGIC, sizeof(NANITE_FILE_MAGIC));
+        header.version  = NANITE_FILE_VERSION;
+        header.key      = key;
+        header.rootNode = data.rootNode;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        WriteSection(out, header.sections[CLUSTERS], data.clusters);
+        WriteSection(out, header.sections[GROUPS], data.groups);
+        WriteSection(out, header.sections[GROUP_CLUSTERS], data.groupClusters);
+        WriteSection(out, header.sections[NODES], data.nodes);
+        WriteSection(out, header.sections[VERTICES], data.vertices);
+        WriteSection(out, header.sections[INDICES], data.indices);
+
+        //Section offsets are only known once written
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!out)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        LOGE("Failed to write cooked nanite mesh: {}", path);
+        return false;
+    }
+    return true;
+}
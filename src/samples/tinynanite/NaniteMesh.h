@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Core/BoundingBox.h"
+#include "IO/MappedFile.h"
+
+#include <glm.hpp>
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+constexpr uint32_t NANITE_HIERARCHY_FANOUT     = 4;
+//Set on a hierarchy child that is a cluster group, the other children are hierarchy nodes
+constexpr uint32_t NANITE_HIERARCHY_GROUP_FLAG = 0x80000000u;
+constexpr uint32_t NANITE_INVALID_INDEX        = 0xffffffffu;
+
+//Every struct below is stored as is in the cooked file and follows the std430 layout, sections can be uploaded untouched
+
+struct NaniteVertex {
+    glm::vec3 position;
+    float     u;
+    glm::vec3 normal;
+    float     v;
+};
+
+struct NaniteClusterData {
+    glm::vec3 boundsMin;
+    uint32_t  vertexOffset;
+    glm::vec3 boundsMax;
+    //In triangles, indices are local to the vertices of the cluster
+    uint32_t  triangleOffset;
+    //Bounding sphere the lodError is measured against
+    glm::vec4 lodBounds;
+    uint32_t  vertexCount;
+    uint32_t  triangleCount;
+    //Group the cluster is simplified in, NANITE_INVALID_INDEX for the root clusters
+    uint32_t  groupIndex;
+    //Group whose simplification produced the cluster, NANITE_INVALID_INDEX for the source clusters
+    uint32_t  generatingGroupIndex;
+    //The cluster is drawn when lodError is under the threshold and parentLodError is not
+    float     lodError;
+    float     parentLodError;
+    uint32_t  mipLevel;
+    uint32_t  padding;
+};
+
+struct NaniteClusterGroupData {
+    glm::vec3 boundsMin;
+    //Error of the clusters generated from the group, never below the error of its clusters
+    float     lodError;
+    glm::vec3 boundsMax;
+    float     padding;
+    glm::vec4 lodBounds;
+    //Range of groupClusters
+    uint32_t  clusterOffset;
+    uint32_t  clusterCount;
+    uint32_t  mipLevel;
+    uint32_t  padding1;
+};
+
+struct NaniteHierarchyNodeData {
+    glm::vec4 lodBounds[NANITE_HIERARCHY_FANOUT];
+    //w holds the min lod error of the subtree
+    glm::vec4 boundsMin[NANITE_HIERARCHY_FANOUT];
+    //w holds the max lod error of the subtree
+    glm::vec4 boundsMax[NANITE_HIERARCHY_FANOUT];
+    //Node index, group index with NANITE_HIERARCHY_GROUP_FLAG, or NANITE_INVALID_INDEX for an empty slot
+    uint32_t  children[NANITE_HIERARCHY_FANOUT];
+};
+
+//Output of the NaniteBuilder, the content of a cooked file
+struct NaniteMeshData {
+    std::vector<NaniteClusterData>       clusters;
+    std::vector<NaniteClusterGroupData>  groups;
+    std::vector<uint32_t>                groupClusters;
+    std::vector<NaniteHierarchyNodeData> nodes;
+    std::vector<NaniteVertex>            vertices;
+    std::vector<uint32_t>                indices;
+    uint32_t                             rootNode{NANITE_INVALID_INDEX};
+};
+
+/**
+ * Cooked cluster DAG of a mesh, memory mapped from the cache.
+ * The file is a header followed by one 16 byte aligned section per array of NaniteMeshData, the spans point straight in
+ * the mapping so loading does no copy and no parsing whatever the size of the mesh.
+ */
+class NaniteMesh {
+public:
+    //Null if the file is missing, truncated or written by another version of the cooker
+    static std::unique_ptr<NaniteMesh> load(const std::string& path, uint64_t key);
+    static bool                        save(const std::string& path, uint64_t key, const NaniteMeshData& data);
+
+    std::span<const NaniteClusterData>       getClusters() const { return clusters; }
+    std::span<const NaniteClusterGroupData>  getGroups() const { return groups; }
+    std::span<const uint32_t>                getGroupClusters() const { return groupClusters; }
+    std::span<const NaniteHierarchyNodeData> getNodes() const { return nodes; }
+    std::span<const NaniteVertex>            getVertices() const { return vertices; }
+    std::span<const uint32_t>                getIndices() const { return indices; }
+    uint32_t                                 getRootNode() const { return rootNode; }
+    //Union of the root children, empty box without hierarchy
+    BBox                                     getBounds() const;
+
+protected:
+    MappedFile                               file;
+    std::span<const NaniteClusterData>       clusters;
+    std::span<const NaniteClusterGroupData>  groups;
+    std::span<const uint32_t>                groupClusters;
+    std::span<const NaniteHierarchyNodeData> nodes;
+    std::span<const NaniteVertex>            vertices;
+    std::span<const uint32_t>                indices;
+    uint32_t                                 rootNode{NANITE_INVALID_INDEX};
+};
@@ -1 +1,154 @@
-#include "NaniteRasteriztion.h"
\ No newline at end of file
+#include "NaniteRasteriztion.h"
+
+#include "imgui.h"
+#include "Common/ResourceCache.h"
+#include "Core/RenderContext.h"
+#include "Core/View.h"
+
+struct NaniteResolvePushConstant {
+    uint32_t visualizeMode;
+    uint32_t flipY;
+};
+
+void NaniteRasteriztion::setMesh(const NaniteMesh& mesh) {
+    if (mesh.getVertices().empty())
+        return;
+    g_context->deferRelease(std::move(mVertexBuffer));
+    g_context->deferRelease(std::move(mIndexBuffer));
+    auto& device  = g_context->getDevice();
+    mVertexBuffer = std::make_unique<Buffer>(device, mesh.getVertices().size_bytes(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, mesh.getVertices().data());
+    mIndexBuffer  = std::make_unique<Buffer>(device, mesh.getIndices().size_bytes(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, mesh.getIndices().data());
+}
+
+void NaniteRasteriztion::bindClusterBuffers() {
+    g_manager->getView()->bindViewBuffer();
+    g_context->bindBuffer(1, mInstanceCuller.getInstanceBuffer())
+        .bindBuffer(2, mClusterCuller.getClusterBuffer())
+        .bindBuffer(3, *mVertexBuffer)
+        .bindBuffer(4, *mIndexBuffer)
+        .bindBuffer(5, mClusterCuller.getVisibleClusterBuffer());
+}
+
+void NaniteRasteriztion::render(RenderGraph& rg) {
+    auto& blackBoard = rg.getBlackBoard();
+    auto& device     = g_context->getDevice();
+    if (!blackBoard.contains(NANITE_DRAW_COMMANDS_NAME) || !device.isDrawIndirectCountSupported())
+        return;
+
+    if (!device.isBufferInt64AtomicsSupported()) {
+        renderDirect(rg);
+        return;
+    }
+
+    VkExtent2D   extent = g_context->getViewPortExtent();
+    VkDeviceSize size   = sizeof(uint64_t) * extent.width * extent.height;
+    if (mVisibilityBuffer == nullptr || mVisibilityBuffer->getSize() != size) {
+        g_context->deferRelease(std::move(mVisibilityBuffer));
+        mVisibilityBuffer = std::make_unique<Buffer>(device, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+    rg.importBuffer(NANITE_VISIBILITY_BUFFER_NAME, mVisibilityBuffer.get());
+
+    renderSoftware(rg);
+    renderHardware(rg);
+    renderResolve(rg);
+}
+
+void NaniteRasteriztion::renderDirect(RenderGraph& rg) {
+    auto& blackBoard = rg.getBlackBoard();
+    rg.addGraphicPass(
+        "Nanite Raster Pass",
+        [&](RenderGraph::Builder& builder, GraphicPassSettings& settings) {
+            const auto output = blackBoard.getHandle(RENDER_VIEW_PORT_IMAGE_NAME);
+            builder.writeTexture(output, RenderGraphTexture::Usage::COLOR_ATTACHMENT);
+            auto depth = rg.createTexture(DEPTH_IMAGE_NAME, {.extent = g_context->getViewPortExtent(), .useage = TextureUsage::DEPTH_ATTACHMENT | TextureUsage::SAMPLEABLE});
+            builder.writeTexture(depth, RenderGraphTexture::Usage::DEPTH_ATTACHMENT);
+            builder.readBuffer(blackBoard.getHandle(NANITE_DRAW_COMMANDS_NAME), BufferUsage::INDIRECT);
+            builder.readBuffer(blackBoard.getHandle(NANITE_QUEUE_STATE_NAME), BufferUsage::INDIRECT);
+            builder.readBuffer(blackBoard.getHandle(NANITE_VISIBLE_CLUSTERS_NAME), BufferUsage::STORAGE);
+            builder.declare(RenderGraphPassDescriptor({output, depth}, {.outputAttachments = {output, depth}}));
+        },
+        [this](RenderPassContext& context) {
+            g_context->getPipelineState().setDepthStencilState({.depthCompareOp = VK_COMPARE_OP_LESS});
+            bindClusterBuffers();
+            g_context->bindShaders({"tinyNanite/nanite_raster.vert", "tinyNanite/nanite_raster.frag"}).bindPushConstants(mVisualizeMode);
+            //The draw count is the hardware cluster count left in the queue state by the culling
+            g_context->flushAndDrawIndirectCount(context.commandBuffer, mClusterCuller.getDrawCommandBuffer(), 0, mInstanceCuller.getQueueStateBuffer(), offsetof(NaniteQueueState, hwClusterCount), mClusterCuller.getMaxVisibleClusters());
+        });
+}
+
+void NaniteRasteriztion::renderSoftware(RenderGraph& rg) {
+    auto& blackBoard = rg.getBlackBoard();
+    rg.addComputePass(
+        "Nanite Software Raster Pass",
+        [&](RenderGraph::Builder& builder, ComputePassSettings& settings) {
+            builder.readBuffer(blackBoard.getHandle(NANITE_QUEUE_STATE_NAME), BufferUsage::INDIRECT);
+            builder.readBuffer(blackBoard.getHandle(NANITE_VISIBLE_CLUSTERS_NAME), BufferUsage::STORAGE);
+            builder.readBuffer(blackBoard.getHandle(NANITE_SW_CLUSTERS_NAME), BufferUsage::STORAGE);
+            builder.writeBuffer(blackBoard.getHandle(NANITE_VISIBILITY_BUFFER_NAME), BufferUsage::STORAGE);
+            settings.pipelineLayout = &rg.getDevice().getResourceCache().requestPipelineLayout(ShaderPipelineKey{"tinyNanite/nanite_sw_raster.comp"});
+        },
+        [this](RenderPassContext& context) {
+            //Empty pixels hold the far plane, the first raster pass of the frame clears the buffer
+            CmdFillStorageBuffer(context.commandBuffer, *mVisibilityBuffer, 0);
+
+            uint32_t flipY = g_context->getFlipViewport();
+            bindClusterBuffers();
+            g_context->bindBuffer(6, *mVisibilityBuffer)
+                .bindBuffer(7, mClusterCuller.getSwClusterBuffer())
+                .bindPushConstants(flipY)
+                .flushAndDispatchIndirect(context.commandBuffer, mInstanceCuller.getQueueStateBuffer(), offsetof(NaniteQueueState, swClusterCount));
+        });
+}
+
+void NaniteRasteriztion::renderHardware(RenderGraph& rg) {
+    auto& blackBoard = rg.getBlackBoard();
+    rg.addGraphicPass(
+        "Nanite Hardware Raster Pass",
+        [&](RenderGraph::Builder& builder, GraphicPassSettings& settings) {
+            //Depth only, the depth test rejects hidden fragments before their visibility atomic
+            auto depth = rg.createTexture(DEPTH_IMAGE_NAME, {.extent = g_context->getViewPortExtent(), .useage = TextureUsage::DEPTH_ATTACHMENT | TextureUsage::SAMPLEABLE});
+            builder.writeTexture(depth, RenderGraphTexture::Usage::DEPTH_ATTACHMENT);
+            builder.readBuffer(blackBoard.getHandle(NANITE_DRAW_COMMANDS_NAME), BufferUsage::INDIRECT);
+            builder.readBuffer(blackBoard.getHandle(NANITE_QUEUE_STATE_NAME), BufferUsage::INDIRECT);
+            builder.readBuffer(blackBoard.getHandle(NANITE_VISIBLE_CLUSTERS_NAME), BufferUsage::STORAGE);
+            builder.writeBuffer(blackBoard.getHandle(NANITE_VISIBILITY_BUFFER_NAME), BufferUsage::STORAGE);
+            builder.declare(RenderGraphPassDescriptor({depth}, {.outputAttachments = {depth}}));
+        },
+        [this](RenderPassContext& context) {
+            g_context->getPipelineState().setDepthStencilState({.depthCompareOp = VK_COMPARE_OP_LESS});
+            bindClusterBuffers();
+            g_context->bindBuffer(6, *mVisibilityBuffer)
+                .bindShaders({ShaderKey{"tinyNanite/nanite_raster.vert", {"VISIBILITY_BUFFER"}}, ShaderKey{"tinyNanite/nanite_raster.frag", {"VISIBILITY_BUFFER"}}});
+            g_context->flushAndDrawIndirectCount(context.commandBuffer, mClusterCuller.getDrawCommandBuffer(), 0, mInstanceCuller.getQueueStateBuffer(), offsetof(NaniteQueueState, hwClusterCount), mClusterCuller.getMaxVisibleClusters());
+        });
+}
+
+void NaniteRasteriztion::renderResolve(RenderGraph& rg) {
+    auto& blackBoard = rg.getBlackBoard();
+    rg.addGraphicPass(
+        "Nanite Resolve Pass",
+        [&](RenderGraph::Builder& builder, GraphicPassSettings& settings) {
+            const auto output = blackBoard.getHandle(RENDER_VIEW_PORT_IMAGE_NAME);
+            const auto depth  = blackBoard.getHandle(DEPTH_IMAGE_NAME);
+            builder.writeTexture(output, RenderGraphTexture::Usage::COLOR_ATTACHMENT);
+            builder.writeTexture(depth, RenderGraphTexture::Usage::DEPTH_ATTACHMENT);
+            builder.readBuffer(blackBoard.getHandle(NANITE_VISIBLE_CLUSTERS_NAME), BufferUsage::STORAGE);
+            builder.readBuffer(blackBoard.getHandle(NANITE_VISIBILITY_BUFFER_NAME), BufferUsage::STORAGE);
+            builder.declare(RenderGraphPassDescriptor({output, depth}, {.outputAttachments = {output, depth}}));
+        },
+        [this](RenderPassContext& context) {
+            //Every covered pixel writes the depth of the visibility buffer, software clusters included
+            g_context->getPipelineState().setRasterizationState({.cullMode = VK_CULL_MODE_NONE}).setDepthStencilState({.depthCompareOp = VK_COMPARE_OP_ALWAYS});
+            bindClusterBuffers();
+            NaniteResolvePushConstant pushConstant{.visualizeMode = mVisualizeMode, .flipY = g_context->getFlipViewport()};
+            g_context->bindBuffer(6, *mVisibilityBuffer)
+                .bindShaders({"full_screen.vert", "tinyNanite/nanite_resolve.frag"})
+                .bindPushConstants(pushConstant)
+                .flushAndDraw(context.commandBuffer, 3, 1, 0, 0);
+        });
+}
+
+void NaniteRasteriztion::updateGui() {
+    static const char* visualizeModes[] = {"Shaded", "Clusters", "Triangles", "Groups", "Mip level", "Raster path"};
+    ImGui::Combo("Nanite visualize", reinterpret_cast<int*>(&mVisualizeMode), visualizeModes, IM_ARRAYSIZE(visualizeModes));
+}
@@ -1,6 +1,49 @@
 #pragma once
 
-class NaniteRasteriztion {
+#include "ClusterCuller.h"
+
+static const std::string NANITE_VISIBILITY_BUFFER_NAME = "nanite_visibility_buffer";
+
+/**
+ * Rasterizes the clusters selected by the ClusterCuller. Large clusters are drawn by the hardware with a single
+ * vkCmdDrawIndirectCount, the vertex shader fetches the cluster vertices from storage buffers. When the device has 64
+ * bit buffer atomics the small clusters are rasterized by a compute shader, both paths write depth and triangle id into
+ * a 64 bit visibility buffer with atomicMax and a full screen resolve shades every pixel once. Otherwise the hardware
+ * path shades directly. Writes the viewport image and the depth the Hi-Z of the next frame is built from.
+ */
+class NaniteRasteriztion : public PassBase {
 public:
-    
+    NaniteRasteriztion(const InstanceCuller& instanceCuller, const ClusterCuller& clusterCuller) : mInstanceCuller(instanceCuller), mClusterCuller(clusterCuller) {}
+
+    void render(RenderGraph& rg) override;
+    void updateGui() override;
+
+    void setMesh(const NaniteMesh& mesh);
+
+protected:
+    enum VisualizeMode : uint32_t {
+        SHADED,
+        CLUSTERS,
+        TRIANGLES,
+        GROUPS,
+        MIP_LEVEL,
+        RASTER_PATH,
+    };
+
+    void renderDirect(RenderGraph& rg);
+    void renderSoftware(RenderGraph& rg);
+    void renderHardware(RenderGraph& rg);
+    void renderResolve(RenderGraph& rg);
+    //Storage buffers shared by the three raster shaders
+    void bindClusterBuffers();
+
+    const InstanceCuller& mInstanceCuller;
+    const ClusterCuller&  mClusterCuller;
+
+    std::unique_ptr<Buffer> mVertexBuffer;
+    std::unique_ptr<Buffer> mIndexBuffer;
+    //One uint64 per viewport pixel, recreated with the viewport
+    std::unique_ptr<Buffer> mVisibilityBuffer;
+
+    uint32_t mVisualizeMode{CLUSTERS};
 };
@@ -1,35 +1,59 @@
 #include "TinyNanite.h"
 
+#include "imgui.h"
 #include "NaniteBuilder.h"
 void TinyNanite::drawFrame(RenderGraph& rg) {
-    // rg.addGraphicPass(
-    //     "clusterColorPass",
-    //     [&](RenderGraph::Builder& builder, GraphicPassSettings& settings) {
-    //         const auto output = rg.getBlackBoard().getHandle(RENDER_VIEW_PORT_IMAGE_NAME);
-    //         builder.writeTexture(output, RenderGraphTexture::Usage::COLOR_ATTACHMENT);
-    //         auto depth = rg.createTexture(DEPTH_IMAGE_NAME, {.extent = g_context->getViewPortExtent(), .useage = TextureUsage::DEPTH_ATTACHMENT | TextureUsage::SAMPLEABLE});
-    //         builder.writeTexture(depth, RenderGraphTexture::Usage::DEPTH_ATTACHMENT);
-    //         builder.declare(RenderGraphPassDescriptor({output, depth}, {.outputAttachments = {output, depth}}));
-    //     },
-    //     [&](RenderPassContext& context) {
-    //         view->bindViewBuffer();
-    //         g_context->bindShaders({"tinyNanite/clusterColor.vert", "tinyNanite/clusterColor.frag"});
-    //         g_context->bindPrimitiveGeom(context.commandBuffer, *mPrimitive).flushAndDrawIndexed(context.commandBuffer, mPrimitive->indexCount);
-    //     });
-
-    // g_context->bindPrimitiveGeom(command*mPrimitive).flushAndDrawIndexed(F
+    if (!mNaniteMesh)
+        return;
+    mInstanceCuller->render(rg);
+    mClusterCuller->render(rg);
+    mNaniteRasterization->render(rg);
+    mInstanceCuller->renderHiz(rg);
 }
 void TinyNanite::prepare() {
     Application::prepare();
     auto naniteMeshInput = NaniteBuilder::createNaniteExampleMeshInputData();
     // mPrimitive           = NaniteBuilder::createNaniteExamplePrimitive();
-    NaniteBuilder::Build(*naniteMeshInput, nullptr, {});
+    mNaniteMesh          = NaniteBuilder::LoadOrBuild(*naniteMeshInput, {});
     scene = std::make_unique<Scene>();
     scene->getLoadCompleteInfo().SetGeometryLoaded();
     scene->getLoadCompleteInfo().SetTextureLoaded();
+    initView();
+
+    mInstanceCuller      = std::make_unique<InstanceCuller>();
+    mClusterCuller       = std::make_unique<ClusterCuller>(*mInstanceCuller);
+    mNaniteRasterization = std::make_unique<NaniteRasteriztion>(*mInstanceCuller, *mClusterCuller);
+    mInstanceCuller->init();
+    mClusterCuller->init();
+    mNaniteRasterization->init();
+    if (!mNaniteMesh)
+        return;
+    mClusterCuller->setMesh(*mNaniteMesh);
+    mNaniteRasterization->setMesh(*mNaniteMesh);
+    updateInstances();
+
+    //Whole first row of the grid in front of the camera
+    BBox bounds = mNaniteMesh->getBounds();
+    camera->setTranslation(glm::vec3(bounds.center().x, bounds.center().y, bounds.min().z - bounds.maxExtent() * 2.0f));
+}
+void TinyNanite::updateInstances() {
+    BBox                   bounds  = mNaniteMesh->getBounds();
+    float                  spacing = bounds.maxExtent() * 1.25f;
+    std::vector<glm::mat4> transforms;
+    for (int z = 0; z < mInstanceGridSize; z++)
+        for (int x = 0; x < mInstanceGridSize; x++)
+            transforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3((x - (mInstanceGridSize - 1) * 0.5f) * spacing, 0.0f, z * spacing)));
+    mInstanceCuller->setInstances(*mNaniteMesh, transforms);
 }
 void TinyNanite::onUpdateGUI() {
     Application::onUpdateGUI();
+    if (!mNaniteMesh)
+        return;
+    if (ImGui::SliderInt("Instance grid", &mInstanceGridSize, 1, 32))
+        updateInstances();
+    mInstanceCuller->updateGui();
+    mClusterCuller->updateGui();
+    mNaniteRasterization->updateGui();
 }
 
 MAIN(TinyNanite)
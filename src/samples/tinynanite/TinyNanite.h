@@ -1,5 +1,9 @@
 #pragma once
 #include "App/Application.h"
+#include "ClusterCuller.h"
+#include "InstanceCuller.h"
+#include "NaniteMesh.h"
+#include "NaniteRasteriztion.h"
 
 class TinyNanite : public Application {
     public:
@@ -7,5 +11,14 @@ class TinyNanite : public Application {
     void prepare() override;
     void onUpdateGUI() override;
 protected:
-    std::unique_ptr<Primitive> mPrimitive;
-};
\ No newline at end of file
+    //Grid of copies of the mesh, instances out of view or hidden behind the others are culled
+    void updateInstances();
+
+    std::unique_ptr<Primitive>  mPrimitive;
+    std::unique_ptr<NaniteMesh> mNaniteMesh;
+
+    std::unique_ptr<InstanceCuller>     mInstanceCuller;
+    std::unique_ptr<ClusterCuller>      mClusterCuller;
+    std::unique_ptr<NaniteRasteriztion> mNaniteRasterization;
+    int                                 mInstanceGridSize{4};
+};
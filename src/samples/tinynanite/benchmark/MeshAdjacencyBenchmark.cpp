@@ -0,0 +1,170 @@
+#include "MeshAdjacency.h"
+#include "NaniteBuilder.h"
+
+#include "Common/FIleUtils.h"
+#include "Common/Log.h"
+#include "Common/Timer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <set>
+#include <unordered_map>
+
+//Builds the edge adjacency of the bunny and jinx meshes, or of the objs given as arguments, with the set and hash map
+//structures the builder used before MeshAdjacency and with the CSR one. Reports the best time of a few runs, the peak
+//heap usage during the build and the memory the result keeps. The CSR neighbours are checked against the sets
+
+static size_t g_allocatedBytes = 0;
+static size_t g_peakBytes      = 0;
+
+//Every allocation carries its size in front so delete can account for it
+static constexpr size_t AllocationHeader = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+    auto* block = static_cast<unsigned char*>(std::malloc(size + AllocationHeader));
+    if (!block)
+        throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(block) = size;
+    g_allocatedBytes += size;
+    g_peakBytes = std::max(g_peakBytes, g_allocatedBytes);
+    return block + AllocationHeader;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer)
+        return;
+    auto* block = static_cast<unsigned char*>(pointer) - AllocationHeader;
+    g_allocatedBytes -= *reinterpret_cast<size_t*>(block);
+    std::free(block);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void  operator delete[](void* pointer) noexcept { operator delete(pointer); }
+void  operator delete(void* pointer, size_t) noexcept { operator delete(pointer); }
+void  operator delete[](void* pointer, size_t) noexcept { operator delete(pointer); }
+
+//Previous position keyed builder, one std::set per corner filled through a map from edge hash to corners
+static std::vector<std::set<uint32_t>> BuildLegacyPositionAdjacency(std::span<const uint32_t> vertexKeys) {
+    std::vector<std::set<uint32_t>>                   adjacency(vertexKeys.size());
+    std::unordered_map<size_t, std::vector<uint32_t>> edgeHash;
+    for (uint32_t corner = 0; corner < vertexKeys.size(); corner++) {
+        uint32_t key0 = vertexKeys[corner];
+        uint32_t key1 = vertexKeys[cycle3(corner)];
+        auto     it   = edgeHash.find(size_t(key0) | (size_t(key1) << 32));
+        if (it != edgeHash.end()) {
+            for (uint32_t other : it->second) {
+                adjacency[corner].insert(other);
+                adjacency[other].insert(corner);
+            }
+        }
+        edgeHash[size_t(key1) | (size_t(key0) << 32)].push_back(corner);
+    }
+    return adjacency;
+}
+
+//Previous index keyed builder, one hash map of outgoing edges per vertex
+static std::vector<std::unordered_map<uint32_t, int>> BuildLegacyIndexAdjacency(std::span<const uint32_t> indices, uint32_t vertexCount) {
+    std::vector<std::unordered_map<uint32_t, int>> adjacency(vertexCount);
+    for (uint32_t corner = 0; corner < indices.size(); corner++)
+        adjacency[indices[corner]][indices[cycle3(corner)]] = corner / 3;
+    return adjacency;
+}
+
+static size_t CountLegacyPairs(const std::vector<std::set<uint32_t>>& adjacency) {
+    size_t count = 0;
+    for (const auto& neighbors : adjacency)
+        count += neighbors.size();
+    return count;
+}
+
+static size_t CountLegacyPairs(const std::vector<std::unordered_map<uint32_t, int>>& adjacency) {
+    size_t count = 0;
+    for (uint32_t from = 0; from < adjacency.size(); from++)
+        for (const auto& [to, face] : adjacency[from])
+            count += adjacency[to].contains(from);
+    return count;
+}
+
+struct BenchmarkResult {
+    double ms{std::numeric_limits<double>::max()};
+    size_t peakBytes{0};
+    size_t retainedBytes{0};
+    size_t pairs{0};
+};
+
+//Best time of a few runs, the memory of the last one
+template<typename Build, typename Count>
+static BenchmarkResult Run(Build&& build, Count&& count) {
+    BenchmarkResult result;
+    for (int run = 0; run < 3; run++) {
+        size_t baseline = g_allocatedBytes;
+        g_peakBytes     = baseline;
+        Timer timer;
+        timer.start();
+        auto adjacency   = build();
+        result.ms        = std::min(result.ms, timer.stop<Timer::Milliseconds>());
+        result.peakBytes = g_peakBytes - baseline;
+        result.retainedBytes = g_allocatedBytes - baseline;
+        result.pairs         = count(adjacency);
+    }
+    return result;
+}
+
+static void Report(const char* name, const BenchmarkResult& result) {
+    LOGI("  {:<22} {:>9.2f} ms peak {:>8.2f} MB retained {:>8.2f} MB {:>10} adjacent pairs", name, result.ms, result.peakBytes / (1024.0 * 1024.0), result.retainedBytes / (1024.0 * 1024.0), result.pairs);
+}
+
+static bool BenchmarkMesh(const std::string& path) {
+    auto input = NaniteBuilder::createMeshInputData(path);
+    if (!input || input->TriangleIndices.empty()) {
+        LOGE("No mesh at {}", path);
+        return false;
+    }
+    const auto& indices   = input->TriangleIndices;
+    const auto& positions = input->Vertices.Positions;
+
+    std::vector<uint32_t> positionKeys(indices.size());
+    for (uint32_t corner = 0; corner < indices.size(); corner++)
+        positionKeys[corner] = HashPosition(positions[indices[corner]]);
+
+    LOGI("{}: {} triangles, {} vertices", path, indices.size() / 3, positions.size());
+
+    auto countCsr = [](const MeshAdjacency& adjacency) { return size_t(adjacency.adjacency.size()); };
+    auto legacyPosition = Run([&] { return BuildLegacyPositionAdjacency(positionKeys); }, [](const auto& adjacency) { return CountLegacyPairs(adjacency); });
+    auto csrPosition    = Run([&] { return BuildMeshAdjacency(positionKeys); }, countCsr);
+    auto legacyIndex    = Run([&] { return BuildLegacyIndexAdjacency(indices, positions.size()); }, [](const auto& adjacency) { return CountLegacyPairs(adjacency); });
+    auto csrIndex       = Run([&] { return BuildMeshAdjacency(indices); }, countCsr);
+
+    Report("position sets", legacyPosition);
+    Report("position csr", csrPosition);
+    Report("index hash maps", legacyIndex);
+    Report("index csr", csrIndex);
+    LOGI("  speedup position {:.2f}x index {:.2f}x", legacyPosition.ms / csrPosition.ms, legacyIndex.ms / csrIndex.ms);
+
+    //Both hold every neighbour once in ascending order
+    auto legacy = BuildLegacyPositionAdjacency(positionKeys);
+    auto csr    = BuildMeshAdjacency(positionKeys);
+    for (uint32_t corner = 0; corner < csr.getCornerCount(); corner++) {
+        auto neighbors = csr.getNeighbors(corner);
+        if (!std::equal(neighbors.begin(), neighbors.end(), legacy[corner].begin(), legacy[corner].end())) {
+            LOGE("  Adjacency of corner {} differs from the legacy builder", corner);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+        paths.emplace_back(argv[i]);
+    if (paths.empty())
+        paths = {FileUtils::getResourcePath("tiny_nanite/bunny_simple.obj"), FileUtils::getResourcePath("tiny_nanite/jinx-combined.obj")};
+
+    bool matching = true;
+    for (const auto& path : paths)
+        matching &= BenchmarkMesh(path);
+    return matching ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#include "NaniteBuilder.h"
+
+#include "Common/Log.h"
+#include "Common/Timer.h"
+#include "Common/samplerCPP/ThreadPool.h"
+
+#include <cstring>
+
+//Times NaniteBuilder::Build against the thread count on the example mesh, or on the obj given as first argument.
+//Every deterministic build is compared with the single thread one, the cooked output must not depend on the threads
+
+template<typename T>
+static bool SameData(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+static bool SameOutput(const NaniteMeshData& a, const NaniteMeshData& b) {
+    return SameData(a.clusters, b.clusters) && SameData(a.groups, b.groups) && SameData(a.groupClusters, b.groupClusters) &&
+           SameData(a.nodes, b.nodes) && SameData(a.vertices, b.vertices) && SameData(a.indices, b.indices) && a.rootNode == b.rootNode;
+}
+
+int main(int argc, char** argv) {
+    auto input = argc > 1 ? NaniteBuilder::createMeshInputData(argv[1]) : NaniteBuilder::createNaniteExampleMeshInputData();
+    if (!input || input->TriangleIndices.empty()) {
+        LOGE("No mesh to build");
+        return 1;
+    }
+
+    uint32_t maxThreads = ThreadPool::GetThreadPool().size();
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double         triangleMillions = input->TriangleIndices.size() / 3 / 1e6;
+    double         singleThreadMs   = 0;
+    NaniteMeshData reference;
+    bool           deterministic = true;
+    for (uint32_t threads : threadCounts) {
+        //Build may modify its input, every run starts from the same copy
+        MeshInputData  runInput = *input;
+        NaniteMeshData output;
+        Timer          timer;
+        timer.start();
+        NaniteBuilder::Build(runInput, nullptr, {.Deterministic = true, .MaxThreads = threads}, output);
+        double ms = timer.stop<Timer::Milliseconds>();
+
+        if (threads == 1) {
+            singleThreadMs = ms;
+            reference      = std::move(output);
+        } else if (!SameOutput(reference, output)) {
+            deterministic = false;
+            LOGE("Build on {} threads differs from the single thread build", threads);
+        }
+        LOGI("{:>3} threads {:>10.1f} ms {:>10.1f} ms per million triangles speedup {:.2f}x", threads, ms, ms / triangleMillions, singleThreadMs / ms);
+    }
+    LOGI("{} triangles, {} clusters, {} groups", input->TriangleIndices.size() / 3, reference.clusters.size(), reference.groups.size());
+    return deterministic ? 0 : 1;
+}